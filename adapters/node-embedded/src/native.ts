@@ -1,4 +1,4 @@
-const native = require("../build/Release/kyntrix_agent.node") as {
+const native = require(process.env.KYNTRIX_AGENT_ADDON ?? "../build/Release/kyntrix_agent.node") as {
   init(config: {
     ingestUrl: string;
     runId: string;
@@ -17,8 +17,22 @@ const native = require("../build/Release/kyntrix_agent.node") as {
     dataJson?: string | null;
   }): void;
 
+  intern(s: string): number;
+
+  recordInterned(
+    seq: number,
+    ts: number,
+    kindId: number,
+    nodeKeyId: number,
+    span: string | null,
+    parentSpan: string | null,
+    dataJson: string | null,
+    runId?: string | null
+  ): void;
+
   flush(): void;
   shutdown(): void;
+  stats(): NativeStats;
 };
 
 export type NativeAgentConfig = {
@@ -39,6 +53,14 @@ export type NativeEvent = {
   dataJson?: string | null;
 };
 
+export type NativeStats = {
+  recorded: number;
+  dropped: number;
+  sent: number;
+  wireBytes: number;
+  rawBytes: number;
+};
+
 // Called once per process to configure C++ agent_core
 export function nativeInit(cfg: NativeAgentConfig) {
   native.init({
@@ -54,6 +76,29 @@ export function nativeRecord(ev: NativeEvent) {
   native.record(ev);
 }
 
+// Kinds and node keys repeat, so callers intern them once and pass the id
+export function nativeIntern(s: string): number {
+  return native.intern(s);
+}
+
+// nodeKeyId 0 = no node key
+export function nativeRecordInterned(
+  seq: number,
+  ts: number,
+  kindId: number,
+  nodeKeyId: number,
+  span: string | null,
+  parentSpan: string | null,
+  dataJson: string | null,
+  runId: string | null
+) {
+  native.recordInterned(seq, ts, kindId, nodeKeyId, span, parentSpan, dataJson, runId);
+}
+
+export function nativeStats(): NativeStats {
+  return native.stats();
+}
+
 export function nativeFlush() {
   native.flush();
 }
@@ -0,0 +1,100 @@
+// adapters/node-embedded/src/otel/channelExporter.ts
+import { record, flush, shutdown } from "../sdk";
+
+// The parts of an OpenTelemetry ReadableSpan used here; field names differ
+// between sdk-trace-base 1.x and 2.x
+type HrTime = [number, number];
+
+type Span = {
+  name: string;
+  kind: number;  // SpanKind: 0 = INTERNAL, 1 = SERVER, 2 = CLIENT, 3 = PRODUCER, 4 = CONSUMER
+  spanContext(): { traceId: string; spanId: string };
+  parentSpanId?: string;
+  parentSpanContext?: { spanId: string };
+  startTime: HrTime;
+  endTime: HrTime;
+  attributes: Record<string, unknown>;
+  status: { code: number; message?: string };  // 2 = ERROR
+  events: { name: string; time: HrTime; attributes?: Record<string, unknown> }[];
+  instrumentationLibrary?: { name: string };
+  instrumentationScope?: { name: string };
+};
+
+const SUCCESS = 0;
+
+function hrToMs(t: HrTime): number {
+  return t[0] * 1000 + Math.floor(t[1] / 1e6);
+}
+
+// Same classification as servers/agents/transforms/otlpToTal.ts
+function spanType(span: Span): string {
+  const a = span.attributes;
+  if (a["http.method"] || a["http.url"]) return "http";
+  if (a["db.system"] || a["db.statement"]) return "database";
+  if (a["rpc.system"] || a["rpc.method"]) return "rpc";
+
+  switch (span.kind) {
+    case 1: return "server";
+    case 2: return "client";
+    case 3: return "producer";
+    case 4: return "consumer";
+    default: return "internal";
+  }
+}
+
+// SpanExporter that emits each finished span as the TAL events otlpToTal()
+// would produce (call_start, event / error, call_end) through agent_core,
+// which sends them over the container's telemetry channel
+export class ChannelSpanExporter {
+  export(spans: Span[], resultCallback: (result: { code: number }) => void) {
+    for (const span of spans) {
+      const ctx = span.spanContext();
+      const parentSpan = span.parentSpanContext?.spanId ?? span.parentSpanId ?? undefined;
+      const start = hrToMs(span.startTime);
+      const end = hrToMs(span.endTime);
+      const scope = (span.instrumentationScope ?? span.instrumentationLibrary)?.name ?? "unknown";
+
+      record("call_start", {
+        ts: start,
+        span: ctx.spanId,
+        parentSpan,
+        nodeKey: span.name,
+        data: { type: spanType(span), scope, traceId: ctx.traceId, ...span.attributes },
+      });
+
+      for (const ev of span.events) {
+        record(ev.name === "exception" ? "error" : "event", {
+          ts: hrToMs(ev.time),
+          span: ctx.spanId,
+          parentSpan,
+          nodeKey: ev.name,
+          data: ev.attributes ?? {},
+        });
+      }
+
+      const isError = span.status.code === 2;
+      record("call_end", {
+        ts: end,
+        span: ctx.spanId,
+        parentSpan,
+        nodeKey: span.name,
+        data: {
+          durationMs: end - start,
+          status: isError ? "ERROR" : "OK",
+          statusMessage: span.status.message || null,
+        },
+      });
+    }
+    resultCallback({ code: SUCCESS });
+  }
+
+  forceFlush(): Promise<void> {
+    flush();
+    return Promise.resolve();
+  }
+
+  shutdown(): Promise<void> {
+    shutdown();
+    return Promise.resolve();
+  }
+}
@@ -0,0 +1,26 @@
+// adapters/node-embedded/src/otel/register.ts
+//
+// Loaded with --require in kyntrixd containers that have a telemetry channel
+// (KYNTRIXD_NODE_OTEL_HOOK); replaces
+// @opentelemetry/auto-instrumentations-node/register, using the same
+// instrumentations but exporting through agent_core instead of OTLP/HTTP.
+import { configure } from "../sdk";
+import { ChannelSpanExporter } from "./channelExporter";
+
+// Provided by the container image alongside auto-instrumentations-node
+const { NodeSDK, tracing } = require("@opentelemetry/sdk-node");
+const { getNodeAutoInstrumentations } = require("@opentelemetry/auto-instrumentations-node");
+
+configure();
+
+// Exporting is only a push into agent_core's ring, so spans need not be
+// batched again on the JS side
+const sdk = new NodeSDK({
+  spanProcessors: [new tracing.SimpleSpanProcessor(new ChannelSpanExporter())],
+  instrumentations: [getNodeAutoInstrumentations()],
+});
+sdk.start();
+
+process.once("beforeExit", () => {
+  void sdk.shutdown();
+});
@@ -1,9 +1,21 @@
 // adapters/node-embedded/src/sdk.ts
-import { nativeInit, nativeRecord, nativeFlush, nativeShutdown, NativeEvent } from "./native";
+import { nativeInit, nativeIntern, nativeRecordInterned, nativeFlush, nativeShutdown, nativeStats } from "./native";
 
 let initialized = false;
 let seqCounter = 1;
 
+// kind / nodeKey -> agent_core string id
+const internedIds = new Map<string, number>();
+
+function internId(s: string): number {
+  let id = internedIds.get(s);
+  if (id === undefined) {
+    id = nativeIntern(s);
+    internedIds.set(s, id);
+  }
+  return id;
+}
+
 function nowMs(): number {
   return Date.now();
 }
@@ -39,6 +51,7 @@ export function record(
     nodeKey?: string;
     data?: unknown;
     runId?: string;
+    ts?: number;
   }
 ) {
   if (!initialized) {
@@ -47,18 +60,16 @@ export function record(
     return;
   }
 
-  const ev: NativeEvent = {
-    runId: opts?.runId ?? null,
-    seq: nextSeq(),
-    ts: nowMs(),
-    kind,
-    span: opts?.span ?? null,
-    parentSpan: opts?.parentSpan ?? null,
-    nodeKey: opts?.nodeKey ?? null,
-    dataJson: opts?.data ? JSON.stringify(opts.data) : null,
-  };
-
-  nativeRecord(ev);
+  nativeRecordInterned(
+    nextSeq(),
+    opts?.ts ?? nowMs(),
+    internId(kind),
+    opts?.nodeKey != null ? internId(opts.nodeKey) : 0,
+    opts?.span ?? null,
+    opts?.parentSpan ?? null,
+    opts?.data ? JSON.stringify(opts.data) : null,
+    opts?.runId ?? null
+  );
 }
 
 export function flush() {
@@ -66,6 +77,10 @@ export function flush() {
   nativeFlush();
 }
 
+export function stats() {
+  return initialized ? nativeStats() : null;
+}
+
 export function shutdown() {
   if (!initialized) return;
   nativeShutdown();
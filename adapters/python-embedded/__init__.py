@@ -2,13 +2,29 @@ import os
 import itertools
 import time
 import json
-from .binding import init_agent as _init_agent, record_event as _record_event, flush as _flush, shutdown as _shutdown
+from .binding import (
+    init_agent as _init_agent,
+    intern as _intern,
+    record_interned as _record_interned,
+    stats as _stats,
+    flush as _flush,
+    shutdown as _shutdown,
+)
 
-__all__ = ["configure", "record", "flush", "shutdown"]
+__all__ = ["configure", "record", "flush", "shutdown", "stats"]
 
 _seq_counter = itertools.count(1)
 _initialized = False
 
+# kind / node_key -> agent_core string id
+_ids: dict[str, int] = {}
+
+def _id(s: str) -> int:
+    i = _ids.get(s)
+    if i is None:
+        i = _ids[s] = _intern(s)
+    return i
+
 def now_ms() -> int:
     return int(time.time() * 1000)
 
@@ -43,23 +59,24 @@ def record(
     node_key: str | None = None,
     data: dict | None = None,
     run_id: str | None = None,
+    ts: int | None = None,
 ) -> None:
     if not _initialized:
         # You can raise if you want strict behavior:
         # raise RuntimeError("Kyntrix agent not configured. Call configure() first.")
         return
 
-    data_json = json.dumps(data) if data is not None else None
+    data_json = json.dumps(data).encode("utf-8") if data is not None else None
 
-    _record_event(
-        run_id=run_id,
+    _record_interned(
         seq=_next_seq(),
-        ts=now_ms(),
-        kind=kind,
+        ts=ts if ts is not None else now_ms(),
+        kind_id=_id(kind),
+        node_key_id=_id(node_key) if node_key is not None else 0,
         span=span,
         parent_span=parent_span,
-        node_key=node_key,
         data_json=data_json,
+        run_id=run_id,
     )
 
 def flush() -> None:
@@ -67,6 +84,11 @@ def flush() -> None:
         return
     _flush()
 
+def stats() -> dict | None:
+    if not _initialized:
+        return None
+    return _stats()
+
 def shutdown() -> None:
     if not _initialized:
         return
@@ -2,7 +2,7 @@
 import os
 import sys
 import ctypes
-from ctypes import c_char_p, c_longlong, c_int, Structure, POINTER
+from ctypes import c_char_p, c_longlong, c_int, c_uint32, c_size_t, c_uint64, Structure, POINTER
 
 def _default_lib_name() -> str:
     if sys.platform == "win32":
@@ -35,12 +35,32 @@ class KyntrixEvent(Structure):
         ("data_json", c_char_p),
     ]
 
+class KyntrixAgentStats(Structure):
+    _fields_ = [
+        ("recorded", c_uint64),
+        ("dropped", c_uint64),
+        ("sent", c_uint64),
+        ("wire_bytes", c_uint64),
+        ("raw_bytes", c_uint64),
+    ]
+
 _lib.kyntrix_agent_init.argtypes    = [POINTER(KyntrixAgentConfig)]
 _lib.kyntrix_agent_init.restype     = None
 
 _lib.kyntrix_agent_record.argtypes  = [POINTER(KyntrixEvent)]
 _lib.kyntrix_agent_record.restype   = None
 
+_lib.kyntrix_agent_intern.argtypes  = [c_char_p]
+_lib.kyntrix_agent_intern.restype   = c_uint32
+
+_lib.kyntrix_agent_record_interned.argtypes = [
+    c_longlong, c_longlong, c_uint32, c_uint32, c_char_p, c_char_p, c_char_p, c_size_t, c_char_p,
+]
+_lib.kyntrix_agent_record_interned.restype  = None
+
+_lib.kyntrix_agent_stats.argtypes   = [POINTER(KyntrixAgentStats)]
+_lib.kyntrix_agent_stats.restype    = None
+
 _lib.kyntrix_agent_flush.argtypes   = []
 _lib.kyntrix_agent_flush.restype    = None
 
@@ -90,6 +110,37 @@ def record_event(
     )
     _lib.kyntrix_agent_record(ctypes.byref(ev))
 
+def intern(s: str) -> int:
+    """Interns a kind or node key; ids are never 0."""
+    return _lib.kyntrix_agent_intern(s.encode("utf-8"))
+
+def record_interned(
+    seq: int,
+    ts: int,
+    kind_id: int,
+    node_key_id: int = 0,
+    span: str | None = None,
+    parent_span: str | None = None,
+    data_json: bytes | None = None,
+    run_id: str | None = None,
+) -> None:
+    _lib.kyntrix_agent_record_interned(
+        seq,
+        ts,
+        kind_id,
+        node_key_id,
+        span.encode("utf-8") if span is not None else None,
+        parent_span.encode("utf-8") if parent_span is not None else None,
+        data_json,
+        len(data_json) if data_json is not None else 0,
+        run_id.encode("utf-8") if run_id is not None else None,
+    )
+
+def stats() -> dict:
+    out = KyntrixAgentStats()
+    _lib.kyntrix_agent_stats(ctypes.byref(out))
+    return {name: getattr(out, name) for name, _ in KyntrixAgentStats._fields_}
+
 def flush() -> None:
     _lib.kyntrix_agent_flush()
 
@@ -0,0 +1,94 @@
+# adapters/python-embedded/kyntrix_agent/otel_exporter.py
+#
+# OpenTelemetry span exporter for kyntrixd containers with a telemetry
+# channel. opentelemetry-instrument loads it as OTEL_TRACES_EXPORTER=kyntrix
+# (entry point in pyproject.toml); spans are emitted as the TAL events
+# servers/agents/transforms/otlpToTal.ts would produce and sent through
+# agent_core over the channel instead of OTLP/HTTP.
+from typing import Sequence
+
+from opentelemetry.sdk.trace import ReadableSpan
+from opentelemetry.sdk.trace.export import SpanExporter, SpanExportResult
+from opentelemetry.trace import SpanKind, StatusCode
+
+from . import configure, record, flush, shutdown
+
+_KIND_TYPES = {
+    SpanKind.SERVER: "server",
+    SpanKind.CLIENT: "client",
+    SpanKind.PRODUCER: "producer",
+    SpanKind.CONSUMER: "consumer",
+}
+
+def _span_type(span: ReadableSpan) -> str:
+    attrs = span.attributes or {}
+    if attrs.get("http.method") or attrs.get("http.url"):
+        return "http"
+    if attrs.get("db.system") or attrs.get("db.statement"):
+        return "database"
+    if attrs.get("rpc.system") or attrs.get("rpc.method"):
+        return "rpc"
+    return _KIND_TYPES.get(span.kind, "internal")
+
+def _span_id(span_id: int) -> str:
+    return format(span_id, "016x")
+
+class ChannelSpanExporter(SpanExporter):
+    # agent_core is configured on the first export rather than here: in the
+    # Python zygote (zygote.py) the exporter is built before the fork, and the
+    # telemetry channel and flush thread belong to each forked run
+    def export(self, spans: Sequence[ReadableSpan]) -> SpanExportResult:
+        configure()
+        for span in spans:
+            ctx = span.get_span_context()
+            span_id = _span_id(ctx.span_id)
+            parent = _span_id(span.parent.span_id) if span.parent else None
+            start = span.start_time // 1_000_000
+            end = span.end_time // 1_000_000
+            scope = span.instrumentation_scope.name if span.instrumentation_scope else "unknown"
+
+            record(
+                "call_start",
+                span=span_id,
+                parent_span=parent,
+                node_key=span.name,
+                data={
+                    "type": _span_type(span),
+                    "scope": scope,
+                    "traceId": format(ctx.trace_id, "032x"),
+                    **dict(span.attributes or {}),
+                },
+                ts=start,
+            )
+
+            for ev in span.events:
+                record(
+                    "error" if ev.name == "exception" else "event",
+                    span=span_id,
+                    parent_span=parent,
+                    node_key=ev.name,
+                    data=dict(ev.attributes or {}),
+                    ts=ev.timestamp // 1_000_000,
+                )
+
+            is_error = span.status.status_code == StatusCode.ERROR
+            record(
+                "call_end",
+                span=span_id,
+                parent_span=parent,
+                node_key=span.name,
+                data={
+                    "durationMs": end - start,
+                    "status": "ERROR" if is_error else "OK",
+                    "statusMessage": span.status.description or None,
+                },
+                ts=end,
+            )
+        return SpanExportResult.SUCCESS
+
+    def force_flush(self, timeout_millis: int = 30000) -> bool:
+        flush()
+        return True
+
+    def shutdown(self) -> None:
+        shutdown()
@@ -0,0 +1,96 @@
+# adapters/python-embedded/kyntrix_agent/zygote.py
+#
+# Fork server for kyntrixd's Python template (runtime/container/ct_zygote.h).
+# kyntrixd starts it as `opentelemetry-instrument python -m kyntrix_agent.zygote`,
+# so the SDK, the instrumentations and KYNTRIX_ZYGOTE_PRELOAD are imported
+# once. Each run is forked from here by libkyntrix_zygote.so into its own
+# namespaces and then runs its entry script as `python script.py` would.
+import ctypes
+import importlib
+import os
+import runpy
+import sys
+from ctypes import c_char_p, c_int
+
+LIB_PATH = os.getenv("KYNTRIX_ZYGOTE_LIB", "libkyntrix_zygote.so")
+
+# Blocking calls release the GIL; the fork must hold it, as os.fork() does
+_lib = ctypes.CDLL(LIB_PATH)
+_fork_lib = ctypes.PyDLL(LIB_PATH)
+_api = ctypes.pythonapi
+
+_lib.kyntrix_zygote_ready.argtypes = []
+_lib.kyntrix_zygote_ready.restype  = c_int
+_lib.kyntrix_zygote_wait.argtypes  = []
+_lib.kyntrix_zygote_wait.restype   = c_int
+_lib.kyntrix_zygote_run_id.argtypes = []
+_lib.kyntrix_zygote_run_id.restype  = c_char_p
+_lib.kyntrix_zygote_entry.argtypes  = []
+_lib.kyntrix_zygote_entry.restype   = c_char_p
+
+_fork_lib.kyntrix_zygote_fork.argtypes = []
+_fork_lib.kyntrix_zygote_fork.restype  = c_int
+
+for _name in ("PyOS_BeforeFork", "PyOS_AfterFork_Parent", "PyOS_AfterFork_Child"):
+    getattr(_api, _name).argtypes = []
+    getattr(_api, _name).restype = None
+
+def _preload() -> None:
+    for name in os.getenv("KYNTRIX_ZYGOTE_PRELOAD", "").split(","):
+        name = name.strip()
+        if not name:
+            continue
+        try:
+            importlib.import_module(name)
+        except Exception as e:
+            print(f"[kyntrix-zygote] preload {name} failed: {e!r}", file=sys.stderr)
+
+def _fork() -> int:
+    _api.PyOS_BeforeFork()
+    pid = _fork_lib.kyntrix_zygote_fork()
+    if pid == 0:
+        _api.PyOS_AfterFork_Child()
+    else:
+        _api.PyOS_AfterFork_Parent()
+    return pid
+
+def _bind_resource(run_id: str) -> None:
+    # The tracer provider, and every tracer the instrumentations took from it,
+    # share the Resource built before the fork; add the run's id to it in place
+    try:
+        from opentelemetry import trace
+    except ImportError:
+        return
+    try:
+        resource = getattr(trace.get_tracer_provider(), "resource", None)
+        if resource is not None:
+            resource.attributes._dict["kyntrix.run_id"] = run_id
+    except Exception as e:
+        print(f"[kyntrix-zygote] cannot set kyntrix.run_id on the resource: {e!r}", file=sys.stderr)
+
+def _run(run_id: str, entry: str) -> None:
+    os.environ["OTEL_RESOURCE_ATTRIBUTES"] = f"kyntrix.run_id={run_id}"
+    os.environ["KYNTRIX_RUN_ID"] = run_id
+    _bind_resource(run_id)
+
+    sys.argv = [entry]
+    sys.path[0] = os.path.dirname(entry)
+    runpy.run_path(entry, run_name="__main__")
+
+def main() -> None:
+    _preload()
+
+    if _lib.kyntrix_zygote_ready() != 0:
+        print("[kyntrix-zygote] KYNTRIX_ZYGOTE_FD is not a control socket", file=sys.stderr)
+        sys.exit(1)
+
+    # Returns when kyntrixd closes the control socket
+    while _lib.kyntrix_zygote_wait() == 1:
+        if _fork() == 0:
+            run_id = _lib.kyntrix_zygote_run_id().decode("utf-8")
+            entry = _lib.kyntrix_zygote_entry().decode("utf-8")
+            _run(run_id, entry)
+            return
+
+if __name__ == "__main__":
+    main()
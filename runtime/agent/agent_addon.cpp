@@ -0,0 +1,209 @@
+#define NAPI_VERSION 8
+#include "agent_core.h"
+#include <node_api.h>
+#include <string>
+
+// Node-API binding for adapters/node-embedded/src/native.ts:
+//   init({ ingestUrl, runId, batchSize, flushIntervalMs })
+//   record({ runId?, seq, ts, kind, span?, parentSpan?, nodeKey?, dataJson? })
+//   intern(s: string): number
+//   recordInterned(seq, ts, kindId, nodeKeyId, span, parentSpan, dataJson, runId?)
+//   flush(), shutdown()
+//   stats(): { recorded, dropped, sent, wireBytes, rawBytes }
+
+namespace {
+
+// A string argument as UTF-8; null / undefined leave ptr null
+class Utf8Arg {
+public:
+    bool read(napi_env env, napi_value v) {
+        ptr = nullptr;
+        len = 0;
+
+        napi_valuetype type;
+        if (napi_typeof(env, v, &type) != napi_ok) return false;
+        if (type == napi_null || type == napi_undefined) return true;
+        if (type != napi_string) return false;
+
+        // Most spans and payloads fit the stack buffer; longer ones are
+        // measured and read again
+        if (napi_get_value_string_utf8(env, v, m_stack, sizeof(m_stack), &len) != napi_ok) return false;
+        if (len < sizeof(m_stack) - 1) {
+            ptr = m_stack;
+            return true;
+        }
+
+        if (napi_get_value_string_utf8(env, v, nullptr, 0, &len) != napi_ok) return false;
+        m_heap.resize(len + 1);
+        napi_get_value_string_utf8(env, v, m_heap.data(), len + 1, &len);
+        ptr = m_heap.c_str();
+        return true;
+    }
+
+    const char* ptr = nullptr;
+    size_t len = 0;
+
+private:
+    char m_stack[512];
+    std::string m_heap;
+};
+
+bool read_number(napi_env env, napi_value v, double& out) {
+    return napi_get_value_double(env, v, &out) == napi_ok;
+}
+
+bool read_property(napi_env env, napi_value obj, const char* name, napi_value& out) {
+    bool has = false;
+    if (napi_has_named_property(env, obj, name, &has) != napi_ok || !has) return false;
+    return napi_get_named_property(env, obj, name, &out) == napi_ok;
+}
+
+bool read_string_property(napi_env env, napi_value obj, const char* name, Utf8Arg& out) {
+    napi_value v;
+    if (!read_property(env, obj, name, v)) {
+        out.ptr = nullptr;
+        return true;
+    }
+    return out.read(env, v);
+}
+
+napi_value undefined(napi_env env) {
+    napi_value v;
+    napi_get_undefined(env, &v);
+    return v;
+}
+
+napi_value init(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value cfg;
+    napi_get_cb_info(env, info, &argc, &cfg, nullptr, nullptr);
+
+    Utf8Arg url, run_id;
+    napi_value v;
+    double batch = 0, interval = 0;
+    if (argc < 1 || !read_string_property(env, cfg, "ingestUrl", url) ||
+        !read_string_property(env, cfg, "runId", run_id)) {
+        napi_throw_type_error(env, nullptr, "init expects { ingestUrl, runId, batchSize, flushIntervalMs }");
+        return nullptr;
+    }
+    if (read_property(env, cfg, "batchSize", v)) read_number(env, v, batch);
+    if (read_property(env, cfg, "flushIntervalMs", v)) read_number(env, v, interval);
+
+    std::string url_s = url.ptr ? url.ptr : "";
+    std::string run_s = run_id.ptr ? run_id.ptr : "";
+    KyntrixAgentConfig c{url_s.c_str(), run_s.c_str(), (int)batch, (int)interval};
+    kyntrix_agent_init(&c);
+    return undefined(env);
+}
+
+napi_value record(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value ev;
+    napi_get_cb_info(env, info, &argc, &ev, nullptr, nullptr);
+
+    Utf8Arg run_id, kind, span, parent, key, data;
+    napi_value v;
+    double seq = 0, ts = 0;
+    if (argc < 1 || !read_property(env, ev, "seq", v) || !read_number(env, v, seq) ||
+        !read_property(env, ev, "ts", v) || !read_number(env, v, ts) ||
+        !read_string_property(env, ev, "kind", kind) || !kind.ptr ||
+        !read_string_property(env, ev, "runId", run_id) ||
+        !read_string_property(env, ev, "span", span) ||
+        !read_string_property(env, ev, "parentSpan", parent) ||
+        !read_string_property(env, ev, "nodeKey", key) ||
+        !read_string_property(env, ev, "dataJson", data)) {
+        napi_throw_type_error(env, nullptr, "record expects a TAL event");
+        return nullptr;
+    }
+
+    KyntrixEvent e{run_id.ptr, (long long)seq, (long long)ts, kind.ptr, span.ptr, parent.ptr, key.ptr, data.ptr};
+    kyntrix_agent_record(&e);
+    return undefined(env);
+}
+
+napi_value intern(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value arg;
+    napi_get_cb_info(env, info, &argc, &arg, nullptr, nullptr);
+
+    Utf8Arg s;
+    if (argc < 1 || !s.read(env, arg) || !s.ptr) {
+        napi_throw_type_error(env, nullptr, "intern expects a string");
+        return nullptr;
+    }
+
+    napi_value result;
+    napi_create_uint32(env, kyntrix_agent_intern(s.ptr), &result);
+    return result;
+}
+
+napi_value record_interned(napi_env env, napi_callback_info info) {
+    size_t argc = 8;
+    napi_value argv[8];
+    napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr);
+
+    double seq, ts;
+    uint32_t kind, key;
+    Utf8Arg span, parent, data, run_id;
+    if (argc < 7 || !read_number(env, argv[0], seq) || !read_number(env, argv[1], ts) ||
+        napi_get_value_uint32(env, argv[2], &kind) != napi_ok ||
+        napi_get_value_uint32(env, argv[3], &key) != napi_ok ||
+        !span.read(env, argv[4]) || !parent.read(env, argv[5]) || !data.read(env, argv[6]) ||
+        (argc > 7 && !run_id.read(env, argv[7]))) {
+        napi_throw_type_error(env, nullptr,
+                              "recordInterned expects (seq, ts, kindId, nodeKeyId, span, parentSpan, dataJson, runId?)");
+        return nullptr;
+    }
+
+    kyntrix_agent_record_interned((long long)seq, (long long)ts, kind, key, span.ptr, parent.ptr,
+                                  data.ptr, data.len, run_id.ptr);
+    return undefined(env);
+}
+
+napi_value flush(napi_env env, napi_callback_info) {
+    kyntrix_agent_flush();
+    return undefined(env);
+}
+
+napi_value shutdown(napi_env env, napi_callback_info) {
+    kyntrix_agent_shutdown();
+    return undefined(env);
+}
+
+napi_value stats(napi_env env, napi_callback_info) {
+    KyntrixAgentStats s;
+    kyntrix_agent_stats(&s);
+
+    napi_value obj;
+    napi_create_object(env, &obj);
+
+    auto set = [&](const char* name, uint64_t n) {
+        napi_value v;
+        napi_create_double(env, (double)n, &v);
+        napi_set_named_property(env, obj, name, v);
+    };
+    set("recorded", s.recorded);
+    set("dropped", s.dropped);
+    set("sent", s.sent);
+    set("wireBytes", s.wire_bytes);
+    set("rawBytes", s.raw_bytes);
+    return obj;
+}
+
+napi_value module_init(napi_env env, napi_value exports) {
+    napi_property_descriptor fns[] = {
+        {"init", nullptr, init, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"record", nullptr, record, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"intern", nullptr, intern, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"recordInterned", nullptr, record_interned, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"flush", nullptr, flush, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"shutdown", nullptr, shutdown, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"stats", nullptr, stats, nullptr, nullptr, nullptr, napi_default, nullptr},
+    };
+    napi_define_properties(env, exports, sizeof(fns) / sizeof(fns[0]), fns);
+    return exports;
+}
+
+} // namespace
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, module_init)
@@ -0,0 +1,470 @@
+#include "agent_core.h"
+#include "agent_http.h"
+#include "agent_ring.h"
+#include "agent_wire.h"
+#include "tal_intern.h"
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+static constexpr size_t kDefaultRingBytes = 1 << 20;
+static constexpr size_t kMaxFrameRecords = 65536;
+static constexpr size_t kMaxPostBytes = 4 << 20;
+// One frame per message on the telemetry channel, kept below the socket
+// buffer kyntrixd gives it (ct_telemetry.h)
+static constexpr size_t kMaxChannelFrameBytes = 256 << 10;
+
+namespace {
+
+struct ThreadRing {
+    explicit ThreadRing(size_t bytes) : ring(bytes) {}
+
+    SpscRing ring;
+    std::atomic<bool> closed{false};
+};
+
+struct Agent {
+    std::string run_id;
+    HttpTarget target;
+    int channel_fd = -1;      // kyntrixd telemetry channel; HTTP when -1
+    uint32_t batch_size = 100;
+    std::chrono::milliseconds interval{1000};
+    size_t ring_bytes = kDefaultRingBytes;
+    bool zstd = false;
+
+    std::atomic<bool> running{false};
+
+    // Interned kinds / node keys; id = index + 1
+    std::mutex strings_mutex;
+    StringInterner strings;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::condition_variable done_cv;
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+    std::atomic<bool> wake{false};
+    bool stopping = false;
+    uint64_t flush_requested = 0;
+    uint64_t flush_done = 0;
+    std::thread flusher;
+
+    std::atomic<uint64_t> recorded{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> sent{0};
+    std::atomic<uint64_t> wire_bytes{0};
+    std::atomic<uint64_t> raw_bytes{0};
+
+    // A process that exits without kyntrix_agent_shutdown() still gets its
+    // last events sent
+    ~Agent() { kyntrix_agent_shutdown(); }
+};
+
+Agent g_agent;
+
+// Per traced thread: its ring, a lock-free view of the interned strings it
+// has used, and the buffer records are encoded into
+struct Producer {
+    std::shared_ptr<ThreadRing> ring;
+    std::unordered_map<std::string_view, uint32_t> ids;
+    std::string record;
+    uint32_t since_wake = 0;
+
+    ~Producer() {
+        if (ring) ring->closed.store(true, std::memory_order_release);
+    }
+};
+
+thread_local Producer t_producer;
+
+size_t round_pow2(size_t n) {
+    size_t p = 4096;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+void put_varint(std::string& out, uint64_t v) {
+    wire_put_varint(out, v);
+}
+
+void put_bytes(std::string& out, const char* p, size_t n) {
+    wire_put_varint(out, n);
+    out.append(p, n);
+}
+
+bool get_varint(const char*& p, const char* end, uint64_t& v) {
+    return wire_get_varint(p, end, v);
+}
+
+bool get_bytes(const char*& p, const char* end, std::string_view& out) {
+    uint64_t n;
+    if (!get_varint(p, end, n) || n > (uint64_t)(end - p)) return false;
+    out = std::string_view(p, n);
+    p += n;
+    return true;
+}
+
+uint32_t intern_locked(std::string_view s) {
+    std::lock_guard<std::mutex> lock(g_agent.strings_mutex);
+    return g_agent.strings.intern(s) + 1;
+}
+
+uint32_t intern_cached(const char* s) {
+    std::string_view v(s);
+    auto it = t_producer.ids.find(v);
+    if (it != t_producer.ids.end()) return it->second;
+
+    uint32_t id;
+    std::string_view stable;   // interned bytes never move
+    {
+        std::lock_guard<std::mutex> lock(g_agent.strings_mutex);
+        id = g_agent.strings.intern(v);
+        stable = g_agent.strings.str(id);
+    }
+    t_producer.ids.emplace(stable, id + 1);
+    return id + 1;
+}
+
+ThreadRing& producer_ring() {
+    if (!t_producer.ring) {
+        t_producer.ring = std::make_shared<ThreadRing>(g_agent.ring_bytes);
+        std::lock_guard<std::mutex> lock(g_agent.mutex);
+        g_agent.rings.push_back(t_producer.ring);
+    }
+    return *t_producer.ring;
+}
+
+// Producer record layout (ring only, not the wire format):
+//   u8 mask, varint seq, varint zigzag(ts), varint kind id,
+//   [bytes span] [bytes parentSpan] [varint nodeKey id] [bytes runId] [bytes data]
+void push_record(long long seq, long long ts, uint32_t kind, uint32_t node_key, const char* span,
+                 const char* parent_span, const char* data, size_t data_len, const char* run_id) {
+    if (!g_agent.running.load(std::memory_order_acquire)) return;
+
+    uint8_t mask = 0;
+    if (span) mask |= kWireSpan;
+    if (parent_span) mask |= kWireParentSpan;
+    if (node_key) mask |= kWireNodeKey;
+    if (run_id) mask |= kWireRunId;
+    if (data) mask |= kWireData;
+
+    std::string& r = t_producer.record;
+    r.clear();
+    r += (char)mask;
+    put_varint(r, (uint64_t)seq);
+    put_varint(r, wire_zigzag(ts));
+    put_varint(r, kind);
+    if (span) put_bytes(r, span, std::strlen(span));
+    if (parent_span) put_bytes(r, parent_span, std::strlen(parent_span));
+    if (node_key) put_varint(r, node_key);
+    if (run_id) put_bytes(r, run_id, std::strlen(run_id));
+    if (data) put_bytes(r, data, data_len);
+
+    ThreadRing& tr = producer_ring();
+    if (!tr.ring.push(r.data(), (uint32_t)r.size())) {
+        g_agent.dropped.fetch_add(1, std::memory_order_relaxed);
+        g_agent.wake.store(true, std::memory_order_relaxed);
+        g_agent.cv.notify_one();
+        return;
+    }
+    g_agent.recorded.fetch_add(1, std::memory_order_relaxed);
+
+    if (++t_producer.since_wake >= g_agent.batch_size) {
+        t_producer.since_wake = 0;
+        g_agent.wake.store(true, std::memory_order_relaxed);
+        g_agent.cv.notify_one();
+    }
+}
+
+// Flusher side: names for interned ids, refreshed from the shared table
+// only when an id has not been seen yet
+class NameCache {
+public:
+    std::string_view get(uint32_t id) {
+        if (id > m_names.size()) {
+            std::lock_guard<std::mutex> lock(g_agent.strings_mutex);
+            for (uint32_t i = (uint32_t)m_names.size(); i < g_agent.strings.size(); ++i) {
+                m_names.push_back(g_agent.strings.str(i));
+            }
+        }
+        return id - 1 < m_names.size() ? m_names[id - 1] : std::string_view();
+    }
+
+private:
+    std::vector<std::string_view> m_names;
+};
+
+bool decode_record(const char* p, uint32_t n, NameCache& names, WireRecord& r) {
+    const char* end = p + n;
+    uint64_t v;
+
+    r = WireRecord{};
+    if (p == end) return false;
+    r.mask = (uint8_t)*p++;
+
+    if (!get_varint(p, end, r.seq)) return false;
+    if (!get_varint(p, end, v)) return false;
+    r.ts = wire_unzigzag(v);
+    if (!get_varint(p, end, v)) return false;
+    r.kind = names.get((uint32_t)v);
+
+    if ((r.mask & kWireSpan) && !get_bytes(p, end, r.span)) return false;
+    if ((r.mask & kWireParentSpan) && !get_bytes(p, end, r.parent_span)) return false;
+    if (r.mask & kWireNodeKey) {
+        if (!get_varint(p, end, v)) return false;
+        r.node_key = names.get((uint32_t)v);
+    }
+    if ((r.mask & kWireRunId) && !get_bytes(p, end, r.run_id)) return false;
+    if ((r.mask & kWireData) && !get_bytes(p, end, r.data)) return false;
+    return true;
+}
+
+class Sender {
+public:
+    void add_frame(WireFrameWriter& frame) {
+        m_events += frame.count();
+        g_agent.raw_bytes.fetch_add(frame.raw_size(), std::memory_order_relaxed);
+
+        // kyntrixd reads channel frames uncompressed
+        if (g_agent.channel_fd >= 0) {
+            frame.finish(m_body, false);
+            send_channel();
+            return;
+        }
+        frame.finish(m_body, g_agent.zstd);
+        if (m_body.size() >= kMaxPostBytes) post();
+    }
+
+    void post() {
+        if (m_body.empty()) return;
+
+        std::string err;
+        int status = http_post(g_agent.target, "application/x-kyntrix-tal", m_body, err);
+        if (status >= 200 && status < 300) {
+            g_agent.sent.fetch_add(m_events, std::memory_order_relaxed);
+            g_agent.wire_bytes.fetch_add(m_body.size(), std::memory_order_relaxed);
+            m_failing = false;
+        } else {
+            g_agent.dropped.fetch_add(m_events, std::memory_order_relaxed);
+            if (!m_failing) {
+                std::cerr << "[kyntrix-agent] POST " << g_agent.target.path << " failed: "
+                          << (status < 0 ? err : "HTTP " + std::to_string(status))
+                          << "; dropping batches until it recovers\n";
+            }
+            m_failing = true;
+        }
+        m_body.clear();
+        m_events = 0;
+    }
+
+private:
+    // Blocks while the channel is full; the rings absorb the backlog and
+    // drop once they overflow
+    void send_channel() {
+        ssize_t n;
+        do {
+            n = ::send(g_agent.channel_fd, m_body.data(), m_body.size(), MSG_NOSIGNAL);
+        } while (n < 0 && errno == EINTR);
+
+        if (n == (ssize_t)m_body.size()) {
+            g_agent.sent.fetch_add(m_events, std::memory_order_relaxed);
+            g_agent.wire_bytes.fetch_add(m_body.size(), std::memory_order_relaxed);
+            m_failing = false;
+        } else {
+            g_agent.dropped.fetch_add(m_events, std::memory_order_relaxed);
+            if (!m_failing) {
+                std::cerr << "[kyntrix-agent] telemetry channel send failed: " << std::strerror(errno)
+                          << "; dropping batches until it recovers\n";
+            }
+            m_failing = true;
+        }
+        m_body.clear();
+        m_events = 0;
+    }
+
+    std::string m_body;
+    size_t m_events = 0;
+    bool m_failing = false;
+};
+
+void flush_cycle(NameCache& names, Sender& sender, std::string& scratch) {
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+    {
+        std::lock_guard<std::mutex> lock(g_agent.mutex);
+        rings = g_agent.rings;
+    }
+
+    std::unique_ptr<WireFrameWriter> frame;
+    WireRecord r;
+
+    for (auto& tr : rings) {
+        tr->ring.drain(scratch, [&](const char* p, uint32_t n) {
+            if (!decode_record(p, n, names, r)) return;
+            if (!frame) frame = std::make_unique<WireFrameWriter>(g_agent.run_id);
+            frame->add(r);
+            if (frame->count() >= kMaxFrameRecords ||
+                (g_agent.channel_fd >= 0 && frame->raw_size() >= kMaxChannelFrameBytes)) {
+                sender.add_frame(*frame);
+                frame.reset();
+            }
+        });
+    }
+    if (frame) sender.add_frame(*frame);
+    sender.post();
+
+    // Rings of exited threads go once they are empty
+    std::lock_guard<std::mutex> lock(g_agent.mutex);
+    auto& all = g_agent.rings;
+    for (size_t i = 0; i < all.size();) {
+        if (all[i]->closed.load(std::memory_order_acquire) && all[i]->ring.empty()) {
+            all[i] = all.back();
+            all.pop_back();
+        } else {
+            ++i;
+        }
+    }
+}
+
+void flusher_main() {
+    NameCache names;
+    Sender sender;
+    std::string scratch;
+
+    std::unique_lock<std::mutex> lock(g_agent.mutex);
+    while (true) {
+        g_agent.cv.wait_for(lock, g_agent.interval, [] {
+            return g_agent.stopping || g_agent.wake.load(std::memory_order_relaxed) ||
+                   g_agent.flush_requested > g_agent.flush_done;
+        });
+
+        uint64_t serving = g_agent.flush_requested;
+        bool stopping = g_agent.stopping;
+        g_agent.wake.store(false, std::memory_order_relaxed);
+
+        lock.unlock();
+        flush_cycle(names, sender, scratch);
+        lock.lock();
+
+        g_agent.flush_done = serving;
+        g_agent.done_cv.notify_all();
+        if (stopping) break;
+    }
+}
+
+size_t env_size(const char* name, size_t fallback) {
+    const char* v = std::getenv(name);
+    if (!v || !*v) return fallback;
+    char* end = nullptr;
+    unsigned long long n = std::strtoull(v, &end, 10);
+    return (end && *end == '\0' && n > 0) ? (size_t)n : fallback;
+}
+
+// Set by kyntrixd for processes inside its containers
+int channel_from_env() {
+    const char* v = std::getenv("KYNTRIX_TELEMETRY_FD");
+    if (!v || !*v) return -1;
+
+    char* end = nullptr;
+    long fd = std::strtol(v, &end, 10);
+    struct stat st;
+    if (*end != '\0' || fd < 0 || ::fstat((int)fd, &st) < 0 || !S_ISSOCK(st.st_mode)) {
+        std::cerr << "[kyntrix-agent] KYNTRIX_TELEMETRY_FD=" << v << " is not a socket; using HTTP\n";
+        return -1;
+    }
+    return (int)fd;
+}
+
+} // namespace
+
+extern "C" {
+
+void kyntrix_agent_init(const KyntrixAgentConfig* cfg) {
+    if (g_agent.running.load()) return;
+
+    g_agent.channel_fd = channel_from_env();
+    if (g_agent.channel_fd < 0 && !http_parse_url(cfg->ingest_url ? cfg->ingest_url : "", g_agent.target)) {
+        std::cerr << "[kyntrix-agent] unsupported ingest url: "
+                  << (cfg->ingest_url ? cfg->ingest_url : "(null)") << "; telemetry disabled\n";
+        return;
+    }
+
+    g_agent.run_id = cfg->run_id ? cfg->run_id : "";
+    g_agent.batch_size = cfg->batch_size > 0 ? (uint32_t)cfg->batch_size : 100;
+    g_agent.interval = std::chrono::milliseconds(cfg->flush_interval_ms > 0 ? cfg->flush_interval_ms : 1000);
+    g_agent.ring_bytes = round_pow2(env_size("KYNTRIX_AGENT_RING_KB", kDefaultRingBytes / 1024) * 1024);
+
+    const char* compress = std::getenv("KYNTRIX_WIRE_COMPRESS");
+    g_agent.zstd = compress && std::strcmp(compress, "zstd") == 0;
+    if (g_agent.zstd && !wire_have_zstd()) {
+        std::cerr << "[kyntrix-agent] built without zstd; sending uncompressed frames\n";
+        g_agent.zstd = false;
+    }
+
+    g_agent.stopping = false;
+    g_agent.running.store(true, std::memory_order_release);
+    g_agent.flusher = std::thread(flusher_main);
+}
+
+void kyntrix_agent_record(const KyntrixEvent* ev) {
+    if (!ev || !ev->kind || !g_agent.running.load(std::memory_order_acquire)) return;
+
+    uint32_t kind = intern_cached(ev->kind);
+    uint32_t node_key = ev->node_key ? intern_cached(ev->node_key) : 0;
+    const char* data = ev->data_json;
+
+    push_record(ev->seq, ev->ts, kind, node_key, ev->span, ev->parent_span, data,
+                data ? std::strlen(data) : 0, ev->run_id);
+}
+
+uint32_t kyntrix_agent_intern(const char* s) {
+    return s ? intern_locked(s) : 0;
+}
+
+void kyntrix_agent_record_interned(long long seq, long long ts, uint32_t kind, uint32_t node_key,
+                                   const char* span, const char* parent_span,
+                                   const char* data_json, size_t data_len, const char* run_id) {
+    if (kind == 0) return;
+    push_record(seq, ts, kind, node_key, span, parent_span, data_json, data_len, run_id);
+}
+
+void kyntrix_agent_flush(void) {
+    if (!g_agent.running.load()) return;
+
+    std::unique_lock<std::mutex> lock(g_agent.mutex);
+    uint64_t target = ++g_agent.flush_requested;
+    g_agent.cv.notify_all();
+    g_agent.done_cv.wait(lock, [target] { return g_agent.flush_done >= target || g_agent.stopping; });
+}
+
+void kyntrix_agent_shutdown(void) {
+    if (!g_agent.running.exchange(false)) return;
+
+    {
+        std::lock_guard<std::mutex> lock(g_agent.mutex);
+        g_agent.stopping = true;
+    }
+    g_agent.cv.notify_all();
+    if (g_agent.flusher.joinable()) g_agent.flusher.join();
+}
+
+void kyntrix_agent_stats(KyntrixAgentStats* out) {
+    out->recorded = g_agent.recorded.load();
+    out->dropped = g_agent.dropped.load();
+    out->sent = g_agent.sent.load();
+    out->wire_bytes = g_agent.wire_bytes.load();
+    out->raw_bytes = g_agent.raw_bytes.load();
+}
+
+} // extern "C"
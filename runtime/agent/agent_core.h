@@ -0,0 +1,70 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// C ABI of libkyntrix_agent (adapters/python-embedded/binding.py) and of the
+// kyntrix_agent.node addon (adapters/node-embedded/src/native.ts).
+//
+// record calls only encode the event into the calling thread's ring buffer;
+// a background flusher drains all rings every flush_interval_ms (or sooner,
+// once a ring holds batch_size events) and POSTs them to ingest_url in the
+// binary format described in agent_wire.h. Events that do not fit in a full
+// ring are dropped and counted rather than blocking the traced thread.
+//
+// Inside a kyntrixd container KYNTRIX_TELEMETRY_FD names the run's telemetry
+// channel; frames are then written to it, one per message, and ingest_url is
+// not used.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct KyntrixAgentConfig {
+    const char* ingest_url;
+    const char* run_id;
+    int batch_size;
+    int flush_interval_ms;
+} KyntrixAgentConfig;
+
+// NULL string fields are absent
+typedef struct KyntrixEvent {
+    const char* run_id;
+    long long seq;
+    long long ts;
+    const char* kind;
+    const char* span;
+    const char* parent_span;
+    const char* node_key;
+    const char* data_json;
+} KyntrixEvent;
+
+typedef struct KyntrixAgentStats {
+    uint64_t recorded;       // events accepted into a ring
+    uint64_t dropped;        // events lost to a full ring or a failed POST
+    uint64_t sent;           // events delivered
+    uint64_t wire_bytes;     // bytes POSTed
+    uint64_t raw_bytes;      // frame payload bytes before compression
+} KyntrixAgentStats;
+
+void kyntrix_agent_init(const KyntrixAgentConfig* cfg);
+
+void kyntrix_agent_record(const KyntrixEvent* ev);
+
+// Interns a kind or node key for kyntrix_agent_record_interned. Ids are
+// process-wide and never 0.
+uint32_t kyntrix_agent_intern(const char* s);
+
+// Hot-path variant of kyntrix_agent_record: kind and node_key are interned
+// ids (node_key 0 = absent), data_len bytes of data_json are copied (data_json
+// NULL = absent), run_id NULL uses the configured run.
+void kyntrix_agent_record_interned(long long seq, long long ts, uint32_t kind, uint32_t node_key,
+                                   const char* span, const char* parent_span,
+                                   const char* data_json, size_t data_len, const char* run_id);
+
+void kyntrix_agent_flush(void);
+void kyntrix_agent_shutdown(void);
+void kyntrix_agent_stats(KyntrixAgentStats* out);
+
+#ifdef __cplusplus
+}
+#endif
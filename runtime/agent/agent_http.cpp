@@ -0,0 +1,116 @@
+#include "agent_http.h"
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+static constexpr int kIoTimeoutSec = 5;
+
+bool http_parse_url(const std::string& url, HttpTarget& out) {
+    const std::string scheme = "http://";
+    if (url.compare(0, scheme.size(), scheme) != 0) return false;
+
+    size_t host_start = scheme.size();
+    size_t path_start = url.find('/', host_start);
+    std::string authority = url.substr(host_start, path_start == std::string::npos
+                                                       ? std::string::npos
+                                                       : path_start - host_start);
+    out.path = path_start == std::string::npos ? "/" : url.substr(path_start);
+
+    size_t colon = authority.rfind(':');
+    if (colon != std::string::npos && authority.find(']') == std::string::npos) {
+        out.host = authority.substr(0, colon);
+        out.port = authority.substr(colon + 1);
+    } else {
+        out.host = authority;
+        out.port = "80";
+    }
+    if (out.host.size() > 2 && out.host.front() == '[' && out.host.back() == ']') {
+        out.host = out.host.substr(1, out.host.size() - 2);
+    }
+    return !out.host.empty() && !out.port.empty();
+}
+
+static int connect_to(const HttpTarget& t, std::string& err) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* res = nullptr;
+    int rc = getaddrinfo(t.host.c_str(), t.port.c_str(), &hints, &res);
+    if (rc != 0) {
+        err = std::string("resolve ") + t.host + ": " + gai_strerror(rc);
+        return -1;
+    }
+
+    int fd = -1;
+    for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+
+        timeval tv{kIoTimeoutSec, 0};
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        err = std::string("connect ") + t.host + ":" + t.port + ": " + strerror(errno);
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+static bool send_all(int fd, const char* p, size_t n) {
+    while (n > 0) {
+        ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += w;
+        n -= (size_t)w;
+    }
+    return true;
+}
+
+int http_post(const HttpTarget& t, const char* content_type, const std::string& body,
+              std::string& err) {
+    int fd = connect_to(t, err);
+    if (fd < 0) return -1;
+
+    std::string head = "POST " + t.path + " HTTP/1.1\r\n";
+    head += "Host: " + t.host + ":" + t.port + "\r\n";
+    head += std::string("Content-Type: ") + content_type + "\r\n";
+    head += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    head += "Connection: close\r\n\r\n";
+
+    if (!send_all(fd, head.data(), head.size()) || !send_all(fd, body.data(), body.size())) {
+        err = std::string("send: ") + strerror(errno);
+        close(fd);
+        return -1;
+    }
+
+    // Only the status line matters
+    char buf[256];
+    size_t got = 0;
+    while (got < sizeof(buf) - 1) {
+        ssize_t r = recv(fd, buf + got, sizeof(buf) - 1 - got, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        got += (size_t)r;
+        if (memchr(buf, '\n', got)) break;
+    }
+    close(fd);
+    buf[got] = '\0';
+
+    const char* sp = strchr(buf, ' ');
+    if (strncmp(buf, "HTTP/1.", 7) != 0 || !sp) {
+        err = "malformed response";
+        return -1;
+    }
+    return atoi(sp + 1);
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <string>
+
+struct HttpTarget {
+    std::string host;
+    std::string port;
+    std::string path;
+};
+
+// Parses http://host[:port][/path]. https is not supported.
+bool http_parse_url(const std::string& url, HttpTarget& out);
+
+// Blocking HTTP/1.1 POST on a fresh connection. Returns the status code, or
+// -1 with err set if the request could not be sent.
+int http_post(const HttpTarget& t, const char* content_type, const std::string& body,
+              std::string& err);
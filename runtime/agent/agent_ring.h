@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+// Single-producer single-consumer byte ring of length-prefixed records. The
+// traced thread is the only producer and the flusher the only consumer, so
+// push and drain need no locks: head is published with release by the
+// producer, tail by the consumer.
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity_pow2)
+        : m_buf(new char[capacity_pow2]), m_mask(capacity_pow2 - 1) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side. Returns false (and writes nothing) if the record does
+    // not fit in the free space.
+    bool push(const char* p, uint32_t n) {
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        uint64_t need = sizeof(uint32_t) + n;
+
+        if (need > capacity() - (head - m_cached_tail)) {
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+            if (need > capacity() - (head - m_cached_tail)) return false;
+        }
+
+        copy_in(head, (const char*)&n, sizeof(n));
+        copy_in(head + sizeof(n), p, n);
+        m_head.store(head + need, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Calls fn(const char*, uint32_t) for every record
+    // published so far; a record that wraps the end is copied to scratch.
+    template <typename Fn>
+    size_t drain(std::string& scratch, Fn&& fn) {
+        uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        uint64_t head = m_head.load(std::memory_order_acquire);
+        size_t records = 0;
+
+        while (tail != head) {
+            uint32_t n;
+            copy_out(tail, (char*)&n, sizeof(n));
+            uint64_t at = tail + sizeof(n);
+
+            size_t off = at & m_mask;
+            if (off + n <= capacity()) {
+                fn(m_buf.get() + off, n);
+            } else {
+                scratch.resize(n);
+                copy_out(at, scratch.data(), n);
+                fn(scratch.data(), n);
+            }
+
+            tail = at + n;
+            ++records;
+        }
+
+        m_tail.store(tail, std::memory_order_release);
+        return records;
+    }
+
+    bool empty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+private:
+    void copy_in(uint64_t pos, const char* p, size_t n) {
+        size_t off = pos & m_mask;
+        size_t first = n < capacity() - off ? n : capacity() - off;
+        std::memcpy(m_buf.get() + off, p, first);
+        std::memcpy(m_buf.get(), p + first, n - first);
+    }
+
+    void copy_out(uint64_t pos, char* p, size_t n) const {
+        size_t off = pos & m_mask;
+        size_t first = n < capacity() - off ? n : capacity() - off;
+        std::memcpy(p, m_buf.get() + off, first);
+        std::memcpy(p + first, m_buf.get(), n - first);
+    }
+
+    std::unique_ptr<char[]> m_buf;
+    const size_t m_mask;
+
+    alignas(64) std::atomic<uint64_t> m_head{0};
+    uint64_t m_cached_tail = 0;   // producer's last view of m_tail
+    alignas(64) std::atomic<uint64_t> m_tail{0};
+};
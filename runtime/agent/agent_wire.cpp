@@ -0,0 +1,172 @@
+#include "agent_wire.h"
+
+#ifdef KYNTRIX_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+WireFrameWriter::WireFrameWriter(std::string_view run_id) : m_dict(std::make_unique<StringInterner>()) {
+    put_ref(m_head, run_id);
+}
+
+void WireFrameWriter::put_ref(std::string& out, std::string_view s) {
+    size_t before = m_dict->size();
+    uint32_t id = m_dict->intern(s);
+
+    if (m_dict->size() == before) {
+        wire_put_varint(out, (uint64_t)id << 1);
+    } else {
+        wire_put_varint(out, (uint64_t)s.size() << 1 | 1);
+        out.append(s.data(), s.size());
+    }
+}
+
+void WireFrameWriter::add(const WireRecord& r) {
+    m_body += (char)r.mask;
+    wire_put_varint(m_body, wire_zigzag((int64_t)(r.seq - m_prev_seq)));
+    wire_put_varint(m_body, wire_zigzag(r.ts - m_prev_ts));
+    m_prev_seq = r.seq;
+    m_prev_ts = r.ts;
+
+    put_ref(m_body, r.kind);
+    if (r.mask & kWireSpan)       put_ref(m_body, r.span);
+    if (r.mask & kWireParentSpan) put_ref(m_body, r.parent_span);
+    if (r.mask & kWireNodeKey)    put_ref(m_body, r.node_key);
+    if (r.mask & kWireRunId)      put_ref(m_body, r.run_id);
+    if (r.mask & kWireData) {
+        wire_put_varint(m_body, r.data.size());
+        m_body.append(r.data.data(), r.data.size());
+    }
+    ++m_count;
+}
+
+void WireFrameWriter::finish(std::string& out, bool zstd) {
+    std::string raw = std::move(m_head);
+    wire_put_varint(raw, m_count);
+    raw += m_body;
+
+    uint8_t flags = 0;
+    std::string packed;
+#ifdef KYNTRIX_HAVE_ZSTD
+    if (zstd) {
+        packed.resize(ZSTD_compressBound(raw.size()));
+        size_t n = ZSTD_compress(packed.data(), packed.size(), raw.data(), raw.size(), 1);
+        if (!ZSTD_isError(n) && n < raw.size()) {
+            packed.resize(n);
+            flags |= kWireZstd;
+        }
+    }
+#else
+    (void)zstd;
+#endif
+    const std::string& payload = (flags & kWireZstd) ? packed : raw;
+
+    out += "KTAL";
+    out += (char)kWireVersion;
+    out += (char)flags;
+    wire_put_varint(out, payload.size());
+    wire_put_varint(out, raw.size());
+    out += payload;
+}
+
+namespace {
+
+class FrameParser {
+public:
+    FrameParser(const char* p, const char* end) : m_p(p), m_end(end) {}
+
+    bool ref(std::string_view& out) {
+        uint64_t v;
+        if (!wire_get_varint(m_p, m_end, v)) return false;
+
+        if (v & 1) {
+            if (!take(v >> 1, out)) return false;
+            m_dict.push_back(out);
+            return true;
+        }
+        if ((v >> 1) >= m_dict.size()) return false;
+        out = m_dict[v >> 1];
+        return true;
+    }
+
+    bool take(uint64_t n, std::string_view& out) {
+        if (n > (uint64_t)(m_end - m_p)) return false;
+        out = std::string_view(m_p, n);
+        m_p += n;
+        return true;
+    }
+
+    bool varint(uint64_t& v) { return wire_get_varint(m_p, m_end, v); }
+
+    bool byte(uint8_t& b) {
+        if (m_p == m_end) return false;
+        b = (uint8_t)*m_p++;
+        return true;
+    }
+
+    bool done() const { return m_p == m_end; }
+
+private:
+    const char* m_p;
+    const char* m_end;
+    std::vector<std::string_view> m_dict;
+};
+
+} // namespace
+
+bool wire_read_frame(std::string_view buf, size_t& consumed, std::string_view& run_id,
+                     std::vector<WireRecord>& records) {
+    records.clear();
+
+    const char* p = buf.data();
+    const char* end = p + buf.size();
+    uint64_t payload_len, raw_len;
+    if (buf.size() < 6 || buf.compare(0, 4, "KTAL") != 0 || (uint8_t)p[4] != kWireVersion ||
+        ((uint8_t)p[5] & kWireZstd)) {
+        return false;
+    }
+    p += 6;
+    if (!wire_get_varint(p, end, payload_len) || !wire_get_varint(p, end, raw_len) ||
+        payload_len != raw_len || payload_len > (uint64_t)(end - p)) {
+        return false;
+    }
+
+    FrameParser in(p, p + payload_len);
+    uint64_t count, v;
+    if (!in.ref(run_id) || !in.varint(count)) return false;
+
+    uint64_t seq = 0;
+    int64_t ts = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        WireRecord r;
+        if (!in.byte(r.mask)) return false;
+
+        if (!in.varint(v)) return false;
+        seq += (uint64_t)wire_unzigzag(v);
+        if (!in.varint(v)) return false;
+        ts += wire_unzigzag(v);
+        r.seq = seq;
+        r.ts = ts;
+
+        if (!in.ref(r.kind)) return false;
+        if ((r.mask & kWireSpan) && !in.ref(r.span)) return false;
+        if ((r.mask & kWireParentSpan) && !in.ref(r.parent_span)) return false;
+        if ((r.mask & kWireNodeKey) && !in.ref(r.node_key)) return false;
+        if ((r.mask & kWireRunId) && !in.ref(r.run_id)) return false;
+        if (r.mask & kWireData) {
+            if (!in.varint(v) || !in.take(v, r.data)) return false;
+        }
+        records.push_back(r);
+    }
+    if (!in.done()) return false;
+
+    consumed = (size_t)(p + payload_len - buf.data());
+    return true;
+}
+
+bool wire_have_zstd() {
+#ifdef KYNTRIX_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "tal_intern.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Binary TAL wire format, sent by agent_core as application/x-kyntrix-tal
+// and decoded by servers/agents/transforms/talWire.ts. A request body is one
+// or more frames:
+//
+//   frame   := "KTAL" u8(version = 1) u8(flags) varint(payload_len)
+//              varint(raw_len) payload
+//   flags   := bit 0: payload is zstd-compressed; raw_len is its size
+//              once decompressed (otherwise raw_len == payload_len)
+//   payload := ref(runId) varint(count) record*
+//   record  := u8(mask) varint(zigzag(seq - prev seq))
+//              varint(zigzag(ts - prev ts)) ref(kind)
+//              [ref(span)] [ref(parentSpan)] [ref(nodeKey)] [ref(runId)]
+//              [varint(len) data]
+//   mask    := 1 span, 2 parentSpan, 4 nodeKey, 8 runId (overrides the
+//              frame's), 16 data (JSON text)
+//   ref     := varint(v): v odd -> a new string of v >> 1 bytes follows and
+//              is appended to the frame's dictionary; v even -> dictionary
+//              entry v >> 1
+//
+// prev seq / prev ts start at 0 in each frame. Frames are self-contained so
+// the decoder keeps no state between requests.
+enum WireMask : uint8_t {
+    kWireSpan       = 1,
+    kWireParentSpan = 2,
+    kWireNodeKey    = 4,
+    kWireRunId      = 8,
+    kWireData       = 16,
+};
+
+inline constexpr uint8_t kWireVersion = 1;
+inline constexpr uint8_t kWireZstd = 1;
+
+struct WireRecord {
+    uint8_t mask = 0;
+    uint64_t seq = 0;
+    int64_t ts = 0;
+    std::string_view kind;
+    std::string_view span;
+    std::string_view parent_span;
+    std::string_view node_key;
+    std::string_view run_id;
+    std::string_view data;
+};
+
+inline void wire_put_varint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out += (char)(v | 0x80);
+        v >>= 7;
+    }
+    out += (char)v;
+}
+
+inline bool wire_get_varint(const char*& p, const char* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = (uint8_t)*p++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+inline uint64_t wire_zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+inline int64_t wire_unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// Builds one frame; strings repeated within the frame are sent once.
+class WireFrameWriter {
+public:
+    explicit WireFrameWriter(std::string_view run_id);
+
+    void add(const WireRecord& r);
+    size_t count() const { return m_count; }
+    size_t raw_size() const { return m_body.size(); }
+
+    // Appends the finished frame to out; compresses when zstd is true and
+    // agent_core was built with zstd. The writer is spent afterwards.
+    void finish(std::string& out, bool zstd);
+
+private:
+    void put_ref(std::string& out, std::string_view s);
+
+    std::unique_ptr<StringInterner> m_dict;
+    std::string m_head;   // ref(runId), written before count
+    std::string m_body;   // records
+    size_t m_count = 0;
+    uint64_t m_prev_seq = 0;
+    int64_t m_prev_ts = 0;
+};
+
+// Parses the uncompressed frame at the start of buf. On success consumed is
+// the frame's length and run_id / records view into buf, which must outlive
+// them. Compressed frames are rejected.
+bool wire_read_frame(std::string_view buf, size_t& consumed, std::string_view& run_id,
+                     std::vector<WireRecord>& records);
+
+bool wire_have_zstd();
@@ -0,0 +1,170 @@
+#include "bench_store.h"
+#include "ct_exec.h"
+#include "ct_mount.h"
+#include "ct_namespace.h"
+#include "ct_workspace.h"
+#include <benchmark/benchmark.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fstream>
+#include <string>
+
+// Container start-up, piece by piece: the unprivileged steps (image
+// resolution, exec spec, workspace snapshots) anywhere, the mount set-up and
+// a full spawn_container() only as root. BM_SpawnContainer also needs a real
+// image store in KYNTRIX_BENCH_IMAGE_ROOT whose python-rootfs can run
+// `opentelemetry-instrument python`; it reports the mean of each SpawnPhase
+// as a counter.
+
+static bool is_root() {
+    return ::geteuid() == 0;
+}
+
+// Per-phase means, in microseconds
+static void report_phases(benchmark::State& state, const SpawnTimings& total) {
+    for (size_t p = 0; p < kSpawnPhases; ++p) {
+        if (total.ns[p] == 0) continue;
+        state.counters[std::string(spawn_phase_name((SpawnPhase)p)) + "_us"] =
+            benchmark::Counter((double)total.ns[p] / 1e3, benchmark::Counter::kAvgIterations);
+    }
+}
+
+static void add_timings(SpawnTimings& total, const SpawnTimings& t) {
+    for (size_t p = 0; p < kSpawnPhases; ++p) total.ns[p] += t.ns[p];
+}
+
+static void BM_ResolveRootfs(benchmark::State& state) {
+    BenchStore::get();
+    for (auto _ : state) {
+        RootfsSpec spec = prepare_rootfs_for_template(ContainerTemplate::Python);
+        benchmark::DoNotOptimize(spec);
+    }
+}
+BENCHMARK(BM_ResolveRootfs);
+
+static void BM_ExecSpec(benchmark::State& state) {
+    for (auto _ : state) {
+        ExecSpec spec;
+        build_exec_spec(spec, ContainerTemplate::Python);
+        bool ok = bind_exec_run(spec, "bench-run", "main.py");
+        benchmark::DoNotOptimize(ok);
+    }
+}
+BENCHMARK(BM_ExecSpec);
+
+// A files-mode upload of state.range(0) 1 KiB files; new content every
+// iteration unless range(1) asks for the cache hit path
+static void BM_WorkspaceSnapshot(benchmark::State& state) {
+    BenchStore::get();
+    const long files = state.range(0);
+    const bool same = state.range(1) != 0;
+    std::string body(1024, 'x');
+    long round = 0;
+
+    for (auto _ : state) {
+        WorkspaceWriter writer;
+        for (long f = 0; f < files; ++f) {
+            std::string content = body + std::to_string(same ? f : round * files + f);
+            writer.begin_file("src/file" + std::to_string(f) + ".py");
+            writer.write(content.data(), content.size());
+            writer.end_file();
+        }
+        WorkspaceSnapshot snap = writer.commit();
+        benchmark::DoNotOptimize(snap);
+        ++round;
+    }
+    state.SetItemsProcessed(state.iterations() * files);
+}
+BENCHMARK(BM_WorkspaceSnapshot)->ArgsProduct({{1, 16, 256}, {0, 1}})->ArgNames({"files", "hit"});
+
+// setup_rootfs() in a fresh mount namespace, as a container init runs it
+static void BM_MountSetup(benchmark::State& state) {
+    if (!is_root()) {
+        state.SkipWithError("requires root");
+        return;
+    }
+    BenchStore::get();
+    RootfsSpec rootfs = prepare_rootfs_for_template(ContainerTemplate::Python);
+    SpawnTimings total{};
+
+    for (auto _ : state) {
+        int fds[2];
+        if (::pipe(fds) < 0) {
+            state.SkipWithError("pipe failed");
+            break;
+        }
+
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            ::close(fds[0]);
+            SpawnTimings t{};
+            bool ok = ::unshare(CLONE_NEWNS) == 0 && setup_rootfs(rootfs, &t);
+            (void)!::write(fds[1], &t, sizeof(t));
+            ::_exit(ok ? 0 : 1);
+        }
+        ::close(fds[1]);
+
+        SpawnTimings t{};
+        bool got = pid > 0 && ::read(fds[0], &t, sizeof(t)) == (ssize_t)sizeof(t);
+        ::close(fds[0]);
+        int status = 0;
+        if (pid > 0) ::waitpid(pid, &status, 0);
+
+        if (!got || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            state.SkipWithError("setup_rootfs failed");
+            break;
+        }
+        add_timings(total, t);
+    }
+    report_phases(state, total);
+}
+BENCHMARK(BM_MountSetup)->UseRealTime();
+
+// Cold spawn up to exec of the entry point; the container is killed and
+// reaped outside the timed region
+static void BM_SpawnContainer(benchmark::State& state) {
+    if (!is_root() || !std::getenv("KYNTRIX_BENCH_IMAGE_ROOT")) {
+        state.SkipWithError("requires root and KYNTRIX_BENCH_IMAGE_ROOT");
+        return;
+    }
+    BenchStore::get();
+
+    char dir[] = "/tmp/kyntrix_bench_ws.XXXXXX";
+    if (!::mkdtemp(dir)) {
+        state.SkipWithError("mkdtemp failed");
+        return;
+    }
+    std::ofstream(std::string(dir) + "/main.py") << "import time\ntime.sleep(60)\n";
+
+    RunSpec run;
+    run.workspace_path = dir;
+    run.entry_script = "main.py";
+    SpawnTimings total{};
+    long n = 0;
+
+    for (auto _ : state) {
+        run.run_id = "bench-" + std::to_string(n++);
+        SpawnTimings t{};
+        pid_t pid = spawn_container(ContainerTemplate::Python, run, &t);
+
+        state.PauseTiming();
+        if (pid > 0) {
+            ::kill(pid, SIGKILL);
+            ::waitpid(pid, nullptr, 0);
+        }
+        state.ResumeTiming();
+
+        if (pid <= 0) {
+            state.SkipWithError("spawn_container failed");
+            break;
+        }
+        add_timings(total, t);
+    }
+    report_phases(state, total);
+
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+}
+BENCHMARK(BM_SpawnContainer)->UseRealTime();
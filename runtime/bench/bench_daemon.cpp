@@ -0,0 +1,227 @@
+#include "bench_store.h"
+#include "control_protocol.h"
+#include "daemon_config.h"
+#include "daemon_server.h"
+#include "metrics.h"
+#include "run_scheduler.h"
+#include <benchmark/benchmark.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// The daemon's request path: decoding, framing, and full round trips
+// through an in-process KyntrixDaemonServer on a scratch socket, with
+// has_layer as the request (no containers involved).
+
+using json = nlohmann::json;
+
+static void BM_DecodeStart(benchmark::State& state) {
+    json files = json::object();
+    for (long f = 0; f < state.range(0); ++f) {
+        files["src/file" + std::to_string(f) + ".py"] = std::string(1024, 'x');
+    }
+    std::string body = json{
+        {"action", "start"}, {"run_id", "bench"}, {"template", "python"},
+        {"entry", "main.py"}, {"mode", "files"}, {"files", files},
+    }.dump();
+
+    for (auto _ : state) {
+        json j = json::parse(body);
+        ControlRequest req;
+        std::string error;
+        bool ok = decode_control_request(j, req, error);
+        benchmark::DoNotOptimize(ok);
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)body.size());
+}
+BENCHMARK(BM_DecodeStart)->Arg(0)->Arg(16)->Arg(256)->ArgName("files");
+
+static void BM_FrameCodec(benchmark::State& state) {
+    std::string body(state.range(0), 'x');
+    std::string out;
+    for (auto _ : state) {
+        out.clear();
+        append_frame(out, FrameType::Response, 42, body);
+        FrameHeader h;
+        bool ok = decode_frame_header(out.data(), h);
+        benchmark::DoNotOptimize(ok);
+    }
+}
+BENCHMARK(BM_FrameCodec)->Arg(64)->Arg(4096)->ArgName("bytes");
+
+static void BM_HistogramRecord(benchmark::State& state) {
+    Histogram h;
+    uint64_t ns = 1;
+    for (auto _ : state) {
+        h.record_ns(ns);
+        ns = ns * 6364136223846793005ull + 1442695040888963407ull;
+        ns >>= 34;
+    }
+}
+BENCHMARK(BM_HistogramRecord);
+
+static std::string run_name(long i) {
+    std::string s = "r";
+    s += std::to_string(i);
+    return s;
+}
+
+// Two NUMA nodes of 32 two-thread cores, full, with runs churning through
+// the queue
+static void BM_SchedulerChurn(benchmark::State& state) {
+    CpuTopology topo;
+    for (int n = 0; n < 2; ++n) {
+        NumaNode node{n, {}};
+        for (int c = 0; c < 32; ++c) {
+            int cpu = n * 32 + c;
+            node.cores.push_back(CpuCore{{cpu, cpu + 64}});
+        }
+        topo.nodes.push_back(std::move(node));
+    }
+    SchedulerConfig cfg;
+    cfg.queue_max = 1u << 20;
+    RunScheduler sched(cfg, topo);
+
+    long next = 0;
+    std::vector<std::pair<std::string, Placement>> placed;
+    for (long i = 0; i < 64; ++i) {
+        Placement p;
+        sched.admit(run_name(next++), 0, p);
+    }
+
+    long oldest = 0;
+    for (auto _ : state) {
+        Placement p;
+        sched.admit(run_name(next), (int)(next % 3), p);
+        ++next;
+        placed.clear();
+        sched.release(run_name(oldest++), placed);
+        benchmark::DoNotOptimize(placed);
+    }
+}
+BENCHMARK(BM_SchedulerChurn);
+
+// One server for every round-trip benchmark, stopped at exit
+struct BenchServer {
+    DaemonConfig cfg;
+    std::unique_ptr<KyntrixDaemonServer> server;
+    std::thread thread;
+
+    BenchServer() {
+        cfg.socket_path = BenchStore::get().root + "/kyntrixd.sock";
+        cfg.worker_threads = 4;
+        server = std::make_unique<KyntrixDaemonServer>(cfg);
+        thread = std::thread([this] { server->run(); });
+    }
+
+    ~BenchServer() {
+        server->stop();
+        thread.join();
+    }
+
+    static BenchServer& get() {
+        static BenchServer s;
+        return s;
+    }
+};
+
+static int connect_daemon() {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, BenchServer::get().cfg.socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    if (fd >= 0 && ::connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool write_all(int fd, const std::string& s) {
+    size_t off = 0;
+    while (off < s.size()) {
+        ssize_t n = ::write(fd, s.data() + off, s.size() - off);
+        if (n <= 0) return false;
+        off += (size_t)n;
+    }
+    return true;
+}
+
+static const std::string kHasLayer = R"({"action":"has_layer","digest":"bench"})";
+
+// Newline-delimited JSON: one request in flight per connection
+static void BM_RoundTripLines(benchmark::State& state) {
+    int fd = connect_daemon();
+    if (fd < 0) {
+        state.SkipWithError("cannot connect to the bench server");
+        return;
+    }
+    std::string line = kHasLayer + "\n";
+    std::string in;
+    char buf[4096];
+
+    for (auto _ : state) {
+        if (!write_all(fd, line)) break;
+        size_t nl;
+        while ((nl = in.find('\n')) == std::string::npos) {
+            ssize_t n = ::read(fd, buf, sizeof(buf));
+            if (n <= 0) break;
+            in.append(buf, (size_t)n);
+        }
+        if (nl == std::string::npos) {
+            state.SkipWithError("connection closed");
+            break;
+        }
+        in.erase(0, nl + 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+    ::close(fd);
+}
+BENCHMARK(BM_RoundTripLines)->UseRealTime();
+
+// Framed protocol with state.range(0) requests pipelined per iteration
+static void BM_RoundTripFramed(benchmark::State& state) {
+    int fd = connect_daemon();
+    if (fd < 0) {
+        state.SkipWithError("cannot connect to the bench server");
+        return;
+    }
+    const long depth = state.range(0);
+    std::string batch;
+    for (long i = 0; i < depth; ++i) {
+        append_frame(batch, FrameType::Request, (uint32_t)(i + 1), kHasLayer);
+    }
+    std::string in;
+    char buf[16384];
+
+    for (auto _ : state) {
+        if (!write_all(fd, batch)) break;
+        long answered = 0;
+        bool closed = false;
+        while (answered < depth && !closed) {
+            FrameHeader h;
+            while (in.size() >= kFrameHeaderBytes && decode_frame_header(in.data(), h) &&
+                   in.size() >= kFrameHeaderBytes + h.length) {
+                in.erase(0, kFrameHeaderBytes + h.length);
+                ++answered;
+            }
+            if (answered == depth) break;
+            ssize_t n = ::read(fd, buf, sizeof(buf));
+            if (n <= 0) closed = true;
+            else in.append(buf, (size_t)n);
+        }
+        if (closed) {
+            state.SkipWithError("connection closed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * depth);
+    ::close(fd);
+}
+BENCHMARK(BM_RoundTripFramed)->Arg(1)->Arg(8)->Arg(64)->ArgName("depth")->UseRealTime();
@@ -0,0 +1,43 @@
+#pragma once
+#include "ct_image.h"
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+// Image store shared by the benchmarks: KYNTRIX_BENCH_IMAGE_ROOT if set (a
+// real store, for the spawn benchmark), else a scratch directory with an
+// empty python-rootfs that is removed at exit.
+struct BenchStore {
+    std::string root;
+    bool scratch = false;
+
+    BenchStore() {
+        if (const char* r = std::getenv("KYNTRIX_BENCH_IMAGE_ROOT")) {
+            root = r;
+        } else {
+            char dir[] = "/tmp/kyntrix_bench.XXXXXX";
+            if (::mkdtemp(dir)) {
+                root = dir;
+                scratch = true;
+                std::filesystem::create_directories(root + "/images/python-rootfs");
+            }
+        }
+
+        ImageStoreConfig ic;
+        ic.root = root;
+        configure_image_store(ic);
+    }
+
+    ~BenchStore() {
+        std::error_code ec;
+        if (scratch) std::filesystem::remove_all(root, ec);
+    }
+
+    static BenchStore& get() {
+        static BenchStore store;
+        return store;
+    }
+};
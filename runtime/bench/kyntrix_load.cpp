@@ -0,0 +1,367 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// Closed-loop load generator for a running kyntrixd. Each of --concurrency
+// clients keeps one connection, starts a run, waits for the answer (and with
+// --wait-exit for the run's exit event) and starts the next, until
+// --duration seconds have passed or --runs runs were started. Prints one
+// JSON object with throughput and start latency percentiles:
+//
+//   kyntrix_load [--socket PATH] [--concurrency N] [--duration S | --runs N]
+//                [--template python|node] [--workspace DIR --entry FILE]
+//                [--tier T] [--wait-exit] [--exit-timeout S] [--out FILE]
+//
+// Without --workspace each run uploads a one-line script (files mode).
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+struct LoadConfig {
+    std::string socket = "/var/run/kyntrixd.sock";
+    long concurrency = 8;
+    double duration_s = 10;
+    long runs = 0;                 // 0 = bounded by duration
+    std::string tmpl = "python";
+    std::string workspace;
+    std::string entry;
+    std::string tier;
+    bool wait_exit = false;
+    double exit_timeout_s = 60;
+    std::string out;
+};
+
+static void usage() {
+    std::cerr << "usage: kyntrix_load [--socket PATH] [--concurrency N] [--duration S | --runs N]\n"
+                 "                    [--template python|node] [--workspace DIR --entry FILE]\n"
+                 "                    [--tier T] [--wait-exit] [--exit-timeout S] [--out FILE]\n";
+}
+
+static bool parse_args(int argc, char** argv, LoadConfig& cfg) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto value = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* v = nullptr;
+
+        if (a == "--wait-exit") { cfg.wait_exit = true; continue; }
+        if (a == "--help" || a == "-h") return false;
+        if (!(v = value())) return false;
+
+        if (a == "--socket")            cfg.socket = v;
+        else if (a == "--concurrency")  cfg.concurrency = std::atol(v);
+        else if (a == "--duration")     cfg.duration_s = std::atof(v);
+        else if (a == "--runs")         cfg.runs = std::atol(v);
+        else if (a == "--template")     cfg.tmpl = v;
+        else if (a == "--workspace")    cfg.workspace = v;
+        else if (a == "--entry")        cfg.entry = v;
+        else if (a == "--tier")         cfg.tier = v;
+        else if (a == "--exit-timeout") cfg.exit_timeout_s = std::atof(v);
+        else if (a == "--out")          cfg.out = v;
+        else return false;
+    }
+    if (cfg.concurrency <= 0 || (cfg.runs <= 0 && cfg.duration_s <= 0)) return false;
+    if (cfg.tmpl != "python" && cfg.tmpl != "node") return false;
+    return cfg.workspace.empty() || !cfg.entry.empty();
+}
+
+// Newline-delimited JSON connection to kyntrixd
+class DaemonLink {
+public:
+    explicit DaemonLink(const std::string& path) {
+        m_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        if (m_fd >= 0 && ::connect(m_fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+    ~DaemonLink() {
+        if (m_fd >= 0) ::close(m_fd);
+    }
+
+    DaemonLink(const DaemonLink&) = delete;
+    DaemonLink& operator=(const DaemonLink&) = delete;
+
+    bool ok() const { return m_fd >= 0; }
+
+    bool send(const std::string& line) {
+        std::string s = line + "\n";
+        size_t off = 0;
+        while (off < s.size()) {
+            ssize_t n = ::write(m_fd, s.data() + off, s.size() - off);
+            if (n <= 0) return false;
+            off += (size_t)n;
+        }
+        return true;
+    }
+
+    bool read_line(std::string& line) {
+        size_t nl;
+        char buf[8192];
+        while ((nl = m_in.find('\n')) == std::string::npos) {
+            ssize_t n = ::read(m_fd, buf, sizeof(buf));
+            if (n <= 0) return false;
+            m_in.append(buf, (size_t)n);
+        }
+        line = m_in.substr(0, nl);
+        m_in.erase(0, nl + 1);
+        return true;
+    }
+
+    void shutdown() {
+        if (m_fd >= 0) ::shutdown(m_fd, SHUT_RDWR);
+    }
+
+private:
+    int m_fd = -1;
+    std::string m_in;
+};
+
+// Exit events from one subscribed connection, awaited by run id
+class ExitWatcher {
+public:
+    explicit ExitWatcher(const std::string& path) : m_link(path) {}
+
+    ~ExitWatcher() {
+        m_link.shutdown();
+        if (m_thread.joinable()) m_thread.join();
+    }
+
+    bool start() {
+        std::string ack;
+        if (!m_link.ok() || !m_link.send(R"({"action":"subscribe"})") || !m_link.read_line(ack)) {
+            return false;
+        }
+        m_thread = std::thread([this] { reader_main(); });
+        return true;
+    }
+
+    // The exit event for run_id, or a null json on timeout
+    json wait(const std::string& run_id, Clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait_until(lock, deadline, [&] { return m_exits.count(run_id) > 0 || m_closed; });
+        auto it = m_exits.find(run_id);
+        if (it == m_exits.end()) return json();
+        json ev = std::move(it->second);
+        m_exits.erase(it);
+        return ev;
+    }
+
+    // Drops an exit that arrives after its waiter gave up
+    void forget(const std::string& run_id) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_exits.erase(run_id);
+    }
+
+private:
+    void reader_main() {
+        std::string line;
+        while (m_link.read_line(line)) {
+            json ev = json::parse(line, nullptr, false);
+            if (ev.is_discarded() || ev.value("event", "") != "exit") continue;
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_exits[ev.value("run_id", "")] = std::move(ev);
+            m_cv.notify_all();
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_cv.notify_all();
+    }
+
+    DaemonLink m_link;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::unordered_map<std::string, json> m_exits;
+    bool m_closed = false;
+};
+
+struct ClientResult {
+    std::vector<double> start_ms;
+    std::vector<double> exit_ms;
+    long ok = 0;
+    long queued = 0;
+    long failed = 0;
+    long nonzero_exit = 0;
+    std::map<std::string, long> errors;
+};
+
+static json start_request(const LoadConfig& cfg, const std::string& run_id) {
+    json req = {
+        {"action", "start"}, {"run_id", run_id}, {"template", cfg.tmpl},
+    };
+    if (!cfg.tier.empty()) req["tier"] = cfg.tier;
+
+    if (!cfg.workspace.empty()) {
+        req["workspace_path"] = cfg.workspace;
+        req["entry"] = cfg.entry;
+    } else {
+        bool py = cfg.tmpl == "python";
+        std::string entry = py ? "main.py" : "main.js";
+        req["mode"] = "files";
+        req["entry"] = entry;
+        req["files"] = {{entry, py ? "print('kyntrix-load')\n" : "console.log('kyntrix-load')\n"}};
+    }
+    return req;
+}
+
+static void client_main(const LoadConfig& cfg, long id, std::atomic<long>& budget,
+                        Clock::time_point end, ExitWatcher* exits, ClientResult& out) {
+    DaemonLink link(cfg.socket);
+    if (!link.ok()) {
+        out.errors["cannot connect"]++;
+        return;
+    }
+
+    const std::string prefix = "load-" + std::to_string(::getpid()) + "-" + std::to_string(id) + "-";
+    for (long seq = 0;; ++seq) {
+        if (cfg.runs > 0 ? budget.fetch_sub(1) <= 0 : Clock::now() >= end) break;
+
+        std::string run_id = prefix + std::to_string(seq);
+        auto t0 = Clock::now();
+        std::string line;
+        if (!link.send(start_request(cfg, run_id).dump()) || !link.read_line(line)) {
+            out.failed++;
+            out.errors["connection lost"]++;
+            return;
+        }
+        auto t1 = Clock::now();
+
+        json resp = json::parse(line, nullptr, false);
+        if (resp.is_discarded() || !resp.value("ok", false)) {
+            out.failed++;
+            std::string err = resp.is_discarded() ? "invalid response" : resp.value("error", "start refused");
+            out.errors[err]++;
+            continue;
+        }
+        out.ok++;
+        if (resp.value("queued", false)) out.queued++;
+        out.start_ms.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+
+        if (!exits) continue;
+        auto deadline = t1 + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(cfg.exit_timeout_s));
+        json ev = exits->wait(run_id, deadline);
+        if (ev.is_null()) {
+            exits->forget(run_id);
+            out.errors["exit not seen"]++;
+            continue;
+        }
+        out.exit_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+        if (ev.value("exit_code", 0) != 0 || ev.value("not_started", false)) out.nonzero_exit++;
+    }
+}
+
+static json summarize(std::vector<double>& ms) {
+    if (ms.empty()) return json{{"count", 0}};
+    std::sort(ms.begin(), ms.end());
+
+    auto q = [&ms](double p) {
+        size_t i = (size_t)(p * (double)(ms.size() - 1) + 0.5);
+        return ms[std::min(i, ms.size() - 1)];
+    };
+    double sum = 0;
+    for (double v : ms) sum += v;
+
+    return json{
+        {"count", ms.size()},
+        {"mean", sum / (double)ms.size()},
+        {"p50", q(0.50)},
+        {"p99", q(0.99)},
+        {"p999", q(0.999)},
+        {"max", ms.back()},
+    };
+}
+
+int main(int argc, char** argv) {
+    LoadConfig cfg;
+    if (const char* s = std::getenv("KYNTRIXD_SOCKET")) cfg.socket = s;
+    if (!parse_args(argc, argv, cfg)) {
+        usage();
+        return 2;
+    }
+
+    std::unique_ptr<ExitWatcher> exits;
+    if (cfg.wait_exit) {
+        exits = std::make_unique<ExitWatcher>(cfg.socket);
+        if (!exits->start()) {
+            std::cerr << "kyntrix_load: cannot subscribe to exit events on " << cfg.socket << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<ClientResult> results((size_t)cfg.concurrency);
+    std::vector<std::thread> clients;
+    std::atomic<long> budget{cfg.runs};
+
+    auto t0 = Clock::now();
+    auto end = t0 + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(cfg.duration_s));
+    for (long i = 0; i < cfg.concurrency; ++i) {
+        clients.emplace_back(client_main, std::cref(cfg), i, std::ref(budget), end,
+                             exits.get(), std::ref(results[(size_t)i]));
+    }
+    for (auto& t : clients) t.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    ClientResult all;
+    for (auto& r : results) {
+        all.start_ms.insert(all.start_ms.end(), r.start_ms.begin(), r.start_ms.end());
+        all.exit_ms.insert(all.exit_ms.end(), r.exit_ms.begin(), r.exit_ms.end());
+        all.ok += r.ok;
+        all.queued += r.queued;
+        all.failed += r.failed;
+        all.nonzero_exit += r.nonzero_exit;
+        for (auto& [err, n] : r.errors) all.errors[err] += n;
+    }
+
+    json report = {
+        {"config", {
+            {"socket", cfg.socket},
+            {"concurrency", cfg.concurrency},
+            {"duration_s", cfg.runs > 0 ? json(nullptr) : json(cfg.duration_s)},
+            {"runs", cfg.runs > 0 ? json(cfg.runs) : json(nullptr)},
+            {"template", cfg.tmpl},
+            {"mode", cfg.workspace.empty() ? "files" : "bind"},
+            {"wait_exit", cfg.wait_exit},
+        }},
+        {"elapsed_s", elapsed},
+        {"started", all.ok},
+        {"queued", all.queued},
+        {"failed", all.failed},
+        {"throughput_per_s", elapsed > 0 ? (double)all.ok / elapsed : 0.0},
+        {"start_latency_ms", summarize(all.start_ms)},
+        {"errors", all.errors},
+    };
+    if (cfg.wait_exit) {
+        report["exit_latency_ms"] = summarize(all.exit_ms);
+        report["nonzero_exit"] = all.nonzero_exit;
+    }
+
+    std::string text = report.dump(2);
+    if (cfg.out.empty()) {
+        std::cout << text << "\n";
+    } else {
+        std::ofstream(cfg.out) << text << "\n";
+    }
+    return all.ok > 0 ? 0 : 1;
+}
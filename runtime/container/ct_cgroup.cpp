@@ -0,0 +1,233 @@
+#include "ct_cgroup.h"
+#include <sys/stat.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+static std::string g_parent;
+static std::string g_controllers;   // enabled for run cgroups, " cpu memory ... "
+
+static bool write_file(const std::string& path, const std::string& value) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    ssize_t n = ::write(fd, value.data(), value.size());
+    int err = errno;
+    ::close(fd);
+    errno = err;
+    return n == (ssize_t)value.size();
+}
+
+static std::string dirname_of(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == 0 || slash == std::string::npos ? "/" : path.substr(0, slash);
+}
+
+static std::string read_controllers(const std::string& file) {
+    std::ifstream in(file);
+    std::string c, out = " ";
+    while (in >> c) out += c + " ";
+    return out;
+}
+
+// Enables in cgroup the controllers its parent offers; on hybrid hosts some
+// stay on v1. Throws if one it offers cannot be enabled.
+static void enable_controllers(const std::string& cgroup) {
+    std::string available = read_controllers(cgroup + "/cgroup.controllers");
+    for (const char* c : {"cpu", "cpuset", "memory", "pids", "io"}) {
+        if (available.find(std::string(" ") + c + " ") == std::string::npos) continue;
+
+        if (!write_file(cgroup + "/cgroup.subtree_control", std::string("+") + c)) {
+            throw std::runtime_error(std::string("cgroup: enabling ") + c + " in " + cgroup +
+                                     " failed: " + strerror(errno));
+        }
+    }
+}
+
+// A non-root cgroup with processes cannot enable controllers for its
+// children, so move the ones in cgroup (kyntrixd itself, typically) into a
+// leaf beside the run parent
+static void evacuate(const std::string& cgroup, const std::string& leaf) {
+    if (::access((cgroup + "/cgroup.type").c_str(), F_OK) < 0) return;   // the root
+
+    std::ifstream procs(cgroup + "/cgroup.procs");
+    std::string pid;
+    bool created = false;
+    while (procs >> pid) {
+        if (!created) {
+            if (::mkdir(leaf.c_str(), 0755) < 0 && errno != EEXIST) {
+                throw std::runtime_error("cgroup: mkdir(" + leaf + ") failed: " + strerror(errno));
+            }
+            created = true;
+        }
+        if (!write_file(leaf + "/cgroup.procs", pid) && errno != ESRCH) {
+            throw std::runtime_error("cgroup: moving " + pid + " to " + leaf +
+                                     " failed: " + strerror(errno));
+        }
+    }
+}
+
+bool cgroup_init(const std::string& parent_path) {
+    std::string parent_of_parent = dirname_of(parent_path);
+    if (::access((parent_of_parent + "/cgroup.controllers").c_str(), R_OK) < 0) {
+        std::cerr << "cgroup: " << parent_of_parent
+                  << " is not a cgroup v2 hierarchy; running without resource limits\n";
+        return false;
+    }
+
+    if (::mkdir(parent_path.c_str(), 0755) < 0 && errno != EEXIST) {
+        std::cerr << "cgroup: mkdir(" << parent_path << ") failed: " << strerror(errno) << "\n";
+        return false;
+    }
+
+    // Controllers must be enabled at every level down to the run cgroups
+    std::string leaf = parent_of_parent + "/daemon";
+    if (leaf == parent_path) leaf += "-procs";
+    evacuate(parent_of_parent, leaf);
+    enable_controllers(parent_of_parent);
+    enable_controllers(parent_path);
+
+    g_controllers = read_controllers(parent_path + "/cgroup.subtree_control");
+    if (g_controllers == " ") {
+        std::cerr << "cgroup: no controllers available under " << parent_path
+                  << "; runs are accounted but not limited\n";
+    }
+
+    g_parent = parent_path;
+    return true;
+}
+
+bool cgroup_controller_enabled(const char* controller) {
+    return g_controllers.find(std::string(" ") + controller + " ") != std::string::npos;
+}
+
+std::string cgroup_create(const std::string& run_id, const CgroupLimits& limits) {
+    if (g_parent.empty()) {
+        throw std::runtime_error("cgroup hierarchy not initialized");
+    }
+    if (run_id.empty() || run_id.find('/') != std::string::npos || run_id[0] == '.') {
+        throw std::runtime_error("Invalid run id for cgroup: " + run_id);
+    }
+
+    // A leftover of an earlier daemon must not carry its limits and
+    // processes into this run
+    std::string path = g_parent + "/" + run_id;
+    if (::mkdir(path.c_str(), 0755) < 0) {
+        if (errno != EEXIST) {
+            throw std::runtime_error("mkdir(" + path + ") failed: " + strerror(errno));
+        }
+        if (!cgroup_remove(path) || ::mkdir(path.c_str(), 0755) < 0) {
+            throw std::runtime_error("cgroup " + path + " already exists and is in use");
+        }
+    }
+
+    struct Setting { const char* controller; const char* file; const std::string& value; };
+    const Setting settings[] = {
+        {"cpu",    "cpu.max",    limits.cpu_max},
+        {"memory", "memory.max", limits.memory_max},
+        {"pids",   "pids.max",   limits.pids_max},
+        {"io",     "io.max",     limits.io_max},
+        {"cpuset", "cpuset.mems", limits.cpuset_mems},
+        {"cpuset", "cpuset.cpus", limits.cpuset_cpus},
+    };
+
+    for (auto& s : settings) {
+        if (s.value.empty()) continue;
+
+        // Controllers still bound to a v1 hierarchy (hybrid hosts) cannot be
+        // limited here; the run is still accounted for
+        if (g_controllers.find(std::string(" ") + s.controller + " ") == std::string::npos) continue;
+
+        // io.max takes one device per write
+        std::istringstream lines(s.value);
+        std::string line;
+        while (std::getline(lines, line)) {
+            if (line.empty()) continue;
+            if (!write_file(path + "/" + s.file, line)) {
+                std::string err = strerror(errno);
+                ::rmdir(path.c_str());
+                throw std::runtime_error(std::string("cgroup: writing ") + s.file + "=" +
+                                         line + " failed: " + err);
+            }
+        }
+    }
+
+    return path;
+}
+
+bool cgroup_attach(const std::string& cgroup_path, pid_t pid) {
+    if (!write_file(cgroup_path + "/cgroup.procs", std::to_string(pid))) {
+        std::cerr << "cgroup: attaching " << pid << " to " << cgroup_path
+                  << " failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    return true;
+}
+
+static uint64_t read_u64(const std::string& path) {
+    std::ifstream in(path);
+    uint64_t v = 0;
+    in >> v;
+    return v;
+}
+
+CgroupUsage cgroup_read_usage(const std::string& cgroup_path) {
+    CgroupUsage u{};
+
+    std::ifstream cpu(cgroup_path + "/cpu.stat");
+    std::string key;
+    uint64_t value;
+    while (cpu >> key >> value) {
+        if (key == "usage_usec") u.cpu_usec = value;
+        else if (key == "user_usec") u.cpu_user_usec = value;
+        else if (key == "system_usec") u.cpu_system_usec = value;
+    }
+
+    u.memory_peak_bytes = read_u64(cgroup_path + "/memory.peak");
+
+    // io.stat: "MAJ:MIN rbytes=N wbytes=N rios=N ..." per device
+    std::ifstream io(cgroup_path + "/io.stat");
+    std::string line;
+    while (std::getline(io, line)) {
+        std::istringstream fields(line);
+        std::string field;
+        fields >> field;   // device
+        while (fields >> field) {
+            size_t eq = field.find('=');
+            if (eq == std::string::npos) continue;
+
+            uint64_t n = std::strtoull(field.c_str() + eq + 1, nullptr, 10);
+            if (field.compare(0, eq, "rbytes") == 0) u.io_read_bytes += n;
+            else if (field.compare(0, eq, "wbytes") == 0) u.io_write_bytes += n;
+        }
+    }
+
+    return u;
+}
+
+bool cgroup_signal(const std::string& cgroup_path, int sig) {
+    std::ifstream in(cgroup_path + "/cgroup.procs");
+    if (!in) return false;
+
+    pid_t pid;
+    while (in >> pid) {
+        ::kill(pid, sig);
+    }
+    return true;
+}
+
+bool cgroup_kill(const std::string& cgroup_path) {
+    return write_file(cgroup_path + "/cgroup.kill", "1");
+}
+
+bool cgroup_remove(const std::string& cgroup_path) {
+    return ::rmdir(cgroup_path.c_str()) == 0 || errno == ENOENT;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <sys/types.h>
+#include <cstdint>
+#include <string>
+
+// cgroup v2 limits for one run. Values are written verbatim to the matching
+// interface file; an empty string leaves the kernel default in place.
+struct CgroupLimits {
+    std::string cpu_max;      // "quota period", e.g. "200000 100000" = 2 CPUs
+    std::string memory_max;   // bytes or K/M/G suffix, or "max"
+    std::string pids_max;     // e.g. "512"
+    std::string io_max;       // "MAJ:MIN rbps=... wbps=..." lines
+    std::string cpuset_cpus;  // cpu list, e.g. "8-11"; set by the run scheduler
+    std::string cpuset_mems;  // NUMA nodes, e.g. "0"
+};
+
+// Per-run resource accounting read back from the run's cgroup.
+struct CgroupUsage {
+    uint64_t cpu_usec;
+    uint64_t cpu_user_usec;
+    uint64_t cpu_system_usec;
+    uint64_t memory_peak_bytes;   // memory.peak (0 on kernels < 5.19)
+    uint64_t io_read_bytes;
+    uint64_t io_write_bytes;
+};
+
+// Creates (if needed) the parent cgroup every run is placed under and enables
+// the cpu, cpuset, memory, pids and io controllers for its children. The
+// processes of the parent's parent (the daemon's own cgroup) move to a
+// "daemon" leaf beside it first. Returns false if cgroup v2 is unavailable;
+// callers then run containers without limits. Throws std::runtime_error if
+// an available controller cannot be enabled.
+bool cgroup_init(const std::string& parent_path);
+
+// True if cgroup_init() enabled controller (e.g. "cpuset") for run cgroups
+bool cgroup_controller_enabled(const char* controller);
+
+// Creates <parent>/<run_id>, replacing a stale one, and applies limits for the controllers enabled
+// by cgroup_init(). Throws std::runtime_error.
+std::string cgroup_create(const std::string& run_id, const CgroupLimits& limits);
+
+// Moves pid (and, for a container init, everything it later forks) into the cgroup.
+bool cgroup_attach(const std::string& cgroup_path, pid_t pid);
+
+CgroupUsage cgroup_read_usage(const std::string& cgroup_path);
+
+// Sends sig to every process currently listed in cgroup.procs.
+bool cgroup_signal(const std::string& cgroup_path, int sig);
+
+// Kills every process in the cgroup (cgroup.kill, Linux 5.14+).
+bool cgroup_kill(const std::string& cgroup_path);
+
+// Removes the cgroup; fails with EBUSY while it still has live processes.
+bool cgroup_remove(const std::string& cgroup_path);
@@ -0,0 +1,158 @@
+#include "ct_exec.h"
+#include "ct_telemetry.h"
+#include "ct_zygote.h"
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+
+#ifndef SYS_close_range
+#define SYS_close_range 436
+#endif
+
+extern char** environ;
+
+static ExecConfig g_exec_cfg;
+
+void configure_exec(const ExecConfig& cfg) {
+    g_exec_cfg = cfg;
+}
+
+static void set_env(std::vector<std::string>& env, const std::string& key, const std::string& value) {
+    std::string prefix = key + "=";
+    for (auto& e : env) {
+        if (e.compare(0, prefix.size(), prefix) == 0) {
+            e = prefix + value;
+            return;
+        }
+    }
+    env.push_back(prefix + value);
+}
+
+static size_t env_index(const std::vector<std::string>& env, const std::string& key) {
+    std::string prefix = key + "=";
+    for (size_t i = 0; i < env.size(); ++i) {
+        if (env[i].compare(0, prefix.size(), prefix) == 0) return i;
+    }
+    return env.size();
+}
+
+static void build_env(ExecSpec& spec, ContainerTemplate tmpl) {
+    for (char** e = environ; e && *e; ++e) {
+        spec.env_strings.emplace_back(*e);
+    }
+
+    auto& env = spec.env_strings;
+
+    // OpenTelemetry configuration
+    set_env(env, "OTEL_SERVICE_NAME", "user-script");
+    set_env(env, "OTEL_RESOURCE_ATTRIBUTES", "");   // bound per run
+
+    if (g_exec_cfg.telemetry_channel) {
+        // Spans go to the run's telemetry channel through agent_core, which
+        // flushes every 10ms; the daemon forwards them to ingestion
+        set_env(env, "KYNTRIX_TELEMETRY_FD", std::to_string(kTelemetryFd));
+        set_env(env, "KYNTRIX_FLUSH_INTERVAL", "10");
+        set_env(env, "KYNTRIX_FLUSH_MS", "10");
+        set_env(env, "OTEL_BSP_SCHEDULE_DELAY", "10");
+        set_env(env, "OTEL_TRACES_EXPORTER", "kyntrix");
+    } else {
+        set_env(env, "OTEL_EXPORTER_OTLP_ENDPOINT", "http://agents:4318");
+        set_env(env, "OTEL_EXPORTER_OTLP_PROTOCOL", "http/json");
+        set_env(env, "OTEL_BSP_SCHEDULE_DELAY", "100");  // Flush every 100ms
+        set_env(env, "OTEL_TRACES_EXPORTER", "otlp");
+    }
+    set_env(env, "OTEL_METRICS_EXPORTER", "none");
+    set_env(env, "OTEL_LOGS_EXPORTER", "none");
+
+    if (tmpl == ContainerTemplate::Node) {
+        // Node.js with OpenTelemetry auto-instrumentation
+        const std::string hook = g_exec_cfg.telemetry_channel
+            ? g_exec_cfg.node_otel_hook
+            : "@opentelemetry/auto-instrumentations-node/register";
+        set_env(env, "NODE_OPTIONS", "--require " + hook);
+    }
+}
+
+static void finish_spec(ExecSpec& spec) {
+    for (auto& s : spec.arg_strings) {
+        spec.argv.push_back(const_cast<char*>(s.c_str()));
+    }
+    spec.entry_slot = spec.argv.size();
+    spec.argv.push_back(spec.entry_path);
+    spec.argv.push_back(nullptr);
+
+    auto& env = spec.env_strings;
+    for (auto& s : spec.env_strings) {
+        spec.envp.push_back(const_cast<char*>(s.c_str()));
+    }
+    spec.envp.push_back(nullptr);
+    spec.resource_attrs_slot = env_index(env, "OTEL_RESOURCE_ATTRIBUTES");
+    spec.envp[spec.resource_attrs_slot] = spec.resource_attrs;
+
+    spec.resource_attrs[0] = '\0';
+    spec.entry_path[0] = '\0';
+}
+
+void build_exec_spec(ExecSpec& spec, ContainerTemplate tmpl) {
+    build_env(spec, tmpl);
+
+    if (tmpl == ContainerTemplate::Node) {
+        spec.arg_strings.push_back("node");
+    } else {
+        // Python with OpenTelemetry auto-instrumentation
+        spec.arg_strings.push_back("opentelemetry-instrument");
+        spec.arg_strings.push_back("python");
+    }
+    finish_spec(spec);
+}
+
+void build_zygote_exec_spec(ExecSpec& spec, int ctl_fd, const std::string& preload) {
+    build_env(spec, ContainerTemplate::Python);
+    set_env(spec.env_strings, kZygoteFdEnv, std::to_string(ctl_fd));
+    if (!preload.empty()) {
+        set_env(spec.env_strings, "KYNTRIX_ZYGOTE_PRELOAD", preload);
+    }
+
+    spec.arg_strings.push_back("opentelemetry-instrument");
+    spec.arg_strings.push_back("python");
+    spec.arg_strings.push_back("-m");
+    finish_spec(spec);
+
+    ::memcpy(spec.entry_path, "kyntrix_agent.zygote", sizeof("kyntrix_agent.zygote"));
+    ::memcpy(spec.resource_attrs, "OTEL_RESOURCE_ATTRIBUTES=", sizeof("OTEL_RESOURCE_ATTRIBUTES="));
+}
+
+void close_inherited_fds(int keep) {
+    // Drop every inherited daemon fd (client connections, other containers'
+    // control sockets) except stdio
+    if (keep > 3 && ::syscall(SYS_close_range, 3u, (unsigned)keep - 1, 0u) < 0) {
+        for (int fd = 3; fd < keep; ++fd) ::close(fd);
+    }
+    if (::syscall(SYS_close_range, (unsigned)keep + 1, ~0u, 0u) < 0) {
+        long max_fd = ::sysconf(_SC_OPEN_MAX);
+        for (int fd = keep + 1; fd < max_fd; ++fd) ::close(fd);
+    }
+}
+
+static bool append(char* dst, size_t cap, size_t& len, const char* src) {
+    size_t n = ::strlen(src);
+    if (len + n >= cap) return false;
+    ::memcpy(dst + len, src, n);
+    len += n;
+    dst[len] = '\0';
+    return true;
+}
+
+bool bind_exec_run(ExecSpec& spec, const char* run_id, const char* entry_script) {
+    size_t len = 0;
+    spec.resource_attrs[0] = '\0';
+    if (!append(spec.resource_attrs, sizeof(spec.resource_attrs), len, "OTEL_RESOURCE_ATTRIBUTES=kyntrix.run_id=") ||
+        !append(spec.resource_attrs, sizeof(spec.resource_attrs), len, run_id)) {
+        return false;
+    }
+
+    len = 0;
+    spec.entry_path[0] = '\0';
+    return append(spec.entry_path, sizeof(spec.entry_path), len, "/workspace/") &&
+           append(spec.entry_path, sizeof(spec.entry_path), len, entry_script);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "ct_namespace.h"
+#include <limits.h>
+#include <string>
+#include <vector>
+
+// Pre-built execve() arguments for a container entry point.
+//
+// Everything is assembled in the parent. The per-run values (run id, entry
+// script) live in fixed-size buffers so that a cloned child can patch them in
+// with bind_exec_run() without allocating: the daemon is multi-threaded and a
+// child of clone() may inherit a held malloc lock.
+struct ExecSpec {
+    ExecSpec() = default;
+    ExecSpec(const ExecSpec&) = delete;             // argv/envp point into this
+    ExecSpec& operator=(const ExecSpec&) = delete;
+
+    std::vector<std::string> arg_strings;
+    std::vector<std::string> env_strings;
+    std::vector<char*> argv;
+    std::vector<char*> envp;
+
+    char resource_attrs[512];
+    char entry_path[PATH_MAX];
+    size_t resource_attrs_slot = 0;   // index into envp
+    size_t entry_slot = 0;            // index into argv
+};
+
+struct ExecConfig {
+    // Containers get a telemetry channel (ct_telemetry.h) and export spans
+    // over it instead of OTLP/HTTP to the agents service
+    bool telemetry_channel = false;
+    // Module --require'd into Node containers to install the channel
+    // exporter (adapters/node-embedded/src/otel/register.ts)
+    std::string node_otel_hook = "/opt/kyntrix/node/otel/register.js";
+};
+
+// Applies to exec specs built afterwards; call before the warm pool starts.
+void configure_exec(const ExecConfig& cfg);
+
+void build_exec_spec(ExecSpec& spec, ContainerTemplate tmpl);
+
+// Python template environment, running the fork server in
+// adapters/python-embedded/zygote.py (ct_zygote.h) on control socket ctl_fd
+// instead of an entry script. preload: comma-separated modules it imports
+// before serving.
+void build_zygote_exec_spec(ExecSpec& spec, int ctl_fd, const std::string& preload);
+
+// Closes every fd above stderr except keep. Does not allocate.
+void close_inherited_fds(int keep);
+
+// Async-signal-safe; returns false if a value does not fit its buffer.
+bool bind_exec_run(ExecSpec& spec, const char* run_id, const char* entry_script);
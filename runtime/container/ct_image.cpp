@@ -1,20 +1,155 @@
 #include "ct_image.h"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <iostream>
 #include <string>
 #include <stdexcept>
 
+// Fixed scratch locations inside each container's private mount namespace
+static const char* kUpperDir = "/mnt/kyntrix-rw/upper";
+static const char* kWorkDir  = "/mnt/kyntrix-rw/work";
 
+// overlayfs mount data must fit in a single page
+static constexpr size_t kMaxMountData = 4096;
 
+static ImageStoreConfig g_store;
 
-std::string prepare_rootfs_for_template(ContainerTemplate tmpl) {
+void configure_image_store(const ImageStoreConfig& cfg) {
+    g_store = cfg;
+}
+
+const std::string& image_store_root() {
+    return g_store.root;
+}
+
+static const char* template_name(ContainerTemplate tmpl) {
     switch (tmpl) {
     case ContainerTemplate::Node:
-        return "/var/lib/kyntrix/images/node-rootfs";
-        break;
+        return "node";
     case ContainerTemplate::Python:
-        return "/var/lib/kyntrix/images/python-rootfs";
-        break;
+        return "python";
     default:
         throw std::runtime_error("Unknown container template");
-        break;
     }
-}
\ No newline at end of file
+}
+
+static bool is_dir(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static std::string layer_path(const std::string& digest) {
+    return g_store.root + "/layers/" + digest;
+}
+
+bool is_valid_digest(const std::string& digest) {
+    if (digest.empty() || digest.size() > 128) return false;
+    if (digest[0] == '.' || digest[0] == '-') return false;
+
+    for (char c : digest) {
+        bool ok = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+                  c == '-' || c == '_' || c == '.';
+        if (!ok) return false;
+    }
+    return true;
+}
+
+bool layer_exists(const std::string& digest) {
+    return is_valid_digest(digest) && is_dir(layer_path(digest));
+}
+
+static std::vector<std::string> read_manifest(const std::string& path) {
+    std::vector<std::string> layers;
+    std::ifstream in(path);
+    std::string line;
+
+    while (std::getline(in, line)) {
+        size_t end = line.find_last_not_of(" \t\r");
+        if (end == std::string::npos || line[0] == '#') continue;
+        line.resize(end + 1);
+
+        if (!is_valid_digest(line)) {
+            throw std::runtime_error("Invalid layer digest in " + path + ": " + line);
+        }
+        layers.push_back(layer_path(line));
+    }
+    return layers;
+}
+
+RootfsSpec prepare_rootfs_for_template(ContainerTemplate tmpl, const std::string& deps_key) {
+    std::string name = template_name(tmpl);
+    std::string manifest = g_store.root + "/images/" + name + ".layers";
+
+    RootfsSpec spec;
+    if (is_dir(g_store.root + "/images") && ::access(manifest.c_str(), R_OK) == 0) {
+        spec.layers = read_manifest(manifest);
+    } else {
+        spec.layers.push_back(g_store.root + "/images/" + name + "-rootfs");
+    }
+
+    if (!deps_key.empty()) {
+        if (!is_valid_digest(deps_key)) {
+            throw std::runtime_error("Invalid dependency layer key: " + deps_key);
+        }
+        spec.layers.push_back(layer_path(deps_key));
+    }
+
+    for (auto& l : spec.layers) {
+        if (!is_dir(l)) {
+            throw std::runtime_error("Missing image layer: " + l);
+        }
+    }
+    if (spec.layers.empty()) {
+        throw std::runtime_error("Image for template " + name + " has no layers");
+    }
+
+    // overlayfs lists lowerdirs top-most first
+    std::string lower;
+    for (auto it = spec.layers.rbegin(); it != spec.layers.rend(); ++it) {
+        if (!lower.empty()) lower += ':';
+        lower += *it;
+    }
+
+    spec.overlay_opts = "lowerdir=" + lower +
+                        ",upperdir=" + kUpperDir +
+                        ",workdir=" + kWorkDir;
+    if (spec.overlay_opts.size() >= kMaxMountData) {
+        throw std::runtime_error("Too many image layers for template " + name);
+    }
+
+    spec.tmpfs_opts = "size=" + g_store.tmpfs_size + ",mode=0755";
+    return spec;
+}
+
+bool import_layer(const std::string& src_dir, const std::string& digest) {
+    if (!is_valid_digest(digest) || !is_dir(src_dir)) {
+        return false;
+    }
+
+    std::string layers_dir = g_store.root + "/layers";
+    if (::mkdir(layers_dir.c_str(), 0755) < 0 && errno != EEXIST) {
+        std::cerr << "mkdir(" << layers_dir << ") failed: " << strerror(errno) << "\n";
+        return false;
+    }
+
+    std::string dst = layer_path(digest);
+    if (is_dir(dst)) {
+        return true;   // already cached
+    }
+
+    // rename() is atomic, so a concurrent import of the same digest either
+    // wins or finds the finished layer; readers never see a partial tree
+    if (::rename(src_dir.c_str(), dst.c_str()) < 0) {
+        if ((errno == EEXIST || errno == ENOTEMPTY) && is_dir(dst)) {
+            return true;
+        }
+        std::cerr << "rename(" << src_dir << " -> " << dst << ") failed: "
+                  << strerror(errno) << "\n";
+        return false;
+    }
+    return true;
+}
@@ -1,7 +1,43 @@
 #pragma once
 #include "ct_namespace.h"
 #include <string>
+#include <vector>
 
+// Content-addressed, read-only layer store:
+//   <root>/layers/<digest>/          layer trees, never modified once present
+//   <root>/images/<template>.layers  one digest per line, base layer first
+//
+// A template without a .layers manifest falls back to the legacy single-tree
+// image at <root>/images/<template>-rootfs. Either way the container gets an
+// overlayfs view with a private tmpfs upper dir, so setup cost does not depend
+// on image size and no run can modify a shared layer.
+struct ImageStoreConfig {
+    std::string root       = "/var/lib/kyntrix";
+    std::string tmpfs_size = "256m";   // per-run writable upper dir
+};
 
+// Call once at startup, before any container is spawned.
+void configure_image_store(const ImageStoreConfig& cfg);
 
-std::string prepare_rootfs_for_template(ContainerTemplate tmpl);
\ No newline at end of file
+const std::string& image_store_root();
+
+struct RootfsSpec {
+    std::vector<std::string> layers;   // absolute layer dirs, base first
+    std::string overlay_opts;          // prebuilt overlayfs mount data
+    std::string tmpfs_opts;            // prebuilt tmpfs mount data for upper/work
+};
+
+// Resolves the layer chain for a template, plus the cached dependency layer
+// named by deps_key (e.g. a lockfile hash) when one is given.
+// Throws std::runtime_error if the template or a referenced layer is missing.
+RootfsSpec prepare_rootfs_for_template(ContainerTemplate tmpl,
+                                       const std::string& deps_key = "");
+
+bool layer_exists(const std::string& digest);
+
+// Atomically moves a prepared directory into the store as layer `digest`.
+// Returns true if the layer is present afterwards (including when it was
+// already cached, in which case src_dir is left untouched).
+bool import_layer(const std::string& src_dir, const std::string& digest);
+
+bool is_valid_digest(const std::string& digest);
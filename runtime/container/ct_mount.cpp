@@ -11,6 +11,8 @@
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <limits.h>
+#include <stdio.h>
 
 #include <string>
 #include <iostream>
@@ -33,7 +35,29 @@ static bool ensure_dir(const char* path, mode_t mode = 0755) {
     return true;
 }
 
-bool setup_rootfs_and_mounts(const std::string& rootfs_path, const std::string& workspace_path) {
+bool setup_rootfs(const RootfsSpec& rootfs, SpawnTimings* timings) {
+    uint64_t since = monotonic_ns();
+
+    // Keep our mounts out of the host namespace (and let pivot_root work
+    // when / is a shared mount)
+    if (::mount(nullptr, "/", nullptr, MS_REC | MS_PRIVATE, nullptr) < 0) {
+        std::cerr << "mount(MS_PRIVATE /) failed: " << strerror(errno) << "\n";
+        return false;
+    }
+
+    // Per-run writable layer; lives only as long as this mount namespace
+    const char* scratch = "/mnt/kyntrix-rw";
+    if (!ensure_dir(scratch)) {
+        return false;
+    }
+    if (::mount("tmpfs", scratch, "tmpfs", MS_NOSUID | MS_NODEV,
+                rootfs.tmpfs_opts.c_str()) < 0) {
+        std::cerr << "mount(tmpfs " << scratch << ") failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    if (!ensure_dir("/mnt/kyntrix-rw/upper") || !ensure_dir("/mnt/kyntrix-rw/work")) {
+        return false;
+    }
 
     const char* new_root_mount = "/mnt/root";
 
@@ -41,12 +65,13 @@ bool setup_rootfs_and_mounts(const std::string& rootfs_path, const std::string&
         return false;
     }
 
-    if (::mount(rootfs_path.c_str(), new_root_mount, nullptr,
-           MS_BIND | MS_REC, nullptr) < 0) {
-        std::cerr << "mount(BIND " << rootfs_path << " -> " << new_root_mount
+    if (::mount("overlay", new_root_mount, "overlay", 0,
+                rootfs.overlay_opts.c_str()) < 0) {
+        std::cerr << "mount(overlay -> " << new_root_mount
            << ") failed: " << strerror(errno) << "\n";
         return false;
     }
+    phase_mark(timings, SpawnPhase::Overlay, since);
 
     if (::chdir(new_root_mount) < 0) {
         std::cerr << "chdir(" << new_root_mount << ") failed: " << strerror(errno) << "\n";
@@ -67,6 +92,7 @@ bool setup_rootfs_and_mounts(const std::string& rootfs_path, const std::string&
         std::cerr << "chdir(/) after pivot_root failed: " << strerror(errno) << "\n";
         return false;
     }
+    phase_mark(timings, SpawnPhase::PivotRoot, since);
 
     if (!ensure_dir("/proc")) {
         return false;
@@ -87,15 +113,60 @@ bool setup_rootfs_and_mounts(const std::string& rootfs_path, const std::string&
     if (!ensure_dir("/workspace")) {
         return false;
     }
-    if (::mount(workspace_path.c_str(), "/workspace", nullptr,
+
+    ensure_dir("/tmp", 01777);
+    phase_mark(timings, SpawnPhase::SysMounts, since);
+
+    return true;
+}
+
+static bool mount_workspace_overlay(const char* source) {
+    // The run's tmpfs is still reachable through the old root
+    const char* upper = "/old_root/mnt/kyntrix-rw/ws-upper";
+    const char* work  = "/old_root/mnt/kyntrix-rw/ws-work";
+    if (!ensure_dir(upper) || !ensure_dir(work)) {
+        return false;
+    }
+
+    // overlayfs treats these as separators in mount data
+    if (::strpbrk(source, ",:")) {
+        std::cerr << "workspace path not usable as overlay lowerdir: " << source << "\n";
+        return false;
+    }
+
+    static char opts[PATH_MAX + 256];
+    int n = ::snprintf(opts, sizeof(opts), "lowerdir=%s,upperdir=%s,workdir=%s",
+                       source, upper, work);
+    if (n < 0 || (size_t)n >= sizeof(opts)) {
+        return false;
+    }
+
+    if (::mount("overlay", "/workspace", "overlay", 0, opts) < 0) {
+        std::cerr << "mount(overlay workspace " << source << " -> /workspace"
+                  << ") failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool mount_workspace(const char* workspace_path, WorkspaceMount mode) {
+    char source[PATH_MAX];
+    int n = ::snprintf(source, sizeof(source), "/old_root%s", workspace_path);
+    if (n < 0 || (size_t)n >= sizeof(source) || workspace_path[0] != '/') {
+        return false;
+    }
+
+    if (mode == WorkspaceMount::Snapshot) {
+        if (!mount_workspace_overlay(source)) {
+            return false;
+        }
+    } else if (::mount(source, "/workspace", nullptr,
                 MS_BIND | MS_REC, nullptr) < 0) {
         std::cerr << "mount(BIND workspace " << workspace_path << " -> /workspace"
                   << ") failed: " << strerror(errno) << "\n";
         return false;
     }
 
-    ensure_dir("/tmp", 01777);
-
     if (::umount2("/old_root", MNT_DETACH) < 0) {
         std::cerr << "umount2(/old_root) failed: " << strerror(errno) << "\n";
     }
@@ -103,5 +174,15 @@ bool setup_rootfs_and_mounts(const std::string& rootfs_path, const std::string&
     return true;
 }
 
+bool setup_rootfs_and_mounts(const RootfsSpec& rootfs, const std::string& workspace_path,
+                             WorkspaceMount mode, SpawnTimings* timings) {
+    if (!setup_rootfs(rootfs, timings)) return false;
+
+    uint64_t since = monotonic_ns();
+    if (!mount_workspace(workspace_path.c_str(), mode)) return false;
+    phase_mark(timings, SpawnPhase::Workspace, since);
+    return true;
+}
+
 
 #endif // __linux__
\ No newline at end of file
@@ -1,10 +1,30 @@
 #pragma once
+#include "ct_image.h"
+#include "ct_namespace.h"
+#include "ct_timing.h"
 #include <string>
 
+// Mounts the image layers as an overlay (tmpfs upper dir), pivots into it and
+// mounts /proc, /sys and /tmp. The host root stays reachable at /old_root
+// until mount_workspace() detaches it, so a parked container can bind a
+// workspace it only learns about later. Does not allocate.
+// @param rootfs: Resolved layers and mount options from prepare_rootfs_for_template()
+// @param timings: Optional; receives the Overlay, PivotRoot and SysMounts phases
+bool setup_rootfs(const RootfsSpec& rootfs, SpawnTimings* timings = nullptr);
+
+// Mounts a host workspace (resolved through /old_root) at /workspace and
+// detaches the old root. A Snapshot workspace becomes the read-only lower dir
+// of an overlay whose upper dir lives on the run's tmpfs. Does not allocate;
+// safe in a cloned child.
+// @param workspace_path: Absolute host path of the user's workspace
+bool mount_workspace(const char* workspace_path, WorkspaceMount mode);
+
 // Sets up rootfs with pivot_root and mounts workspace into container
-// @param rootfs_path: Path to the rootfs template (e.g., /var/kyntrix/images/node)
+// @param rootfs: Resolved layers and mount options from prepare_rootfs_for_template()
 // @param workspace_path: Path to user's workspace to bind mount at /workspace
-bool setup_rootfs_and_mounts(const std::string& rootfs_path,
-    const std::string& workspace_path);
+// @param timings: Optional; receives the phases from Overlay to Workspace
+bool setup_rootfs_and_mounts(const RootfsSpec& rootfs,
+    const std::string& workspace_path, WorkspaceMount mode,
+    SpawnTimings* timings = nullptr);
 
 
@@ -6,7 +6,16 @@
 #include "ct_namespace.h"
 #include "ct_mount.h"
 #include "ct_image.h"
+#include "ct_exec.h"
+#include "ct_cgroup.h"
+#include "ct_telemetry.h"
+#include "ct_topology.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
 #include <sched.h>
+#include <errno.h>
+#include <iostream>
 #include <memory>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -16,40 +25,147 @@
 static int container_child_main(void* arg);
 
 struct ContainerArgs {
-    ContainerTemplate tmpl;
-    std::string run_id;
-    std::string workspace_path;
-    std::string entry_script;
-    std::string rootfs_path;
+    RunSpec run;
+    RootfsSpec rootfs;
+    ExecSpec exec;
+    int go_fd;          // parent writes one byte once the cgroup is joined
+    int go_write_fd;    // parent's end, inherited by clone(); child closes it
+    int report_fd;      // close-on-exec; the child sends its SpawnReport here
+    SpawnTimings timings;
 };
 
+// Longest a child may take from clone() to exec
+static constexpr int kExecTimeoutMs = 10000;
+
+// Reads exactly len bytes, or fails on EOF, error or timeout
+static bool read_full(int fd, void* buf, size_t len, int timeout_ms) {
+    char* p = (char*)buf;
+    while (len > 0) {
+        pollfd pfd{fd, POLLIN, 0};
+        int r = ::poll(&pfd, 1, timeout_ms);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+
+        ssize_t n = ::read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// The report pipe is close-on-exec: EOF after the report means the entry
+// point is running, a further byte means execvpe() returned
+static bool wait_exec(int fd, SpawnTimings* timings) {
+    SpawnReport report;
+    if (!read_full(fd, &report, sizeof(report), kExecTimeoutMs)) return false;
 
+    char failed;
+    if (read_full(fd, &failed, 1, kExecTimeoutMs)) return false;
 
+    if (timings) {
+        for (size_t i = (size_t)SpawnPhase::Overlay; i < (size_t)SpawnPhase::Exec; ++i) {
+            timings->ns[i] = report.timings.ns[i];
+        }
+        timings->ns[(size_t)SpawnPhase::Exec] = monotonic_ns() - report.exec_at;
+    }
+    return true;
+}
 
-pid_t spawn_container(ContainerTemplate tmpl,
-                        const std::string& run_id,
-                        const std::string& workspace_path,
-                        const std::string& entry_script) {
-    ContainerArgs* cargs = new ContainerArgs;
-    cargs->tmpl          = tmpl;
-    cargs->run_id        = run_id;
-    cargs->workspace_path = workspace_path;
-    cargs->entry_script  = entry_script;
 
-    // Prepare rootfs 
-    cargs->rootfs_path   = prepare_rootfs_for_template(tmpl);
+
+pid_t spawn_container(ContainerTemplate tmpl, const RunSpec& run, SpawnTimings* timings) {
+    uint64_t since = monotonic_ns();
+
+    std::unique_ptr<ContainerArgs> cargs(new ContainerArgs);
+    cargs->run = run;
+    cargs->go_fd = -1;
+    cargs->go_write_fd = -1;
+    cargs->timings = SpawnTimings{};
+
+    // Resolve image layers (throws if the image is incomplete)
+    cargs->rootfs = prepare_rootfs_for_template(tmpl, run.deps_key);
+    phase_mark(timings, SpawnPhase::Resolve, since);
+
+    // argv/envp are built here: the cloned child must not allocate
+    build_exec_spec(cargs->exec, tmpl);
+    if (!bind_exec_run(cargs->exec, run.run_id.c_str(), run.entry_script.c_str())) {
+        return -1;
+    }
+    phase_mark(timings, SpawnPhase::ExecSpec, since);
+
+    int report[2];
+    if (::pipe2(report, O_CLOEXEC) < 0) {
+        return -1;
+    }
+    cargs->report_fd = report[1];
+
+    // The child holds until it has been moved into its cgroup, so none of
+    // its work is charged to the daemon, and pinned to its CPUs
+    int go[2] = {-1, -1};
+    if (!run.cgroup_path.empty() || !run.cpus.empty()) {
+        if (::pipe2(go, O_CLOEXEC) < 0) {
+            ::close(report[0]); ::close(report[1]);
+            return -1;
+        }
+        cargs->go_fd = go[0];
+        cargs->go_write_fd = go[1];
+    }
 
     // Allocate stack for clone
     const int stack_size = 1024 * 1024;
     void* stack = ::malloc(stack_size);
+    if (!stack) {
+        if (go[0] >= 0) { ::close(go[0]); ::close(go[1]); }
+        ::close(report[0]); ::close(report[1]);
+        return -1;
+    }
     void* stack_top = (char*)stack + stack_size;
 
-    int flags = CLONE_NEWNS | CLONE_NEWPID | CLONE_NEWNET | SIGCHLD;
+    int flags = CLONE_NEWNS | CLONE_NEWPID | SIGCHLD;
+    if (run.netns_fd < 0) {
+        flags |= CLONE_NEWNET;
+    }
+
+    pid_t child_pid = ::clone(container_child_main, stack_top, flags, cargs.get());
+
+    // No CLONE_VM: the child runs on its own copy of the stack
+    ::free(stack);
+    ::close(report[1]);
 
-    pid_t child_pid = ::clone(container_child_main, stack_top, flags, cargs);
     if (child_pid < 0) {
-        ::free(stack);
-        delete cargs;
+        if (go[0] >= 0) { ::close(go[0]); ::close(go[1]); }
+        ::close(report[0]);
+        return -1;
+    }
+    phase_mark(timings, SpawnPhase::Clone, since);
+
+    if (go[0] >= 0) {
+        ::close(go[0]);
+        bool joined = run.cgroup_path.empty() || cgroup_attach(run.cgroup_path, child_pid);
+        if (joined && !run.cpus.empty() && !pin_process(child_pid, run.cpus)) {
+            std::cerr << "spawn_container: pinning " << run.run_id << " to its cpus failed\n";
+        }
+        // Closing without a byte tells the child to give up
+        if (joined) {
+            (void)!::write(go[1], "g", 1);
+        }
+        ::close(go[1]);
+        if (!joined) {
+            ::close(report[0]);
+            ::kill(child_pid, SIGKILL);
+            ::waitpid(child_pid, nullptr, 0);
+            return -1;
+        }
+    }
+    phase_mark(timings, SpawnPhase::Cgroup, since);
+
+    bool exec_ok = wait_exec(report[0], timings);
+    ::close(report[0]);
+    if (!exec_ok) {
+        ::kill(child_pid, SIGKILL);
+        ::waitpid(child_pid, nullptr, 0);
         return -1;
     }
 
@@ -58,51 +174,41 @@ pid_t spawn_container(ContainerTemplate tmpl,
 }
 
 static int container_child_main(void* arg) {
-    std::unique_ptr<ContainerArgs> cargs((ContainerArgs*)arg);
+    // Runs on a copy of the parent's address space: no allocation, no frees
+    ContainerArgs* cargs = (ContainerArgs*)arg;
 
-    // Mount & pivot_root into rootfs
-    if (!setup_rootfs_and_mounts(cargs->rootfs_path, cargs->workspace_path)) {
+    if (cargs->go_fd >= 0) {
+        ::close(cargs->go_write_fd);
+
+        char go;
+        if (::read(cargs->go_fd, &go, 1) != 1) {
+            return 1;
+        }
+        ::close(cargs->go_fd);
+    }
+
+    // Before /sys is mounted, so it shows the run's interfaces
+    if (cargs->run.netns_fd >= 0 && ::setns(cargs->run.netns_fd, CLONE_NEWNET) < 0) {
         return 1;
     }
 
-    // OpenTelemetry configuration
-    ::setenv("OTEL_SERVICE_NAME", "user-script", 1);
-
-    std::string resource_attrs = "kyntrix.run_id=" + cargs->run_id;
-    ::setenv("OTEL_RESOURCE_ATTRIBUTES", resource_attrs.c_str(), 1);
-
-    ::setenv("OTEL_EXPORTER_OTLP_ENDPOINT", "http://agents:4318", 1);
-    ::setenv("OTEL_EXPORTER_OTLP_PROTOCOL", "http/json", 1);
-    ::setenv("OTEL_BSP_SCHEDULE_DELAY", "100", 1);  // Flush every 100ms
-    ::setenv("OTEL_TRACES_EXPORTER", "otlp", 1);
-    ::setenv("OTEL_METRICS_EXPORTER", "none", 1);
-    ::setenv("OTEL_LOGS_EXPORTER", "none", 1);
-
-    // Build argv - need to keep strings alive until execvp
-    std::vector<std::string> arg_strings;
-    std::vector<char*> argv;
-
-    if (cargs->tmpl == ContainerTemplate::Node) {
-        // Node.js with OpenTelemetry auto-instrumentation
-        ::setenv("NODE_OPTIONS", "--require @opentelemetry/auto-instrumentations-node/register", 1);
-
-        arg_strings.push_back("node");
-        arg_strings.push_back("/workspace/" + cargs->entry_script);
-    } else {
-        // Python with OpenTelemetry auto-instrumentation
-        arg_strings.push_back("opentelemetry-instrument");
-        arg_strings.push_back("python");
-        arg_strings.push_back("/workspace/" + cargs->entry_script);
+    // Mount & pivot_root into rootfs
+    if (!setup_rootfs_and_mounts(cargs->rootfs, cargs->run.workspace_path, cargs->run.ws_mount,
+                                 &cargs->timings)) {
+        return 1;
     }
 
-    // Build argv from persistent strings
-    for (auto& s : arg_strings) {
-        argv.push_back(const_cast<char*>(s.c_str()));
+    if (cargs->run.telemetry_fd >= 0 && !telemetry_install(cargs->run.telemetry_fd)) {
+        return 1;
     }
-    argv.push_back(nullptr);
 
-    ::execvp(argv[0], argv.data());
+    SpawnReport report{cargs->timings, monotonic_ns()};
+    if (::write(cargs->report_fd, &report, sizeof(report)) != (ssize_t)sizeof(report)) {
+        return 1;
+    }
+    ::execvpe(cargs->exec.argv[0], cargs->exec.argv.data(), cargs->exec.envp.data());
 
+    (void)!::write(cargs->report_fd, "E", 1);
     return 1;
 }
 
@@ -1,5 +1,8 @@
 #pragma once
+#include "ct_timing.h"
+#include <sys/types.h>
 #include <string>
+#include <vector>
 
 
 enum class ContainerTemplate {
@@ -8,8 +11,32 @@ enum class ContainerTemplate {
 
 };
 
+// How the run's workspace appears at /workspace
+enum class WorkspaceMount {
+    Bind,       // host directory, bound read-write
+    Snapshot    // immutable snapshot (ct_workspace.h) under a per-run overlay
+};
+
 
-pid_t spawn_container(ContainerTemplate ct,
-    const std::string& run_id, const std::string& workspace_path,
-    const std::string& entry_script);
+// Everything specific to one run of a template.
+struct RunSpec {
+    std::string run_id;
+    std::string workspace_path;
+    std::string entry_script;
+    std::string deps_key;        // optional cached dependency layer (ct_image.h)
+    WorkspaceMount ws_mount = WorkspaceMount::Bind;
+    std::string cgroup_path;     // optional; the container joins it before exec
+    std::vector<int> cpus;       // optional; the container is pinned to them
+                                 // before exec (runs without a cpuset cgroup)
+    int telemetry_fd = -1;       // optional; container end of the run's
+                                 // telemetry channel (ct_telemetry.h)
+    int netns_fd = -1;           // optional; network namespace the container
+                                 // joins instead of a fresh one (ct_netns.h)
+};
 
+// Cold-starts a container and returns the pid of its init once it has
+// exec'd the entry point, or -1. Throws std::runtime_error if the image
+// cannot be resolved.
+// @param timings: Optional; receives every phase from Resolve to Exec
+pid_t spawn_container(ContainerTemplate ct, const RunSpec& run,
+                      SpawnTimings* timings = nullptr);
@@ -0,0 +1,545 @@
+#ifdef __linux__
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "ct_netns.h"
+#include <linux/if_link.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/veth.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sched.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+extern char** environ;
+
+const char* net_policy_name(NetPolicy p) {
+    switch (p) {
+        case NetPolicy::None:     return "none";
+        case NetPolicy::Loopback: return "loopback";
+        case NetPolicy::Egress:   return "egress";
+    }
+    return "unknown";
+}
+
+bool parse_net_policy(const std::string& name, NetPolicy& out) {
+    if (name == "none")     { out = NetPolicy::None;     return true; }
+    if (name == "loopback") { out = NetPolicy::Loopback; return true; }
+    if (name == "egress")   { out = NetPolicy::Egress;   return true; }
+    return false;
+}
+
+// "a.b.c.d/n" (or a bare address, /32) in host order
+static bool parse_cidr(const std::string& s, uint32_t& addr, int& prefix) {
+    size_t slash = s.find('/');
+    std::string ip = s.substr(0, slash);
+    prefix = 32;
+    if (slash != std::string::npos) {
+        char* end = nullptr;
+        long n = std::strtol(s.c_str() + slash + 1, &end, 10);
+        if (end == s.c_str() + slash + 1 || *end != '\0' || n < 0 || n > 32) return false;
+        prefix = (int)n;
+    }
+
+    in_addr a{};
+    if (::inet_pton(AF_INET, ip.c_str(), &a) != 1) return false;
+    uint32_t mask = prefix == 0 ? 0 : ~0u << (32 - prefix);
+    addr = ntohl(a.s_addr) & mask;
+    return true;
+}
+
+// One rtnetlink request, built in place
+struct NlMsg {
+    alignas(nlmsghdr) char buf[1024];
+
+    NlMsg(uint16_t type, uint16_t flags) {
+        ::memset(buf, 0, sizeof(buf));
+        hdr()->nlmsg_len = NLMSG_LENGTH(0);
+        hdr()->nlmsg_type = type;
+        hdr()->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK | flags;
+    }
+
+    nlmsghdr* hdr() { return (nlmsghdr*)buf; }
+    char* tail() { return buf + NLMSG_ALIGN(hdr()->nlmsg_len); }
+
+    // Fixed-size header of the request (ifinfomsg, ifaddrmsg, rtmsg)
+    void* body(size_t len) {
+        void* p = tail();
+        hdr()->nlmsg_len = NLMSG_ALIGN(hdr()->nlmsg_len) + (uint32_t)len;
+        return p;
+    }
+
+    rtattr* attr(uint16_t type, const void* data, size_t len) {
+        rtattr* a = (rtattr*)tail();
+        a->rta_type = type;
+        a->rta_len = (uint16_t)RTA_LENGTH(len);
+        if (len) ::memcpy(RTA_DATA(a), data, len);
+        hdr()->nlmsg_len = NLMSG_ALIGN(hdr()->nlmsg_len) + RTA_ALIGN(a->rta_len);
+        return a;
+    }
+
+    rtattr* attr(uint16_t type, const std::string& s) { return attr(type, s.c_str(), s.size() + 1); }
+    rtattr* attr(uint16_t type, uint32_t v) { return attr(type, &v, sizeof(v)); }
+
+    rtattr* nest(uint16_t type) { return attr(type, nullptr, 0); }
+    void end(rtattr* nest) { nest->rta_len = (uint16_t)(tail() - (char*)nest); }
+};
+
+static int nl_open() {
+    int fd = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) return -1;
+    sockaddr_nl sa{};
+    sa.nl_family = AF_NETLINK;
+    if (::bind(fd, (sockaddr*)&sa, sizeof(sa)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Sends one request and waits for its ack; false with errno set on a NACK
+static bool nl_talk(int fd, NlMsg& m) {
+    if (::send(fd, m.buf, m.hdr()->nlmsg_len, 0) != (ssize_t)m.hdr()->nlmsg_len) return false;
+
+    alignas(nlmsghdr) char reply[4096];
+    for (;;) {
+        ssize_t n = ::recv(fd, reply, sizeof(reply), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+
+        for (nlmsghdr* h = (nlmsghdr*)reply; NLMSG_OK(h, (size_t)n); h = NLMSG_NEXT(h, n)) {
+            if (h->nlmsg_type != NLMSG_ERROR) continue;
+            int err = ((nlmsgerr*)NLMSG_DATA(h))->error;
+            errno = -err;
+            return err == 0;
+        }
+    }
+}
+
+// Brings a link up, optionally enslaving it to master
+static bool nl_link_up(int fd, int ifindex, int master) {
+    NlMsg m(RTM_NEWLINK, 0);
+    ifinfomsg* ifi = (ifinfomsg*)m.body(sizeof(ifinfomsg));
+    ifi->ifi_family = AF_UNSPEC;
+    ifi->ifi_index = ifindex;
+    ifi->ifi_flags = IFF_UP;
+    ifi->ifi_change = IFF_UP;
+    if (master > 0) m.attr(IFLA_MASTER, (uint32_t)master);
+    return nl_talk(fd, m);
+}
+
+// A veth pair: name here, peer in the namespace of peer_ns_fd
+static bool nl_add_veth(int fd, const std::string& name, const std::string& peer, int peer_ns_fd) {
+    NlMsg m(RTM_NEWLINK, NLM_F_CREATE | NLM_F_EXCL);
+    ((ifinfomsg*)m.body(sizeof(ifinfomsg)))->ifi_family = AF_UNSPEC;
+    m.attr(IFLA_IFNAME, name);
+
+    rtattr* info = m.nest(IFLA_LINKINFO);
+    m.attr(IFLA_INFO_KIND, std::string("veth"));
+    rtattr* data = m.nest(IFLA_INFO_DATA);
+    rtattr* peer_info = m.nest(VETH_INFO_PEER);
+    ((ifinfomsg*)m.body(sizeof(ifinfomsg)))->ifi_family = AF_UNSPEC;
+    m.attr(IFLA_IFNAME, peer);
+    m.attr(IFLA_NET_NS_FD, (uint32_t)peer_ns_fd);
+    m.end(peer_info);
+    m.end(data);
+    m.end(info);
+    return nl_talk(fd, m);
+}
+
+static bool nl_add_bridge(int fd, const std::string& name) {
+    NlMsg m(RTM_NEWLINK, NLM_F_CREATE | NLM_F_EXCL);
+    ((ifinfomsg*)m.body(sizeof(ifinfomsg)))->ifi_family = AF_UNSPEC;
+    m.attr(IFLA_IFNAME, name);
+    rtattr* info = m.nest(IFLA_LINKINFO);
+    m.attr(IFLA_INFO_KIND, std::string("bridge"));
+    m.end(info);
+    return nl_talk(fd, m) || errno == EEXIST;
+}
+
+// Keeps a bridge port from talking to the other ports (runs reach the
+// gateway, not each other)
+static bool nl_isolate_port(int fd, int ifindex) {
+    NlMsg m(RTM_SETLINK, 0);
+    ifinfomsg* ifi = (ifinfomsg*)m.body(sizeof(ifinfomsg));
+    ifi->ifi_family = AF_BRIDGE;
+    ifi->ifi_index = ifindex;
+    rtattr* prot = m.nest(IFLA_PROTINFO | NLA_F_NESTED);
+    uint8_t on = 1;
+    m.attr(IFLA_BRPORT_ISOLATED, &on, sizeof(on));
+    m.end(prot);
+    return nl_talk(fd, m);
+}
+
+static bool nl_add_addr(int fd, int ifindex, uint32_t addr, int prefix) {
+    NlMsg m(RTM_NEWADDR, NLM_F_CREATE | NLM_F_REPLACE);
+    ifaddrmsg* ifa = (ifaddrmsg*)m.body(sizeof(ifaddrmsg));
+    ifa->ifa_family = AF_INET;
+    ifa->ifa_prefixlen = (uint8_t)prefix;
+    ifa->ifa_index = (uint32_t)ifindex;
+    uint32_t a = htonl(addr);
+    m.attr(IFA_LOCAL, a);
+    m.attr(IFA_ADDRESS, a);
+    return nl_talk(fd, m);
+}
+
+static bool nl_add_route(int fd, uint32_t dst, int prefix, uint32_t gateway) {
+    NlMsg m(RTM_NEWROUTE, NLM_F_CREATE | NLM_F_EXCL);
+    rtmsg* rt = (rtmsg*)m.body(sizeof(rtmsg));
+    rt->rtm_family = AF_INET;
+    rt->rtm_dst_len = (uint8_t)prefix;
+    rt->rtm_table = RT_TABLE_MAIN;
+    rt->rtm_protocol = RTPROT_BOOT;
+    rt->rtm_scope = RT_SCOPE_UNIVERSE;
+    rt->rtm_type = RTN_UNICAST;
+    if (prefix > 0) m.attr(RTA_DST, htonl(dst));
+    m.attr(RTA_GATEWAY, htonl(gateway));
+    return nl_talk(fd, m) || errno == EEXIST;
+}
+
+static std::string format_addr(uint32_t addr) {
+    in_addr a{htonl(addr)};
+    char buf[INET_ADDRSTRLEN];
+    return ::inet_ntop(AF_INET, &a, buf, sizeof(buf));
+}
+
+// One nft invocation; commands separated by ';'
+static bool run_nft(const std::string& script) {
+    char* argv[] = {const_cast<char*>("nft"), const_cast<char*>(script.c_str()), nullptr};
+
+    posix_spawn_file_actions_t fa;
+    ::posix_spawn_file_actions_init(&fa);
+    ::posix_spawn_file_actions_addopen(&fa, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    pid_t pid;
+    int rc = ::posix_spawnp(&pid, "nft", &fa, nullptr, argv, environ);
+    ::posix_spawn_file_actions_destroy(&fa);
+    if (rc != 0) {
+        errno = rc;
+        return false;
+    }
+
+    int status = 0;
+    while (::waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return false;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+NetnsPool::NetnsPool(const NetnsPoolConfig& cfg)
+    : m_cfg(cfg), m_host_fd(-1), m_firewall(false), m_next_if(0), m_bridge_ready(false),
+      m_built(0), m_misses(0), m_failures(0), m_stopping(false) {
+    uint32_t base;
+    if (!parse_cidr(cfg.subnet, base, m_prefix) || m_prefix < 8 || m_prefix > 30) {
+        throw std::runtime_error("netns: invalid subnet " + cfg.subnet);
+    }
+    m_gateway   = base + 1;
+    m_next_addr = base + 2;
+    m_last_addr = (base | (~0u >> m_prefix)) - 1;
+
+    for (const std::string& cidr : cfg.egress_allow) {
+        Route r;
+        if (!parse_cidr(cidr, r.dst, r.prefix)) {
+            throw std::runtime_error("netns: invalid egress CIDR " + cidr);
+        }
+        m_routes.push_back(r);
+    }
+    if (m_routes.empty()) {
+        m_routes.push_back(Route{0, 0});
+    }
+
+    m_host_fd = ::open("/proc/thread-self/ns/net", O_RDONLY | O_CLOEXEC);
+    if (m_host_fd < 0) {
+        throw std::runtime_error("netns: cannot open the host network namespace");
+    }
+
+    slot(NetPolicy::Loopback).target = cfg.loopback_size;
+    slot(NetPolicy::Egress).target   = cfg.egress_size;
+    if (cfg.loopback_size > 0 || cfg.egress_size > 0) {
+        m_refiller = std::thread(&NetnsPool::refill_main, this);
+    }
+}
+
+NetnsPool::~NetnsPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    if (m_refiller.joinable()) m_refiller.join();
+
+    for (auto& s : m_slots) {
+        for (auto& lease : s.ready) ::close(lease.fd);
+        s.ready.clear();
+    }
+    if (m_firewall) run_nft("delete table ip " + std::string(kTable));
+    ::close(m_host_fd);
+}
+
+bool NetnsPool::claim(NetPolicy policy, NetLease& out) {
+    if (policy == NetPolicy::None) return false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& ready = slot(policy).ready;
+        if (!ready.empty()) {
+            out = ready.front();
+            ready.pop_front();
+            m_cv.notify_all();   // wake the refiller
+            return true;
+        }
+        ++m_misses;
+    }
+    return build(policy, out);
+}
+
+void NetnsPool::release(uint32_t addr) {
+    if (addr == 0) return;
+    if (m_firewall) unfence(addr);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_free_addrs.push_back(addr);
+}
+
+NetnsStats NetnsPool::stats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return NetnsStats{
+        slot(NetPolicy::Loopback).ready.size(),
+        slot(NetPolicy::Egress).ready.size(),
+        m_built, m_misses, m_failures,
+    };
+}
+
+// Fresh addresses first, so a released one is reused as late as possible
+bool NetnsPool::take_addr(uint32_t& out) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_next_addr <= m_last_addr) {
+        out = m_next_addr++;
+        return true;
+    }
+    if (m_free_addrs.empty()) return false;
+    out = m_free_addrs.front();
+    m_free_addrs.pop_front();
+    return true;
+}
+
+void NetnsPool::discard(const NetLease& lease) {
+    if (lease.fd >= 0) ::close(lease.fd);
+    release(lease.addr);
+}
+
+bool NetnsPool::ensure_bridge() {
+    std::lock_guard<std::mutex> setup(m_setup_mutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_bridge_ready) return true;
+    }
+
+    int nl = nl_open();
+    bool ok = nl >= 0 && nl_add_bridge(nl, m_cfg.bridge);
+    int br = ok ? (int)::if_nametoindex(m_cfg.bridge.c_str()) : 0;
+    ok = ok && br > 0 && nl_add_addr(nl, br, m_gateway, m_prefix) && nl_link_up(nl, br, 0);
+    if (!ok) {
+        std::cerr << "netns: cannot set up bridge " << m_cfg.bridge << ": " << strerror(errno) << "\n";
+    }
+    if (nl >= 0) ::close(nl);
+    ok = ok && install_firewall();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_bridge_ready = ok;
+    return ok;
+}
+
+// The allowlist as host forward rules. Routes inside a namespace are the
+// run's to change, so what decides is the host: only addresses of live
+// leases may send from the bridge, and only to egress_allow; new
+// connections into runs are refused. Traffic to the host itself is held to
+// the same allowlist.
+bool NetnsPool::install_firewall() {
+    std::string allow;
+    for (const Route& r : m_routes) {
+        if (!allow.empty()) allow += ", ";
+        allow += format_addr(r.dst) + "/" + std::to_string(r.prefix);
+    }
+
+    const std::string t = std::string("ip ") + kTable;
+    const std::string br = "\"" + m_cfg.bridge + "\"";
+    std::string script =
+        "add table " + t + "; delete table " + t + "; add table " + t + "; "
+        "add set " + t + " leases { type ipv4_addr; }; "
+        "add set " + t + " allow { type ipv4_addr; flags interval; auto-merge; }; "
+        "add element " + t + " allow { " + allow + " }; "
+        "add chain " + t + " forward { type filter hook forward priority -10; policy accept; }; "
+        "add rule " + t + " forward iifname " + br + " ip saddr @leases ip daddr @allow accept; "
+        "add rule " + t + " forward iifname " + br + " drop; "
+        "add rule " + t + " forward oifname " + br + " ct state established,related accept; "
+        "add rule " + t + " forward oifname " + br + " drop; "
+        "add chain " + t + " input { type filter hook input priority -10; policy accept; }; "
+        "add rule " + t + " input iifname " + br + " ct state established,related accept; "
+        "add rule " + t + " input iifname " + br + " ip saddr @leases ip daddr @allow accept; "
+        "add rule " + t + " input iifname " + br + " drop";
+
+    if (!run_nft(script)) {
+        std::cerr << "netns: cannot install the egress firewall (nft); no egress namespaces without it\n";
+        return false;
+    }
+    m_firewall = true;
+    return true;
+}
+
+bool NetnsPool::fence(uint32_t addr) {
+    return run_nft("add element ip " + std::string(kTable) + " leases { " + format_addr(addr) + " }");
+}
+
+void NetnsPool::unfence(uint32_t addr) {
+    // Fails harmlessly for a lease whose build never got that far
+    run_nft("delete element ip " + std::string(kTable) + " leases { " + format_addr(addr) + " }");
+}
+
+// Runs inside the new namespace: eth0 and its routes, with the host end of
+// the pair (host_if) left in the host namespace
+bool NetnsPool::wire_egress(int nl, NetLease& lease, const std::string& host_if) {
+    if (!nl_add_veth(nl, "eth0", host_if, m_host_fd)) return false;
+
+    int eth = (int)::if_nametoindex("eth0");
+    if (eth <= 0 || !nl_add_addr(nl, eth, lease.addr, m_prefix) || !nl_link_up(nl, eth, 0)) {
+        return false;
+    }
+    for (const Route& r : m_routes) {
+        if (!nl_add_route(nl, r.dst, r.prefix, m_gateway)) return false;
+    }
+    return true;
+}
+
+bool NetnsPool::build(NetPolicy policy, NetLease& out) {
+    NetLease lease;
+    std::string host_if;
+    if (policy == NetPolicy::Egress) {
+        if (!ensure_bridge()) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_failures;
+            return false;
+        }
+        if (!take_addr(lease.addr)) {
+            std::cerr << "netns: no free address in " << m_cfg.subnet << "\n";
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_failures;
+            return false;
+        }
+        char name[IFNAMSIZ];
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ::snprintf(name, sizeof(name), "ktv%lx", (unsigned long)m_next_if++);
+        host_if = name;
+    }
+
+    // Network namespaces are per thread: this one moves into the new
+    // namespace, configures it and comes back
+    if (::unshare(CLONE_NEWNET) < 0) {
+        std::cerr << "netns: unshare failed: " << strerror(errno) << "\n";
+        discard(lease);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_failures;
+        return false;
+    }
+
+    lease.fd = ::open("/proc/thread-self/ns/net", O_RDONLY | O_CLOEXEC);
+    int nl = nl_open();
+    int lo = (int)::if_nametoindex("lo");
+    bool ok = lease.fd >= 0 && nl >= 0 && lo > 0 && nl_link_up(nl, lo, 0);
+    if (ok && policy == NetPolicy::Egress) {
+        ok = wire_egress(nl, lease, host_if);
+    }
+    int err = errno;
+    if (nl >= 0) ::close(nl);
+
+    if (::setns(m_host_fd, CLONE_NEWNET) < 0) {
+        std::cerr << "netns: cannot return to the host network namespace: " << strerror(errno) << "\n";
+        std::abort();
+    }
+
+    if (ok && policy == NetPolicy::Egress) {
+        int hnl = nl_open();
+        int port = (int)::if_nametoindex(host_if.c_str());
+        int br = (int)::if_nametoindex(m_cfg.bridge.c_str());
+        ok = hnl >= 0 && port > 0 && br > 0 && nl_link_up(hnl, port, br);
+        err = errno;
+        if (ok && !nl_isolate_port(hnl, port)) {
+            std::cerr << "netns: cannot isolate " << host_if << ": " << strerror(errno) << "\n";
+        }
+        if (hnl >= 0) ::close(hnl);
+        if (ok && !fence(lease.addr)) {
+            err = errno;
+            ok = false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!ok) {
+        std::cerr << "netns: " << net_policy_name(policy) << " namespace set-up failed: "
+                  << strerror(err) << "\n";
+        ++m_failures;
+        if (lease.fd >= 0) ::close(lease.fd);
+        if (lease.addr) m_free_addrs.push_back(lease.addr);
+        return false;
+    }
+    ++m_built;
+    out = lease;
+    return true;
+}
+
+void NetnsPool::refill_main() {
+    using clock = std::chrono::steady_clock;
+    auto interval = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>(m_cfg.refill_per_sec > 0 ? 1.0 / m_cfg.refill_per_sec : 1.0));
+    auto next_build = clock::now();
+
+    const NetPolicy policies[] = { NetPolicy::Loopback, NetPolicy::Egress };
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        bool wanted = false;
+
+        for (auto policy : policies) {
+            if (m_stopping) break;
+
+            Slot& s = slot(policy);
+            if (s.ready.size() >= s.target) continue;
+            wanted = true;
+
+            if (m_cv.wait_until(lock, next_build, [this] { return m_stopping; })) break;
+            next_build = clock::now() + interval;
+
+            lock.unlock();
+            NetLease lease;
+            bool ok = build(policy, lease);
+            lock.lock();
+
+            if (ok) {
+                s.ready.push_back(lease);
+            }
+        }
+
+        if (!wanted) {
+            m_cv.wait(lock, [this] {
+                if (m_stopping) return true;
+                for (auto& s : m_slots) {
+                    if (s.ready.size() < s.target) return true;
+                }
+                return false;
+            });
+        }
+    }
+}
+
+#endif // __linux__
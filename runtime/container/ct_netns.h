@@ -0,0 +1,126 @@
+#pragma once
+#include <sys/types.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Network access of a run
+enum class NetPolicy : uint8_t {
+    None,       // fresh namespace, nothing configured (not even lo)
+    Loopback,   // lo up, no other interfaces
+    Egress      // lo plus eth0 on the host bridge; the host forwards only to the allowlist
+};
+
+const char* net_policy_name(NetPolicy p);
+bool parse_net_policy(const std::string& name, NetPolicy& out);
+
+struct NetnsPoolConfig {
+    size_t loopback_size  = 0;     // ready Loopback namespaces to keep
+    size_t egress_size    = 0;     // ready Egress namespaces to keep
+    double refill_per_sec = 50.0;  // upper bound on builds per second
+    std::string bridge = "kyntrix0";
+    std::string subnet = "10.88.0.0/16";   // the bridge takes the first address
+    std::vector<std::string> egress_allow; // CIDRs Egress runs may reach;
+                                           // empty = a default route
+};
+
+// A claimed namespace. fd keeps it alive until the run's container has
+// joined it (RunSpec::netns_fd); the namespace, and its veth, go away with
+// the container.
+struct NetLease {
+    int fd = -1;
+    uint32_t addr = 0;   // eth0's IPv4 address (host order); 0 for Loopback
+};
+
+struct NetnsStats {
+    size_t ready_loopback;
+    size_t ready_egress;
+    uint64_t built;
+    uint64_t misses;     // claims that found nothing ready and built inline
+    uint64_t failures;
+};
+
+// Pool of pre-built network namespaces, so configuring a run's network is
+// paid for off the start path. Namespaces are built with rtnetlink on the
+// refill thread, which unshares into each new namespace and returns to the
+// host's.
+//
+// Egress namespaces get a veth pair: eth0 inside, with an address from
+// subnet and routes to egress_allow via the bridge, and a ktv<n> end
+// enslaved to bridge (created on first use). Forwarding and NAT for the
+// subnet are the host's to provide. The allowlist is enforced on the host:
+// with the bridge the pool installs an nft table (kyntrix) whose forward
+// and input rules pass traffic from the bridge only if its source is a
+// live lease and its destination is in egress_allow. A lease's address is
+// added when it is built and removed on release. Without nft, Egress
+// namespaces are not built.
+class NetnsPool {
+public:
+    // Throws std::runtime_error if subnet or egress_allow is invalid.
+    explicit NetnsPool(const NetnsPoolConfig& cfg);
+    ~NetnsPool();
+
+    NetnsPool(const NetnsPool&) = delete;
+    NetnsPool& operator=(const NetnsPool&) = delete;
+
+    // A ready namespace for policy (not None), built inline if none is
+    // ready. The caller closes out.fd once the container has joined it.
+    bool claim(NetPolicy policy, NetLease& out);
+
+    // Returns a lease's address once the run holding it is gone
+    void release(uint32_t addr);
+
+    NetnsStats stats();
+
+private:
+    struct Route {
+        uint32_t dst;
+        int prefix;
+    };
+
+    struct Slot {
+        size_t target = 0;
+        std::deque<NetLease> ready;
+    };
+
+    Slot& slot(NetPolicy p) { return m_slots[p == NetPolicy::Egress ? 1 : 0]; }
+
+    bool build(NetPolicy policy, NetLease& out);
+    bool wire_egress(int nl, NetLease& lease, const std::string& host_if);
+    bool ensure_bridge();
+    bool install_firewall();
+    bool fence(uint32_t addr);
+    void unfence(uint32_t addr);
+    bool take_addr(uint32_t& out);
+    void discard(const NetLease& lease);
+    void refill_main();
+
+    NetnsPoolConfig m_cfg;
+    int m_host_fd;                  // the daemon's network namespace
+    uint32_t m_gateway;             // bridge address
+    int m_prefix;
+    std::vector<Route> m_routes;
+
+    static constexpr const char* kTable = "kyntrix";
+
+    std::mutex m_setup_mutex;       // bridge and firewall set-up
+    std::atomic<bool> m_firewall;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    Slot m_slots[2];
+    uint32_t m_next_addr;
+    uint32_t m_last_addr;
+    std::deque<uint32_t> m_free_addrs;   // released, reused oldest first
+    uint64_t m_next_if;
+    bool m_bridge_ready;
+    uint64_t m_built;
+    uint64_t m_misses;
+    uint64_t m_failures;
+    bool m_stopping;
+    std::thread m_refiller;
+};
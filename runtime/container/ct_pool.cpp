@@ -0,0 +1,416 @@
+
+
+#ifdef __linux__
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "ct_pool.h"
+#include "ct_cgroup.h"
+#include "ct_exec.h"
+#include "ct_image.h"
+#include "ct_mount.h"
+#include "ct_telemetry.h"
+#include "ct_topology.h"
+#include <sched.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/mount.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+// Control messages on the parked container's socket
+static constexpr char kReady    = 'R';   // child -> parent: parked
+static constexpr char kAccepted = 'A';   // child -> parent: workspace bound, exec next
+                                         // (an AcceptMsg)
+static constexpr char kFailed   = 'E';   // child -> parent: setup failed
+
+static constexpr int kParkTimeoutMs  = 10000;
+static constexpr int kClaimTimeoutMs = 5000;
+
+struct ClaimMsg {
+    uint32_t ws_mount;      // WorkspaceMount
+    uint32_t netns;         // 1: the last fd attached is a network namespace
+    char run_id[256];
+    char workspace_path[PATH_MAX];
+    char entry_script[PATH_MAX];
+};
+
+struct AcceptMsg {
+    char status;            // kAccepted
+    SpawnReport report;     // Workspace phase and exec start
+};
+
+struct ParkArgs {
+    RootfsSpec rootfs;
+    ExecSpec exec;
+    int ctl_fd;
+};
+
+static int parked_child_main(void* arg);
+
+static bool read_byte(int fd, char& out, int timeout_ms) {
+    pollfd pfd{fd, POLLIN, 0};
+    int r;
+    do {
+        r = ::poll(&pfd, 1, timeout_ms);
+    } while (r < 0 && errno == EINTR);
+    if (r <= 0) return false;
+
+    ssize_t n;
+    do {
+        n = ::read(fd, &out, 1);
+    } while (n < 0 && errno == EINTR);
+    return n == 1;
+}
+
+static bool read_accept(int fd, AcceptMsg& out, int timeout_ms) {
+    pollfd pfd{fd, POLLIN, 0};
+    int r;
+    do {
+        r = ::poll(&pfd, 1, timeout_ms);
+    } while (r < 0 && errno == EINTR);
+    if (r <= 0) return false;
+
+    ssize_t n;
+    do {
+        n = ::recv(fd, &out, sizeof(out), 0);
+    } while (n < 0 && errno == EINTR);
+    return n == (ssize_t)sizeof(out) && out.status == kAccepted;
+}
+
+// The claim message, with the run's telemetry channel and network namespace
+// attached when it has them
+static bool send_claim(int ctl, const ClaimMsg& msg, int telemetry_fd, int netns_fd) {
+    iovec iov{const_cast<ClaimMsg*>(&msg), sizeof(msg)};
+    msghdr mh{};
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+
+    int fds[2];
+    size_t nfds = 0;
+    if (telemetry_fd >= 0) fds[nfds++] = telemetry_fd;
+    if (netns_fd >= 0) fds[nfds++] = netns_fd;
+
+    alignas(cmsghdr) char cbuf[CMSG_SPACE(sizeof(fds))];
+    if (nfds > 0) {
+        mh.msg_control = cbuf;
+        mh.msg_controllen = CMSG_SPACE(nfds * sizeof(int));
+        cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN(nfds * sizeof(int));
+        ::memcpy(CMSG_DATA(cm), fds, nfds * sizeof(int));
+    }
+
+    return ::sendmsg(ctl, &mh, MSG_NOSIGNAL) == (ssize_t)sizeof(msg);
+}
+
+static bool copy_field(char* dst, size_t cap, const std::string& src) {
+    if (src.size() >= cap || src.find('\0') != std::string::npos) return false;
+    ::memcpy(dst, src.c_str(), src.size() + 1);
+    return true;
+}
+
+WarmPool::WarmPool(const WarmPoolConfig& cfg)
+    : m_cfg(cfg), m_stopping(false) {
+    slot(ContainerTemplate::Node).target   = cfg.node_size;
+    slot(ContainerTemplate::Python).target = cfg.python_size;
+
+    if (cfg.node_size > 0 || cfg.python_size > 0) {
+        m_refiller = std::thread(&WarmPool::refill_main, this);
+    }
+}
+
+WarmPool::~WarmPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    if (m_refiller.joinable()) m_refiller.join();
+
+    for (auto& s : m_slots) {
+        for (auto& p : s.ready) discard(p);
+        s.ready.clear();
+    }
+}
+
+size_t WarmPool::parked(ContainerTemplate tmpl) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return slot(tmpl).ready.size();
+}
+
+size_t WarmPool::target(ContainerTemplate tmpl) const {
+    return m_slots[tmpl == ContainerTemplate::Node ? 0 : 1].target;
+}
+
+pid_t WarmPool::claim(ContainerTemplate tmpl, const RunSpec& run, SpawnTimings* timings) {
+    if (!run.deps_key.empty()) {
+        return -1;
+    }
+
+    ClaimMsg msg{};
+    msg.ws_mount = (uint32_t)run.ws_mount;
+    msg.netns = run.netns_fd >= 0 ? 1 : 0;
+    if (!copy_field(msg.run_id, sizeof(msg.run_id), run.run_id) ||
+        !copy_field(msg.workspace_path, sizeof(msg.workspace_path), run.workspace_path) ||
+        !copy_field(msg.entry_script, sizeof(msg.entry_script), run.entry_script)) {
+        return -1;
+    }
+
+    Parked p;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& ready = slot(tmpl).ready;
+        if (ready.empty()) return -1;
+
+        p = ready.front();
+        ready.pop_front();
+    }
+    m_cv.notify_all();   // wake the refiller
+
+    // Parked containers are idle, so joining the run's cgroup here charges
+    // everything the run does to it
+    uint64_t since = monotonic_ns();
+    if (!run.cgroup_path.empty() && !cgroup_attach(run.cgroup_path, p.pid)) {
+        discard(p);
+        return -1;
+    }
+    if (!run.cpus.empty() && !pin_process(p.pid, run.cpus)) {
+        std::cerr << "warm pool: pinning " << run.run_id << " to its cpus failed\n";
+    }
+    phase_mark(timings, SpawnPhase::Cgroup, since);
+
+    AcceptMsg accept;
+    if (!send_claim(p.ctl_fd, msg, run.telemetry_fd, run.netns_fd) ||
+        !read_accept(p.ctl_fd, accept, kClaimTimeoutMs)) {
+        discard(p);
+        return -1;
+    }
+
+    // The control socket is close-on-exec: EOF after kAccepted means the
+    // entry point is running; kFailed means execvpe() returned
+    char reply = 0;
+    if (read_byte(p.ctl_fd, reply, kClaimTimeoutMs)) {
+        discard(p);
+        return -1;
+    }
+
+    if (timings) {
+        size_t ws = (size_t)SpawnPhase::Workspace;
+        timings->ns[ws] = accept.report.timings.ns[ws];
+        timings->ns[(size_t)SpawnPhase::Exec] = monotonic_ns() - accept.report.exec_at;
+    }
+
+    ::close(p.ctl_fd);
+    return p.pid;
+}
+
+bool WarmPool::park_one(ContainerTemplate tmpl, Parked& out) {
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0) {
+        std::cerr << "warm pool: socketpair failed: " << strerror(errno) << "\n";
+        return false;
+    }
+
+    std::unique_ptr<ParkArgs> args(new ParkArgs);
+    args->ctl_fd = fds[1];
+
+    try {
+        args->rootfs = prepare_rootfs_for_template(tmpl);
+    } catch (const std::exception& ex) {
+        std::cerr << "warm pool: " << ex.what() << "\n";
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return false;
+    }
+    build_exec_spec(args->exec, tmpl);
+
+    const int stack_size = 1024 * 1024;
+    void* stack = ::malloc(stack_size);
+    if (!stack) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return false;
+    }
+
+    int flags = CLONE_NEWNS | CLONE_NEWPID | CLONE_NEWNET | SIGCHLD;
+    pid_t pid = ::clone(parked_child_main, (char*)stack + stack_size, flags, args.get());
+
+    // No CLONE_VM: the child runs on its own copy of the stack
+    ::free(stack);
+    ::close(fds[1]);
+
+    if (pid < 0) {
+        std::cerr << "warm pool: clone failed: " << strerror(errno) << "\n";
+        ::close(fds[0]);
+        return false;
+    }
+
+    Parked p{pid, fds[0]};
+    char reply = 0;
+    if (!read_byte(p.ctl_fd, reply, kParkTimeoutMs) || reply != kReady) {
+        discard(p);
+        return false;
+    }
+
+    out = p;
+    return true;
+}
+
+void WarmPool::discard(const Parked& p) {
+    ::close(p.ctl_fd);
+    ::kill(p.pid, SIGKILL);
+    ::waitpid(p.pid, nullptr, 0);
+}
+
+void WarmPool::refill_main() {
+    using clock = std::chrono::steady_clock;
+    auto interval = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>(m_cfg.refill_per_sec > 0 ? 1.0 / m_cfg.refill_per_sec : 1.0));
+    auto next_park = clock::now();
+
+    const ContainerTemplate templates[] = { ContainerTemplate::Node, ContainerTemplate::Python };
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        bool wanted = false;
+
+        for (auto tmpl : templates) {
+            if (m_stopping) break;
+
+            Slot& s = slot(tmpl);
+            if (s.ready.size() >= s.target) continue;
+            wanted = true;
+
+            // Rate limit parks so a drained pool cannot fork-bomb the host
+            if (m_cv.wait_until(lock, next_park, [this] { return m_stopping; })) break;
+            next_park = clock::now() + interval;
+
+            lock.unlock();
+            Parked p;
+            bool ok = park_one(tmpl, p);
+            lock.lock();
+
+            if (ok) {
+                s.ready.push_back(p);
+            }
+        }
+
+        if (!wanted) {
+            m_cv.wait(lock, [this] {
+                if (m_stopping) return true;
+                for (auto& s : m_slots) {
+                    if (s.ready.size() < s.target) return true;
+                }
+                return false;
+            });
+        }
+    }
+}
+
+static int parked_child_main(void* arg) {
+    // Runs on a copy of the parent's address space: no allocation, no frees
+    ParkArgs* args = (ParkArgs*)arg;
+    int ctl = args->ctl_fd;
+
+    // Parked containers live indefinitely; keep only the control socket
+    close_inherited_fds(ctl);
+
+    // kTelemetryFd is reserved for the run's telemetry channel
+    if (ctl == kTelemetryFd) {
+        int moved = ::fcntl(ctl, F_DUPFD_CLOEXEC, kTelemetryFd + 1);
+        if (moved < 0) return 1;
+        ::close(ctl);
+        ctl = moved;
+    }
+
+    if (!setup_rootfs(args->rootfs)) {
+        (void)!::write(ctl, &kFailed, 1);
+        return 1;
+    }
+
+    if (::write(ctl, &kReady, 1) != 1) {
+        return 1;
+    }
+
+    static ClaimMsg msg;
+    alignas(cmsghdr) static char cbuf[CMSG_SPACE(2 * sizeof(int))];
+    iovec iov{&msg, sizeof(msg)};
+    msghdr mh{};
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = cbuf;
+    mh.msg_controllen = sizeof(cbuf);
+
+    ssize_t n;
+    do {
+        n = ::recvmsg(ctl, &mh, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+
+    if (n != (ssize_t)sizeof(msg)) {
+        return 0;   // pool shut down while parked
+    }
+
+    int fds[2] = {-1, -1};
+    size_t nfds = 0;
+    cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+    if (cm && cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS) {
+        nfds = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        if (nfds > 2) nfds = 2;
+        ::memcpy(fds, CMSG_DATA(cm), nfds * sizeof(int));
+    }
+    int netns_fd = msg.netns && nfds > 0 ? fds[--nfds] : -1;
+    int telemetry_fd = nfds > 0 ? fds[0] : -1;
+
+    msg.run_id[sizeof(msg.run_id) - 1] = '\0';
+    msg.workspace_path[sizeof(msg.workspace_path) - 1] = '\0';
+    msg.entry_script[sizeof(msg.entry_script) - 1] = '\0';
+
+    WorkspaceMount mode = msg.ws_mount == (uint32_t)WorkspaceMount::Snapshot
+        ? WorkspaceMount::Snapshot : WorkspaceMount::Bind;
+
+    static AcceptMsg accept;
+    accept.status = kAccepted;
+    uint64_t since = monotonic_ns();
+
+    // The parked /sys shows the namespace the container was cloned with
+    if (msg.netns && (netns_fd < 0 || ::setns(netns_fd, CLONE_NEWNET) < 0 ||
+                      ::umount2("/sys", MNT_DETACH) < 0 ||
+                      ::mount("sysfs", "/sys", "sysfs", 0, nullptr) < 0)) {
+        (void)!::write(ctl, &kFailed, 1);
+        return 1;
+    }
+
+    if (!mount_workspace(msg.workspace_path, mode)) {
+        (void)!::write(ctl, &kFailed, 1);
+        return 1;
+    }
+    phase_mark(&accept.report.timings, SpawnPhase::Workspace, since);
+
+    if (!bind_exec_run(args->exec, msg.run_id, msg.entry_script) ||
+        (telemetry_fd >= 0 && !telemetry_install(telemetry_fd))) {
+        (void)!::write(ctl, &kFailed, 1);
+        return 1;
+    }
+
+    accept.report.exec_at = monotonic_ns();
+    (void)!::write(ctl, &accept, sizeof(accept));
+    ::execvpe(args->exec.argv[0], args->exec.argv.data(), args->exec.envp.data());
+
+    (void)!::write(ctl, &kFailed, 1);
+    return 1;
+}
+
+
+
+#endif // __linux__
@@ -0,0 +1,64 @@
+#pragma once
+#include "ct_namespace.h"
+#include <sys/types.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct WarmPoolConfig {
+    size_t node_size      = 0;     // parked Node containers to keep ready
+    size_t python_size    = 0;     // parked Python containers to keep ready
+    double refill_per_sec = 20.0;  // upper bound on parks per second
+};
+
+// Per-template pool of pre-created containers. Each parked container has its
+// namespaces, rootfs, /proc and /sys already set up and blocks on a control
+// socket; claiming it only binds the workspace and execs the entry point.
+class WarmPool {
+public:
+    explicit WarmPool(const WarmPoolConfig& cfg);
+    ~WarmPool();
+
+    WarmPool(const WarmPool&) = delete;
+    WarmPool& operator=(const WarmPool&) = delete;
+
+    // Hands a parked container its run (moving it into run.cgroup_path and
+    // pinning it to run.cpus first) and waits until it has exec'd. Returns the container pid, or -1
+    // if nothing is parked for tmpl or the claim failed; the caller then
+    // falls back to spawn_container(). run.deps_key is not supported;
+    // run.telemetry_fd and run.netns_fd are passed over the control socket.
+    // @param timings: Optional; receives the Cgroup, Workspace and Exec
+    // phases (the rest ran when the container was parked)
+    pid_t claim(ContainerTemplate tmpl, const RunSpec& run,
+                SpawnTimings* timings = nullptr);
+
+    size_t parked(ContainerTemplate tmpl);
+    size_t target(ContainerTemplate tmpl) const;
+
+private:
+    struct Parked {
+        pid_t pid;
+        int ctl_fd;
+    };
+
+    struct Slot {
+        size_t target = 0;
+        std::deque<Parked> ready;
+    };
+
+    Slot& slot(ContainerTemplate tmpl) { return m_slots[tmpl == ContainerTemplate::Node ? 0 : 1]; }
+
+    bool park_one(ContainerTemplate tmpl, Parked& out);
+    void refill_main();
+
+    static void discard(const Parked& p);
+
+    WarmPoolConfig m_cfg;
+    Slot m_slots[2];
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stopping;
+    std::thread m_refiller;
+};
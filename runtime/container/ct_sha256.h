@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Minimal streaming SHA-256 for content addressing (workspace objects,
+// snapshot keys). Not constant-time; do not use for secrets.
+class Sha256 {
+public:
+    Sha256();
+
+    void update(const void* data, size_t len);
+    void update(const std::string& s) { update(s.data(), s.size()); }
+
+    // Finishes the digest and returns it as 64 lowercase hex characters.
+    // The object must not be updated afterwards.
+    std::string hex();
+
+private:
+    void transform(const uint8_t* block);
+
+    uint32_t m_state[8];
+    uint8_t  m_buf[64];
+    size_t   m_buf_len;
+    uint64_t m_total;
+};
+
+std::string sha256_hex(const std::string& data);
@@ -0,0 +1,49 @@
+#include "ct_telemetry.h"
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <iostream>
+
+// agent_core frames stay below 256 KiB
+static constexpr int kChannelBufferBytes = 1 << 20;
+
+bool telemetry_channel_open(TelemetryChannel& ch) {
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0) {
+        std::cerr << "telemetry: socketpair failed: " << strerror(errno) << "\n";
+        return false;
+    }
+
+    // The daemon runs as root, so the buffers may exceed wmem_max / rmem_max
+    int bytes = kChannelBufferBytes;
+    if (::setsockopt(fds[1], SOL_SOCKET, SO_SNDBUFFORCE, &bytes, sizeof(bytes)) < 0) {
+        ::setsockopt(fds[1], SOL_SOCKET, SO_SNDBUF, &bytes, sizeof(bytes));
+    }
+    if (::setsockopt(fds[0], SOL_SOCKET, SO_RCVBUFFORCE, &bytes, sizeof(bytes)) < 0) {
+        ::setsockopt(fds[0], SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+    }
+
+    ch.host_fd = fds[0];
+    ch.container_fd = fds[1];
+    return true;
+}
+
+void telemetry_channel_close(TelemetryChannel& ch) {
+    if (ch.host_fd >= 0) ::close(ch.host_fd);
+    if (ch.container_fd >= 0) ::close(ch.container_fd);
+    ch.host_fd = ch.container_fd = -1;
+}
+
+bool telemetry_install(int fd) {
+    if (fd == kTelemetryFd) {
+        return ::fcntl(fd, F_SETFD, 0) == 0;
+    }
+    // The duplicate does not inherit FD_CLOEXEC
+    if (::dup2(fd, kTelemetryFd) < 0) {
+        return false;
+    }
+    ::close(fd);
+    return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+// Per-run telemetry channel between a container and kyntrixd.
+//
+// A SOCK_SEQPACKET socketpair: the container end is installed as fd
+// kTelemetryFd before exec and its processes write one binary TAL frame
+// (runtime/agent/agent_wire.h) per message, through agent_core or the OTel
+// exporters in adapters/. The daemon reads the host end. Unlike OTLP over
+// HTTP this needs no network path into the container's network namespace.
+
+inline constexpr int kTelemetryFd = 3;
+
+struct TelemetryChannel {
+    int host_fd = -1;
+    int container_fd = -1;
+};
+
+// Both ends are close-on-exec. The container end's send buffer is sized so
+// a full agent_core frame fits in one message.
+bool telemetry_channel_open(TelemetryChannel& ch);
+void telemetry_channel_close(TelemetryChannel& ch);
+
+// Makes fd the container's kTelemetryFd, inheritable across exec. Does not
+// allocate; safe in a cloned child.
+bool telemetry_install(int fd);
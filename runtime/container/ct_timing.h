@@ -0,0 +1,67 @@
+#pragma once
+#include <time.h>
+#include <cstddef>
+#include <cstdint>
+
+// Start-up phases of a container. Stamped with CLOCK_MONOTONIC, which is
+// async-signal-safe and the same clock in every PID namespace, so a cloned
+// child times its own phases and reports them to the parent before exec.
+enum class SpawnPhase : uint8_t {
+    Resolve,     // image layers resolved
+    ExecSpec,    // argv / envp built
+    Network,     // network namespace claimed from the pool (ct_netns.h)
+    Clone,       // clone() of the container init
+    Cgroup,      // moved into the run's cgroup
+    Overlay,     // tmpfs and overlay root mounted
+    PivotRoot,
+    SysMounts,   // /proc, /sys
+    Workspace,   // /workspace mounted
+    Exec,        // child's last stamp until execve() has replaced it
+    Count
+};
+
+inline constexpr size_t kSpawnPhases = (size_t)SpawnPhase::Count;
+
+// Nanoseconds per phase; 0 = the phase did not run on this path
+struct SpawnTimings {
+    uint64_t ns[kSpawnPhases];
+};
+
+inline const char* spawn_phase_name(SpawnPhase p) {
+    switch (p) {
+        case SpawnPhase::Resolve:   return "resolve";
+        case SpawnPhase::ExecSpec:  return "exec_spec";
+        case SpawnPhase::Network:   return "network";
+        case SpawnPhase::Clone:     return "clone";
+        case SpawnPhase::Cgroup:    return "cgroup";
+        case SpawnPhase::Overlay:   return "overlay";
+        case SpawnPhase::PivotRoot: return "pivot_root";
+        case SpawnPhase::SysMounts: return "sys_mounts";
+        case SpawnPhase::Workspace: return "workspace";
+        case SpawnPhase::Exec:      return "exec";
+        case SpawnPhase::Count:     break;
+    }
+    return "unknown";
+}
+
+inline uint64_t monotonic_ns() {
+    timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Records the time since `since` as phase p (if t is set) and restarts the
+// clock
+inline void phase_mark(SpawnTimings* t, SpawnPhase p, uint64_t& since) {
+    uint64_t now = monotonic_ns();
+    if (t) t->ns[(size_t)p] = now - since;
+    since = now;
+}
+
+// Sent by a container to its parent just before execvpe(): the phases it
+// timed itself and when exec started. The channel is close-on-exec, so EOF
+// after the report marks the end of the Exec phase.
+struct SpawnReport {
+    SpawnTimings timings;
+    uint64_t exec_at;   // monotonic_ns()
+};
@@ -0,0 +1,166 @@
+#include "ct_topology.h"
+#include <sched.h>
+#include <dirent.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+
+static const char* const kCpuRoot  = "/sys/devices/system/cpu";
+static const char* const kNodeRoot = "/sys/devices/system/node";
+
+static bool read_cpu_list(const std::string& path, std::vector<int>& out) {
+    std::ifstream in(path);
+    std::string line;
+    if (!std::getline(in, line)) return false;
+    return parse_cpu_list(line, out);
+}
+
+bool parse_cpu_list(const std::string& list, std::vector<int>& out) {
+    out.clear();
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t comma = list.find(',', pos);
+        std::string range = list.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        pos = comma == std::string::npos ? list.size() : comma + 1;
+
+        while (!range.empty() && (range.back() == '\n' || range.back() == ' ')) range.pop_back();
+        if (range.empty()) continue;
+
+        char* end = nullptr;
+        long lo = std::strtol(range.c_str(), &end, 10);
+        long hi = lo;
+        if (*end == '-') {
+            hi = std::strtol(end + 1, &end, 10);
+        }
+        if (*end != '\0' || lo < 0 || hi < lo || hi >= CPU_SETSIZE) return false;
+
+        for (long c = lo; c <= hi; ++c) out.push_back((int)c);
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return true;
+}
+
+std::string format_cpu_list(std::vector<int> cpus) {
+    std::sort(cpus.begin(), cpus.end());
+
+    std::string out;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) ++j;
+
+        if (!out.empty()) out += ',';
+        out += std::to_string(cpus[i]);
+        if (j > i) {
+            out += '-';
+            out += std::to_string(cpus[j]);
+        }
+        i = j + 1;
+    }
+    return out;
+}
+
+// node id -> its CPUs, from /sys/devices/system/node/nodeN/cpulist
+static std::map<int, std::vector<int>> read_nodes() {
+    std::map<int, std::vector<int>> nodes;
+
+    DIR* dir = ::opendir(kNodeRoot);
+    if (!dir) return nodes;
+
+    while (dirent* e = ::readdir(dir)) {
+        std::string name = e->d_name;
+        if (name.compare(0, 4, "node") != 0 || name.size() == 4) continue;
+
+        char* end = nullptr;
+        long id = std::strtol(name.c_str() + 4, &end, 10);
+        if (*end != '\0') continue;
+
+        std::vector<int> cpus;
+        if (read_cpu_list(std::string(kNodeRoot) + "/" + name + "/cpulist", cpus)) {
+            nodes[(int)id] = std::move(cpus);
+        }
+    }
+    ::closedir(dir);
+    return nodes;
+}
+
+CpuTopology topology_read(const std::vector<int>& allowed) {
+    CpuTopology topo;
+
+    std::vector<int> online;
+    if (!read_cpu_list(std::string(kCpuRoot) + "/online", online) || online.empty()) {
+        std::cerr << "topology: cannot read " << kCpuRoot << "/online\n";
+        return topo;
+    }
+
+    std::set<int> usable(online.begin(), online.end());
+    if (!allowed.empty()) {
+        std::set<int> keep(allowed.begin(), allowed.end());
+        for (auto it = usable.begin(); it != usable.end();) {
+            it = keep.count(*it) ? std::next(it) : usable.erase(it);
+        }
+    }
+
+    std::map<int, std::vector<int>> nodes = read_nodes();
+    if (nodes.empty()) {
+        nodes[0] = online;
+    }
+
+    std::set<int> seen;
+    for (auto& [id, cpus] : nodes) {
+        NumaNode node{id, {}};
+
+        for (int cpu : cpus) {
+            if (!usable.count(cpu) || seen.count(cpu)) continue;
+
+            // A core is listed once, at its first usable sibling
+            std::vector<int> siblings;
+            std::string path = std::string(kCpuRoot) + "/cpu" + std::to_string(cpu) +
+                               "/topology/thread_siblings_list";
+            if (!read_cpu_list(path, siblings) || siblings.empty()) {
+                siblings = {cpu};
+            }
+
+            CpuCore core;
+            for (int s : siblings) {
+                if (usable.count(s) && !seen.count(s)) {
+                    core.cpus.push_back(s);
+                    seen.insert(s);
+                }
+            }
+            if (!core.cpus.empty()) node.cores.push_back(std::move(core));
+        }
+
+        if (!node.cores.empty()) topo.nodes.push_back(std::move(node));
+    }
+    return topo;
+}
+
+bool pin_process(pid_t pid, const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) CPU_SET(c, &set);
+
+    std::string task_dir = "/proc/" + std::to_string(pid) + "/task";
+    DIR* dir = ::opendir(task_dir.c_str());
+    if (!dir) return false;
+
+    bool ok = true;
+    while (dirent* e = ::readdir(dir)) {
+        if (e->d_name[0] == '.') continue;
+        pid_t tid = (pid_t)std::strtol(e->d_name, nullptr, 10);
+        if (::sched_setaffinity(tid, sizeof(set), &set) < 0) ok = false;
+    }
+    ::closedir(dir);
+    return ok;
+}
+
+bool process_pinned(pid_t pid, const std::vector<int>& cpus) {
+    cpu_set_t want, have;
+    CPU_ZERO(&want);
+    for (int c : cpus) CPU_SET(c, &want);
+    return ::sched_getaffinity(pid, sizeof(have), &have) == 0 && CPU_EQUAL(&want, &have);
+}
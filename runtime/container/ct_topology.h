@@ -0,0 +1,37 @@
+#pragma once
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+// Host CPU layout read from sysfs, used to place runs (see
+// runtime/daemon/run_scheduler.h).
+
+// Online CPUs sharing one physical core (SMT siblings)
+struct CpuCore {
+    std::vector<int> cpus;
+};
+
+struct NumaNode {
+    int id;
+    std::vector<CpuCore> cores;   // in CPU order
+};
+
+struct CpuTopology {
+    std::vector<NumaNode> nodes;  // nodes with at least one usable CPU
+};
+
+// Groups the online CPUs into cores and NUMA nodes, keeping only CPUs in
+// allowed (every online CPU if empty). A kernel without NUMA support, or
+// without the sysfs node directory, yields a single node 0.
+CpuTopology topology_read(const std::vector<int>& allowed = {});
+
+// Kernel cpu list syntax: "0-3,8,10-11". False on malformed input.
+bool parse_cpu_list(const std::string& list, std::vector<int>& out);
+std::string format_cpu_list(std::vector<int> cpus);
+
+// sched_setaffinity() on every thread of pid. Threads the process creates
+// afterwards inherit the mask; for runs without a cpuset cgroup.
+bool pin_process(pid_t pid, const std::vector<int>& cpus);
+
+// True if pid's main thread runs on exactly cpus
+bool process_pinned(pid_t pid, const std::vector<int>& cpus);
@@ -0,0 +1,456 @@
+#include "ct_workspace.h"
+#include "ct_image.h"
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+extern char** environ;
+
+static std::string store_dir(const char* sub) {
+    return image_store_root() + "/workspaces/" + sub;
+}
+
+static std::runtime_error io_error(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + "(" + path + ") failed: " + strerror(errno));
+}
+
+static void mkdir_p(const std::string& path, mode_t mode = 0755) {
+    size_t pos = 0;
+    while (pos != std::string::npos) {
+        pos = path.find('/', pos + 1);
+        std::string part = path.substr(0, pos);
+        if (part.empty()) continue;
+        if (::mkdir(part.c_str(), mode) < 0 && errno != EEXIST) {
+            throw io_error("mkdir", part);
+        }
+    }
+}
+
+static int remove_entry(const char* path, const struct stat*, int, struct FTW*) {
+    ::remove(path);
+    return 0;
+}
+
+static void remove_tree(const std::string& path) {
+    ::nftw(path.c_str(), remove_entry, 32, FTW_DEPTH | FTW_PHYS);
+}
+
+static void copy_file(const std::string& src, const std::string& dst, mode_t mode) {
+    int in = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) throw io_error("open", src);
+    int out = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, mode);
+    if (out < 0) {
+        ::close(in);
+        throw io_error("open", dst);
+    }
+
+    char buf[65536];
+    ssize_t n;
+    bool ok = true;
+    while (ok && (n = ::read(in, buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            ok = errno == EINTR;
+            continue;
+        }
+        ok = ::write(out, buf, (size_t)n) == n;
+    }
+    ::close(in);
+    ::close(out);
+    if (!ok) throw io_error("copy", dst);
+}
+
+static std::string unique_name(const char* prefix) {
+    static std::atomic<uint64_t> counter{0};
+    auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    return std::string(prefix) + std::to_string(::getpid()) + "-" +
+           std::to_string((uint64_t)now) + "-" + std::to_string(counter++);
+}
+
+bool is_safe_relative_path(const std::string& rel_path) {
+    if (rel_path.empty() || rel_path[0] == '/' || rel_path.size() >= 4096) return false;
+    if (rel_path.find('\0') != std::string::npos) return false;
+
+    size_t start = 0;
+    while (start <= rel_path.size()) {
+        size_t end = rel_path.find('/', start);
+        if (end == std::string::npos) end = rel_path.size();
+
+        std::string part = rel_path.substr(start, end - start);
+        if (part.empty() || part == "." || part == "..") return false;
+        start = end + 1;
+    }
+    return true;
+}
+
+WorkspaceWriter::WorkspaceWriter()
+    : m_committed(false), m_fd(-1), m_executable(false) {
+    mkdir_p(store_dir("objects"));
+    mkdir_p(store_dir("snapshots"));
+    mkdir_p(store_dir("staging"));
+
+    m_staging = store_dir("staging") + "/" + unique_name("ws-");
+    if (::mkdir(m_staging.c_str(), 0755) < 0) {
+        throw io_error("mkdir", m_staging);
+    }
+}
+
+WorkspaceWriter::~WorkspaceWriter() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        ::unlink(m_tmp_path.c_str());
+    }
+    if (!m_committed) {
+        remove_tree(m_staging);
+    }
+}
+
+void WorkspaceWriter::begin_file(const std::string& rel_path, bool executable) {
+    if (m_fd >= 0) {
+        throw std::runtime_error("begin_file() while another file is open");
+    }
+    if (!is_safe_relative_path(rel_path)) {
+        throw std::runtime_error("Unsafe workspace path: " + rel_path);
+    }
+
+    m_tmp_path = store_dir("objects") + "/." + unique_name("tmp-");
+    m_fd = ::open(m_tmp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (m_fd < 0) {
+        throw io_error("open", m_tmp_path);
+    }
+
+    m_rel_path = rel_path;
+    m_executable = executable;
+    m_hash = Sha256();
+}
+
+void WorkspaceWriter::write(const void* data, size_t len) {
+    if (m_fd < 0) {
+        throw std::runtime_error("write() without begin_file()");
+    }
+
+    m_hash.update(data, len);
+
+    const char* p = (const char*)data;
+    while (len > 0) {
+        ssize_t n = ::write(m_fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw io_error("write", m_tmp_path);
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+}
+
+void WorkspaceWriter::end_file() {
+    if (m_fd < 0) {
+        throw std::runtime_error("end_file() without begin_file()");
+    }
+
+    std::string object = m_hash.hex() + (m_executable ? ".x" : "");
+    std::string object_path = store_dir("objects") + "/" + object;
+
+    ::fchmod(m_fd, m_executable ? 0555 : 0444);
+    ::close(m_fd);
+    m_fd = -1;
+
+    // Identical content already stored: drop our copy and share the inode
+    struct stat st;
+    if (::stat(object_path.c_str(), &st) == 0) {
+        ::unlink(m_tmp_path.c_str());
+    } else if (::rename(m_tmp_path.c_str(), object_path.c_str()) < 0) {
+        int err = errno;
+        ::unlink(m_tmp_path.c_str());
+        errno = err;
+        throw io_error("rename", object_path);
+    }
+
+    std::string dst = m_staging + "/" + m_rel_path;
+    size_t slash = dst.rfind('/');
+    mkdir_p(dst.substr(0, slash));
+
+    if (::link(object_path.c_str(), dst.c_str()) < 0) {
+        // Very common objects (empty files) can exhaust the link count
+        if (errno != EMLINK) throw io_error("link", dst);
+        copy_file(object_path, dst, m_executable ? 0555 : 0444);
+    }
+
+    m_entries.push_back({m_rel_path, object});
+}
+
+void WorkspaceWriter::add_symlink(const std::string& rel_path, const std::string& target) {
+    if (!is_safe_relative_path(rel_path)) {
+        throw std::runtime_error("Unsafe workspace path: " + rel_path);
+    }
+
+    std::string dst = m_staging + "/" + rel_path;
+    mkdir_p(dst.substr(0, dst.rfind('/')));
+    if (::symlink(target.c_str(), dst.c_str()) < 0) {
+        throw io_error("symlink", dst);
+    }
+
+    m_entries.push_back({rel_path, "->" + target});
+}
+
+WorkspaceSnapshot WorkspaceWriter::commit(const std::string& key) {
+    if (m_fd >= 0) {
+        throw std::runtime_error("commit() with an open file");
+    }
+
+    WorkspaceSnapshot snap;
+    snap.key = key;
+
+    if (snap.key.empty()) {
+        std::sort(m_entries.begin(), m_entries.end(),
+                  [](const Entry& a, const Entry& b) { return a.path < b.path; });
+
+        Sha256 h;
+        for (auto& e : m_entries) {
+            h.update(e.path);
+            h.update("\0", 1);
+            h.update(e.object);
+            h.update("\n", 1);
+        }
+        snap.key = "files-" + h.hex();
+    }
+
+    snap.path = store_dir("snapshots") + "/" + snap.key;
+    snap.cache_hit = false;
+
+    if (::rename(m_staging.c_str(), snap.path.c_str()) < 0) {
+        if (errno != EEXIST && errno != ENOTEMPTY) {
+            throw io_error("rename", snap.path);
+        }
+        // Someone published the same snapshot first; ours is redundant
+        remove_tree(m_staging);
+        snap.cache_hit = true;
+    }
+
+    m_committed = true;
+    return snap;
+}
+
+// Remote transports a run may name; blocks ext::, file:// and local paths
+static const char kGitProtocols[] = "GIT_ALLOW_PROTOCOL=https:http:ssh:git";
+// Bounds all of a snapshot's git commands together; the instance manager
+// client waits a little longer for a git-mode start (daemonClient.ts)
+static constexpr auto kGitTimeout = std::chrono::minutes(2);
+
+static bool run_git(const std::vector<std::string>& args,
+                    std::chrono::steady_clock::time_point deadline) {
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>("git"));
+    for (auto& a : args) argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+
+    // Never prompt for credentials; a remote that asks just fails
+    std::vector<char*> envp;
+    for (char** e = environ; *e; ++e) {
+        if (::strncmp(*e, "GIT_ALLOW_PROTOCOL=", 19) == 0) continue;
+        if (::strncmp(*e, "GIT_TERMINAL_PROMPT=", 20) == 0) continue;
+        envp.push_back(*e);
+    }
+    envp.push_back(const_cast<char*>(kGitProtocols));
+    envp.push_back(const_cast<char*>("GIT_TERMINAL_PROMPT=0"));
+    envp.push_back(nullptr);
+
+    posix_spawn_file_actions_t fa;
+    posix_spawnattr_t attr;
+    ::posix_spawn_file_actions_init(&fa);
+    ::posix_spawn_file_actions_addopen(&fa, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    ::posix_spawnattr_init(&attr);
+    ::posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    ::posix_spawnattr_setpgroup(&attr, 0);      // so a timeout kills its helpers too
+
+    // posix_spawn: safe from the daemon's worker threads
+    pid_t pid;
+    int rc = ::posix_spawnp(&pid, "git", &fa, &attr, argv.data(), envp.data());
+    ::posix_spawn_file_actions_destroy(&fa);
+    ::posix_spawnattr_destroy(&attr);
+    if (rc != 0) {
+        std::cerr << "posix_spawnp(git) failed: " << strerror(rc) << "\n";
+        return false;
+    }
+
+    int status = 0;
+    for (;;) {
+        pid_t r = ::waitpid(pid, &status, WNOHANG);
+        if (r == pid) break;
+        if (r < 0 && errno != EINTR) return false;
+        if (std::chrono::steady_clock::now() >= deadline) {
+            std::cerr << "git ran past the "
+                      << std::chrono::duration_cast<std::chrono::seconds>(kGitTimeout).count()
+                      << "s limit; killing it\n";
+            ::kill(-pid, SIGKILL);
+            while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+            return false;
+        }
+        ::usleep(20 * 1000);
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static bool is_hex(const std::string& s) {
+    if (s.empty()) return false;
+    for (char c : s) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) return false;
+    }
+    return true;
+}
+
+struct IngestCtx {
+    WorkspaceWriter* writer;
+    size_t root_len;
+    std::string error;
+};
+
+static thread_local IngestCtx* t_ingest = nullptr;
+
+static int ingest_entry(const char* path, const struct stat* st, int type, struct FTW*) {
+    IngestCtx& ctx = *t_ingest;
+    std::string full = path;
+    if (full.size() <= ctx.root_len) return 0;
+
+    std::string rel = full.substr(ctx.root_len + 1);
+    if (rel == ".git" || rel.compare(0, 5, ".git/") == 0) return 0;
+
+    try {
+        if (type == FTW_SL) {
+            char target[4096];
+            ssize_t n = ::readlink(path, target, sizeof(target) - 1);
+            if (n < 0) throw io_error("readlink", full);
+            ctx.writer->add_symlink(rel, std::string(target, (size_t)n));
+        } else if (type == FTW_F && S_ISREG(st->st_mode)) {
+            int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) throw io_error("open", full);
+
+            ctx.writer->begin_file(rel, (st->st_mode & 0111) != 0);
+            char buf[65536];
+            ssize_t n;
+            while ((n = ::read(fd, buf, sizeof(buf))) > 0) {
+                ctx.writer->write(buf, (size_t)n);
+            }
+            ::close(fd);
+            if (n < 0) throw io_error("read", full);
+            ctx.writer->end_file();
+        }
+    } catch (const std::exception& ex) {
+        ctx.error = ex.what();
+        return 1;
+    }
+    return 0;
+}
+
+// Serializes builds of one snapshot key; entries live while someone holds
+// or waits on them
+class KeyLock {
+public:
+    explicit KeyLock(const std::string& key) : m_key(key) {
+        {
+            std::lock_guard<std::mutex> lock(s_guard);
+            auto& e = s_locks[key];
+            if (!e) e = std::make_unique<Entry>();
+            ++e->refs;
+            m_entry = e.get();
+        }
+        m_entry->mutex.lock();
+    }
+
+    ~KeyLock() {
+        m_entry->mutex.unlock();
+        std::lock_guard<std::mutex> lock(s_guard);
+        if (--m_entry->refs == 0) s_locks.erase(m_key);
+    }
+
+    KeyLock(const KeyLock&) = delete;
+    KeyLock& operator=(const KeyLock&) = delete;
+
+private:
+    struct Entry {
+        std::mutex mutex;
+        unsigned refs = 0;
+    };
+
+    static inline std::mutex s_guard;
+    static inline std::map<std::string, std::unique_ptr<Entry>> s_locks;
+
+    std::string m_key;
+    Entry* m_entry;
+};
+
+WorkspaceSnapshot materialize_git(const std::string& url,
+                                  const std::string& commit_sha,
+                                  const std::string& branch) {
+    if (url.empty() || url[0] == '-') {
+        throw std::runtime_error("Invalid git url");
+    }
+    // Full object ids only: the cache is keyed by them, and servers fetch
+    // commits by their full id
+    if ((commit_sha.size() != 40 && commit_sha.size() != 64) || !is_hex(commit_sha)) {
+        throw std::runtime_error("Invalid commit sha (need a full 40 or 64 hex digit id): " + commit_sha);
+    }
+
+    std::string key = "git-" + sha256_hex(url).substr(0, 16) + "-" + commit_sha;
+    std::string path = store_dir("snapshots") + "/" + key;
+
+    struct stat st;
+    if (::stat(path.c_str(), &st) == 0) {
+        return {key, path, true};
+    }
+
+    KeyLock lock(key);
+    if (::stat(path.c_str(), &st) == 0) {
+        return {key, path, true};   // built while we waited
+    }
+
+    mkdir_p(store_dir("staging"));
+    std::string src = store_dir("staging") + "/" + unique_name("git-");
+    struct Cleanup {
+        std::string dir;
+        ~Cleanup() { remove_tree(dir); }
+    } cleanup{src};
+
+    auto deadline = std::chrono::steady_clock::now() + kGitTimeout;
+    if (!run_git({"init", "-q", src}, deadline)) {
+        throw std::runtime_error("git init failed");
+    }
+
+    // Shallow fetch of the exact commit; fall back to the branch (or all
+    // refs) for servers that refuse fetching unadvertised objects
+    bool fetched = run_git({"-C", src, "fetch", "-q", "--depth", "1", "--", url, commit_sha},
+                           deadline);
+    if (!fetched) {
+        std::vector<std::string> args = {"-C", src, "fetch", "-q", "--", url};
+        if (!branch.empty()) args.push_back(branch);
+        fetched = run_git(args, deadline);
+    }
+    if (!fetched || !run_git({"-C", src, "checkout", "-q", "--detach", commit_sha}, deadline)) {
+        throw std::runtime_error("git fetch/checkout of " + commit_sha + " failed");
+    }
+
+    WorkspaceWriter writer;
+    IngestCtx ctx{&writer, src.size(), ""};
+    t_ingest = &ctx;
+    int rc = ::nftw(src.c_str(), ingest_entry, 32, FTW_PHYS);
+    t_ingest = nullptr;
+    if (rc != 0) {
+        throw std::runtime_error("Ingesting " + commit_sha + " failed: " + ctx.error);
+    }
+
+    return writer.commit(key);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "ct_sha256.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Content-deduplicated, immutable workspace snapshots:
+//   <root>/workspaces/objects/<sha256>[.x]   file contents, shared by hardlink
+//   <root>/workspaces/snapshots/<key>/       trees of hardlinks into objects/
+//   <root>/workspaces/staging/               snapshots being built
+//
+// A snapshot is mounted read-only under a per-run writable overlay (see
+// mount_workspace()), so repeated runs of the same commit or upload cost a
+// mount, and identical files across commits share one inode on disk.
+// Uses the root configured with configure_image_store().
+
+struct WorkspaceSnapshot {
+    std::string key;
+    std::string path;
+    bool cache_hit;
+};
+
+// Builds a snapshot from a stream of files. Each file is hashed and written
+// to the object store as its bytes arrive, so an upload never has to be held
+// in memory or written twice. Throws std::runtime_error on I/O failure.
+class WorkspaceWriter {
+public:
+    WorkspaceWriter();
+    ~WorkspaceWriter();
+
+    WorkspaceWriter(const WorkspaceWriter&) = delete;
+    WorkspaceWriter& operator=(const WorkspaceWriter&) = delete;
+
+    // rel_path must be relative and free of "." / ".." components.
+    void begin_file(const std::string& rel_path, bool executable = false);
+    void write(const void* data, size_t len);
+    void end_file();
+
+    void add_symlink(const std::string& rel_path, const std::string& target);
+
+    // Publishes the snapshot. With an empty key the key is derived from the
+    // content, so identical uploads resolve to the same snapshot.
+    WorkspaceSnapshot commit(const std::string& key = "");
+
+private:
+    struct Entry {
+        std::string path;
+        std::string object;   // object name, or "->target" for symlinks
+    };
+
+    std::string m_staging;
+    std::vector<Entry> m_entries;
+    bool m_committed;
+
+    // current file
+    int m_fd;
+    std::string m_tmp_path;
+    std::string m_rel_path;
+    bool m_executable;
+    Sha256 m_hash;
+};
+
+// Returns the snapshot for commit_sha (a full SHA-1 or SHA-256 id in
+// lowercase hex) of url, cloning and ingesting it on a cache miss. Concurrent requests for the same commit share one clone.
+WorkspaceSnapshot materialize_git(const std::string& url,
+                                  const std::string& commit_sha,
+                                  const std::string& branch = "");
+
+bool is_safe_relative_path(const std::string& rel_path);
@@ -0,0 +1,355 @@
+#ifdef __linux__
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "ct_zygote.h"
+#include "ct_cgroup.h"
+#include "ct_exec.h"
+#include "ct_image.h"
+#include "ct_mount.h"
+#include "ct_telemetry.h"
+#include "ct_topology.h"
+#include <sched.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+// Interpreter start-up with the instrumentations and preloads
+static constexpr int kBootTimeoutMs  = 30000;
+static constexpr int kForkTimeoutMs  = 5000;
+static constexpr int kSetupTimeoutMs = 5000;
+
+// Between boot attempts, and between health checks of a running zygote
+static constexpr auto kRestartInterval = std::chrono::seconds(1);
+
+struct ZygoteArgs {
+    RootfsSpec rootfs;
+    ExecSpec exec;
+    int ctl_fd;
+};
+
+static int zygote_child_main(void* arg);
+
+static bool wait_readable(int fd, int timeout_ms) {
+    pollfd pfd{fd, POLLIN, 0};
+    int r;
+    do {
+        r = ::poll(&pfd, 1, timeout_ms);
+    } while (r < 0 && errno == EINTR);
+    return r > 0;
+}
+
+// Reads exactly one message of len bytes
+static bool read_msg(int fd, void* out, size_t len, int timeout_ms) {
+    if (!wait_readable(fd, timeout_ms)) return false;
+
+    ssize_t n;
+    do {
+        n = ::recv(fd, out, len, 0);
+    } while (n < 0 && errno == EINTR);
+    return n == (ssize_t)len;
+}
+
+// The fork request, with the run socket, the run's telemetry channel and its
+// network namespace
+static bool send_fork(int ctl, const ZygoteFork& msg, int run_fd, int telemetry_fd,
+                      int netns_fd) {
+    iovec iov{const_cast<ZygoteFork*>(&msg), sizeof(msg)};
+    msghdr mh{};
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+
+    int fds[3] = {run_fd};
+    size_t nfds = 1;
+    if (telemetry_fd >= 0) fds[nfds++] = telemetry_fd;
+    if (netns_fd >= 0) fds[nfds++] = netns_fd;
+
+    alignas(cmsghdr) char cbuf[CMSG_SPACE(sizeof(fds))];
+    mh.msg_control = cbuf;
+    mh.msg_controllen = CMSG_SPACE(nfds * sizeof(int));
+    cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(nfds * sizeof(int));
+    ::memcpy(CMSG_DATA(cm), fds, nfds * sizeof(int));
+
+    return ::sendmsg(ctl, &mh, MSG_NOSIGNAL) == (ssize_t)sizeof(msg);
+}
+
+static bool copy_field(char* dst, size_t cap, const std::string& src) {
+    if (src.size() >= cap || src.find('\0') != std::string::npos) return false;
+    ::memcpy(dst, src.c_str(), src.size() + 1);
+    return true;
+}
+
+static void kill_and_reap(pid_t pid) {
+    ::kill(pid, SIGKILL);
+    ::waitpid(pid, nullptr, 0);
+}
+
+Zygote::Zygote(const ZygoteConfig& cfg)
+    : m_cfg(cfg), m_pid(-1), m_ctl_fd(-1), m_stopping(false), m_restarts(0) {
+    if (cfg.python) {
+        m_keeper = std::thread(&Zygote::keeper_main, this);
+    }
+}
+
+Zygote::~Zygote() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    if (m_keeper.joinable()) m_keeper.join();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    discard();
+}
+
+bool Zygote::ready(ContainerTemplate tmpl) {
+    if (tmpl != ContainerTemplate::Python) return false;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_ctl_fd >= 0;
+}
+
+// Caller holds m_mutex
+void Zygote::discard() {
+    if (m_ctl_fd < 0) return;
+    ::close(m_ctl_fd);
+    kill_and_reap(m_pid);
+    m_ctl_fd = -1;
+    m_pid = -1;
+}
+
+pid_t Zygote::spawn(ContainerTemplate tmpl, const RunSpec& run, SpawnTimings* timings) {
+    if (tmpl != ContainerTemplate::Python || !run.deps_key.empty()) {
+        return -1;
+    }
+
+    ZygoteFork msg{};
+    msg.ws_mount = (uint32_t)run.ws_mount;
+    msg.netns = run.netns_fd >= 0 ? 1 : 0;
+    if (!copy_field(msg.run_id, sizeof(msg.run_id), run.run_id) ||
+        !copy_field(msg.workspace_path, sizeof(msg.workspace_path), run.workspace_path) ||
+        !copy_field(msg.entry_script, sizeof(msg.entry_script), run.entry_script)) {
+        return -1;
+    }
+
+    int rs[2];
+    if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, rs) < 0) {
+        return -1;
+    }
+
+    uint64_t since = monotonic_ns();
+    ZygoteForked forked{-1, 0};
+    {
+        // Forks are serialized on the control socket; the run sets itself up
+        // after the lock is released
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_ctl_fd < 0 || !copy_field(msg.tmpfs_opts, sizeof(msg.tmpfs_opts), m_tmpfs_opts)) {
+            ::close(rs[0]);
+            ::close(rs[1]);
+            return -1;
+        }
+        if (!send_fork(m_ctl_fd, msg, rs[1], run.telemetry_fd, run.netns_fd) ||
+            !read_msg(m_ctl_fd, &forked, sizeof(forked), kForkTimeoutMs)) {
+            std::cerr << "zygote: python zygote stopped responding; restarting it\n";
+            discard();
+            forked.pid = -1;
+            m_cv.notify_all();   // wake the keeper
+        }
+    }
+    ::close(rs[1]);
+
+    if (forked.pid <= 0) {
+        if (forked.error) std::cerr << "zygote: clone failed: " << strerror(forked.error) << "\n";
+        ::close(rs[0]);
+        return -1;
+    }
+    pid_t pid = forked.pid;
+    phase_mark(timings, SpawnPhase::Clone, since);
+
+    // The run waits for the go byte, so none of its set-up is charged to
+    // the zygote's cgroup; closing without one tells it to give up
+    if (!run.cgroup_path.empty() && !cgroup_attach(run.cgroup_path, pid)) {
+        ::close(rs[0]);
+        kill_and_reap(pid);
+        return -1;
+    }
+    if (!run.cpus.empty() && !pin_process(pid, run.cpus)) {
+        std::cerr << "zygote: pinning " << run.run_id << " to its cpus failed\n";
+    }
+    phase_mark(timings, SpawnPhase::Cgroup, since);
+
+    SpawnReport report;
+    if (::send(rs[0], "g", 1, MSG_NOSIGNAL) != 1 ||
+        !read_msg(rs[0], &report, sizeof(report), kSetupTimeoutMs)) {
+        ::close(rs[0]);
+        kill_and_reap(pid);
+        return -1;
+    }
+    ::close(rs[0]);
+
+    if (timings) {
+        size_t ws = (size_t)SpawnPhase::Workspace;
+        timings->ns[ws] = report.timings.ns[ws];
+        timings->ns[(size_t)SpawnPhase::Exec] = monotonic_ns() - report.exec_at;
+    }
+    return pid;
+}
+
+bool Zygote::boot(pid_t& pid, int& ctl_fd, std::string& tmpfs_opts) {
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0) {
+        std::cerr << "zygote: socketpair failed: " << strerror(errno) << "\n";
+        return false;
+    }
+
+    // kTelemetryFd is reserved for the runs' telemetry channels, and the fd
+    // number is baked into the zygote's environment
+    int child_fd = ::fcntl(fds[1], F_DUPFD_CLOEXEC, kTelemetryFd + 1);
+    ::close(fds[1]);
+    if (child_fd < 0) {
+        ::close(fds[0]);
+        return false;
+    }
+
+    std::unique_ptr<ZygoteArgs> args(new ZygoteArgs);
+    args->ctl_fd = child_fd;
+
+    try {
+        args->rootfs = prepare_rootfs_for_template(ContainerTemplate::Python);
+    } catch (const std::exception& ex) {
+        std::cerr << "zygote: " << ex.what() << "\n";
+        ::close(fds[0]);
+        ::close(child_fd);
+        return false;
+    }
+    build_zygote_exec_spec(args->exec, child_fd, m_cfg.preload);
+
+    const int stack_size = 1024 * 1024;
+    void* stack = ::malloc(stack_size);
+    if (!stack) {
+        ::close(fds[0]);
+        ::close(child_fd);
+        return false;
+    }
+
+    // No CLONE_NEWPID: the runs are forked with CLONE_PARENT, which the init
+    // of a PID namespace may not use
+    int flags = CLONE_NEWNS | CLONE_NEWNET | SIGCHLD;
+    pid_t child = ::clone(zygote_child_main, (char*)stack + stack_size, flags, args.get());
+
+    // No CLONE_VM: the child runs on its own copy of the stack
+    ::free(stack);
+    ::close(child_fd);
+
+    if (child < 0) {
+        std::cerr << "zygote: clone failed: " << strerror(errno) << "\n";
+        ::close(fds[0]);
+        return false;
+    }
+
+    char reply = 0;
+    if (!read_msg(fds[0], &reply, 1, kBootTimeoutMs) || reply != kZygoteReady) {
+        std::cerr << "zygote: python zygote did not come up\n";
+        ::close(fds[0]);
+        kill_and_reap(child);
+        return false;
+    }
+
+    pid = child;
+    ctl_fd = fds[0];
+    tmpfs_opts = args->rootfs.tmpfs_opts;
+    return true;
+}
+
+void Zygote::keeper_main() {
+    using clock = std::chrono::steady_clock;
+    auto next_boot = clock::now();
+    bool booted = false;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        if (m_ctl_fd >= 0) {
+            // The zygote only writes when asked to fork, so anything readable
+            // while idle is EOF: it died
+            if (m_cv.wait_for(lock, kRestartInterval, [this] { return m_stopping || m_ctl_fd < 0; })) {
+                continue;
+            }
+            pollfd pfd{m_ctl_fd, POLLIN, 0};
+            if (::poll(&pfd, 1, 0) != 0) {
+                std::cerr << "zygote: python zygote exited; restarting it\n";
+                discard();
+            }
+            continue;
+        }
+
+        // Rate limit boots so a zygote that cannot start does not spin
+        if (m_cv.wait_until(lock, next_boot, [this] { return m_stopping; })) break;
+        next_boot = clock::now() + kRestartInterval;
+
+        lock.unlock();
+        pid_t pid = -1;
+        int ctl_fd = -1;
+        std::string tmpfs_opts;
+        bool ok = boot(pid, ctl_fd, tmpfs_opts);
+        lock.lock();
+
+        if (!ok) continue;
+        if (m_stopping) {
+            ::close(ctl_fd);
+            kill_and_reap(pid);
+            break;
+        }
+        m_pid = pid;
+        m_ctl_fd = ctl_fd;
+        m_tmpfs_opts = tmpfs_opts;
+        if (booted) ++m_restarts;
+        booted = true;
+    }
+}
+
+static int zygote_child_main(void* arg) {
+    // Runs on a copy of the parent's address space: no allocation, no frees
+    ZygoteArgs* args = (ZygoteArgs*)arg;
+    int ctl = args->ctl_fd;
+
+    // The zygote lives as long as the daemon; keep only the control socket
+    close_inherited_fds(ctl);
+
+    // Keeps /old_root, so each run can bind its workspace
+    if (!setup_rootfs(args->rootfs)) {
+        return 1;
+    }
+
+    // Inherited by the interpreter (KYNTRIX_ZYGOTE_FD)
+    if (::fcntl(ctl, F_SETFD, 0) < 0) {
+        return 1;
+    }
+
+    // Holds kTelemetryFd so nothing the interpreter opens lands there; each
+    // run replaces it with its channel
+    int hold = ::eventfd(0, 0);
+    if (hold < 0) {
+        return 1;
+    }
+    if (hold != kTelemetryFd) {
+        if (::dup2(hold, kTelemetryFd) < 0) return 1;
+        ::close(hold);
+    }
+    ::execvpe(args->exec.argv[0], args->exec.argv.data(), args->exec.envp.data());
+    return 1;
+}
+
+#endif // __linux__
@@ -0,0 +1,98 @@
+#pragma once
+#include "ct_namespace.h"
+#include <sys/types.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <limits.h>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct ZygoteConfig {
+    bool python = false;     // fork Python runs from a preloaded interpreter
+    std::string preload;     // comma-separated modules the zygote imports up front
+};
+
+// Fork server for a template. The zygote is a long-lived container (own
+// mount and network namespaces, rootfs pivoted, the host root still at
+// /old_root) running the template's instrumented interpreter: for Python,
+// opentelemetry-instrument with adapters/python-embedded/zygote.py as the
+// entry point, so the SDK, the instrumentations and any preloaded modules
+// are imported once. Each run is forked from it by libkyntrix_zygote.so into
+// fresh PID, mount and network namespaces (or joins the pooled network
+// namespace in RunSpec::netns_fd); CLONE_PARENT makes the run a
+// child of the daemon, so it is reaped like any other container.
+//
+// The zygote's image root is shared with its runs and is read-only in them;
+// each run gets its own /proc, /tmp and /workspace.
+//
+// Node is not supported: V8's platform threads and libuv do not survive
+// fork(), so Node runs keep using the warm pool.
+class Zygote {
+public:
+    explicit Zygote(const ZygoteConfig& cfg);
+    ~Zygote();
+
+    Zygote(const Zygote&) = delete;
+    Zygote& operator=(const Zygote&) = delete;
+
+    // Forks a run from tmpl's zygote, moves it into run.cgroup_path (pinned to
+    // run.cpus) and waits
+    // until its entry point is about to run. Returns the run's pid, or -1 if
+    // the template has no zygote (or it is still starting) or the fork
+    // failed; the caller then falls back to the warm pool or a cold start.
+    // run.deps_key is not supported.
+    // @param timings: Optional; receives the Clone, Cgroup, Workspace and
+    // Exec phases
+    pid_t spawn(ContainerTemplate tmpl, const RunSpec& run,
+                SpawnTimings* timings = nullptr);
+
+    bool ready(ContainerTemplate tmpl);
+    uint64_t restarts() const { return m_restarts.load(); }
+
+private:
+    bool boot(pid_t& pid, int& ctl_fd, std::string& tmpfs_opts);
+    void keeper_main();
+    void discard();
+
+    ZygoteConfig m_cfg;
+    std::mutex m_mutex;              // held across a fork request
+    std::condition_variable m_cv;
+    pid_t m_pid;
+    int m_ctl_fd;
+    std::string m_tmpfs_opts;        // of the zygote's image (ct_image.h)
+    bool m_stopping;
+    std::atomic<uint64_t> m_restarts;
+    std::thread m_keeper;
+};
+
+// Control protocol on the zygote's SOCK_SEQPACKET socket, shared with the
+// shim in ct_zygote_shim.cpp:
+//
+//   zygote -> daemon  kZygoteReady once the interpreter has preloaded
+//   daemon -> zygote  ZygoteFork, with SCM_RIGHTS [run socket, telemetry fd,
+//                     network namespace]; the last two only when the run has them
+//   zygote -> daemon  ZygoteForked
+//
+// The run socket is a per-run socketpair: the forked run reads one byte from
+// it once it has joined its cgroup (EOF means give up), sets up its mounts,
+// sends a SpawnReport and closes it before the entry point runs.
+inline constexpr char kZygoteReady = 'R';
+
+struct ZygoteFork {
+    uint32_t ws_mount;      // WorkspaceMount
+    uint32_t netns;         // 1: the last fd attached is a network namespace
+    char run_id[256];
+    char workspace_path[PATH_MAX];
+    char entry_script[PATH_MAX];
+    char tmpfs_opts[128];   // for the run's /tmp and workspace upper dir
+};
+
+struct ZygoteForked {
+    int32_t pid;            // in the daemon's PID namespace; -1 on failure
+    int32_t error;          // errno of a failed clone()
+};
+
+// Environment variable naming the zygote's control socket
+inline constexpr const char* kZygoteFdEnv = "KYNTRIX_ZYGOTE_FD";
@@ -0,0 +1,225 @@
+#ifdef __linux__
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "ct_zygote.h"
+#include "ct_mount.h"
+#include "ct_telemetry.h"
+#include <sched.h>
+#include <signal.h>
+#include <sys/mount.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// libkyntrix_zygote.so: the zygote side of ct_zygote.h, loaded with ctypes by
+// adapters/python-embedded/zygote.py. The interpreter drives the loop:
+//
+//   kyntrix_zygote_ready()
+//   while kyntrix_zygote_wait() == 1:
+//       PyOS_BeforeFork(); pid = kyntrix_zygote_fork(); PyOS_AfterFork_*()
+//       in the run (pid 0): run kyntrix_zygote_entry()
+//
+// so CPython's own fork bookkeeping (import lock, threading, os.register_at_fork
+// handlers such as the OTel batch span processor's) brackets a clone() that
+// fork() cannot express.
+
+extern "C" {
+int kyntrix_zygote_ready(void);
+int kyntrix_zygote_wait(void);
+int kyntrix_zygote_fork(void);
+const char* kyntrix_zygote_run_id(void);
+const char* kyntrix_zygote_entry(void);
+}
+
+static int g_ctl = -1;
+static ZygoteFork g_req;
+static int g_run_fd = -1;
+static int g_telemetry_fd = -1;
+static int g_netns_fd = -1;
+static char g_entry[PATH_MAX];
+
+static void close_request_fds() {
+    if (g_run_fd >= 0) ::close(g_run_fd);
+    if (g_telemetry_fd >= 0) ::close(g_telemetry_fd);
+    if (g_netns_fd >= 0) ::close(g_netns_fd);
+    g_run_fd = g_telemetry_fd = g_netns_fd = -1;
+}
+
+int kyntrix_zygote_ready(void) {
+    const char* v = ::getenv(kZygoteFdEnv);
+    if (!v || !*v) return -1;
+
+    char* end = nullptr;
+    long fd = ::strtol(v, &end, 10);
+    if (*end != '\0' || fd <= kTelemetryFd) return -1;
+
+    // Not inherited by anything the runs exec
+    if (::fcntl((int)fd, F_SETFD, FD_CLOEXEC) < 0) return -1;
+    g_ctl = (int)fd;
+    return ::write(g_ctl, &kZygoteReady, 1) == 1 ? 0 : -1;
+}
+
+int kyntrix_zygote_wait(void) {
+    close_request_fds();
+
+    alignas(cmsghdr) char cbuf[CMSG_SPACE(3 * sizeof(int))];
+    iovec iov{&g_req, sizeof(g_req)};
+    msghdr mh{};
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+
+    for (;;) {
+        mh.msg_control = cbuf;
+        mh.msg_controllen = sizeof(cbuf);
+
+        ssize_t n;
+        do {
+            n = ::recvmsg(g_ctl, &mh, MSG_CMSG_CLOEXEC);
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0) return 0;   // the daemon closed the socket
+
+        int fds[3] = {-1, -1, -1};
+        size_t nfds = 0;
+        cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+        if (cm && cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS) {
+            nfds = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            if (nfds > 3) nfds = 3;
+            ::memcpy(fds, CMSG_DATA(cm), nfds * sizeof(int));
+        }
+        g_run_fd = fds[0];
+        if (n == (ssize_t)sizeof(g_req) && g_req.netns && nfds > 1) {
+            g_netns_fd = fds[--nfds];
+            fds[nfds] = -1;
+        }
+        g_telemetry_fd = fds[1];
+
+        bool complete = n == (ssize_t)sizeof(g_req) && g_run_fd >= 0 &&
+                        (g_netns_fd >= 0) == (g_req.netns != 0);
+        if (complete) break;
+
+        ZygoteForked reply{-1, EINVAL};
+        (void)!::send(g_ctl, &reply, sizeof(reply), MSG_NOSIGNAL);
+        close_request_fds();
+    }
+
+    g_req.run_id[sizeof(g_req.run_id) - 1] = '\0';
+    g_req.workspace_path[sizeof(g_req.workspace_path) - 1] = '\0';
+    g_req.entry_script[sizeof(g_req.entry_script) - 1] = '\0';
+    g_req.tmpfs_opts[sizeof(g_req.tmpfs_opts) - 1] = '\0';
+
+    int n = ::snprintf(g_entry, sizeof(g_entry), "/workspace/%s", g_req.entry_script);
+    if (n < 0 || (size_t)n >= sizeof(g_entry)) g_entry[0] = '\0';
+    return 1;
+}
+
+const char* kyntrix_zygote_run_id(void) {
+    return g_req.run_id;
+}
+
+const char* kyntrix_zygote_entry(void) {
+    return g_entry;
+}
+
+// The run's half: waits to be moved into its cgroup, then replaces the
+// zygote's view of /proc, /sys and /tmp with its own and mounts its
+// workspace
+static bool setup_run() {
+    char go;
+    if (::read(g_run_fd, &go, 1) != 1) {
+        return false;
+    }
+
+    SpawnReport report{};
+    uint64_t since = monotonic_ns();
+
+    if (g_netns_fd >= 0) {
+        if (::setns(g_netns_fd, CLONE_NEWNET) < 0) return false;
+        ::close(g_netns_fd);
+        g_netns_fd = -1;
+    }
+
+    // The old mounts show the zygote's PID and network namespaces
+    ::umount2("/proc", MNT_DETACH);
+    if (::mount("proc", "/proc", "proc", 0, nullptr) < 0) {
+        return false;
+    }
+    ::umount2("/sys", MNT_DETACH);
+    if (::mount("sysfs", "/sys", "sysfs", 0, nullptr) < 0) {
+        return false;
+    }
+
+    if (::mount("tmpfs", "/tmp", "tmpfs", MS_NOSUID | MS_NODEV, g_req.tmpfs_opts) < 0 ||
+        ::chmod("/tmp", 01777) < 0) {
+        return false;
+    }
+
+    // Fresh scratch for a Snapshot workspace's upper dir; the zygote's
+    // overlay root keeps its own
+    if (::mount("tmpfs", "/old_root/mnt/kyntrix-rw", "tmpfs", MS_NOSUID | MS_NODEV,
+                g_req.tmpfs_opts) < 0) {
+        return false;
+    }
+
+    WorkspaceMount mode = g_req.ws_mount == (uint32_t)WorkspaceMount::Snapshot
+        ? WorkspaceMount::Snapshot : WorkspaceMount::Bind;
+    if (g_entry[0] == '\0' || !mount_workspace(g_req.workspace_path, mode)) {
+        return false;
+    }
+
+    // The image root's upper dir is shared with the zygote and every other run
+    if (::mount(nullptr, "/", nullptr, MS_REMOUNT | MS_BIND | MS_RDONLY, nullptr) < 0) {
+        return false;
+    }
+    phase_mark(&report.timings, SpawnPhase::Workspace, since);
+
+    // kTelemetryFd holds a placeholder from the zygote's start-up
+    if (g_telemetry_fd >= 0) {
+        if (!telemetry_install(g_telemetry_fd)) return false;
+        g_telemetry_fd = -1;
+    } else {
+        ::close(kTelemetryFd);
+    }
+    if (::chdir("/") < 0) {
+        return false;
+    }
+
+    report.exec_at = monotonic_ns();
+    if (::send(g_run_fd, &report, sizeof(report), MSG_NOSIGNAL) != (ssize_t)sizeof(report)) {
+        return false;
+    }
+    ::close(g_run_fd);
+    g_run_fd = -1;
+    return true;
+}
+
+int kyntrix_zygote_fork(void) {
+    if (g_run_fd < 0) return -1;
+
+    // fork() semantics (same stack, copy-on-write memory) in fresh namespaces;
+    // CLONE_PARENT makes kyntrixd the parent so it reaps the run. A run with
+    // a pooled network namespace joins it in setup_run() instead.
+    long flags = CLONE_PARENT | CLONE_NEWPID | CLONE_NEWNS | SIGCHLD;
+    if (g_netns_fd < 0) flags |= CLONE_NEWNET;
+    long pid = ::syscall(SYS_clone, flags, nullptr, nullptr, nullptr, 0);
+    if (pid == 0) {
+        ::close(g_ctl);
+        if (!setup_run()) ::_exit(1);
+        return 0;
+    }
+
+    ZygoteForked reply{(int32_t)pid, pid < 0 ? errno : 0};
+    close_request_fds();
+    (void)!::send(g_ctl, &reply, sizeof(reply), MSG_NOSIGNAL);
+    return pid < 0 ? -1 : (int)pid;
+}
+
+#endif // __linux__
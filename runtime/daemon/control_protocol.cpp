@@ -0,0 +1,256 @@
+// runtime/daemon/control_protocol.cpp
+#include "control_protocol.h"
+#include <cstring>
+#include <initializer_list>
+
+using json = nlohmann::json;
+
+static uint32_t load_u32(const char* p) {
+    const unsigned char* b = (const unsigned char*)p;
+    return (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+}
+
+static void store_u32(char* p, uint32_t v) {
+    p[0] = (char)(v & 0xff);
+    p[1] = (char)(v >> 8 & 0xff);
+    p[2] = (char)(v >> 16 & 0xff);
+    p[3] = (char)(v >> 24 & 0xff);
+}
+
+bool decode_frame_header(const char* p, FrameHeader& out) {
+    if ((uint8_t)p[0] != kFrameMagic) return false;
+    out.version = (uint8_t)p[1];
+    out.type    = (FrameType)(uint8_t)p[2];
+    out.id      = load_u32(p + 4);
+    out.length  = load_u32(p + 8);
+    return true;
+}
+
+void append_frame(std::string& out, FrameType type, uint32_t id, const std::string& body) {
+    char h[kFrameHeaderBytes] = {};
+    h[0] = (char)kFrameMagic;
+    h[1] = (char)kProtocolVersion;
+    h[2] = (char)type;
+    store_u32(h + 4, id);
+    store_u32(h + 8, (uint32_t)body.size());
+    out.append(h, sizeof(h));
+    out += body;
+}
+
+static const struct {
+    const char* name;
+    ControlAction action;
+} kActions[] = {
+    {"start",        ControlAction::Start},
+    {"start_many",   ControlAction::StartMany},
+    {"stop",         ControlAction::Stop},
+    {"usage",        ControlAction::Usage},
+    {"status",       ControlAction::Status},
+    {"subscribe",    ControlAction::Subscribe},
+    {"import_layer", ControlAction::ImportLayer},
+    {"has_layer",    ControlAction::HasLayer},
+    {"stats",        ControlAction::Stats},
+};
+
+// Field checks for one object; the first failure is kept in error
+class Schema {
+public:
+    Schema(json& obj, std::string prefix, std::string& error)
+        : m_obj(obj), m_prefix(std::move(prefix)), m_error(error) {}
+
+    bool ok() const { return m_error.empty(); }
+
+    void string(const char* key, std::string& out, bool required = false) {
+        json* v = find(key, required);
+        if (!v) return;
+        if (!v->is_string()) return fail(key, "must be a string");
+        out = std::move(v->get_ref<std::string&>());
+    }
+
+    void integer(const char* key, long& out) {
+        json* v = find(key, false);
+        if (!v) return;
+        if (!v->is_number_integer()) return fail(key, "must be an integer");
+        out = v->get<long>();
+    }
+
+    void one_of(const char* key, std::string& out, std::initializer_list<const char*> allowed) {
+        string(key, out);
+        if (!ok() || !m_obj.contains(key)) return;
+        for (const char* a : allowed) {
+            if (out == a) return;
+        }
+        fail(key, "has an unsupported value");
+    }
+
+    // Object of path -> content
+    void files(const char* key, StartRequest& out) {
+        json* v = find(key, false);
+        if (!v) return;
+        if (!v->is_object()) return fail(key, "must be an object of path -> content");
+        out.files.reserve(v->size());
+        for (auto it = v->begin(); it != v->end(); ++it) {
+            if (!it.value().is_string()) {
+                return fail(key, ("entry " + it.key() + " must be a string").c_str());
+            }
+            out.files.emplace_back(it.key(), std::move(it.value().get_ref<std::string&>()));
+        }
+        out.has_files = true;
+    }
+
+    json* array(const char* key) {
+        json* v = find(key, true);
+        if (!v) return nullptr;
+        if (!v->is_array()) {
+            fail(key, "must be an array");
+            return nullptr;
+        }
+        return v;
+    }
+
+    // Called last: anything not consumed above (or in extra) is unknown
+    void no_other_fields(std::initializer_list<const char*> known,
+                         std::initializer_list<const char*> extra = {}) {
+        if (!ok()) return;
+        for (auto it = m_obj.begin(); it != m_obj.end(); ++it) {
+            bool found = false;
+            for (auto list : {known, extra}) {
+                for (const char* k : list) {
+                    if (it.key() == k) { found = true; break; }
+                }
+            }
+            if (!found) {
+                m_error = "unknown field " + m_prefix + it.key();
+                return;
+            }
+        }
+    }
+
+private:
+    json* find(const char* key, bool required) {
+        if (!ok()) return nullptr;
+        auto it = m_obj.find(key);
+        if (it == m_obj.end()) {
+            if (required) fail(key, "is required");
+            return nullptr;
+        }
+        return &*it;
+    }
+
+    void fail(const char* key, const char* why) {
+        if (ok()) m_error = m_prefix + key + " " + why;
+    }
+
+    json& m_obj;
+    std::string m_prefix;
+    std::string& m_error;
+};
+
+static bool is_full_sha(const std::string& s) {
+    if (s.size() != 40 && s.size() != 64) return false;
+    for (char c : s) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) return false;
+    }
+    return true;
+}
+
+// extra: the caller's own fields in obj ("action" for a start request)
+static void decode_start(json& obj, const std::string& prefix, StartRequest& out, std::string& error,
+                         std::initializer_list<const char*> extra) {
+    Schema s(obj, prefix, error);
+    s.string("run_id", out.run_id, true);
+    s.one_of("template", out.tmpl, {"node", "python"});
+    s.string("entry", out.entry);
+    s.one_of("mode", out.mode, {"", "files", "git"});
+    s.string("deps_key", out.deps_key);
+    s.string("tier", out.tier);
+    s.string("workspace_path", out.workspace_path);
+    s.string("git_url", out.git_url);
+    s.string("commit_sha", out.commit_sha);
+    s.string("branch", out.branch);
+    s.integer("timeout_ms", out.timeout_ms);
+    s.files("files", out);
+    s.no_other_fields({"run_id", "template", "entry", "mode", "deps_key",
+                       "tier", "workspace_path", "git_url", "commit_sha", "branch",
+                       "timeout_ms", "files"}, extra);
+
+    // Without it the run would start on an empty workspace
+    if (s.ok() && out.mode == "files" && !out.has_files) {
+        error = prefix + "files is required when mode is \"files\"";
+    }
+    // Snapshots are cached per full commit id; an abbreviation would miss
+    if (s.ok() && out.mode == "git" && !is_full_sha(out.commit_sha)) {
+        error = prefix + "commit_sha must be a full 40 or 64 hex digit commit id";
+    }
+}
+
+bool decode_control_request(json& req, ControlRequest& out, std::string& error) {
+    error.clear();
+    if (!req.is_object()) {
+        error = "request must be an object";
+        return false;
+    }
+
+    Schema s(req, "", error);
+    s.string("action", out.action_name, true);
+    if (!s.ok()) return false;
+
+    bool known = false;
+    for (const auto& a : kActions) {
+        if (out.action_name == a.name) {
+            out.action = a.action;
+            known = true;
+            break;
+        }
+    }
+    if (!known) {
+        error = "unknown action";
+        return false;
+    }
+
+    switch (out.action) {
+        case ControlAction::Start:
+            out.starts.resize(1);
+            decode_start(req, "", out.starts[0], error, {"action"});
+            break;
+        case ControlAction::StartMany: {
+            json* runs = s.array("runs");
+            s.no_other_fields({"action", "runs"});
+            if (!runs) break;
+            if (runs->size() > kMaxBatchRuns) {
+                error = "runs exceeds " + std::to_string(kMaxBatchRuns) + " entries";
+                break;
+            }
+            out.starts.resize(runs->size());
+            for (size_t i = 0; i < runs->size() && error.empty(); ++i) {
+                std::string prefix = "runs[" + std::to_string(i) + "].";
+                if (!(*runs)[i].is_object()) {
+                    error = prefix.substr(0, prefix.size() - 1) + " must be an object";
+                    break;
+                }
+                decode_start((*runs)[i], prefix, out.starts[i], error, {});
+            }
+            break;
+        }
+        case ControlAction::Stop:
+        case ControlAction::Usage:
+        case ControlAction::Status:
+            s.string("run_id", out.run_id, true);
+            s.no_other_fields({"action", "run_id"});
+            break;
+        case ControlAction::ImportLayer:
+            s.string("src_dir", out.src_dir, true);
+            s.string("digest", out.digest, true);
+            s.no_other_fields({"action", "src_dir", "digest"});
+            break;
+        case ControlAction::HasLayer:
+            s.string("digest", out.digest, true);
+            s.no_other_fields({"action", "digest"});
+            break;
+        case ControlAction::Subscribe:
+        case ControlAction::Stats:
+            s.no_other_fields({"action"});
+            break;
+    }
+    return error.empty();
+}
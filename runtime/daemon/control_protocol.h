@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// Framed control protocol on kyntrixd's socket, used by the instance manager
+// (servers/instance-manager/daemonClient.ts) over one persistent connection.
+//
+// Every message is a 12-byte header followed by a JSON body:
+//
+//   u8  magic     kFrameMagic (never the first byte of a JSON line, so the
+//                 daemon tells framed connections from newline-delimited ones)
+//   u8  version   kProtocolVersion
+//   u8  type      FrameType
+//   u8  flags     0
+//   u32 id        request id chosen by the client, echoed in its response;
+//                 0 on events
+//   u32 length    body bytes
+//
+// integers little-endian. Requests are pipelined: the daemon runs up to
+// kMaxInFlight of a connection's requests at once and answers each as it
+// completes, so responses may arrive out of order.
+
+inline constexpr uint8_t kFrameMagic = 0xC7;
+inline constexpr uint8_t kProtocolVersion = 1;
+inline constexpr size_t kFrameHeaderBytes = 12;
+
+// Requests of one framed connection executing at once
+inline constexpr size_t kMaxInFlight = 64;
+// Requests of one connection read but not yet started; a client that
+// pipelines past this is dropped
+inline constexpr size_t kMaxPending = 1024;
+// Runs in one start_many request
+inline constexpr size_t kMaxBatchRuns = 256;
+
+enum class FrameType : uint8_t {
+    Request  = 1,
+    Response = 2,
+    Event    = 3,    // exit events on a subscribed connection
+};
+
+struct FrameHeader {
+    uint8_t version;
+    FrameType type;
+    uint32_t id;
+    uint32_t length;
+};
+
+// Reads a header from p (kFrameHeaderBytes). False if the magic is wrong.
+bool decode_frame_header(const char* p, FrameHeader& out);
+
+// Appends a frame carrying body to out
+void append_frame(std::string& out, FrameType type, uint32_t id, const std::string& body);
+
+enum class ControlAction {
+    Start,
+    StartMany,
+    Stop,
+    Usage,
+    Status,
+    Subscribe,
+    ImportLayer,
+    HasLayer,
+    Stats,
+};
+
+// { action: "start", run_id, template?, entry?, mode?, ... }; also one
+// element of start_many's "runs"
+struct StartRequest {
+    std::string run_id;
+    std::string tmpl = "node";        // "node" | "python"
+    std::string entry;
+    std::string mode;                 // "" (bind workspace_path) | "files" | "git"
+    std::string deps_key;
+    std::string tier;
+    std::string workspace_path;
+    std::string git_url;
+    std::string commit_sha;
+    std::string branch;
+    long timeout_ms = -1;
+    bool has_files = false;
+    std::vector<std::pair<std::string, std::string>> files;   // path -> content
+};
+
+struct ControlRequest {
+    ControlAction action;
+    std::string action_name;
+    std::string run_id;               // stop, usage, status
+    std::string src_dir;              // import_layer
+    std::string digest;               // import_layer, has_layer
+    std::vector<StartRequest> starts; // one for start, the batch for start_many
+};
+
+// Checks req against the action's schema: required fields present, every
+// field of the expected type, no unknown fields. File contents are moved
+// out of req. On failure error names the offending field.
+bool decode_control_request(nlohmann::json& req, ControlRequest& out, std::string& error);
@@ -0,0 +1,102 @@
+// runtime/daemon/daemon_config.cpp
+#include "daemon_config.h"
+#include <cstdlib>
+#include <string>
+
+static long env_long(const char* name, long fallback) {
+    const char* v = std::getenv(name);
+    if (!v || !*v) return fallback;
+
+    char* end = nullptr;
+    long n = std::strtol(v, &end, 10);
+    if (end == v || *end != '\0' || n < 0) return fallback;
+    return n;
+}
+
+static double env_double(const char* name, double fallback) {
+    const char* v = std::getenv(name);
+    if (!v || !*v) return fallback;
+
+    char* end = nullptr;
+    double d = std::strtod(v, &end);
+    if (end == v || *end != '\0' || d < 0) return fallback;
+    return d;
+}
+
+DaemonConfig load_daemon_config(int argc, char* argv[]) {
+    DaemonConfig cfg;
+
+    if (const char* p = std::getenv("KYNTRIXD_SOCKET")) {
+        cfg.socket_path = p;
+    }
+    if (argc > 1) {
+        cfg.socket_path = argv[1];
+    }
+
+    cfg.listen_backlog    = (int)env_long("KYNTRIXD_LISTEN_BACKLOG", cfg.listen_backlog);
+    cfg.worker_threads    = (size_t)env_long("KYNTRIXD_WORKERS", (long)cfg.worker_threads);
+    cfg.max_request_bytes = (size_t)env_long("KYNTRIXD_MAX_REQUEST_BYTES", (long)cfg.max_request_bytes);
+    cfg.max_connections   = (int)env_long("KYNTRIXD_MAX_CONNECTIONS", cfg.max_connections);
+
+    cfg.pool_node_size      = (size_t)env_long("KYNTRIXD_POOL_NODE", (long)cfg.pool_node_size);
+    cfg.pool_python_size    = (size_t)env_long("KYNTRIXD_POOL_PYTHON", (long)cfg.pool_python_size);
+    cfg.pool_refill_per_sec = env_double("KYNTRIXD_POOL_REFILL_PER_SEC", cfg.pool_refill_per_sec);
+    cfg.zygote_python       = env_long("KYNTRIXD_ZYGOTE_PYTHON", cfg.zygote_python ? 1 : 0) != 0;
+
+    cfg.sched_enabled          = env_long("KYNTRIXD_SCHED", cfg.sched_enabled ? 1 : 0) != 0;
+    cfg.sched_cpus_per_run     = (size_t)env_long("KYNTRIXD_SCHED_CPUS_PER_RUN", (long)cfg.sched_cpus_per_run);
+    cfg.sched_runs_per_slot    = (size_t)env_long("KYNTRIXD_SCHED_RUNS_PER_SLOT", (long)cfg.sched_runs_per_slot);
+    cfg.sched_queue_max        = (size_t)env_long("KYNTRIXD_SCHED_QUEUE_MAX", (long)cfg.sched_queue_max);
+    cfg.sched_queue_timeout_ms = env_long("KYNTRIXD_SCHED_QUEUE_TIMEOUT_MS", cfg.sched_queue_timeout_ms);
+
+    cfg.net_pool_loopback       = (size_t)env_long("KYNTRIXD_NET_POOL_LOOPBACK", (long)cfg.net_pool_loopback);
+    cfg.net_pool_egress         = (size_t)env_long("KYNTRIXD_NET_POOL_EGRESS", (long)cfg.net_pool_egress);
+    cfg.net_pool_refill_per_sec = env_double("KYNTRIXD_NET_POOL_REFILL_PER_SEC", cfg.net_pool_refill_per_sec);
+
+    cfg.run_timeout_ms = env_long("KYNTRIXD_RUN_TIMEOUT_MS", cfg.run_timeout_ms);
+    cfg.kill_grace_ms  = env_long("KYNTRIXD_KILL_GRACE_MS", cfg.kill_grace_ms);
+    cfg.telemetry_flush_ms = env_long("KYNTRIXD_TELEMETRY_FLUSH_MS", cfg.telemetry_flush_ms);
+    cfg.metrics_port   = env_long("KYNTRIXD_METRICS_PORT", cfg.metrics_port);
+
+    if (const char* p = std::getenv("KYNTRIXD_IMAGE_ROOT")) {
+        cfg.image_root = p;
+    }
+    if (const char* p = std::getenv("KYNTRIXD_ROOTFS_TMPFS_SIZE")) {
+        cfg.rootfs_tmpfs_size = p;
+    }
+    if (const char* p = std::getenv("KYNTRIXD_CGROUP_ROOT")) {
+        cfg.cgroup_root = p;
+    }
+    if (const char* p = std::getenv("KYNTRIXD_LIMITS_FILE")) {
+        cfg.limits_file = p;
+    }
+    if (const char* p = std::getenv("KYNTRIXD_TELEMETRY_URL")) {
+        cfg.telemetry_url = p;
+    }
+    if (const char* p = std::getenv("KYNTRIXD_NODE_OTEL_HOOK")) {
+        cfg.node_otel_hook = p;
+    }
+    if (const char* p = std::getenv("KYNTRIXD_ZYGOTE_PRELOAD")) {
+        cfg.zygote_preload = p;
+    }
+    if (const char* p = std::getenv("KYNTRIXD_SCHED_CPUS")) {
+        cfg.sched_cpus = p;
+    }
+    if (const char* p = std::getenv("KYNTRIXD_METRICS_SOCKET")) {
+        cfg.metrics_socket = p;
+    }
+    if (const char* p = std::getenv("KYNTRIXD_NET_POLICY")) {
+        cfg.net_policy = p;
+    }
+    if (const char* p = std::getenv("KYNTRIXD_NET_BRIDGE")) {
+        cfg.net_bridge = p;
+    }
+    if (const char* p = std::getenv("KYNTRIXD_NET_SUBNET")) {
+        cfg.net_subnet = p;
+    }
+    if (const char* p = std::getenv("KYNTRIXD_NET_EGRESS_ALLOW")) {
+        cfg.net_egress_allow = p;
+    }
+
+    return cfg;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Daemon tunables. Defaults can be overridden with KYNTRIXD_* environment
+// variables; the socket path may also be given as the first CLI argument.
+struct DaemonConfig {
+    std::string socket_path     = "/var/run/kyntrixd.sock";
+    int         listen_backlog  = 512;
+    size_t      worker_threads  = 0;                  // 0 = hardware concurrency
+    size_t      max_request_bytes = 16 * 1024 * 1024; // per framed request
+    int         max_connections = 1024;
+
+    // Warm container pool (0 disables a template's pool)
+    size_t      pool_node_size    = 0;
+    size_t      pool_python_size  = 0;
+    double      pool_refill_per_sec = 20.0;
+
+    // Python runs forked from a preloaded, instrumented interpreter
+    // (ct_zygote.h) ahead of the warm pool; zygote_preload lists modules it
+    // imports up front, comma-separated
+    bool        zygote_python  = false;
+    std::string zygote_preload;
+
+    // Layered image store and per-run overlay upper dir
+    std::string image_root        = "/var/lib/kyntrix";
+    std::string rootfs_tmpfs_size = "256m";
+
+    // cgroup v2 parent for per-run cgroups and optional limits file
+    // (see resource_policy.h)
+    std::string cgroup_root       = "/sys/fs/cgroup/kyntrix";
+    std::string limits_file;
+
+    // Run scheduler (run_scheduler.h): admits runs against the CPUs in
+    // sched_cpus (kernel cpu list; empty = every online CPU), queues the
+    // rest by tier priority and pins each run to its slot. Leave the CPUs of
+    // the daemon and of other services out of sched_cpus.
+    bool        sched_enabled          = false;
+    std::string sched_cpus;
+    size_t      sched_cpus_per_run     = 2;
+    size_t      sched_runs_per_slot    = 1;
+    size_t      sched_queue_max        = 1024;
+    long        sched_queue_timeout_ms = 60000;   // 0 = wait indefinitely
+
+    // Network namespaces (ct_netns.h). net_policy is the default for runs
+    // (none, loopback or egress; tiers may override it, see
+    // resource_policy.h). The pool keeps namespaces ready per policy; egress
+    // ones hang off net_bridge with an address from net_subnet and reach
+    // only net_egress_allow (comma-separated CIDRs; empty = anywhere), which
+    // the host enforces with nft.
+    std::string net_policy              = "none";
+    size_t      net_pool_loopback       = 0;
+    size_t      net_pool_egress         = 0;
+    double      net_pool_refill_per_sec = 50.0;
+    std::string net_bridge              = "kyntrix0";
+    std::string net_subnet              = "10.88.0.0/16";
+    std::string net_egress_allow;
+
+    // Run lifecycle: default wall-clock limit per run (0 = none; a start
+    // request may pass its own timeout_ms) and the SIGTERM -> SIGKILL grace
+    long        run_timeout_ms = 300000;
+    long        kill_grace_ms  = 5000;
+
+    // Telemetry channels (ct_telemetry.h): when telemetry_url is set, each
+    // run gets one and the daemon forwards its spans there, e.g.
+    // http://agents:8081/ingest/tal. Otherwise containers export OTLP/HTTP.
+    std::string telemetry_url;
+    long        telemetry_flush_ms = 5;
+    std::string node_otel_hook     = "/opt/kyntrix/node/otel/register.js";
+
+    // Prometheus exposition (metrics_server.h) on a Unix socket and/or a
+    // 127.0.0.1 port; an empty path and port 0 disable the listener
+    std::string metrics_socket = "/var/run/kyntrixd-metrics.sock";
+    long        metrics_port   = 0;
+};
+
+DaemonConfig load_daemon_config(int argc, char* argv[]);
@@ -1,90 +1,742 @@
 // runtime/daemon/daemon_server.cpp
 #include "daemon_server.h"
 #include "instance_manager.h"
+#include "ct_image.h"
+#include "ct_workspace.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
 #include <nlohmann/json.hpp>
 
 
 
 using json = nlohmann::json;
 
-KyntrixDaemonServer::KyntrixDaemonServer(const std::string& socket_path)
-    : m_socket_fd(-1), m_socket_path(socket_path) {
+// epoll user data for the two non-connection fds; connection ids start above
+static constexpr uint64_t kListenId = 0;
+static constexpr uint64_t kWakeId   = 1;
 
-    m_socket_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+static const char* const kActions[] = {
+    "start", "start_many", "stop", "usage", "status", "subscribe", "import_layer",
+    "has_layer", "stats",
+};
+
+static bool is_blank(const std::string& s, size_t from, size_t to) {
+    for (size_t i = from; i < to; ++i) {
+        if (s[i] != ' ' && s[i] != '\t' && s[i] != '\r' && s[i] != '\n') return false;
+    }
+    return true;
+}
+
+static json usage_json(const CgroupUsage& u) {
+    return json{
+        {"cpu_usec", u.cpu_usec},
+        {"user_usec", u.cpu_user_usec},
+        {"system_usec", u.cpu_system_usec},
+        {"memory_peak_bytes", u.memory_peak_bytes},
+        {"io_read_bytes", u.io_read_bytes},
+        {"io_write_bytes", u.io_write_bytes},
+    };
+}
+
+KyntrixDaemonServer::KyntrixDaemonServer(const DaemonConfig& cfg)
+    : m_cfg(cfg), m_socket_fd(-1), m_epoll_fd(-1), m_wake_fd(-1), m_next_conn_id(2) {
+
+    m_socket_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (m_socket_fd < 0) {
 
         throw std::runtime_error("socket() failed");
     }
-    
-    ::unlink(socket_path.c_str());
+
+    ::unlink(m_cfg.socket_path.c_str());
 
     sockaddr_un addr{};
 
     addr.sun_family = AF_UNIX;
 
-    std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path)-1);
+    std::strncpy(addr.sun_path, m_cfg.socket_path.c_str(), sizeof(addr.sun_path)-1);
 
     if (::bind(m_socket_fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
         throw std::runtime_error("bind() failed");
     }
-    if (::listen(m_socket_fd, 16) < 0) {
+    if (::listen(m_socket_fd, m_cfg.listen_backlog) < 0) {
         throw std::runtime_error("listen() failed");
     }
+
+    m_epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll_fd < 0) {
+        throw std::runtime_error("epoll_create1() failed");
+    }
+
+    m_wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wake_fd < 0) {
+        throw std::runtime_error("eventfd() failed");
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = kListenId;
+    if (::epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_socket_fd, &ev) < 0) {
+        throw std::runtime_error("epoll_ctl(listen) failed");
+    }
+    ev.data.u64 = kWakeId;
+    if (::epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_wake_fd, &ev) < 0) {
+        throw std::runtime_error("epoll_ctl(eventfd) failed");
+    }
+
+    m_workers = std::make_unique<WorkerPool>(m_cfg.worker_threads);
+
+    const char* help = "Control request latency from receipt to response, by action";
+    for (const char* action : kActions) {
+        m_request_latency[action] = &MetricsRegistry::global().histogram(
+            "kyntrixd_request_duration_seconds", help, {{"action", action}});
+    }
+    m_request_latency["other"] = &MetricsRegistry::global().histogram(
+        "kyntrixd_request_duration_seconds", help, {{"action", "other"}});
+
+    InstanceManager::set_exit_listener([this](const RunExit& ex) {
+        json ev;
+        ev["event"]     = "exit";
+        ev["run_id"]    = ex.run_id;
+        ev["exit_code"] = ex.exit_code;
+        ev["signal"]    = ex.signal;
+        ev["wall_ms"]   = ex.wall_ms;
+        ev["timed_out"] = ex.timed_out;
+        ev["stopped"]   = ex.stopped;
+        ev["not_started"] = ex.not_started;
+        ev["usage"]     = usage_json(ex.usage);
+        publish_event(ev.dump());
+    });
 }
 
 KyntrixDaemonServer::~KyntrixDaemonServer() {
+    InstanceManager::set_exit_listener(nullptr);
+
+    // Join workers first so no completion targets a closed connection
+    m_workers.reset();
+
+    for (auto& [id, c] : m_conns) ::close(c->fd);
+    m_conns.clear();
+
+    if (m_wake_fd >= 0) ::close(m_wake_fd);
+    if (m_epoll_fd >= 0) ::close(m_epoll_fd);
     if (m_socket_fd >= 0) ::close(m_socket_fd);
-    ::unlink(m_socket_path.c_str());
+    ::unlink(m_cfg.socket_path.c_str());
 }
 
 void KyntrixDaemonServer::run() {
-    
+    std::cout << "kyntrixd listening on " << m_cfg.socket_path
+              << " (" << m_workers->size() << " workers)" << std::endl;
+
+    epoll_event events[64];
+
+    while (!m_stopping) {
+        int n = ::epoll_wait(m_epoll_fd, events, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string("epoll_wait() failed: ") + strerror(errno));
+        }
+
+        for (int i = 0; i < n; ++i) {
+            uint64_t id = events[i].data.u64;
+            uint32_t mask = events[i].events;
+
+            if (id == kListenId) {
+                accept_clients();
+                continue;
+            }
+            if (id == kWakeId) {
+                drain_completions();
+                continue;
+            }
+
+            auto it = m_conns.find(id);
+            if (it == m_conns.end()) continue;
+            Connection& c = *it->second;
+
+            if (mask & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                on_readable(c);
+            }
+            // on_readable may have closed the connection
+            it = m_conns.find(id);
+            if (it != m_conns.end() && (mask & EPOLLOUT)) {
+                on_writable(*it->second);
+            }
+        }
+    }
+}
 
+void KyntrixDaemonServer::stop() {
+    m_stopping = true;
+    uint64_t one = 1;
+    (void)!::write(m_wake_fd, &one, sizeof(one));
+}
+
+void KyntrixDaemonServer::accept_clients() {
     while (true) {
-        int client_fd = ::accept(m_socket_fd, nullptr, nullptr);
+        int client_fd = ::accept4(m_socket_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
         if (client_fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "accept4() failed: " << strerror(errno) << "\n";
+            }
+            return;
+        }
+
+        if ((int)m_conns.size() >= m_cfg.max_connections) {
+            ::close(client_fd);
+            continue;
+        }
+
+        auto c = std::make_unique<Connection>();
+        c->id = m_next_conn_id++;
+        c->fd = client_fd;
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.u64 = c->id;
+        if (::epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, client_fd, &ev) < 0) {
+            ::close(client_fd);
             continue;
         }
-        handle_client(client_fd); 
-        ::close(client_fd);
+
+        m_conns.emplace(c->id, std::move(c));
     }
 }
 
-void KyntrixDaemonServer::handle_client(int client_fd) {
-    // Naive: read whole request into buffer, assume <= 8k
-    char buf[8192];
-    ssize_t n = ::read(client_fd, buf, sizeof(buf));
-    if (n <= 0) return;
+void KyntrixDaemonServer::on_readable(Connection& c) {
+    char buf[16384];
+    std::string error;
+    uint32_t error_id = 0;
+    bool failed = false;
+
+    while (!c.peer_closed) {
+        ssize_t n = ::read(c.fd, buf, sizeof(buf));
+        if (n > 0) {
+            c.in.append(buf, (size_t)n);
+            if (c.in.size() > m_cfg.max_request_bytes && !extract_frames(c, error, error_id)) {
+                failed = true;
+                break;
+            }
+            continue;
+        }
+        if (n == 0) {
+            c.peer_closed = true;
+            break;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+
+        close_connection(c.id);
+        return;
+    }
 
-    json req = json::parse(std::string(buf, n), nullptr, false);
-    if (req.is_discarded()) {
+    if (failed || !extract_frames(c, error, error_id)) {
+        reply_and_close(c, error_id, error);
         return;
     }
 
-    std::string action = req.value("action", "");
+    if (c.peer_closed) {
+        // Nothing more to read; stop polling for input
+        update_interest(c);
+    }
+
+    dispatch_next(c);
+    maybe_close(c);
+}
+
+// Answers once, in the connection's framing, and drops it
+void KyntrixDaemonServer::reply_and_close(Connection& c, uint32_t request_id,
+                                          const std::string& error) {
     json resp;
+    resp["ok"] = false;
+    resp["error"] = error;
+
+    std::string s;
+    if (c.wire == Wire::Framed) {
+        append_frame(s, FrameType::Response, request_id, resp.dump());
+    } else {
+        s = resp.dump() + "\n";
+    }
+    (void)!::write(c.fd, s.data(), s.size());
+    close_connection(c.id);
+}
+
+bool KyntrixDaemonServer::extract_frames(Connection& c, std::string& error, uint32_t& error_id) {
+    if (c.wire == Wire::Unknown) {
+        if (c.in.empty()) return true;
+        c.wire = (uint8_t)c.in[0] == kFrameMagic ? Wire::Framed : Wire::Lines;
+    }
+    return c.wire == Wire::Framed ? extract_framed(c, error, error_id) : extract_lines(c, error);
+}
+
+bool KyntrixDaemonServer::extract_lines(Connection& c, std::string& error) {
+    size_t start = 0;
 
-    if (action == "start") {
-        // { action, run_id, template, workspace_path, entry }
-        std::string run_id = req.value("run_id", "");
-        std::string tmpl   = req.value("template", "node");
-        std::string ws     = req.value("workspace_path", "");
-        std::string entry  = req.value("entry", "");
+    while (true) {
+        size_t nl = c.in.find('\n', c.scan_pos);
+        if (nl == std::string::npos) break;
+
+        if (!is_blank(c.in, start, nl)) {
+            if (c.pending.size() >= kMaxPending) {
+                error = "too many pending requests";
+                return false;
+            }
+            c.pending.push_back({0, c.in.substr(start, nl - start)});
+        }
+        start = nl + 1;
+        c.scan_pos = start;
+    }
+
+    if (start > 0) {
+        c.in.erase(0, start);
+    }
+    c.scan_pos = c.in.size();
+
+    // EOF terminates a final unframed request (one-shot clients)
+    if (c.peer_closed && !c.in.empty()) {
+        if (!is_blank(c.in, 0, c.in.size())) {
+            c.pending.push_back({0, std::move(c.in)});
+        }
+        c.in.clear();
+        c.scan_pos = 0;
+    }
+
+    if (c.in.size() > m_cfg.max_request_bytes) {
+        error = "request too large";
+        return false;
+    }
+    return true;
+}
+
+bool KyntrixDaemonServer::extract_framed(Connection& c, std::string& error, uint32_t& error_id) {
+    size_t pos = 0;
+
+    while (c.in.size() - pos >= kFrameHeaderBytes) {
+        FrameHeader h;
+        if (!decode_frame_header(c.in.data() + pos, h)) {
+            error = "bad frame";
+            return false;
+        }
+        error_id = h.id;
+        if (h.version != kProtocolVersion) {
+            error = "unsupported protocol version " + std::to_string(h.version);
+            return false;
+        }
+        if (h.type != FrameType::Request) {
+            error = "unexpected frame type";
+            return false;
+        }
+        if (h.length > m_cfg.max_request_bytes) {
+            error = "request too large";
+            return false;
+        }
+        if (c.in.size() - pos - kFrameHeaderBytes < h.length) break;
+        if (c.pending.size() >= kMaxPending) {
+            error = "too many pending requests";
+            return false;
+        }
 
-        bool ok = InstanceManager::start_instance(run_id, tmpl, ws, entry);
+        c.pending.push_back({h.id, c.in.substr(pos + kFrameHeaderBytes, h.length)});
+        pos += kFrameHeaderBytes + h.length;
+    }
+
+    if (pos > 0) {
+        c.in.erase(0, pos);
+    }
+    // A frame cut short by EOF is dropped with the connection
+    return true;
+}
+
+void KyntrixDaemonServer::dispatch_next(Connection& c) {
+    size_t limit = c.wire == Wire::Framed ? kMaxInFlight : 1;
+
+    while (c.in_flight < limit && !c.pending.empty()) {
+        ++c.in_flight;
+        Request req = std::move(c.pending.front());
+        c.pending.pop_front();
+
+        Completion done{c.id, req.id, {}, false};
+        auto received = std::chrono::steady_clock::now();
+        m_workers->submit([this, done = std::move(done), received, body = std::move(req.body)]() mutable {
+            std::string action;
+            bool handed_off = false;
+            try {
+                json j = json::parse(body, nullptr, false);
+                body.clear();
+
+                ControlRequest req;
+                std::string error;
+                if (j.is_discarded()) {
+                    error = "invalid json";
+                } else {
+                    decode_control_request(j, req, error);
+                }
+                action = req.action_name;
+
+                if (error.empty() && req.action == ControlAction::StartMany) {
+                    // start_many answers once its last run is through
+                    handed_off = true;
+                    start_many(std::move(req.starts), std::move(done), received);
+                    return;
+                }
+                if (error.empty()) {
+                    done.response = handle_request(req, done.subscribe);
+                } else {
+                    done.response = json{{"ok", false}, {"error", error}}.dump();
+                }
+            } catch (const std::exception& ex) {
+                json err;
+                err["ok"] = false;
+                err["error"] = ex.what();
+                done.response = err.dump();
+            } catch (...) {
+                done.response = json{{"ok", false}, {"error", "internal error"}}.dump();
+            }
+            // Every request must complete, or its connection stays busy
+            if (!handed_off) complete(std::move(done), action, received);
+        });
+    }
+}
+
+// Called on a worker
+void KyntrixDaemonServer::complete(Completion done, const std::string& action,
+                                   std::chrono::steady_clock::time_point received) {
+    request_histogram(action)->record(std::chrono::steady_clock::now() - received);
+    {
+        std::lock_guard<std::mutex> lock(m_done_mutex);
+        m_done.push_back(std::move(done));
+    }
+    uint64_t one = 1;
+    (void)!::write(m_wake_fd, &one, sizeof(one));
+}
+
+void KyntrixDaemonServer::drain_completions() {
+    uint64_t counter;
+    while (::read(m_wake_fd, &counter, sizeof(counter)) > 0) {}
+
+    std::vector<Completion> done;
+    std::vector<std::string> events;
+    {
+        std::lock_guard<std::mutex> lock(m_done_mutex);
+        done.swap(m_done);
+        events.swap(m_events);
+    }
+
+    for (auto& d : done) {
+        auto it = m_conns.find(d.conn_id);
+        if (it == m_conns.end()) continue;   // client went away mid-request
+
+        Connection& c = *it->second;
+        --c.in_flight;
+        c.subscribed = c.subscribed || d.subscribe;
+        if (c.wire == Wire::Framed) {
+            append_frame(c.out, FrameType::Response, d.request_id, d.response);
+        } else {
+            c.out += d.response;
+            c.out += '\n';
+        }
+
+        on_writable(c);
+        if (m_conns.count(d.conn_id)) {
+            dispatch_next(c);
+        }
+    }
+
+    if (events.empty()) return;
+
+    std::vector<uint64_t> subscribers;
+    for (auto& [id, c] : m_conns) {
+        if (c->subscribed) subscribers.push_back(id);
+    }
+    for (uint64_t id : subscribers) {
+        Connection& c = *m_conns[id];
+        for (auto& e : events) {
+            if (c.wire == Wire::Framed) {
+                append_frame(c.out, FrameType::Event, 0, e);
+            } else {
+                c.out += e;
+                c.out += '\n';
+            }
+        }
+
+        // A subscriber that stops reading must not grow without bound
+        if (c.out.size() > m_cfg.max_request_bytes) {
+            close_connection(id);
+            continue;
+        }
+        on_writable(c);
+    }
+}
+
+// Called from the lifecycle thread
+void KyntrixDaemonServer::publish_event(std::string event) {
+    {
+        std::lock_guard<std::mutex> lock(m_done_mutex);
+        m_events.push_back(std::move(event));
+    }
+    uint64_t one = 1;
+    (void)!::write(m_wake_fd, &one, sizeof(one));
+}
+
+void KyntrixDaemonServer::on_writable(Connection& c) {
+    while (!c.out.empty()) {
+        ssize_t n = ::write(c.fd, c.out.data(), c.out.size());
+        if (n > 0) {
+            c.out.erase(0, (size_t)n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+
+        close_connection(c.id);
+        return;
+    }
+
+    update_interest(c);
+    maybe_close(c);
+}
+
+void KyntrixDaemonServer::update_interest(Connection& c) {
+    uint32_t mask = 0;
+    if (!c.peer_closed) mask |= EPOLLIN | EPOLLRDHUP;
+    if (!c.out.empty()) mask |= EPOLLOUT;
+
+    epoll_event ev{};
+    ev.events = mask;
+    ev.data.u64 = c.id;
+    ::epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, c.fd, &ev);
+}
+
+void KyntrixDaemonServer::maybe_close(Connection& c) {
+    if (c.peer_closed && c.in_flight == 0 && c.pending.empty() && c.out.empty()) {
+        close_connection(c.id);
+    }
+}
+
+void KyntrixDaemonServer::close_connection(uint64_t id) {
+    auto it = m_conns.find(id);
+    if (it == m_conns.end()) return;
+
+    ::epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, it->second->fd, nullptr);
+    ::close(it->second->fd);
+    m_conns.erase(it);
+}
+
+// Materializes the workspace for the request's mode, then starts the run.
+//   files: { files: {path: content} }          -> content-addressed snapshot
+//   git:   { git_url, commit_sha, branch? }    -> cached per-commit snapshot
+//   (none) { workspace_path }                  -> legacy read-write bind
+static void handle_start(StartRequest& req, json& resp) {
+    RunSpec run;
+    run.run_id       = req.run_id;
+    run.entry_script = req.entry;
+    run.deps_key     = req.deps_key;
+    run.ws_mount     = WorkspaceMount::Snapshot;
+
+    if (req.mode == "git") {
+        WorkspaceSnapshot snap = materialize_git(req.git_url, req.commit_sha, req.branch);
+        run.workspace_path = snap.path;
+        resp["cache_hit"] = snap.cache_hit;
+        resp["workspace_key"] = snap.key;
+    } else if (req.mode == "files" && req.has_files) {
+        WorkspaceWriter writer;
+        for (auto& [path, content] : req.files) {
+            writer.begin_file(path);
+            writer.write(content.data(), content.size());
+            writer.end_file();
+            std::string().swap(content);
+        }
+        WorkspaceSnapshot snap = writer.commit();
+        run.workspace_path = snap.path;
+        resp["cache_hit"] = snap.cache_hit;
+        resp["workspace_key"] = snap.key;
+    } else {
+        run.workspace_path = req.workspace_path;
+        run.ws_mount = WorkspaceMount::Bind;
+    }
+
+    bool queued = false;
+    std::string error;
+    resp["ok"] = InstanceManager::start_instance(req.tmpl, run, req.tier, req.timeout_ms, &queued,
+                                                 &error);
+    if (queued) resp["queued"] = true;
+    if (!error.empty()) resp["error"] = error;
+}
+
+// Each run starts on its own worker; the last to finish answers with
+// {"ok": all started, "results": [{run_id, ok, error?, cache_hit?, ...}]}
+// in request order
+void KyntrixDaemonServer::start_many(std::vector<StartRequest> starts, Completion done,
+                                     std::chrono::steady_clock::time_point received) {
+    if (starts.empty()) {
+        done.response = json{{"ok", true}, {"results", json::array()}}.dump();
+        complete(std::move(done), "start_many", received);
+        return;
+    }
+
+    struct Batch {
+        std::mutex mutex;
+        std::vector<json> results;
+        size_t left;
+        Completion done;
+    };
+    auto batch = std::make_shared<Batch>();
+    batch->results.resize(starts.size());
+    batch->left = starts.size();
+    batch->done = std::move(done);
+
+    for (size_t i = 0; i < starts.size(); ++i) {
+        m_workers->submit([this, batch, i, received, req = std::move(starts[i])]() mutable {
+            json r;
+            r["run_id"] = req.run_id;
+            try {
+                handle_start(req, r);
+            } catch (const std::exception& ex) {
+                r["ok"] = false;
+                r["error"] = ex.what();
+            } catch (...) {
+                r["ok"] = false;
+                r["error"] = "internal error";
+            }
+
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            batch->results[i] = std::move(r);
+            if (--batch->left > 0) return;
+
+            bool all_ok = true;
+            json results = json::array();
+            for (auto& res : batch->results) {
+                all_ok = all_ok && res.value("ok", false);
+                results.push_back(std::move(res));
+            }
+            batch->done.response = json{{"ok", all_ok}, {"results", std::move(results)}}.dump();
+            complete(std::move(batch->done), "start_many", received);
+        });
+    }
+}
+
+Histogram* KyntrixDaemonServer::request_histogram(const std::string& action) const {
+    auto it = m_request_latency.find(action);
+    return it != m_request_latency.end() ? it->second : m_request_latency.at("other");
+}
+
+std::string KyntrixDaemonServer::handle_request(ControlRequest& req, bool& subscribe) {
+    json resp;
+
+    if (req.action == ControlAction::Start) {
+        handle_start(req.starts[0], resp);
+    } else if (req.action == ControlAction::Stop) {
+        CgroupUsage usage;
+        bool ok = InstanceManager::stop_instance(req.run_id, &usage);
+        resp["ok"] = ok;
+        if (ok) resp["usage"] = usage_json(usage);
+    } else if (req.action == ControlAction::Usage) {
+        CgroupUsage usage;
+        bool ok = InstanceManager::usage(req.run_id, usage);
         resp["ok"] = ok;
-    } else if (action == "stop") {
-        std::string run_id = req.value("run_id", "");
-        bool ok = InstanceManager::stop_instance(run_id);
+        if (ok) resp["usage"] = usage_json(usage);
+    } else if (req.action == ControlAction::Status) {
+        RunState state;
+        RunExit ex{};
+        bool ok = InstanceManager::status(req.run_id, state, ex);
         resp["ok"] = ok;
+        if (ok) {
+            resp["state"] = run_state_name(state);
+            if (state == RunState::Exited) {
+                resp["exit_code"] = ex.exit_code;
+                resp["signal"]    = ex.signal;
+                resp["wall_ms"]   = ex.wall_ms;
+                resp["timed_out"] = ex.timed_out;
+                resp["stopped"]   = ex.stopped;
+                resp["not_started"] = ex.not_started;
+                resp["usage"]     = usage_json(ex.usage);
+            }
+        }
+    } else if (req.action == ControlAction::Subscribe) {
+        // The connection stays open and receives {"event":"exit",...} lines
+        subscribe = true;
+        resp["ok"] = true;
+    } else if (req.action == ControlAction::ImportLayer) {
+        // { action, src_dir, digest } -- e.g. a finished dependency install
+        resp["ok"] = import_layer(req.src_dir, req.digest);
+    } else if (req.action == ControlAction::HasLayer) {
+        resp["ok"] = true;
+        resp["present"] = layer_exists(req.digest);
+    } else if (req.action == ControlAction::Stats) {
+        InstanceStats st = InstanceManager::stats();
+        auto latency = [](const LatencyWindow::Summary& l) {
+            return json{{"count", l.count}, {"p50_ms", l.p50}, {"p99_ms", l.p99}, {"max_ms", l.max}};
+        };
+
+        resp["ok"] = true;
+        resp["live_instances"] = st.live;
+        resp["exited"] = st.exited;
+        resp["timed_out"] = st.timed_out;
+        resp["pool"] = {
+            {"node",   {{"parked", st.parked_node},   {"target", st.pool_node_target}}},
+            {"python", {{"parked", st.parked_python}, {"target", st.pool_python_target}}},
+        };
+        resp["zygote"] = {
+            {"python", {{"ready", st.zygote_python}}},
+            {"restarts", st.zygote_restarts},
+        };
+        resp["netns"] = {
+            {"ready", {{"loopback", st.netns.ready_loopback}, {"egress", st.netns.ready_egress}}},
+            {"built", st.netns.built},
+            {"misses", st.netns.misses},
+            {"failures", st.netns.failures},
+        };
+        resp["start_latency"] = {
+            {"warm", latency(st.warm_start)},
+            {"cold", latency(st.cold_start)},
+            {"zygote", latency(st.zygote_start)},
+        };
+
+        json phases = json::object();
+        const char* paths[kStartPaths] = {"warm", "cold", "zygote"};
+        for (int w = 0; w < kStartPaths; ++w) {
+            for (size_t p = 0; p < kSpawnPhases; ++p) {
+                if (st.phases[w][p].count == 0) continue;
+                phases[paths[w]][spawn_phase_name((SpawnPhase)p)] = latency(st.phases[w][p]);
+            }
+        }
+        resp["spawn_phases"] = phases;
+        if (st.sched_enabled) {
+            json nodes = json::object();
+            for (auto& [node, runs] : st.sched.node_runs) {
+                nodes[std::to_string(node)] = runs;
+            }
+            resp["scheduler"] = {
+                {"slots", st.sched.slots},
+                {"capacity", st.sched.capacity},
+                {"running", st.sched.running},
+                {"queued", st.sched.queued},
+                {"rejected", st.sched.rejected},
+                {"node_runs", nodes},
+                {"queue_wait", latency(st.queue_wait)},
+            };
+        }
+        if (st.telemetry_enabled) {
+            resp["telemetry"] = {
+                {"channels", st.telemetry.channels},
+                {"frames", st.telemetry.frames},
+                {"events", st.telemetry.events},
+                {"rejected", st.telemetry.rejected},
+                {"dropped", st.telemetry.dropped},
+                {"forward_latency", latency(st.telemetry.forward)},
+            };
+        }
     } else {
         resp["ok"] = false;
         resp["error"] = "unknown action";
     }
 
-    auto s = resp.dump();
-    ::write(client_fd, s.data(), s.size());
+    return resp.dump();
 }
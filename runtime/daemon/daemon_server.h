@@ -1,18 +1,106 @@
 #pragma once
+#include "control_protocol.h"
+#include "daemon_config.h"
+#include "metrics.h"
+#include "worker_pool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
+// Single-threaded epoll loop over the control socket. Requests are parsed
+// incrementally per connection and executed on a worker pool. The first
+// byte a connection sends selects its framing:
+//  - newline-delimited JSON (a request terminated by EOF is also accepted),
+//    answered in order, one request at a time;
+//  - the framed protocol in control_protocol.h, whose requests are pipelined
+//    and answered by id as they complete.
+// A connection that sends {"action":"subscribe"} additionally receives one
+// line (or event frame) per exited run.
 class KyntrixDaemonServer {
     public:
-        explicit KyntrixDaemonServer(const std::string& socket_path);
+        explicit KyntrixDaemonServer(const DaemonConfig& cfg);
         ~KyntrixDaemonServer();
-        
+
+        // Serves until stop() is called
         void run();
+        // Thread-safe; run() returns after its current iteration
+        void stop();
 
 
     private:
+        enum class Wire { Unknown, Lines, Framed };
+
+        struct Request {
+            uint32_t id;               // framed requests only
+            std::string body;
+        };
+
+        struct Connection {
+            uint64_t id;
+            int fd;
+            Wire wire = Wire::Unknown;
+            std::string in;
+            size_t scan_pos = 0;
+            std::string out;
+            std::deque<Request> pending;
+            size_t in_flight = 0;      // requests on the worker pool
+            bool peer_closed = false;
+            bool subscribed = false;   // receives run exit events
+        };
+
+        struct Completion {
+            uint64_t conn_id;
+            uint32_t request_id;
+            std::string response;
+            bool subscribe;
+        };
+
+        DaemonConfig m_cfg;
         int m_socket_fd;
-        std::string m_socket_path;
+        int m_epoll_fd;
+        int m_wake_fd;
+        uint64_t m_next_conn_id;
+        std::atomic<bool> m_stopping{false};
+        std::unordered_map<uint64_t, std::unique_ptr<Connection>> m_conns;
+
+        std::mutex m_done_mutex;
+        std::vector<Completion> m_done;
+        std::vector<std::string> m_events;   // pushed to subscribers
+
+        std::unique_ptr<WorkerPool> m_workers;
+
+        // Request latency (queueing included) by action; fixed after
+        // construction, unknown actions count as "other"
+        std::unordered_map<std::string, Histogram*> m_request_latency;
+        Histogram* request_histogram(const std::string& action) const;
+
+        void accept_clients();
+        void on_readable(Connection& c);
+        void on_writable(Connection& c);
+        void drain_completions();
+        void publish_event(std::string event);
+
+        // False (with error set) if the connection must be dropped
+        bool extract_frames(Connection& c, std::string& error, uint32_t& error_id);
+        bool extract_lines(Connection& c, std::string& error);
+        bool extract_framed(Connection& c, std::string& error, uint32_t& error_id);
+        void reply_and_close(Connection& c, uint32_t request_id, const std::string& error);
+
+        void dispatch_next(Connection& c);
+        void complete(Completion done, const std::string& action,
+                      std::chrono::steady_clock::time_point received);
+        void start_many(std::vector<StartRequest> starts, Completion done,
+                        std::chrono::steady_clock::time_point received);
+        void update_interest(Connection& c);
+        void maybe_close(Connection& c);
+        void close_connection(uint64_t id);
 
-        void handle_client(int client_fd);
-           
-};
\ No newline at end of file
+        // Every action but start_many, which fans out over the worker pool
+        static std::string handle_request(ControlRequest& req, bool& subscribe);
+};
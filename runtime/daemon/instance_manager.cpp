@@ -1,17 +1,411 @@
 // runtime/daemon/instance_manager.cpp
 #include "instance_manager.h"
+#include "ct_exec.h"
+#include "ct_image.h"
 #include "ct_namespace.h"
+#include "ct_netns.h"
+#include "ct_pool.h"
+#include "ct_zygote.h"
+#include "ct_topology.h"
+#include "resource_policy.h"
+#include "worker_pool.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <errno.h>
 #include <signal.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <thread>
 
-std::unordered_map<std::string, pid_t>& InstanceManager::table() {
-    static std::unordered_map<std::string, pid_t> t;
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#ifndef SYS_pidfd_send_signal
+#define SYS_pidfd_send_signal 424
+#endif
+#ifndef P_PIDFD
+#define P_PIDFD ((idtype_t)3)
+#endif
+
+static constexpr size_t kRecentExits = 1024;
+// Threads starting runs the scheduler admits from its queue
+static constexpr size_t kLaunchThreads = 4;
+
+static std::unique_ptr<WarmPool> g_pool;
+static std::unique_ptr<Zygote> g_zygote;
+static std::unique_ptr<TelemetryCollector> g_telemetry;
+static std::unique_ptr<NetnsPool> g_netns;
+static NetPolicy g_net_default = NetPolicy::None;
+static LatencyWindow g_start_latency[kStartPaths];
+// Prometheus series, [0] warm, [1] cold and [2] zygote
+static const char* const kPathNames[kStartPaths] = {"warm", "cold", "zygote"};
+static Histogram* g_start_hist[kStartPaths];
+static Histogram* g_phase_hist[kStartPaths][kSpawnPhases];
+static ResourcePolicy g_policy;
+static bool g_cgroups = false;
+static long g_run_timeout_ms = 0;
+static long g_kill_grace_ms = 0;
+
+// Run scheduler, guarded by table_mutex(); null when disabled
+static std::unique_ptr<RunScheduler> g_sched;
+static std::unique_ptr<WorkerPool> g_launchers;
+static bool g_pin_affinity = false;   // no cpuset controller: sched_setaffinity
+static long g_queue_timeout_ms = 0;
+static LatencyWindow g_queue_wait;
+static Histogram* g_queue_wait_hist;
+
+// Lifecycle thread: one pidfd per running container plus a wakeup eventfd
+static int g_reap_epoll = -1;
+static int g_reap_wake = -1;
+static std::thread g_reaper;
+static std::atomic<bool> g_reaper_stop{false};
+
+// Guarded by table_mutex()
+struct Deadline {
+    std::chrono::steady_clock::time_point at;
+    std::string run_id;
+    bool operator>(const Deadline& o) const { return at > o.at; }
+};
+static std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> g_deadlines;
+static std::unordered_map<int, std::string> g_by_pidfd;
+static std::deque<RunExit> g_recent;
+static uint64_t g_exited = 0;
+static uint64_t g_timed_out = 0;
+static InstanceManager::ExitListener g_listener;
+
+const char* run_state_name(RunState state) {
+    switch (state) {
+        case RunState::Queued:   return "queued";
+        case RunState::Starting: return "starting";
+        case RunState::Running:  return "running";
+        case RunState::Stopping: return "stopping";
+        case RunState::Exited:   return "exited";
+    }
+    return "unknown";
+}
+
+static LatencyWindow::Summary summarize(const Histogram& h) {
+    Histogram::Snapshot snap = h.snapshot();
+    return LatencyWindow::Summary{
+        (size_t)snap.count,
+        (double)snap.quantile_ns(0.50) / 1e6,
+        (double)snap.quantile_ns(0.99) / 1e6,
+        (double)snap.max_ns / 1e6,
+    };
+}
+
+static void register_metrics() {
+    MetricsRegistry& reg = MetricsRegistry::global();
+
+    for (int w = 0; w < kStartPaths; ++w) {
+        g_start_hist[w] = &reg.histogram("kyntrixd_start_duration_seconds",
+            "Time to start a run, from request to entry point exec", {{"path", kPathNames[w]}});
+        for (size_t p = 0; p < kSpawnPhases; ++p) {
+            g_phase_hist[w][p] = &reg.histogram("kyntrixd_spawn_phase_duration_seconds",
+                "Time spent in each container start-up phase",
+                {{"path", kPathNames[w]}, {"phase", spawn_phase_name((SpawnPhase)p)}});
+        }
+    }
+
+    if (g_sched) {
+        g_queue_wait_hist = &reg.histogram("kyntrixd_sched_queue_wait_seconds",
+            "Time a run waited for the scheduler to admit it");
+    }
+
+    reg.add_collector([](MetricsText& out) {
+        InstanceStats st = InstanceManager::stats();
+        out.gauge("kyntrixd_instances", "Runs queued, starting, running or stopping", (double)st.live);
+        const char* parked = "Parked warm containers";
+        out.gauge("kyntrixd_pool_parked", parked, (double)st.parked_node, {{"template", "node"}});
+        out.gauge("kyntrixd_pool_parked", parked, (double)st.parked_python, {{"template", "python"}});
+        const char* target = "Configured warm pool size";
+        out.gauge("kyntrixd_pool_target", target, (double)st.pool_node_target, {{"template", "node"}});
+        out.gauge("kyntrixd_pool_target", target, (double)st.pool_python_target, {{"template", "python"}});
+        out.gauge("kyntrixd_zygote_ready", "Zygote up and serving forks",
+                  st.zygote_python ? 1.0 : 0.0, {{"template", "python"}});
+        out.counter("kyntrixd_zygote_restarts_total", "Zygotes restarted after exiting",
+                    (double)st.zygote_restarts);
+        out.counter("kyntrixd_runs_exited_total", "Runs reaped since startup", (double)st.exited);
+        out.counter("kyntrixd_runs_timed_out_total", "Runs ended by their timeout", (double)st.timed_out);
+
+        if (st.sched_enabled) {
+            out.gauge("kyntrixd_sched_capacity", "Runs the scheduler admits at once",
+                      (double)st.sched.capacity);
+            out.gauge("kyntrixd_sched_running", "Runs holding a scheduler slot",
+                      (double)st.sched.running);
+            out.gauge("kyntrixd_sched_queued", "Runs waiting for a scheduler slot",
+                      (double)st.sched.queued);
+            out.counter("kyntrixd_sched_rejected_total", "Starts refused with the queue full",
+                        (double)st.sched.rejected);
+            for (auto& [node, runs] : st.sched.node_runs) {
+                out.gauge("kyntrixd_sched_node_runs", "Runs placed on each NUMA node",
+                          (double)runs, {{"node", std::to_string(node)}});
+            }
+        }
+
+        const char* ready = "Network namespaces built and waiting for a run";
+        out.gauge("kyntrixd_netns_ready", ready, (double)st.netns.ready_loopback, {{"policy", "loopback"}});
+        out.gauge("kyntrixd_netns_ready", ready, (double)st.netns.ready_egress, {{"policy", "egress"}});
+        out.counter("kyntrixd_netns_built_total", "Network namespaces built", (double)st.netns.built);
+        out.counter("kyntrixd_netns_misses_total", "Claims that built a namespace on the start path",
+                    (double)st.netns.misses);
+        out.counter("kyntrixd_netns_failures_total", "Network namespaces that could not be set up",
+                    (double)st.netns.failures);
+
+        if (st.telemetry_enabled) {
+            out.gauge("kyntrixd_telemetry_channels", "Open telemetry channels",
+                      (double)st.telemetry.channels);
+            out.counter("kyntrixd_telemetry_frames_total", "Frames read from containers",
+                        (double)st.telemetry.frames);
+            out.counter("kyntrixd_telemetry_events_total", "Events forwarded to ingestion",
+                        (double)st.telemetry.events);
+            out.counter("kyntrixd_telemetry_rejected_total", "Malformed or oversized messages",
+                        (double)st.telemetry.rejected);
+            out.counter("kyntrixd_telemetry_dropped_total", "Events lost to failed POSTs",
+                        (double)st.telemetry.dropped);
+        }
+    });
+}
+
+static void wake_reaper() {
+    uint64_t one = 1;
+    (void)!::write(g_reap_wake, &one, sizeof(one));
+}
+
+std::unordered_map<std::string, InstanceManager::Instance>& InstanceManager::table() {
+    static std::unordered_map<std::string, Instance> t;
     return t;
 }
 
-bool InstanceManager::start_instance(const std::string& run_id, const std::string& tmpl, 
-           const std::string& workspace_path, const std::string& entry_script) {
-    
+std::unordered_map<std::string, InstanceManager::PendingStart>& InstanceManager::queued_starts() {
+    static std::unordered_map<std::string, PendingStart> q;
+    return q;
+}
+
+std::vector<std::string>& InstanceManager::retired() {
+    static std::vector<std::string> r;
+    return r;
+}
+
+// Caller holds table_mutex()
+void InstanceManager::reap_retired() {
+    auto& r = retired();
+    for (size_t i = 0; i < r.size();) {
+        if (cgroup_remove(r[i])) {
+            r[i] = r.back();
+            r.pop_back();
+        } else {
+            ++i;
+        }
+    }
+}
+
+std::mutex& InstanceManager::table_mutex() {
+    static std::mutex m;
+    return m;
+}
+
+void InstanceManager::init(const DaemonConfig& cfg) {
+    ImageStoreConfig ic;
+    ic.root       = cfg.image_root;
+    ic.tmpfs_size = cfg.rootfs_tmpfs_size;
+    configure_image_store(ic);
+
+    if (!cfg.limits_file.empty()) {
+        g_policy = ResourcePolicy::load(cfg.limits_file);
+    }
+    g_cgroups = cgroup_init(cfg.cgroup_root);
+
+    if (cfg.sched_enabled) {
+        std::vector<int> allowed;
+        if (!cfg.sched_cpus.empty() && !parse_cpu_list(cfg.sched_cpus, allowed)) {
+            throw std::runtime_error("scheduler: invalid cpu list " + cfg.sched_cpus);
+        }
+        SchedulerConfig sc;
+        sc.cpus_per_run  = cfg.sched_cpus_per_run;
+        sc.runs_per_slot = cfg.sched_runs_per_slot;
+        sc.queue_max     = cfg.sched_queue_max;
+        g_sched = std::make_unique<RunScheduler>(sc, topology_read(allowed));
+        g_pin_affinity = !g_cgroups || !cgroup_controller_enabled("cpuset");
+        g_queue_timeout_ms = cfg.sched_queue_timeout_ms;
+        g_launchers = std::make_unique<WorkerPool>(kLaunchThreads);
+    }
+
+    if (!parse_net_policy(cfg.net_policy, g_net_default)) {
+        throw std::runtime_error("network: invalid policy " + cfg.net_policy);
+    }
+    NetnsPoolConfig nc;
+    nc.loopback_size  = cfg.net_pool_loopback;
+    nc.egress_size    = cfg.net_pool_egress;
+    nc.refill_per_sec = cfg.net_pool_refill_per_sec;
+    nc.bridge         = cfg.net_bridge;
+    nc.subnet         = cfg.net_subnet;
+    for (size_t pos = 0; pos < cfg.net_egress_allow.size();) {
+        size_t comma = cfg.net_egress_allow.find(',', pos);
+        if (comma == std::string::npos) comma = cfg.net_egress_allow.size();
+        if (comma > pos) nc.egress_allow.push_back(cfg.net_egress_allow.substr(pos, comma - pos));
+        pos = comma + 1;
+    }
+    g_netns = std::make_unique<NetnsPool>(nc);
+
+    // Parked containers and zygotes are built with the exec environment, so
+    // this comes before either
+    if (!cfg.telemetry_url.empty()) {
+        g_telemetry = std::make_unique<TelemetryCollector>(cfg.telemetry_url, cfg.telemetry_flush_ms);
+    }
+    ExecConfig ec;
+    ec.telemetry_channel = g_telemetry != nullptr;
+    ec.node_otel_hook    = cfg.node_otel_hook;
+    configure_exec(ec);
+
+    g_run_timeout_ms = cfg.run_timeout_ms;
+    g_kill_grace_ms  = cfg.kill_grace_ms;
+
+    register_metrics();
+
+    g_reap_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    g_reap_wake  = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_reap_epoll < 0 || g_reap_wake < 0) {
+        throw std::runtime_error("lifecycle: epoll/eventfd setup failed");
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = g_reap_wake;
+    if (::epoll_ctl(g_reap_epoll, EPOLL_CTL_ADD, g_reap_wake, &ev) < 0) {
+        throw std::runtime_error("lifecycle: epoll_ctl(eventfd) failed");
+    }
+    g_reaper = std::thread(&InstanceManager::reaper_main);
+
+    ZygoteConfig zc;
+    zc.python  = cfg.zygote_python;
+    zc.preload = cfg.zygote_preload;
+    g_zygote = std::make_unique<Zygote>(zc);
+
+    WarmPoolConfig pc;
+    pc.node_size      = cfg.pool_node_size;
+    pc.python_size    = cfg.pool_python_size;
+    pc.refill_per_sec = cfg.pool_refill_per_sec;
+    g_pool = std::make_unique<WarmPool>(pc);
+}
+
+void InstanceManager::shutdown() {
+    MetricsRegistry::global().clear_collectors();
+    g_launchers.reset();
+    g_pool.reset();
+    g_zygote.reset();
+    g_telemetry.reset();
+
+    if (g_reaper.joinable()) {
+        g_reaper_stop = true;
+        wake_reaper();
+        g_reaper.join();
+    }
+    if (g_reap_wake >= 0) ::close(g_reap_wake);
+    if (g_reap_epoll >= 0) ::close(g_reap_epoll);
+    g_reap_wake = g_reap_epoll = -1;
+
+    // After the reaper, which returns the addresses of exiting runs
+    g_netns.reset();
+}
+
+void InstanceManager::set_exit_listener(ExitListener listener) {
+    std::lock_guard<std::mutex> lock(table_mutex());
+    g_listener = std::move(listener);
+}
+
+// Caller holds table_mutex()
+void InstanceManager::schedule(const std::string& run_id, Instance& inst, Clock::time_point at) {
+    inst.deadline = at;
+    if (at == Clock::time_point::max()) return;
+
+    bool earliest = g_deadlines.empty() || at < g_deadlines.top().at;
+    g_deadlines.push({at, run_id});
+    if (earliest) wake_reaper();
+}
+
+// Caller holds table_mutex(). First call sends SIGTERM to every process of
+// the run; once the grace period has passed, SIGKILL to the container init
+// tears down its whole PID namespace.
+void InstanceManager::terminate(const std::string& run_id, Instance& inst) {
+    if (inst.state == RunState::Running) {
+        inst.state = RunState::Stopping;
+
+        // The init of a PID namespace only sees signals it has a handler for,
+        // so its children are signalled directly through the cgroup
+        if (inst.cgroup_path.empty() || !cgroup_signal(inst.cgroup_path, SIGTERM)) {
+            ::syscall(SYS_pidfd_send_signal, inst.pidfd, SIGTERM, nullptr, 0);
+        }
+        schedule(run_id, inst, Clock::now() + std::chrono::milliseconds(g_kill_grace_ms));
+    } else if (inst.state == RunState::Stopping) {
+        ::syscall(SYS_pidfd_send_signal, inst.pidfd, SIGKILL, nullptr, 0);
+        if (!inst.cgroup_path.empty()) cgroup_kill(inst.cgroup_path);
+        schedule(run_id, inst, Clock::time_point::max());
+    }
+}
+
+bool InstanceManager::start_instance(const std::string& tmpl, RunSpec run,
+                                     const std::string& tier, long timeout_ms, bool* queued,
+                                     std::string* error) {
+    auto fail = [error](std::string why) {
+        if (error) *error = std::move(why);
+        return false;
+    };
+
+    Placement placement;
+    {
+        // Reserve the id so concurrent starts of the same run cannot race
+        std::lock_guard<std::mutex> lock(table_mutex());
+        auto [it, inserted] = table().try_emplace(run.run_id);
+        if (!inserted) return fail("run " + run.run_id + " already exists");
+        it->second.started = Clock::now();
+        reap_retired();
+
+        if (g_sched) {
+            switch (g_sched->admit(run.run_id, g_policy.priority(tier), placement)) {
+                case RunScheduler::Admission::Placed:
+                    break;
+                case RunScheduler::Admission::Rejected:
+                    std::cerr << "start_instance: scheduler queue full, refusing " << run.run_id << "\n";
+                    table().erase(it);
+                    return fail("scheduler queue full");
+                case RunScheduler::Admission::Queued: {
+                    Instance& inst = it->second;
+                    inst.state = RunState::Queued;
+                    if (g_queue_timeout_ms > 0) {
+                        schedule(run.run_id, inst,
+                                 inst.started + std::chrono::milliseconds(g_queue_timeout_ms));
+                    }
+                    std::string run_id = run.run_id;
+                    queued_starts()[run_id] = PendingStart{tmpl, std::move(run), tier, timeout_ms,
+                                                           inst.started};
+                    if (queued) *queued = true;
+                    return true;
+                }
+            }
+        }
+    }
+
+    return launch(tmpl, std::move(run), tier, timeout_ms, placement, error);
+}
+
+// The run's id is reserved; starts its container on placement's CPUs, or
+// anywhere if the scheduler is disabled
+bool InstanceManager::launch(const std::string& tmpl, RunSpec run, const std::string& tier,
+                             long timeout_ms, const Placement& placement, std::string* error) {
+    auto fail = [error](std::string why) {
+        if (error) *error = std::move(why);
+        return false;
+    };
+
     ContainerTemplate ct;
     if (tmpl == "node") {
         ct = ContainerTemplate::Node;
@@ -19,19 +413,438 @@ bool InstanceManager::start_instance(const std::string& run_id, const std::strin
         ct = ContainerTemplate::Python;
     }
 
-    pid_t pid = spawn_container(ct, run_id, workspace_path, entry_script);
-    if (pid <= 0) return false;
+    auto t0 = Clock::now();
+    auto release = [&run] {
+        std::vector<std::pair<std::string, Placement>> placed;
+        {
+            std::lock_guard<std::mutex> lock(table_mutex());
+            table().erase(run.run_id);
+            if (g_sched) g_sched->release(run.run_id, placed);
+        }
+        dispatch(std::move(placed));
+    };
+
+    if (g_cgroups) {
+        CgroupLimits limits = g_policy.resolve(tmpl, tier);
+        if (placement.slot >= 0) {
+            limits.cpuset_cpus = format_cpu_list(placement.cpus);
+            limits.cpuset_mems = std::to_string(placement.node);
+        }
+        try {
+            run.cgroup_path = cgroup_create(run.run_id, limits);
+        } catch (const std::exception& ex) {
+            std::cerr << "start_instance: " << ex.what() << "\n";
+            release();
+            return fail(ex.what());
+        }
+    }
+
+    // A namespace the pool had ready costs a pop; one it has to build here
+    // shows in the Network phase
+    NetLease lease;
+    uint64_t net_ns = 0;
+    NetPolicy net = g_policy.network(tmpl, tier, g_net_default);
+    if (net != NetPolicy::None) {
+        uint64_t since = monotonic_ns();
+        if (!g_netns->claim(net, lease)) {
+            std::cerr << "start_instance: no " << net_policy_name(net)
+                      << " network namespace for " << run.run_id << "\n";
+            if (!run.cgroup_path.empty()) cgroup_remove(run.cgroup_path);
+            release();
+            return fail(std::string("no ") + net_policy_name(net) + " network namespace available");
+        }
+        run.netns_fd = lease.fd;
+        net_ns = monotonic_ns() - since;
+    }
+
+    // The container takes its own copy of the channel's container end and of
+    // the namespace; the daemon's copies are closed either way once it has
+    // been spawned or claimed
+    if (g_telemetry) {
+        run.telemetry_fd = g_telemetry->open_channel(run.run_id);
+    }
+    auto close_fds = [&run] {
+        if (run.telemetry_fd >= 0) ::close(run.telemetry_fd);
+        if (run.netns_fd >= 0) ::close(run.netns_fd);
+        run.telemetry_fd = run.netns_fd = -1;
+    };
+
+    // Without a cpuset cgroup every path pins the container before it runs
+    // anything of the run's
+    if (g_pin_affinity && placement.slot >= 0) {
+        run.cpus = placement.cpus;
+    }
+
+    // Zygotes and parked containers carry only the template image; runs that
+    // need a dependency layer take the cold path
+    pid_t pid = -1;
+    int path = 2;
+    SpawnTimings timings{};
+    try {
+        pid = (g_zygote && run.deps_key.empty()) ? g_zygote->spawn(ct, run, &timings) : -1;
+        if (pid <= 0) {
+            path = 0;
+            timings = SpawnTimings{};
+            pid = (g_pool && run.deps_key.empty()) ? g_pool->claim(ct, run, &timings) : -1;
+        }
+        if (pid <= 0) {
+            path = 1;
+            timings = SpawnTimings{};
+            pid = spawn_container(ct, run, &timings);
+        }
+    } catch (...) {
+        close_fds();
+        g_netns->release(lease.addr);
+        if (!run.cgroup_path.empty()) cgroup_remove(run.cgroup_path);
+        release();
+        throw;
+    }
+    close_fds();
+    timings.ns[(size_t)SpawnPhase::Network] = net_ns;
+
+    // A zombie still has a pidfd, so an init that already exited is reaped
+    // normally
+    int pidfd = pid > 0 ? (int)::syscall(SYS_pidfd_open, pid, 0) : -1;
+    if (pid > 0 && pidfd < 0) {
+        std::cerr << "start_instance: pidfd_open failed: " << strerror(errno) << "\n";
+        ::kill(pid, SIGKILL);
+        ::waitpid(pid, nullptr, 0);
+    }
+    if (pidfd < 0) {
+        g_netns->release(lease.addr);
+        if (!run.cgroup_path.empty()) cgroup_remove(run.cgroup_path);
+        release();
+        return fail(pid > 0 ? "pidfd_open failed" : "container spawn failed");
+    }
+
+    // Fallback for a spawn path that could not pin it
+    if (!run.cpus.empty() && !process_pinned(pid, run.cpus) && !pin_process(pid, run.cpus)) {
+        std::cerr << "start_instance: pinning " << run.run_id << " to its cpus failed\n";
+    }
+
+    auto elapsed = Clock::now() - t0;
+    g_start_latency[path].record(std::chrono::duration<double, std::milli>(elapsed).count());
+    g_start_hist[path]->record(elapsed);
+    for (size_t p = 0; p < kSpawnPhases; ++p) {
+        if (timings.ns[p]) g_phase_hist[path][p]->record_ns(timings.ns[p]);
+    }
+
+    if (timeout_ms < 0) timeout_ms = g_run_timeout_ms;
+
+    std::lock_guard<std::mutex> lock(table_mutex());
+    Instance& inst = table()[run.run_id];
+    inst.state = RunState::Running;
+    inst.pid = pid;
+    inst.pidfd = pidfd;
+    inst.cgroup_path = run.cgroup_path;
+    inst.net_addr = lease.addr;
+
+    g_by_pidfd[pidfd] = run.run_id;
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = pidfd;
+    ::epoll_ctl(g_reap_epoll, EPOLL_CTL_ADD, pidfd, &ev);
+
+    if (inst.stop_requested) {
+        terminate(run.run_id, inst);
+    } else if (timeout_ms > 0) {
+        schedule(run.run_id, inst, t0 + std::chrono::milliseconds(timeout_ms));
+    }
+    return true;
+}
+
+// Hands runs the scheduler admitted from its queue to the launch threads
+void InstanceManager::dispatch(std::vector<std::pair<std::string, Placement>> placed) {
+    for (auto& [run_id, placement] : placed) {
+        PendingStart start;
+        {
+            std::lock_guard<std::mutex> lock(table_mutex());
+            auto q = queued_starts().find(run_id);
+            auto it = table().find(run_id);
+            if (q == queued_starts().end() || it == table().end()) continue;
+
+            start = std::move(q->second);
+            queued_starts().erase(q);
+
+            Instance& inst = it->second;
+            inst.state = RunState::Starting;
+            inst.started = Clock::now();
+            schedule(run_id, inst, Clock::time_point::max());   // queue timeout
+        }
 
-    table()[run_id] = pid;
+        auto wait = Clock::now() - start.queued;
+        g_queue_wait.record(std::chrono::duration<double, std::milli>(wait).count());
+        g_queue_wait_hist->record(wait);
+
+        g_launchers->submit([run_id = run_id, placement = std::move(placement),
+                             start = std::move(start)]() mutable {
+            bool ok = false;
+            try {
+                ok = launch(start.tmpl, std::move(start.run), start.tier, start.timeout_ms, placement);
+            } catch (const std::exception& ex) {
+                std::cerr << "start_instance: " << ex.what() << "\n";
+            }
+            if (ok) return;
+
+            // The client was told the run is queued; it learns the outcome
+            // from the exit event
+            RunExit ex{};
+            ex.run_id = run_id;
+            ex.exit_code = -1;
+            ex.not_started = true;
+            publish_exit(ex);
+        });
+    }
+}
+
+// Caller holds table_mutex() and publishes the returned exit once unlocked.
+// Drops a queued run.
+RunExit InstanceManager::dequeue(const std::string& run_id, Instance& inst) {
+    RunExit ex{};
+    ex.run_id = run_id;
+    ex.exit_code = -1;
+    ex.wall_ms = std::chrono::duration<double, std::milli>(Clock::now() - inst.started).count();
+    ex.timed_out = inst.timed_out;
+    ex.stopped = inst.stop_requested;
+    ex.not_started = true;
+
+    std::vector<std::pair<std::string, Placement>> none;
+    g_sched->release(run_id, none);
+    queued_starts().erase(run_id);
+    table().erase(run_id);
+    return ex;
+}
+
+// Counts ex, keeps it for status() and hands it to the exit listener
+void InstanceManager::publish_exit(const RunExit& ex) {
+    ExitListener listener;
+    {
+        std::lock_guard<std::mutex> lock(table_mutex());
+        ++g_exited;
+        if (ex.timed_out) ++g_timed_out;
+
+        g_recent.push_back(ex);
+        if (g_recent.size() > kRecentExits) g_recent.pop_front();
+        listener = g_listener;
+    }
+
+    if (listener) listener(ex);
+}
+
+bool InstanceManager::stop_instance(const std::string& run_id, CgroupUsage* usage) {
+    std::string cgroup_path;
+    RunExit dropped{};
+    {
+        std::lock_guard<std::mutex> lock(table_mutex());
+        auto& t = table();
+        auto it = t.find(run_id);
+        if (it == t.end()) return false;
+
+        Instance& inst = it->second;
+        inst.stop_requested = true;
+        if (inst.state == RunState::Queued) {
+            dropped = dequeue(run_id, inst);
+        } else {
+            if (inst.state == RunState::Running) {
+                terminate(run_id, inst);
+            }
+            cgroup_path = inst.cgroup_path;
+        }
+    }
+
+    if (dropped.not_started) {
+        publish_exit(dropped);
+    }
+
+    if (usage) {
+        *usage = cgroup_path.empty() ? CgroupUsage{} : cgroup_read_usage(cgroup_path);
+    }
     return true;
 }
 
-bool InstanceManager::stop_instance(const std::string& run_id) {
-    auto& t = table();
-    auto it = t.find(run_id);
-    if (it == t.end()) return false;
+bool InstanceManager::usage(const std::string& run_id, CgroupUsage& out) {
+    std::string cgroup_path;
+    {
+        std::lock_guard<std::mutex> lock(table_mutex());
+        auto it = table().find(run_id);
+        if (it == table().end() || it->second.cgroup_path.empty()) return false;
+        cgroup_path = it->second.cgroup_path;
+    }
 
-    ::kill(it->second, SIGTERM);
-    t.erase(it);
+    out = cgroup_read_usage(cgroup_path);
     return true;
 }
+
+bool InstanceManager::status(const std::string& run_id, RunState& state, RunExit& exit) {
+    std::lock_guard<std::mutex> lock(table_mutex());
+    auto it = table().find(run_id);
+    if (it != table().end()) {
+        state = it->second.state;
+        return true;
+    }
+
+    for (auto r = g_recent.rbegin(); r != g_recent.rend(); ++r) {
+        if (r->run_id == run_id) {
+            state = RunState::Exited;
+            exit = *r;
+            return true;
+        }
+    }
+    return false;
+}
+
+void InstanceManager::reaper_main() {
+    epoll_event events[64];
+
+    while (!g_reaper_stop) {
+        int timeout = -1;
+        std::vector<RunExit> expired;
+        {
+            std::lock_guard<std::mutex> lock(table_mutex());
+            auto now = Clock::now();
+
+            while (!g_deadlines.empty()) {
+                Deadline d = g_deadlines.top();
+                auto it = table().find(d.run_id);
+
+                // Stale: the run exited or was rescheduled
+                if (it == table().end() || it->second.deadline != d.at) {
+                    g_deadlines.pop();
+                    continue;
+                }
+                if (d.at > now) {
+                    auto wait = std::chrono::ceil<std::chrono::milliseconds>(d.at - now);
+                    timeout = (int)std::min<long long>(wait.count(), 60000);
+                    break;
+                }
+
+                g_deadlines.pop();
+                Instance& inst = it->second;
+                if (inst.state == RunState::Queued) {
+                    inst.timed_out = true;
+                    expired.push_back(dequeue(d.run_id, inst));
+                    continue;
+                }
+                if (inst.state == RunState::Running) {
+                    inst.timed_out = true;
+                }
+                terminate(d.run_id, inst);
+            }
+        }
+        for (const RunExit& ex : expired) {
+            publish_exit(ex);
+        }
+
+        int n = ::epoll_wait(g_reap_epoll, events, 64, timeout);
+        if (n < 0 && errno != EINTR) {
+            std::cerr << "lifecycle: epoll_wait failed: " << strerror(errno) << "\n";
+            return;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.fd == g_reap_wake) {
+                uint64_t counter;
+                while (::read(g_reap_wake, &counter, sizeof(counter)) > 0) {}
+                continue;
+            }
+            on_child_exit(events[i].data.fd);
+        }
+    }
+}
+
+void InstanceManager::on_child_exit(int pidfd) {
+    siginfo_t info{};
+    if (::waitid(P_PIDFD, (id_t)pidfd, &info, WEXITED | WNOHANG) < 0 || info.si_pid == 0) {
+        return;
+    }
+
+    Instance inst;
+    RunExit ex{};
+    std::vector<std::pair<std::string, Placement>> placed;
+    {
+        std::lock_guard<std::mutex> lock(table_mutex());
+        auto by = g_by_pidfd.find(pidfd);
+        if (by == g_by_pidfd.end()) return;
+
+        ex.run_id = std::move(by->second);
+        g_by_pidfd.erase(by);
+
+        auto it = table().find(ex.run_id);
+        if (it != table().end()) {
+            inst = std::move(it->second);
+            table().erase(it);
+        }
+        if (g_sched) g_sched->release(ex.run_id, placed);
+    }
+    dispatch(std::move(placed));
+
+    ::epoll_ctl(g_reap_epoll, EPOLL_CTL_DEL, pidfd, nullptr);
+    ::close(pidfd);
+    g_netns->release(inst.net_addr);
+
+    if (info.si_code == CLD_EXITED) {
+        ex.exit_code = info.si_status;
+        ex.signal = 0;
+    } else {
+        ex.exit_code = -1;
+        ex.signal = info.si_status;
+    }
+    ex.wall_ms = std::chrono::duration<double, std::milli>(Clock::now() - inst.started).count();
+    ex.timed_out = inst.timed_out;
+    ex.stopped = inst.stop_requested && !inst.timed_out;
+
+    // Accounting survives the processes; read it before removing the cgroup
+    bool busy = false;
+    if (!inst.cgroup_path.empty()) {
+        ex.usage = cgroup_read_usage(inst.cgroup_path);
+        busy = !cgroup_remove(inst.cgroup_path);
+    }
+
+    if (busy) {
+        // Processes of the torn-down namespace may still be exiting
+        std::lock_guard<std::mutex> lock(table_mutex());
+        retired().push_back(inst.cgroup_path);
+    }
+
+    publish_exit(ex);
+}
+
+InstanceStats InstanceManager::stats() {
+    InstanceStats s{};
+    {
+        std::lock_guard<std::mutex> lock(table_mutex());
+        s.live = table().size();
+        s.exited = g_exited;
+        s.timed_out = g_timed_out;
+        s.sched_enabled = g_sched != nullptr;
+        if (g_sched) s.sched = g_sched->stats();
+    }
+    s.queue_wait = g_queue_wait.summary();
+    if (g_pool) {
+        s.parked_node        = g_pool->parked(ContainerTemplate::Node);
+        s.parked_python      = g_pool->parked(ContainerTemplate::Python);
+        s.pool_node_target   = g_pool->target(ContainerTemplate::Node);
+        s.pool_python_target = g_pool->target(ContainerTemplate::Python);
+    }
+    if (g_zygote) {
+        s.zygote_python   = g_zygote->ready(ContainerTemplate::Python);
+        s.zygote_restarts = g_zygote->restarts();
+    }
+    s.warm_start   = g_start_latency[0].summary();
+    s.cold_start   = g_start_latency[1].summary();
+    s.zygote_start = g_start_latency[2].summary();
+    for (int w = 0; w < kStartPaths; ++w) {
+        if (!g_phase_hist[w][0]) break;   // before init()
+        for (size_t p = 0; p < kSpawnPhases; ++p) {
+            s.phases[w][p] = summarize(*g_phase_hist[w][p]);
+        }
+    }
+    if (g_netns) {
+        s.netns = g_netns->stats();
+    }
+    s.telemetry_enabled = g_telemetry != nullptr;
+    if (g_telemetry) {
+        s.telemetry = g_telemetry->stats();
+    }
+    return s;
+}
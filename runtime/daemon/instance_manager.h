@@ -1,16 +1,158 @@
 #pragma once
+#include "daemon_config.h"
+#include "latency_window.h"
+#include "metrics.h"
+#include "run_scheduler.h"
+#include "telemetry_collector.h"
+#include "ct_cgroup.h"
+#include "ct_namespace.h"
+#include "ct_netns.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
+// How a run was started: warm pool, cold spawn or zygote fork
+inline constexpr int kStartPaths = 3;
+
+struct InstanceStats {
+    size_t live;
+    size_t parked_node;
+    size_t parked_python;
+    size_t pool_node_target;
+    size_t pool_python_target;
+    uint64_t exited;                      // runs reaped since startup
+    uint64_t timed_out;                   // ... of which hit their timeout
+    bool zygote_python;                   // Python zygote up and serving
+    uint64_t zygote_restarts;
+    LatencyWindow::Summary warm_start;   // claimed from the warm pool
+    LatencyWindow::Summary cold_start;   // full spawn_container()
+    LatencyWindow::Summary zygote_start; // forked from a zygote (ct_zygote.h)
+    // Start latency by phase (ct_timing.h), [0] warm, [1] cold and [2]
+    // zygote; phases a path does not run have count 0
+    LatencyWindow::Summary phases[kStartPaths][kSpawnPhases];
+    bool telemetry_enabled;
+    TelemetryStats telemetry;            // zeroed when disabled
+    bool sched_enabled;
+    SchedulerStats sched;                // zeroed when disabled
+    LatencyWindow::Summary queue_wait;   // scheduler queue, for runs that waited
+    NetnsStats netns;                    // pooled network namespaces (ct_netns.h)
+};
+
+// Run lifecycle: (Queued) -> Starting -> Running -> (Stopping) -> Exited
+enum class RunState {
+    Queued,     // waiting for the scheduler to admit it
+    Starting,   // id reserved, container being spawned or claimed
+    Running,
+    Stopping,   // SIGTERM sent, SIGKILL follows after the grace period
+    Exited
+};
+
+const char* run_state_name(RunState state);
+
+// How a run ended, reported once its container init has been reaped.
+struct RunExit {
+    std::string run_id;
+    int exit_code;        // -1 if killed by a signal
+    int signal;           // 0 if the init exited normally
+    double wall_ms;
+    bool timed_out;       // ended by its run timeout
+    bool stopped;         // ended by a stop request
+    bool not_started;     // left the scheduler queue, or failed to start from it
+    CgroupUsage usage;    // zeroed when running without cgroups
+};
+
+// Safe to call from any worker thread; the instance table is guarded by
+// a single mutex that is never held across a container spawn. Exited
+// containers are reaped asynchronously by a lifecycle thread that waits on
+// a pidfd per run and enforces run timeouts.
 class InstanceManager {
 public:
-    static bool start_instance(const std::string& run_id,
-                               const std::string& tmpl,
-                               const std::string& workspace_path,
-                               const std::string& entry_script);
+    using ExitListener = std::function<void(const RunExit&)>;
+
+    // Must be called once before serving requests; configures the image
+    // store, the cgroup hierarchy and the run scheduler, starts the telemetry
+    // collector, the network namespace pool, the zygotes, the warm pool and
+    // the reaper, and registers the instance metrics. Throws if the limits
+    // file, the telemetry url, the scheduler's cpu list or the network
+    // settings are invalid.
+    static void init(const DaemonConfig& cfg);
+    static void shutdown();
+
+    // Called on the lifecycle thread for every reaped run. Must not block.
+    static void set_exit_listener(ExitListener listener);
+
+    // tier selects the resource limits, queue priority and network policy
+    // (see resource_policy.h); run.cgroup_path is filled in here when cgroups
+    // are available. timeout_ms < 0 uses the configured default, 0 disables
+    // the timeout. With the scheduler enabled a run over capacity is queued and
+    // true returned with *queued set; it starts later, and its exit event
+    // reports not_started if it never does. On false, error (if given)
+    // receives the reason; no exit event follows.
+    static bool start_instance(const std::string& tmpl, RunSpec run,
+                               const std::string& tier = "",
+                               long timeout_ms = -1,
+                               bool* queued = nullptr,
+                               std::string* error = nullptr);
 
-    static bool stop_instance(const std::string& run_id);
+    // Asks the run to terminate; it stays listed as Stopping until reaped.
+    // usage, if given, receives the run's resource accounting at stop time
+    static bool stop_instance(const std::string& run_id, CgroupUsage* usage = nullptr);
+
+    // Live accounting for a running instance; false if unknown or unaccounted
+    static bool usage(const std::string& run_id, CgroupUsage& out);
+
+    // Current state, and the exit record for recently exited runs
+    static bool status(const std::string& run_id, RunState& state, RunExit& exit);
+
+    static InstanceStats stats();
 
 private:
-    static std::unordered_map<std::string, pid_t>& table();
+    using Clock = std::chrono::steady_clock;
+
+    struct Instance {
+        RunState state = RunState::Starting;
+        pid_t pid = -1;
+        int pidfd = -1;
+        std::string cgroup_path;          // empty when running without cgroups
+        uint32_t net_addr = 0;            // of its Egress namespace (ct_netns.h)
+        Clock::time_point started;
+        Clock::time_point deadline = Clock::time_point::max();
+        bool timed_out = false;
+        bool stop_requested = false;
+    };
+
+    static std::unordered_map<std::string, Instance>& table();
+    static std::mutex& table_mutex();
+
+    // cgroups of exited runs whose processes had not all gone yet
+    static std::vector<std::string>& retired();
+    static void reap_retired();
+
+    // Admitted or queued runs that still need a container
+    struct PendingStart {
+        std::string tmpl;
+        RunSpec run;
+        std::string tier;
+        long timeout_ms;
+        Clock::time_point queued;
+    };
+
+    // Queued runs, guarded by table_mutex()
+    static std::unordered_map<std::string, PendingStart>& queued_starts();
+
+    static bool launch(const std::string& tmpl, RunSpec run, const std::string& tier,
+                       long timeout_ms, const Placement& placement,
+                       std::string* error = nullptr);
+    static void dispatch(std::vector<std::pair<std::string, Placement>> placed);
+    static RunExit dequeue(const std::string& run_id, Instance& inst);
+    static void publish_exit(const RunExit& ex);
+
+    static void reaper_main();
+    static void on_child_exit(int pidfd);
+    static void terminate(const std::string& run_id, Instance& inst);
+    static void schedule(const std::string& run_id, Instance& inst, Clock::time_point at);
 };
@@ -0,0 +1,43 @@
+// runtime/daemon/latency_window.cpp
+#include "latency_window.h"
+#include <algorithm>
+
+LatencyWindow::LatencyWindow(size_t capacity)
+    : m_samples(), m_next(0), m_total(0) {
+    m_samples.reserve(capacity ? capacity : 1);
+}
+
+void LatencyWindow::record(double ms) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_samples.size() < m_samples.capacity()) {
+        m_samples.push_back(ms);
+    } else {
+        m_samples[m_next] = ms;
+        m_next = (m_next + 1) % m_samples.size();
+    }
+    m_total++;
+}
+
+static double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    size_t idx = (size_t)(q * (double)(sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+LatencyWindow::Summary LatencyWindow::summary() const {
+    std::vector<double> copy;
+    size_t total;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        copy = m_samples;
+        total = m_total;
+    }
+    std::sort(copy.begin(), copy.end());
+
+    return Summary{
+        total,
+        percentile(copy, 0.50),
+        percentile(copy, 0.99),
+        copy.empty() ? 0.0 : copy.back(),
+    };
+}
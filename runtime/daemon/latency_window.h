@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Sliding window of the most recent latency samples (milliseconds) with
+// on-demand percentiles. Cheap to record; percentiles sort a copy.
+class LatencyWindow {
+public:
+    explicit LatencyWindow(size_t capacity = 4096);
+
+    void record(double ms);
+
+    struct Summary {
+        size_t count;   // samples ever recorded
+        double p50;
+        double p99;
+        double max;
+    };
+    Summary summary() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<double> m_samples;
+    size_t m_next;
+    size_t m_total;
+};
@@ -1,23 +1,30 @@
+#include "daemon_config.h"
 #include "daemon_server.h"
+#include "instance_manager.h"
+#include "metrics_server.h"
+#include <signal.h>
 #include <iostream>
 
 
 int main(int argc, char* argv[]) {
     std::cout << "Starting Kyntrix Daemon Server..." << std::endl;
 
-    std::string socket_path = "/var/run/kyntrixd.sock";
-    if (argc > 1) {
-        socket_path = argv[1];
-    }
+    // Peers hanging up mid-response must not kill the daemon
+    ::signal(SIGPIPE, SIG_IGN);
+
+    DaemonConfig cfg = load_daemon_config(argc, argv);
 
     try {
 
-        KyntrixDaemonServer server(socket_path);
+        InstanceManager::init(cfg);
+        MetricsServer metrics(cfg);
+        KyntrixDaemonServer server(cfg);
         server.run();
     } 
     catch (const std::exception& ex) {
         std::cerr << "Daemon server error: " << ex.what() << std::endl;
+        InstanceManager::shutdown();
         return 1;
 
     }
-}
\ No newline at end of file
+}
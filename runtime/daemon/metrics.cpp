@@ -0,0 +1,212 @@
+// runtime/daemon/metrics.cpp
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+static constexpr uint64_t kMaxValue = (1ull << Histogram::kMaxBits) - 1;
+
+// Bucket upper bounds exported as `le`, in seconds. Spawn phases sit at the
+// low end, runs and telemetry forwarding at the high end.
+static const double kLadder[] = {
+    0.00001, 0.000025, 0.00005, 0.0001, 0.00025, 0.0005,
+    0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+    0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60,
+};
+
+Histogram::Histogram()
+    : m_buckets(new std::atomic<uint64_t>[kBuckets]), m_sum_ns(0), m_max_ns(0) {
+    for (size_t i = 0; i < kBuckets; ++i) m_buckets[i].store(0, std::memory_order_relaxed);
+}
+
+size_t Histogram::bucket_of(uint64_t ns) {
+    if (ns > kMaxValue) ns = kMaxValue;
+    if (ns < (1ull << kSubBits)) return (size_t)ns;
+
+    unsigned msb = 63 - (unsigned)__builtin_clzll(ns);
+    unsigned shift = msb - kSubBits;
+    return ((size_t)(shift + 1) << kSubBits) + (size_t)((ns >> shift) - (1ull << kSubBits));
+}
+
+uint64_t Histogram::bucket_upper(size_t bucket) {
+    if (bucket < (2u << kSubBits)) return bucket + 1;
+
+    unsigned shift = (unsigned)(bucket >> kSubBits) - 1;
+    uint64_t sub = bucket & ((1u << kSubBits) - 1);
+    return ((1ull << kSubBits) + sub + 1) << shift;
+}
+
+void Histogram::record_ns(uint64_t ns) {
+    m_buckets[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+    m_sum_ns.fetch_add(ns, std::memory_order_relaxed);
+
+    uint64_t prev = m_max_ns.load(std::memory_order_relaxed);
+    while (ns > prev && !m_max_ns.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {}
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot s;
+    s.buckets.resize(kBuckets);
+    s.count = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        s.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+        s.count += s.buckets[i];
+    }
+    s.sum_ns = m_sum_ns.load(std::memory_order_relaxed);
+    s.max_ns = m_max_ns.load(std::memory_order_relaxed);
+    return s;
+}
+
+uint64_t Histogram::Snapshot::quantile_ns(double q) const {
+    if (count == 0) return 0;
+
+    uint64_t rank = (uint64_t)std::ceil(std::clamp(q, 0.0, 1.0) * (double)count);
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) return std::min(bucket_upper(i), std::max<uint64_t>(max_ns, 1));
+    }
+    return max_ns;
+}
+
+uint64_t Histogram::Snapshot::count_le(uint64_t le_ns) const {
+    uint64_t n = 0;
+    for (size_t i = 0; i < buckets.size() && bucket_upper(i) - 1 <= le_ns; ++i) {
+        n += buckets[i];
+    }
+    return n;
+}
+
+void MetricsText::family(const std::string& name, const std::string& help, const char* type) {
+    if (name == m_family) return;
+    m_family = name;
+
+    m_out += "# HELP " + name + " " + help + "\n";
+    m_out += "# TYPE " + name + " " + type + "\n";
+}
+
+static void append_escaped(std::string& out, const std::string& v) {
+    for (char c : v) {
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else {
+            out += c;
+        }
+    }
+}
+
+static void append_number(std::string& out, double v) {
+    char buf[32];
+    if (v == std::floor(v) && std::fabs(v) < 1e15) {
+        std::snprintf(buf, sizeof(buf), "%.0f", v);
+    } else {
+        std::snprintf(buf, sizeof(buf), "%.9g", v);
+    }
+    out += buf;
+}
+
+void MetricsText::sample(const std::string& name, const MetricLabels& labels,
+                         const char* le, double value) {
+    m_out += name;
+    if (!labels.empty() || le) {
+        m_out += '{';
+        bool first = true;
+        for (auto& [k, v] : labels) {
+            if (!first) m_out += ',';
+            first = false;
+            m_out += k;
+            m_out += "=\"";
+            append_escaped(m_out, v);
+            m_out += '"';
+        }
+        if (le) {
+            if (!first) m_out += ',';
+            m_out += "le=\"";
+            m_out += le;
+            m_out += '"';
+        }
+        m_out += '}';
+    }
+    m_out += ' ';
+    append_number(m_out, value);
+    m_out += '\n';
+}
+
+void MetricsText::gauge(const std::string& name, const std::string& help, double value,
+                        const MetricLabels& labels) {
+    family(name, help, "gauge");
+    sample(name, labels, nullptr, value);
+}
+
+void MetricsText::counter(const std::string& name, const std::string& help, double value,
+                          const MetricLabels& labels) {
+    family(name, help, "counter");
+    sample(name, labels, nullptr, value);
+}
+
+void MetricsText::histogram(const std::string& name, const std::string& help,
+                            const Histogram::Snapshot& snap, const MetricLabels& labels) {
+    family(name, help, "histogram");
+
+    const std::string bucket = name + "_bucket";
+    char le[32];
+    for (double s : kLadder) {
+        std::snprintf(le, sizeof(le), "%g", s);
+        sample(bucket, labels, le, (double)snap.count_le((uint64_t)std::llround(s * 1e9)));
+    }
+    sample(bucket, labels, "+Inf", (double)snap.count);
+    sample(name + "_sum", labels, nullptr, (double)snap.sum_ns / 1e9);
+    sample(name + "_count", labels, nullptr, (double)snap.count);
+}
+
+MetricsRegistry& MetricsRegistry::global() {
+    static MetricsRegistry r;
+    return r;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                      const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Family*& f = m_by_name[name];
+    if (!f) {
+        m_families.push_back(std::make_unique<Family>());
+        f = m_families.back().get();
+        f->name = name;
+        f->help = help;
+    }
+    for (auto& s : f->series) {
+        if (s.labels == labels) return *s.hist;
+    }
+    f->series.push_back({labels, std::make_unique<Histogram>()});
+    return *f->series.back().hist;
+}
+
+void MetricsRegistry::add_collector(Collector fn) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_collectors.push_back(std::move(fn));
+}
+
+void MetricsRegistry::clear_collectors() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_collectors.clear();
+}
+
+std::string MetricsRegistry::render() const {
+    std::string out;
+    MetricsText text(out);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& c : m_collectors) c(text);
+    for (auto& f : m_families) {
+        for (auto& s : f->series) {
+            text.histogram(f->name, f->help, s.hist->snapshot(), s.labels);
+        }
+    }
+    return out;
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Log-linear (HDR-style) histogram of durations. Each power of two is split
+// into 2^kSubBits buckets, so a sample is placed within ~3% of its value over
+// the whole range (1 ns .. ~18 minutes; longer samples are clamped). Recording
+// is two relaxed atomic adds; unlike LatencyWindow it keeps every sample.
+class Histogram {
+public:
+    static constexpr unsigned kSubBits = 5;
+    static constexpr unsigned kMaxBits = 40;
+    static constexpr size_t kBuckets = (kMaxBits - kSubBits + 1) << kSubBits;
+
+    Histogram();
+
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    void record_ns(uint64_t ns);
+
+    template <class Rep, class Period>
+    void record(std::chrono::duration<Rep, Period> d) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+        record_ns(ns > 0 ? (uint64_t)ns : 0);
+    }
+
+    struct Snapshot {
+        std::vector<uint64_t> buckets;
+        uint64_t count;
+        uint64_t sum_ns;
+        uint64_t max_ns;
+
+        // Upper bound of the bucket holding quantile q, in nanoseconds
+        uint64_t quantile_ns(double q) const;
+        // Samples whose bucket lies entirely at or below le_ns
+        uint64_t count_le(uint64_t le_ns) const;
+    };
+    Snapshot snapshot() const;
+
+    static size_t bucket_of(uint64_t ns);
+    static uint64_t bucket_upper(size_t bucket);   // exclusive
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> m_buckets;
+    std::atomic<uint64_t> m_sum_ns;
+    std::atomic<uint64_t> m_max_ns;
+};
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+// Appends samples in the Prometheus text format; used by collectors
+class MetricsText {
+public:
+    explicit MetricsText(std::string& out) : m_out(out) {}
+
+    void gauge(const std::string& name, const std::string& help, double value,
+               const MetricLabels& labels = {});
+    void counter(const std::string& name, const std::string& help, double value,
+                 const MetricLabels& labels = {});
+    void histogram(const std::string& name, const std::string& help,
+                   const Histogram::Snapshot& snap, const MetricLabels& labels = {});
+
+private:
+    void family(const std::string& name, const std::string& help, const char* type);
+    void sample(const std::string& name, const MetricLabels& labels,
+                const char* le, double value);
+
+    std::string& m_out;
+    std::string m_family;   // last family header written
+};
+
+// Process-wide metrics served by MetricsServer. Histograms are created on
+// first use and live as long as the process, so callers may keep the
+// reference; everything else is read at scrape time by collectors.
+class MetricsRegistry {
+public:
+    using Collector = std::function<void(MetricsText&)>;
+
+    static MetricsRegistry& global();
+
+    // Returns the series of family `name` with the given labels, creating it
+    Histogram& histogram(const std::string& name, const std::string& help,
+                         const MetricLabels& labels = {});
+
+    void add_collector(Collector fn);
+    void clear_collectors();
+
+    std::string render() const;
+
+private:
+    struct Series {
+        MetricLabels labels;
+        std::unique_ptr<Histogram> hist;
+    };
+    struct Family {
+        std::string name;
+        std::string help;
+        std::vector<Series> series;
+    };
+
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<Family>> m_families;   // in creation order
+    std::unordered_map<std::string, Family*> m_by_name;
+    std::vector<Collector> m_collectors;
+};
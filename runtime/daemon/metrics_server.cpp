@@ -0,0 +1,170 @@
+// runtime/daemon/metrics_server.cpp
+#include "metrics_server.h"
+#include "metrics.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+static constexpr size_t kMaxRequestBytes = 8192;
+
+static int listen_unix(const std::string& path) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) throw std::runtime_error("metrics: socket() failed");
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        ::close(fd);
+        throw std::runtime_error("metrics: socket path too long: " + path);
+    }
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    ::unlink(path.c_str());
+    if (::bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(fd, 16) < 0) {
+        ::close(fd);
+        throw std::runtime_error("metrics: cannot listen on " + path + ": " + strerror(errno));
+    }
+    return fd;
+}
+
+static int listen_loopback(int port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) throw std::runtime_error("metrics: socket() failed");
+
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (::bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(fd, 16) < 0) {
+        ::close(fd);
+        throw std::runtime_error("metrics: cannot listen on 127.0.0.1:" + std::to_string(port) +
+                                 ": " + strerror(errno));
+    }
+    return fd;
+}
+
+static void send_all(int fd, const std::string& data) {
+    size_t off = 0;
+    while (off < data.size()) {
+        ssize_t n = ::send(fd, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        off += (size_t)n;
+    }
+}
+
+MetricsServer::MetricsServer(const DaemonConfig& cfg)
+    : m_wake(-1), m_stop(false) {
+    if (cfg.metrics_socket.empty() && cfg.metrics_port <= 0) return;
+
+    try {
+        if (!cfg.metrics_socket.empty()) {
+            m_listen.push_back(listen_unix(cfg.metrics_socket));
+            m_socket_path = cfg.metrics_socket;
+        }
+        if (cfg.metrics_port > 0) {
+            m_listen.push_back(listen_loopback((int)cfg.metrics_port));
+        }
+        m_wake = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_wake < 0) throw std::runtime_error("metrics: eventfd() failed");
+    } catch (...) {
+        for (int fd : m_listen) ::close(fd);
+        if (!m_socket_path.empty()) ::unlink(m_socket_path.c_str());
+        throw;
+    }
+
+    m_thread = std::thread(&MetricsServer::run, this);
+}
+
+MetricsServer::~MetricsServer() {
+    if (m_thread.joinable()) {
+        m_stop = true;
+        uint64_t one = 1;
+        (void)!::write(m_wake, &one, sizeof(one));
+        m_thread.join();
+    }
+
+    for (int fd : m_listen) ::close(fd);
+    if (m_wake >= 0) ::close(m_wake);
+    if (!m_socket_path.empty()) ::unlink(m_socket_path.c_str());
+}
+
+void MetricsServer::run() {
+    std::vector<pollfd> fds;
+    for (int fd : m_listen) fds.push_back({fd, POLLIN, 0});
+    fds.push_back({m_wake, POLLIN, 0});
+
+    while (!m_stop) {
+        int n = ::poll(fds.data(), fds.size(), -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "metrics: poll failed: " << strerror(errno) << "\n";
+            return;
+        }
+
+        for (size_t i = 0; i + 1 < fds.size(); ++i) {
+            if (!(fds[i].revents & POLLIN)) continue;
+
+            int conn = ::accept4(fds[i].fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (conn < 0) continue;
+            serve(conn);
+            ::close(conn);
+        }
+    }
+}
+
+void MetricsServer::serve(int fd) {
+    // A stalled scraper must not hold up the next one for long
+    timeval tv{1, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    std::string req;
+    char buf[1024];
+    while (req.find("\r\n\r\n") == std::string::npos && req.size() < kMaxRequestBytes) {
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        req.append(buf, (size_t)n);
+    }
+
+    size_t line_end = req.find("\r\n");
+    std::string line = req.substr(0, line_end);
+    std::string path;
+    if (line.compare(0, 4, "GET ") == 0) {
+        size_t sp = line.find(' ', 4);
+        path = line.substr(4, sp == std::string::npos ? std::string::npos : sp - 4);
+    }
+
+    std::string body, status, type = "text/plain; charset=utf-8";
+    if (path == "/metrics" || path.compare(0, 9, "/metrics?") == 0) {
+        status = "200 OK";
+        type = "text/plain; version=0.0.4; charset=utf-8";
+        body = MetricsRegistry::global().render();
+    } else if (line.compare(0, 4, "GET ") == 0) {
+        status = "404 Not Found";
+        body = "not found\n";
+    } else {
+        status = "405 Method Not Allowed";
+        body = "only GET is supported\n";
+    }
+
+    std::string head = "HTTP/1.1 " + status + "\r\n"
+                       "Content-Type: " + type + "\r\n"
+                       "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                       "Connection: close\r\n\r\n";
+    send_all(fd, head + body);
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "daemon_config.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Serves MetricsRegistry::global() as Prometheus text on GET /metrics, over
+// a Unix socket (cfg.metrics_socket) and/or 127.0.0.1:cfg.metrics_port.
+// Scrapes are rare and small, so one thread answers them one at a time.
+class MetricsServer {
+public:
+    // Throws std::runtime_error if a configured listener cannot be set up.
+    // Does nothing if neither listener is configured.
+    explicit MetricsServer(const DaemonConfig& cfg);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+private:
+    void run();
+    void serve(int fd);
+
+    std::string m_socket_path;
+    std::vector<int> m_listen;
+    int m_wake;
+    std::atomic<bool> m_stop;
+    std::thread m_thread;
+};
@@ -0,0 +1,117 @@
+// runtime/daemon/resource_policy.cpp
+#include "resource_policy.h"
+#include <fstream>
+#include <stdexcept>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+static void apply(CgroupLimits& dst, const CgroupLimits& src) {
+    if (!src.cpu_max.empty())    dst.cpu_max = src.cpu_max;
+    if (!src.memory_max.empty()) dst.memory_max = src.memory_max;
+    if (!src.pids_max.empty())   dst.pids_max = src.pids_max;
+    if (!src.io_max.empty())     dst.io_max = src.io_max;
+}
+
+static std::string field(const json& j, const char* name) {
+    if (!j.contains(name)) return "";
+    const json& v = j[name];
+    // Accept numbers for the numeric-only knobs ("pids_max": 512)
+    return v.is_string() ? v.get<std::string>() : v.dump();
+}
+
+static CgroupLimits parse_limits(const json& j) {
+    if (!j.is_object()) {
+        throw std::runtime_error("resource limits must be an object");
+    }
+
+    CgroupLimits l;
+    l.cpu_max    = field(j, "cpu_max");
+    l.memory_max = field(j, "memory_max");
+    l.pids_max   = field(j, "pids_max");
+    l.io_max     = field(j, "io_max");
+    return l;
+}
+
+// level's "network", if it has one; name labels errors
+static std::optional<NetPolicy> parse_network(const json& level, const std::string& name) {
+    if (!level.is_object() || !level.contains("network")) return std::nullopt;
+
+    const json& v = level["network"];
+    NetPolicy p;
+    if (!v.is_string() || !parse_net_policy(v.get<std::string>(), p)) {
+        throw std::runtime_error(name + ": network must be none, loopback or egress");
+    }
+    return p;
+}
+
+ResourcePolicy::ResourcePolicy() {
+    m_default.cpu_max    = "200000 100000";   // 2 CPUs
+    m_default.memory_max = "1G";
+    m_default.pids_max   = "512";
+}
+
+ResourcePolicy ResourcePolicy::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("cannot open limits file " + path);
+    }
+
+    json j = json::parse(in, nullptr, false);
+    if (j.is_discarded() || !j.is_object()) {
+        throw std::runtime_error("invalid JSON in limits file " + path);
+    }
+
+    ResourcePolicy p;
+    if (j.contains("default")) {
+        apply(p.m_default, parse_limits(j["default"]));
+        p.m_default_network = parse_network(j["default"], "default");
+    }
+    if (j.contains("templates")) {
+        for (auto& [name, limits] : j["templates"].items()) {
+            p.m_templates[name] = parse_limits(limits);
+            if (auto n = parse_network(limits, name)) p.m_template_networks[name] = *n;
+        }
+    }
+    if (j.contains("tiers")) {
+        for (auto& [name, limits] : j["tiers"].items()) {
+            p.m_tiers[name] = parse_limits(limits);
+            if (auto n = parse_network(limits, name)) p.m_tier_networks[name] = *n;
+            if (limits.contains("priority")) {
+                if (!limits["priority"].is_number_integer()) {
+                    throw std::runtime_error("tier " + name + ": priority must be an integer");
+                }
+                p.m_priorities[name] = limits["priority"].get<int>();
+            }
+        }
+    }
+    return p;
+}
+
+CgroupLimits ResourcePolicy::resolve(const std::string& tmpl, const std::string& tier) const {
+    CgroupLimits l = m_default;
+
+    auto t = m_templates.find(tmpl);
+    if (t != m_templates.end()) apply(l, t->second);
+
+    auto r = m_tiers.find(tier);
+    if (r != m_tiers.end()) apply(l, r->second);
+
+    return l;
+}
+
+int ResourcePolicy::priority(const std::string& tier) const {
+    auto it = m_priorities.find(tier);
+    return it != m_priorities.end() ? it->second : 0;
+}
+
+NetPolicy ResourcePolicy::network(const std::string& tmpl, const std::string& tier,
+                                  NetPolicy fallback) const {
+    auto r = m_tier_networks.find(tier);
+    if (r != m_tier_networks.end()) return r->second;
+
+    auto t = m_template_networks.find(tmpl);
+    if (t != m_template_networks.end()) return t->second;
+
+    return m_default_network.value_or(fallback);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "ct_cgroup.h"
+#include "ct_netns.h"
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// Resolves the cgroup limits for a run: built-in defaults, overridden per
+// template, then per user tier. Overrides come from an optional JSON file:
+//
+//   { "default":   { "cpu_max": "200000 100000", "memory_max": "1G", "pids_max": "512" },
+//     "templates": { "python": { "memory_max": "2G" } },
+//     "tiers":     { "free": { "cpu_max": "50000 100000", "io_max": "8:0 wbps=10485760" },
+//                    "pro":  { "priority": 10, "network": "egress" } } }
+//
+// Only the fields present at a level replace the inherited value. A tier's
+// priority orders the run scheduler's queue (run_scheduler.h); higher goes
+// first, default 0. "network" (none, loopback or egress; ct_netns.h) may be
+// set at any level and overrides the daemon's default policy.
+class ResourcePolicy {
+public:
+    ResourcePolicy();
+
+    // Throws std::runtime_error if the file cannot be read or parsed.
+    static ResourcePolicy load(const std::string& path);
+
+    CgroupLimits resolve(const std::string& tmpl, const std::string& tier) const;
+    int priority(const std::string& tier) const;
+    NetPolicy network(const std::string& tmpl, const std::string& tier, NetPolicy fallback) const;
+
+private:
+    CgroupLimits m_default;
+    std::unordered_map<std::string, CgroupLimits> m_templates;
+    std::unordered_map<std::string, CgroupLimits> m_tiers;
+    std::unordered_map<std::string, int> m_priorities;
+    std::optional<NetPolicy> m_default_network;
+    std::unordered_map<std::string, NetPolicy> m_template_networks;
+    std::unordered_map<std::string, NetPolicy> m_tier_networks;
+};
@@ -0,0 +1,121 @@
+// runtime/daemon/run_scheduler.cpp
+#include "run_scheduler.h"
+#include <algorithm>
+#include <stdexcept>
+
+RunScheduler::RunScheduler(const SchedulerConfig& cfg, const CpuTopology& topo) : m_cfg(cfg) {
+    if (m_cfg.cpus_per_run == 0) m_cfg.cpus_per_run = 1;
+    if (m_cfg.runs_per_slot == 0) m_cfg.runs_per_slot = 1;
+
+    for (const NumaNode& node : topo.nodes) {
+        // Whole cores until the slot has cpus_per_run CPUs; a short tail
+        // joins the node's last slot
+        Slot slot{node.id, {}};
+        size_t first = m_slots.size();
+        for (const CpuCore& core : node.cores) {
+            slot.cpus.insert(slot.cpus.end(), core.cpus.begin(), core.cpus.end());
+            if (slot.cpus.size() >= m_cfg.cpus_per_run) {
+                m_slots.push_back(std::move(slot));
+                slot = Slot{node.id, {}};
+            }
+        }
+        if (!slot.cpus.empty()) {
+            if (m_slots.size() > first) {
+                auto& last = m_slots.back().cpus;
+                last.insert(last.end(), slot.cpus.begin(), slot.cpus.end());
+            } else {
+                m_slots.push_back(std::move(slot));
+            }
+        }
+        m_node_slots[node.id] = m_slots.size() - first;
+    }
+
+    if (m_slots.empty()) {
+        throw std::runtime_error("scheduler: no usable CPUs");
+    }
+}
+
+bool RunScheduler::place(Placement& out) {
+    int best = -1;
+    double best_node_load = 0;
+
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        const Slot& s = m_slots[i];
+        if (s.runs >= m_cfg.runs_per_slot) continue;
+
+        double node_load = (double)m_node_runs[s.node] / (double)m_node_slots[s.node];
+        if (best < 0 || s.runs < m_slots[best].runs ||
+            (s.runs == m_slots[best].runs && node_load < best_node_load)) {
+            best = (int)i;
+            best_node_load = node_load;
+        }
+    }
+    if (best < 0) return false;
+
+    Slot& s = m_slots[best];
+    ++s.runs;
+    ++m_node_runs[s.node];
+    out.slot = best;
+    out.node = s.node;
+    out.cpus = s.cpus;
+    return true;
+}
+
+RunScheduler::Admission RunScheduler::admit(const std::string& run_id, int priority, Placement& out) {
+    // Nothing jumps the queue, whatever its priority
+    if (m_queue.empty() && place(out)) {
+        m_placed[run_id] = out.slot;
+        return Admission::Placed;
+    }
+
+    if (m_queue.size() >= m_cfg.queue_max) {
+        ++m_rejected;
+        return Admission::Rejected;
+    }
+    m_waiting[run_id] = m_queue.insert({priority, m_seq++, run_id}).first;
+    return Admission::Queued;
+}
+
+void RunScheduler::release(const std::string& run_id,
+                           std::vector<std::pair<std::string, Placement>>& placed) {
+    auto w = m_waiting.find(run_id);
+    if (w != m_waiting.end()) {
+        m_queue.erase(w->second);
+        m_waiting.erase(w);
+        return;
+    }
+
+    auto it = m_placed.find(run_id);
+    if (it == m_placed.end()) return;
+
+    Slot& s = m_slots[it->second];
+    --s.runs;
+    --m_node_runs[s.node];
+    m_placed.erase(it);
+
+    while (!m_queue.empty()) {
+        Placement p;
+        if (!place(p)) break;
+
+        std::string next = m_queue.begin()->run_id;
+        m_queue.erase(m_queue.begin());
+        m_waiting.erase(next);
+        m_placed[next] = p.slot;
+        placed.emplace_back(std::move(next), std::move(p));
+    }
+}
+
+SchedulerStats RunScheduler::stats() const {
+    SchedulerStats s{};
+    s.slots    = m_slots.size();
+    s.capacity = m_slots.size() * m_cfg.runs_per_slot;
+    s.running  = m_placed.size();
+    s.queued   = m_queue.size();
+    s.rejected = m_rejected;
+    for (auto& [node, slots] : m_node_slots) {
+        auto r = m_node_runs.find(node);
+        s.node_runs.emplace_back(node, r == m_node_runs.end() ? 0 : r->second);
+    }
+    std::sort(s.node_runs.begin(), s.node_runs.end());
+    return s;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "ct_topology.h"
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct SchedulerConfig {
+    size_t cpus_per_run  = 2;
+    size_t runs_per_slot = 1;      // > 1 overcommits each slot
+    size_t queue_max     = 1024;   // waiting runs before starts are refused
+};
+
+// Where an admitted run executes
+struct Placement {
+    int slot = -1;
+    int node = -1;                 // NUMA node, for cpuset.mems
+    std::vector<int> cpus;
+};
+
+struct SchedulerStats {
+    size_t slots;
+    size_t capacity;               // slots * runs_per_slot
+    size_t running;
+    size_t queued;
+    uint64_t rejected;             // refused with the queue full
+    std::vector<std::pair<int, size_t>> node_runs;   // NUMA node -> runs placed
+};
+
+// Admission control and CPU placement for runs. The CPUs are cut into slots
+// of cpus_per_run CPUs made of whole cores on one NUMA node, and a slot holds
+// up to runs_per_slot runs. A run goes to the emptiest slot, preferring the
+// least loaded node; runs over capacity wait, highest tier priority first,
+// then in arrival order.
+//
+// Not thread-safe; InstanceManager drives it under its table mutex.
+class RunScheduler {
+public:
+    enum class Admission { Placed, Queued, Rejected };
+
+    // Throws std::runtime_error if topo has no CPUs
+    RunScheduler(const SchedulerConfig& cfg, const CpuTopology& topo);
+
+    // Places run_id now (filling out) or queues it
+    Admission admit(const std::string& run_id, int priority, Placement& out);
+
+    // Frees run_id's slot, or takes it off the queue. Queued runs the freed
+    // capacity admits are appended to placed, in admission order.
+    void release(const std::string& run_id,
+                 std::vector<std::pair<std::string, Placement>>& placed);
+
+    SchedulerStats stats() const;
+
+private:
+    struct Slot {
+        int node;
+        std::vector<int> cpus;
+        size_t runs = 0;
+    };
+
+    struct Waiting {
+        int priority;
+        uint64_t seq;
+        std::string run_id;
+        bool operator<(const Waiting& o) const {
+            return priority != o.priority ? priority > o.priority : seq < o.seq;
+        }
+    };
+
+    bool place(Placement& out);
+
+    SchedulerConfig m_cfg;
+    std::vector<Slot> m_slots;
+    std::unordered_map<int, size_t> m_node_slots;    // NUMA node -> slots on it
+    std::unordered_map<int, size_t> m_node_runs;     // NUMA node -> runs placed
+    std::unordered_map<std::string, int> m_placed;   // run -> slot
+    std::set<Waiting> m_queue;
+    std::unordered_map<std::string, std::set<Waiting>::iterator> m_waiting;
+    uint64_t m_seq = 0;
+    uint64_t m_rejected = 0;
+};
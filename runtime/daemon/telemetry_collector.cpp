@@ -0,0 +1,282 @@
+// runtime/daemon/telemetry_collector.cpp
+#include "telemetry_collector.h"
+#include "ct_telemetry.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <iostream>
+#include <stdexcept>
+
+// Larger than any message a channel's send buffer admits
+static constexpr size_t kMaxMessageBytes = 2 << 20;
+static constexpr size_t kMaxFrameRecords = 65536;
+// POST early once this much is buffered
+static constexpr size_t kMaxBatchBytes = 4 << 20;
+// Batches queued behind the one being POSTed
+static constexpr size_t kMaxQueuedBatches = 8;
+
+TelemetryCollector::TelemetryCollector(const std::string& ingest_url, long flush_ms)
+    : m_flush(flush_ms > 0 ? flush_ms : 1), m_epoll(-1), m_wake(-1), m_stop(false),
+      m_body_events(0), m_buf(kMaxMessageBytes), m_send_stop(false), m_failing(false),
+      m_frames(0), m_events(0), m_rejected(0), m_dropped(0),
+      m_first_event(MetricsRegistry::global().histogram("kyntrixd_first_telemetry_seconds",
+          "Time from opening a run's telemetry channel to its first message")) {
+
+    if (!http_parse_url(ingest_url, m_target)) {
+        throw std::runtime_error("telemetry: unsupported ingest url " + ingest_url);
+    }
+
+    m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    m_wake  = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_epoll < 0 || m_wake < 0) {
+        if (m_epoll >= 0) ::close(m_epoll);
+        if (m_wake >= 0) ::close(m_wake);
+        throw std::runtime_error("telemetry: epoll/eventfd setup failed");
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = m_wake;
+    ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake, &ev);
+
+    m_sender = std::thread(&TelemetryCollector::send_loop, this);
+    m_thread = std::thread(&TelemetryCollector::run, this);
+}
+
+TelemetryCollector::~TelemetryCollector() {
+    m_stop = true;
+    uint64_t one = 1;
+    (void)!::write(m_wake, &one, sizeof(one));
+    if (m_thread.joinable()) m_thread.join();
+
+    // The sender drains what the collector queued last
+    {
+        std::lock_guard<std::mutex> lock(m_send_mutex);
+        m_send_stop = true;
+    }
+    m_send_cv.notify_one();
+    if (m_sender.joinable()) m_sender.join();
+
+    for (auto& [fd, ch] : m_channels) ::close(fd);
+    ::close(m_wake);
+    ::close(m_epoll);
+}
+
+int TelemetryCollector::open_channel(const std::string& run_id) {
+    TelemetryChannel ch;
+    if (!telemetry_channel_open(ch)) return -1;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_channels[ch.host_fd] = Channel{run_id, Clock::now()};
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = ch.host_fd;
+    if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, ch.host_fd, &ev) < 0) {
+        std::cerr << "telemetry: epoll_ctl failed: " << strerror(errno) << "\n";
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_channels.erase(ch.host_fd);
+        }
+        telemetry_channel_close(ch);
+        return -1;
+    }
+    return ch.container_fd;
+}
+
+TelemetryStats TelemetryCollector::stats() const {
+    TelemetryStats s{};
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        s.channels = m_channels.size();
+    }
+    s.frames   = m_frames.load();
+    s.events   = m_events.load();
+    s.rejected = m_rejected.load();
+    s.dropped  = m_dropped.load();
+    s.forward  = m_latency.summary();
+    return s;
+}
+
+void TelemetryCollector::run() {
+    epoll_event events[64];
+
+    while (!m_stop) {
+        int timeout = -1;
+        if (!m_pending.empty()) {
+            auto left = std::chrono::ceil<std::chrono::milliseconds>(m_first_pending + m_flush - Clock::now());
+            timeout = left.count() > 0 ? (int)left.count() : 0;
+        }
+
+        int n = ::epoll_wait(m_epoll, events, 64, timeout);
+        if (n < 0 && errno != EINTR) {
+            std::cerr << "telemetry: epoll_wait failed: " << strerror(errno) << "\n";
+            break;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == m_wake) {
+                uint64_t counter;
+                while (::read(m_wake, &counter, sizeof(counter)) > 0) {}
+                continue;
+            }
+            read_channel(fd);
+        }
+
+        if (!m_pending.empty() &&
+            (Clock::now() >= m_first_pending + m_flush || m_body.size() >= kMaxBatchBytes)) {
+            flush();
+        }
+    }
+
+    // Forward what was already read
+    flush();
+}
+
+void TelemetryCollector::read_channel(int fd) {
+    std::string run_id;
+    Clock::time_point opened;
+    bool heard;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_channels.find(fd);
+        if (it == m_channels.end()) return;
+        run_id = it->second.run_id;
+        opened = it->second.opened;
+        heard = it->second.heard;
+    }
+
+    // Bounded so one chatty container cannot starve the others
+    for (int budget = 256; budget > 0; --budget) {
+        ssize_t n = ::recv(fd, m_buf.data(), m_buf.size(), MSG_DONTWAIT | MSG_TRUNC);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            close_channel(fd);
+            return;
+        }
+        // Every process holding the container end has exited
+        if (n == 0) {
+            close_channel(fd);
+            return;
+        }
+        if (!heard) {
+            m_first_event.record(Clock::now() - opened);
+            heard = true;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_channels[fd].heard = true;
+        }
+        if ((size_t)n > m_buf.size()) {
+            ++m_rejected;
+            continue;
+        }
+        ingest(run_id, std::string_view(m_buf.data(), (size_t)n));
+    }
+}
+
+void TelemetryCollector::close_channel(int fd) {
+    ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_channels.erase(fd);
+}
+
+void TelemetryCollector::ingest(const std::string& run_id, std::string_view msg) {
+    auto& frame = m_pending[run_id];
+    if (!frame) {
+        frame = std::make_unique<WireFrameWriter>(run_id);
+        if (m_pending.size() == 1 && m_body.empty()) m_first_pending = Clock::now();
+    }
+
+    while (!msg.empty()) {
+        size_t used = 0;
+        std::string_view frame_run;
+        if (!wire_read_frame(msg, used, frame_run, m_records)) {
+            ++m_rejected;
+            break;
+        }
+        msg.remove_prefix(used);
+        ++m_frames;
+
+        for (WireRecord& r : m_records) {
+            r.mask &= (uint8_t)~kWireRunId;
+            frame->add(r);
+            if (frame->count() >= kMaxFrameRecords) {
+                finish_frame(frame);
+                frame = std::make_unique<WireFrameWriter>(run_id);
+            }
+        }
+    }
+
+    if (frame->count() == 0 && m_pending.size() == 1 && m_body.empty()) {
+        m_pending.clear();
+    }
+}
+
+void TelemetryCollector::finish_frame(std::unique_ptr<WireFrameWriter>& frame) {
+    m_body_events += frame->count();
+    frame->finish(m_body, false);
+    frame.reset();
+}
+
+void TelemetryCollector::flush() {
+    for (auto& [run_id, frame] : m_pending) {
+        if (frame && frame->count() > 0) finish_frame(frame);
+    }
+    m_pending.clear();
+    if (m_body.empty()) return;
+
+    Batch batch{std::move(m_body), m_body_events, m_first_pending};
+    m_body.clear();
+    m_body_events = 0;
+
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(m_send_mutex);
+        if (m_outbox.size() < kMaxQueuedBatches) {
+            m_outbox.push_back(std::move(batch));
+            queued = true;
+        }
+    }
+    if (queued) {
+        m_send_cv.notify_one();
+    } else {
+        m_dropped += batch.events;
+    }
+}
+
+void TelemetryCollector::send_loop() {
+    for (;;) {
+        Batch batch;
+        {
+            std::unique_lock<std::mutex> lock(m_send_mutex);
+            m_send_cv.wait(lock, [this] { return m_send_stop || !m_outbox.empty(); });
+            if (m_outbox.empty()) return;
+            batch = std::move(m_outbox.front());
+            m_outbox.pop_front();
+        }
+
+        std::string err;
+        int status = http_post(m_target, "application/x-kyntrix-tal", batch.body, err);
+        if (status >= 200 && status < 300) {
+            m_events += batch.events;
+            m_latency.record(std::chrono::duration<double, std::milli>(Clock::now() - batch.first).count());
+            m_failing = false;
+        } else {
+            m_dropped += batch.events;
+            if (!m_failing) {
+                std::cerr << "telemetry: POST " << m_target.path << " failed: "
+                          << (status < 0 ? err : "HTTP " + std::to_string(status))
+                          << "; dropping batches until it recovers\n";
+            }
+            m_failing = true;
+        }
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include "latency_window.h"
+#include "metrics.h"
+#include "agent_http.h"
+#include "agent_wire.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct TelemetryStats {
+    size_t channels;                    // open
+    uint64_t frames;                    // read from containers
+    uint64_t events;                    // forwarded to ingestion
+    uint64_t rejected;                  // malformed or oversized messages
+    uint64_t dropped;                   // events lost to failed POSTs or a
+                                        // full send queue
+    LatencyWindow::Summary forward;     // first buffered frame -> POST done
+};
+
+// Host end of the per-run telemetry channels (ct_telemetry.h). One thread
+// reads every channel from an epoll set, re-encodes the frames under the run
+// id the channel was opened for (so a container cannot write into another
+// run's stream) and batches them up for at most flush_ms. A second thread
+// POSTs the batches to ingestion, so a slow ingest endpoint does not stop the
+// channels being drained; batches beyond a small queue are dropped. The time from opening a channel to its first message is recorded as
+// kyntrixd_first_telemetry_seconds.
+class TelemetryCollector {
+public:
+    // Throws std::runtime_error if ingest_url is not an http:// URL or the
+    // epoll setup fails
+    TelemetryCollector(const std::string& ingest_url, long flush_ms);
+    ~TelemetryCollector();
+
+    TelemetryCollector(const TelemetryCollector&) = delete;
+    TelemetryCollector& operator=(const TelemetryCollector&) = delete;
+
+    // Returns the container end of a new channel for the run (see
+    // RunSpec::telemetry_fd), or -1. The caller closes it once the container
+    // holds its copy; the channel is read until every copy is closed.
+    int open_channel(const std::string& run_id);
+
+    TelemetryStats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Channel {
+        std::string run_id;
+        Clock::time_point opened;
+        bool heard = false;      // first message seen
+    };
+
+    struct Batch {
+        std::string body;
+        uint64_t events;
+        Clock::time_point first;   // first frame buffered
+    };
+
+    void run();
+    void read_channel(int fd);
+    void close_channel(int fd);
+    void ingest(const std::string& run_id, std::string_view msg);
+    void finish_frame(std::unique_ptr<WireFrameWriter>& frame);
+    void flush();
+    void send_loop();
+
+    HttpTarget m_target;
+    std::chrono::milliseconds m_flush;
+    int m_epoll;
+    int m_wake;
+    std::atomic<bool> m_stop;
+    std::thread m_thread;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<int, Channel> m_channels;   // by host fd
+
+    // Collector thread only
+    std::unordered_map<std::string, std::unique_ptr<WireFrameWriter>> m_pending;
+    std::string m_body;
+    uint64_t m_body_events;
+    Clock::time_point m_first_pending;
+    std::vector<char> m_buf;
+    std::vector<WireRecord> m_records;
+
+    // Batches waiting for the sender thread
+    std::mutex m_send_mutex;
+    std::condition_variable m_send_cv;
+    std::deque<Batch> m_outbox;
+    bool m_send_stop;
+    std::thread m_sender;
+    bool m_failing;          // sender thread only
+
+    std::atomic<uint64_t> m_frames;
+    std::atomic<uint64_t> m_events;
+    std::atomic<uint64_t> m_rejected;
+    std::atomic<uint64_t> m_dropped;
+    LatencyWindow m_latency;
+    Histogram& m_first_event;
+};
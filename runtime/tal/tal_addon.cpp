@@ -0,0 +1,670 @@
+#define NAPI_VERSION 8
+#include "tal_export.h"
+#include "tal_graph.h"
+#include "tal_store.h"
+#include <node_api.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Node-API binding: exports class TalGraph with
+//   apply(event: string | Buffer): boolean
+//   applyBatch(events: Array<string | Buffer>): number[]   rejected indices
+//   applyLines(ndjson: string | Buffer): number[]          rejected indices
+//   delta(runId: string, timestampMs: number, tagged?: boolean): Buffer
+//   patch(runId: string, sinceSeq: number, timestampMs: number,
+//         binary?: boolean): Buffer     tagged GraphPatch JSON, or KTGP
+//   changes(sinceSeq: number): Buffer  { atSeq, nodes, edges } JSON for persistence
+//   exportState(): string
+//   lastSeq(): number
+//   stats(): { lastSeq, nodes, edges }
+//   lastError(): string
+//   restore(dir: string): boolean      reloads an empty graph from its store
+//   checkpoint(dir: string): { atSeq, bytes }
+// and class TalStore, a read-only view of a store (tal_store.h):
+//   new TalStore(dir: string)
+//   range(fromSeq: number, toSeq: number): Buffer            JSON
+//   subtree(rootId: string, depth: number): Buffer | null    JSON
+//   stats(): { atSeq, nodes, edges, bytes }
+//   exportStart(options): boolean      false for a root outside the slice
+//   exportNext(maxBytes: number): Buffer | null
+//   close(): void
+// exportStart() plans a streaming LLM export (tal_export.h), replacing any
+// in progress; options are { format, runId, timestampMs, fromSeq, toSeq,
+// root, depth, tokenBudget }, all optional. exportNext() returns its next
+// chunk, null once it is complete.
+
+namespace {
+
+struct Wrap {
+    TalGraph graph;
+    std::unique_ptr<TalStoreWriter> store;   // opened by the first checkpoint()
+    std::string store_dir;
+    std::string in;    // UTF-8 copy of string arguments
+    std::string out;
+};
+
+struct StoreWrap {
+    TalStore store;
+    std::unique_ptr<TalExporter> exporter;
+    std::string in;
+    std::string out;
+};
+
+// Tells the two classes' instances apart in unwrap
+const napi_type_tag kGraphTag = {0x6b7974616c677261ull, 0x7068000000000001ull};
+const napi_type_tag kStoreTag = {0x6b7974616c73746full, 0x7265000000000001ull};
+
+#define CHECK(call)                                             \
+    do {                                                        \
+        if ((call) != napi_ok) {                                \
+            napi_throw_error(env, nullptr, "napi: " #call);     \
+            return nullptr;                                     \
+        }                                                       \
+    } while (0)
+
+template <typename T>
+T* unwrap_as(napi_env env, napi_callback_info info, size_t* argc, napi_value* argv,
+             const napi_type_tag& tag, const char* error) {
+    napi_value self;
+    if (napi_get_cb_info(env, info, argc, argv, &self, nullptr) != napi_ok) return nullptr;
+
+    bool tagged = false;
+    T* w = nullptr;
+    if (napi_check_object_type_tag(env, self, &tag, &tagged) != napi_ok || !tagged ||
+        napi_unwrap(env, self, (void**)&w) != napi_ok) {
+        napi_throw_type_error(env, nullptr, error);
+        return nullptr;
+    }
+    return w;
+}
+
+Wrap* unwrap(napi_env env, napi_callback_info info, size_t* argc, napi_value* argv) {
+    return unwrap_as<Wrap>(env, info, argc, argv, kGraphTag, "TalGraph method called on wrong object");
+}
+
+StoreWrap* unwrap_store(napi_env env, napi_callback_info info, size_t* argc, napi_value* argv) {
+    return unwrap_as<StoreWrap>(env, info, argc, argv, kStoreTag, "TalStore method called on wrong object");
+}
+
+// Bytes of a Buffer / Uint8Array, or a UTF-8 copy of a string into scratch
+bool input_bytes(napi_env env, napi_value v, std::string& scratch, const char*& p, size_t& n) {
+    bool is_buffer = false;
+    napi_is_buffer(env, v, &is_buffer);
+    if (is_buffer) {
+        void* data;
+        if (napi_get_buffer_info(env, v, &data, &n) != napi_ok) return false;
+        p = (const char*)data;
+        return true;
+    }
+
+    bool is_typed = false;
+    napi_is_typedarray(env, v, &is_typed);
+    if (is_typed) {
+        napi_typedarray_type type;
+        size_t len, offset;
+        void* data;
+        napi_value ab;
+        if (napi_get_typedarray_info(env, v, &type, &len, &data, &ab, &offset) != napi_ok) return false;
+        if (type != napi_uint8_array) return false;
+        p = (const char*)data;
+        n = len;
+        return true;
+    }
+
+    size_t len;
+    if (napi_get_value_string_utf8(env, v, nullptr, 0, &len) != napi_ok) return false;
+    scratch.resize(len + 1);
+    napi_get_value_string_utf8(env, v, scratch.data(), len + 1, &len);
+    scratch.resize(len);
+    p = scratch.data();
+    n = len;
+    return true;
+}
+
+napi_value index_array(napi_env env, const std::vector<uint32_t>& idx) {
+    napi_value arr;
+    CHECK(napi_create_array_with_length(env, idx.size(), &arr));
+    for (size_t i = 0; i < idx.size(); ++i) {
+        napi_value v;
+        CHECK(napi_create_uint32(env, idx[i], &v));
+        CHECK(napi_set_element(env, arr, (uint32_t)i, v));
+    }
+    return arr;
+}
+
+// Deltas go straight to redis.publish, so they stay UTF-8
+napi_value buffer_result(napi_env env, const std::string& s) {
+    napi_value v;
+    CHECK(napi_create_buffer_copy(env, s.size(), s.data(), nullptr, &v));
+    return v;
+}
+
+napi_value string_result(napi_env env, const std::string& s) {
+    napi_value v;
+    CHECK(napi_create_string_utf8(env, s.data(), s.size(), &v));
+    return v;
+}
+
+void finalize(napi_env, void* data, void*) {
+    delete (Wrap*)data;
+}
+
+napi_value construct(napi_env env, napi_callback_info info) {
+    napi_value self, target;
+    CHECK(napi_get_new_target(env, info, &target));
+    if (!target) {
+        napi_throw_type_error(env, nullptr, "TalGraph must be called with new");
+        return nullptr;
+    }
+    CHECK(napi_get_cb_info(env, info, nullptr, nullptr, &self, nullptr));
+
+    Wrap* w = new Wrap();
+    if (napi_wrap(env, self, w, finalize, nullptr, nullptr) != napi_ok) {
+        delete w;
+        napi_throw_error(env, nullptr, "napi_wrap failed");
+        return nullptr;
+    }
+    CHECK(napi_type_tag_object(env, self, &kGraphTag));
+    return self;
+}
+
+napi_value apply(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    Wrap* w = unwrap(env, info, &argc, argv);
+    if (!w) return nullptr;
+
+    const char* p;
+    size_t n;
+    if (argc < 1 || !input_bytes(env, argv[0], w->in, p, n)) {
+        napi_throw_type_error(env, nullptr, "apply expects a string or Buffer");
+        return nullptr;
+    }
+
+    napi_value result;
+    CHECK(napi_get_boolean(env, w->graph.apply_json(p, n), &result));
+    return result;
+}
+
+napi_value apply_batch(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    Wrap* w = unwrap(env, info, &argc, argv);
+    if (!w) return nullptr;
+
+    bool is_array = false;
+    if (argc >= 1) napi_is_array(env, argv[0], &is_array);
+    if (!is_array) {
+        napi_throw_type_error(env, nullptr, "applyBatch expects an array");
+        return nullptr;
+    }
+
+    uint32_t len;
+    CHECK(napi_get_array_length(env, argv[0], &len));
+
+    std::vector<uint32_t> rejected;
+    for (uint32_t i = 0; i < len; ++i) {
+        napi_value item;
+        CHECK(napi_get_element(env, argv[0], i, &item));
+
+        const char* p;
+        size_t n;
+        if (!input_bytes(env, item, w->in, p, n) || !w->graph.apply_json(p, n)) {
+            rejected.push_back(i);
+        }
+    }
+    return index_array(env, rejected);
+}
+
+napi_value apply_lines(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    Wrap* w = unwrap(env, info, &argc, argv);
+    if (!w) return nullptr;
+
+    const char* p;
+    size_t n;
+    if (argc < 1 || !input_bytes(env, argv[0], w->in, p, n)) {
+        napi_throw_type_error(env, nullptr, "applyLines expects a string or Buffer");
+        return nullptr;
+    }
+
+    std::vector<uint32_t> rejected;
+    w->graph.apply_lines(p, n, &rejected);
+    return index_array(env, rejected);
+}
+
+napi_value delta(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value argv[3];
+    Wrap* w = unwrap(env, info, &argc, argv);
+    if (!w) return nullptr;
+
+    const char* run_id;
+    size_t run_id_len;
+    double ts = 0;
+    bool tagged = false;
+    if (argc < 2 || !input_bytes(env, argv[0], w->in, run_id, run_id_len) ||
+        napi_get_value_double(env, argv[1], &ts) != napi_ok) {
+        napi_throw_type_error(env, nullptr, "delta expects (runId, timestampMs[, tagged])");
+        return nullptr;
+    }
+    if (argc >= 3) napi_get_value_bool(env, argv[2], &tagged);
+
+    w->out.clear();
+    w->graph.write_delta(w->out, std::string_view(run_id, run_id_len), ts, tagged);
+    return buffer_result(env, w->out);
+}
+
+napi_value patch(napi_env env, napi_callback_info info) {
+    size_t argc = 4;
+    napi_value argv[4];
+    Wrap* w = unwrap(env, info, &argc, argv);
+    if (!w) return nullptr;
+
+    const char* run_id;
+    size_t run_id_len;
+    double since = -1, ts = 0;
+    bool binary = false;
+    if (argc < 3 || !input_bytes(env, argv[0], w->in, run_id, run_id_len) ||
+        napi_get_value_double(env, argv[1], &since) != napi_ok ||
+        napi_get_value_double(env, argv[2], &ts) != napi_ok) {
+        napi_throw_type_error(env, nullptr, "patch expects (runId, sinceSeq, timestampMs[, binary])");
+        return nullptr;
+    }
+    if (argc >= 4) napi_get_value_bool(env, argv[3], &binary);
+
+    std::string_view id(run_id, run_id_len);
+    w->out.clear();
+    if (binary) {
+        w->graph.write_patch_binary(w->out, id, since, ts);
+    } else {
+        w->graph.write_patch(w->out, id, since, ts, true);
+    }
+    return buffer_result(env, w->out);
+}
+
+napi_value changes(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    Wrap* w = unwrap(env, info, &argc, argv);
+    if (!w) return nullptr;
+
+    double since = -1;
+    if (argc < 1 || napi_get_value_double(env, argv[0], &since) != napi_ok) {
+        napi_throw_type_error(env, nullptr, "changes expects (sinceSeq)");
+        return nullptr;
+    }
+
+    w->out.clear();
+    w->graph.write_changes(w->out, since);
+    return buffer_result(env, w->out);
+}
+
+napi_value last_seq(napi_env env, napi_callback_info info) {
+    size_t argc = 0;
+    Wrap* w = unwrap(env, info, &argc, nullptr);
+    if (!w) return nullptr;
+
+    napi_value v;
+    CHECK(napi_create_double(env, w->graph.last_seq(), &v));
+    return v;
+}
+
+napi_value export_state(napi_env env, napi_callback_info info) {
+    size_t argc = 0;
+    Wrap* w = unwrap(env, info, &argc, nullptr);
+    if (!w) return nullptr;
+
+    w->out.clear();
+    w->graph.write_state(w->out);
+    return string_result(env, w->out);
+}
+
+napi_value stats(napi_env env, napi_callback_info info) {
+    size_t argc = 0;
+    Wrap* w = unwrap(env, info, &argc, nullptr);
+    if (!w) return nullptr;
+
+    napi_value obj, last_seq, nodes, edges;
+    CHECK(napi_create_object(env, &obj));
+    CHECK(napi_create_double(env, w->graph.last_seq(), &last_seq));
+    CHECK(napi_create_double(env, (double)w->graph.node_count(), &nodes));
+    CHECK(napi_create_double(env, (double)w->graph.edge_count(), &edges));
+    CHECK(napi_set_named_property(env, obj, "lastSeq", last_seq));
+    CHECK(napi_set_named_property(env, obj, "nodes", nodes));
+    CHECK(napi_set_named_property(env, obj, "edges", edges));
+    return obj;
+}
+
+napi_value last_error(napi_env env, napi_callback_info info) {
+    size_t argc = 0;
+    Wrap* w = unwrap(env, info, &argc, nullptr);
+    if (!w) return nullptr;
+    return string_result(env, w->graph.last_error());
+}
+
+// On failure the graph is left empty
+napi_value restore(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    Wrap* w = unwrap(env, info, &argc, argv);
+    if (!w) return nullptr;
+
+    const char* p;
+    size_t n;
+    if (argc < 1 || !input_bytes(env, argv[0], w->in, p, n)) {
+        napi_throw_type_error(env, nullptr, "restore expects a directory");
+        return nullptr;
+    }
+    std::string dir(p, n);
+
+    napi_value result;
+    if (!TalStore::exists(dir)) {
+        CHECK(napi_get_boolean(env, false, &result));
+        return result;
+    }
+    if (w->graph.node_count() != 0 || w->graph.last_seq() >= 0) {
+        napi_throw_error(env, nullptr, "restore needs an empty graph");
+        return nullptr;
+    }
+
+    TalStore store;
+    auto writer = std::make_unique<TalStoreWriter>();
+    if (!store.open(dir) || !store.load(w->graph)) {
+        w->graph = TalGraph();
+        napi_throw_error(env, nullptr, ("restore: " + store.error()).c_str());
+        return nullptr;
+    }
+    if (!writer->open(dir)) {
+        w->graph = TalGraph();
+        napi_throw_error(env, nullptr, ("restore: " + writer->error()).c_str());
+        return nullptr;
+    }
+    w->store = std::move(writer);
+    w->store_dir = dir;
+
+    CHECK(napi_get_boolean(env, true, &result));
+    return result;
+}
+
+napi_value checkpoint(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    Wrap* w = unwrap(env, info, &argc, argv);
+    if (!w) return nullptr;
+
+    const char* p;
+    size_t n;
+    if (argc < 1 || !input_bytes(env, argv[0], w->in, p, n)) {
+        napi_throw_type_error(env, nullptr, "checkpoint expects a directory");
+        return nullptr;
+    }
+    std::string dir(p, n);
+
+    if (!w->store || w->store_dir != dir) {
+        auto writer = std::make_unique<TalStoreWriter>();
+        if (!writer->open(dir)) {
+            napi_throw_error(env, nullptr, ("checkpoint: " + writer->error()).c_str());
+            return nullptr;
+        }
+        w->store = std::move(writer);
+        w->store_dir = dir;
+    }
+    if (!w->store->checkpoint(w->graph)) {
+        napi_throw_error(env, nullptr, ("checkpoint: " + w->store->error()).c_str());
+        return nullptr;
+    }
+
+    napi_value obj, at_seq, bytes;
+    CHECK(napi_create_object(env, &obj));
+    CHECK(napi_create_double(env, w->store->at_seq(), &at_seq));
+    CHECK(napi_create_double(env, (double)w->store->bytes(), &bytes));
+    CHECK(napi_set_named_property(env, obj, "atSeq", at_seq));
+    CHECK(napi_set_named_property(env, obj, "bytes", bytes));
+    return obj;
+}
+
+void finalize_store(napi_env, void* data, void*) {
+    delete (StoreWrap*)data;
+}
+
+napi_value construct_store(napi_env env, napi_callback_info info) {
+    napi_value self, target;
+    CHECK(napi_get_new_target(env, info, &target));
+    if (!target) {
+        napi_throw_type_error(env, nullptr, "TalStore must be called with new");
+        return nullptr;
+    }
+
+    size_t argc = 1;
+    napi_value argv[1];
+    CHECK(napi_get_cb_info(env, info, &argc, argv, &self, nullptr));
+
+    std::unique_ptr<StoreWrap> w(new StoreWrap());
+    const char* p;
+    size_t n;
+    if (argc < 1 || !input_bytes(env, argv[0], w->in, p, n)) {
+        napi_throw_type_error(env, nullptr, "TalStore expects a directory");
+        return nullptr;
+    }
+    if (!w->store.open(std::string(p, n))) {
+        napi_throw_error(env, nullptr, w->store.error().c_str());
+        return nullptr;
+    }
+
+    if (napi_wrap(env, self, w.get(), finalize_store, nullptr, nullptr) != napi_ok) {
+        napi_throw_error(env, nullptr, "napi_wrap failed");
+        return nullptr;
+    }
+    w.release();
+    CHECK(napi_type_tag_object(env, self, &kStoreTag));
+    return self;
+}
+
+napi_value store_range(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value argv[2];
+    StoreWrap* w = unwrap_store(env, info, &argc, argv);
+    if (!w) return nullptr;
+
+    double from = -1, to = 0;
+    if (argc < 2 || napi_get_value_double(env, argv[0], &from) != napi_ok ||
+        napi_get_value_double(env, argv[1], &to) != napi_ok) {
+        napi_throw_type_error(env, nullptr, "range expects (fromSeq, toSeq)");
+        return nullptr;
+    }
+
+    w->out.clear();
+    w->store.write_range(w->out, from, to);
+    return buffer_result(env, w->out);
+}
+
+napi_value store_subtree(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value argv[2];
+    StoreWrap* w = unwrap_store(env, info, &argc, argv);
+    if (!w) return nullptr;
+
+    const char* p;
+    size_t n;
+    uint32_t depth = 0;
+    if (argc < 2 || !input_bytes(env, argv[0], w->in, p, n) ||
+        napi_get_value_uint32(env, argv[1], &depth) != napi_ok) {
+        napi_throw_type_error(env, nullptr, "subtree expects (rootId, depth)");
+        return nullptr;
+    }
+
+    w->out.clear();
+    if (!w->store.write_subtree(w->out, std::string_view(p, n), depth)) {
+        napi_value null;
+        CHECK(napi_get_null(env, &null));
+        return null;
+    }
+    return buffer_result(env, w->out);
+}
+
+napi_value store_stats(napi_env env, napi_callback_info info) {
+    size_t argc = 0;
+    StoreWrap* w = unwrap_store(env, info, &argc, nullptr);
+    if (!w) return nullptr;
+
+    napi_value obj, at_seq, nodes, edges, bytes;
+    CHECK(napi_create_object(env, &obj));
+    CHECK(napi_create_double(env, w->store.at_seq(), &at_seq));
+    CHECK(napi_create_double(env, (double)w->store.node_count(), &nodes));
+    CHECK(napi_create_double(env, (double)w->store.edge_count(), &edges));
+    CHECK(napi_create_double(env, (double)w->store.bytes(), &bytes));
+    CHECK(napi_set_named_property(env, obj, "atSeq", at_seq));
+    CHECK(napi_set_named_property(env, obj, "nodes", nodes));
+    CHECK(napi_set_named_property(env, obj, "edges", edges));
+    CHECK(napi_set_named_property(env, obj, "bytes", bytes));
+    return obj;
+}
+
+// The named property of an options object, unless it is missing, undefined or null
+bool option(napi_env env, napi_value obj, const char* name, napi_value& out) {
+    bool has = false;
+    napi_valuetype type;
+    return napi_has_named_property(env, obj, name, &has) == napi_ok && has &&
+           napi_get_named_property(env, obj, name, &out) == napi_ok &&
+           napi_typeof(env, out, &type) == napi_ok && type != napi_undefined && type != napi_null;
+}
+
+napi_value store_export_start(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    StoreWrap* w = unwrap_store(env, info, &argc, argv);
+    if (!w) return nullptr;
+
+    napi_valuetype type = napi_undefined;
+    if (argc > 0) napi_typeof(env, argv[0], &type);
+    if (argc > 0 && type != napi_undefined && type != napi_object) {
+        napi_throw_type_error(env, nullptr, "exportStart expects an options object");
+        return nullptr;
+    }
+
+    TalExportOptions opts;
+    const char* p;
+    size_t n;
+    napi_value v;
+    bool ok = true;
+    if (type == napi_object) {
+        napi_value o = argv[0];
+        if (option(env, o, "format", v)) {
+            ok = input_bytes(env, v, w->in, p, n) &&
+                 tal_parse_export_format(std::string_view(p, n), opts.format);
+        }
+        if (ok && option(env, o, "runId", v)) {
+            ok = input_bytes(env, v, w->in, p, n);
+            if (ok) opts.run_id.assign(p, n);
+        }
+        if (ok && option(env, o, "root", v)) {
+            ok = input_bytes(env, v, w->in, p, n);
+            if (ok) opts.root.assign(p, n);
+        }
+        if (ok && option(env, o, "timestampMs", v)) {
+            ok = napi_get_value_double(env, v, &opts.timestamp_ms) == napi_ok;
+        }
+        if (ok && option(env, o, "fromSeq", v)) {
+            ok = napi_get_value_double(env, v, &opts.from_seq) == napi_ok;
+        }
+        if (ok && option(env, o, "toSeq", v)) {
+            ok = napi_get_value_double(env, v, &opts.to_seq) == napi_ok;
+        }
+        if (ok && option(env, o, "depth", v)) {
+            ok = napi_get_value_uint32(env, v, &opts.depth) == napi_ok;
+        }
+        double budget = 0;
+        if (ok && option(env, o, "tokenBudget", v)) {
+            ok = napi_get_value_double(env, v, &budget) == napi_ok && budget >= 0;
+            opts.token_budget = (size_t)budget;
+        }
+    }
+    if (!ok) {
+        napi_throw_type_error(env, nullptr,
+            "exportStart: bad option (format is json, prompt or jsonld; seqs, depth and tokenBudget are numbers)");
+        return nullptr;
+    }
+
+    w->exporter = std::make_unique<TalExporter>(w->store);
+    bool started = w->exporter->start(opts);
+    if (!started) w->exporter.reset();
+
+    napi_value result;
+    CHECK(napi_get_boolean(env, started, &result));
+    return result;
+}
+
+napi_value store_export_next(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value argv[1];
+    StoreWrap* w = unwrap_store(env, info, &argc, argv);
+    if (!w) return nullptr;
+
+    uint32_t max_bytes = 0;
+    if (argc < 1 || napi_get_value_uint32(env, argv[0], &max_bytes) != napi_ok) {
+        napi_throw_type_error(env, nullptr, "exportNext expects (maxBytes)");
+        return nullptr;
+    }
+
+    w->out.clear();
+    if (!w->exporter || !w->exporter->next(w->out, max_bytes)) {
+        w->exporter.reset();
+        napi_value null;
+        CHECK(napi_get_null(env, &null));
+        return null;
+    }
+    return buffer_result(env, w->out);
+}
+
+// Unmaps now rather than at garbage collection
+napi_value store_close(napi_env env, napi_callback_info info) {
+    size_t argc = 0;
+    StoreWrap* w = unwrap_store(env, info, &argc, nullptr);
+    if (!w) return nullptr;
+    w->exporter.reset();
+    w->store.close();
+    return nullptr;
+}
+
+napi_value init(napi_env env, napi_value exports) {
+    napi_property_descriptor methods[] = {
+        {"apply", nullptr, apply, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"applyBatch", nullptr, apply_batch, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"applyLines", nullptr, apply_lines, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"delta", nullptr, delta, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"patch", nullptr, patch, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"changes", nullptr, changes, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"lastSeq", nullptr, last_seq, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"exportState", nullptr, export_state, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"stats", nullptr, stats, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"lastError", nullptr, last_error, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"restore", nullptr, restore, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"checkpoint", nullptr, checkpoint, nullptr, nullptr, nullptr, napi_default, nullptr},
+    };
+
+    napi_value cls;
+    CHECK(napi_define_class(env, "TalGraph", NAPI_AUTO_LENGTH, construct, nullptr,
+                            sizeof(methods) / sizeof(methods[0]), methods, &cls));
+    CHECK(napi_set_named_property(env, exports, "TalGraph", cls));
+
+    napi_property_descriptor store_methods[] = {
+        {"range", nullptr, store_range, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"subtree", nullptr, store_subtree, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"stats", nullptr, store_stats, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"exportStart", nullptr, store_export_start, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"exportNext", nullptr, store_export_next, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"close", nullptr, store_close, nullptr, nullptr, nullptr, napi_default, nullptr},
+    };
+
+    CHECK(napi_define_class(env, "TalStore", NAPI_AUTO_LENGTH, construct_store, nullptr,
+                            sizeof(store_methods) / sizeof(store_methods[0]), store_methods, &cls));
+    CHECK(napi_set_named_property(env, exports, "TalStore", cls));
+    return exports;
+}
+
+} // namespace
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, init)
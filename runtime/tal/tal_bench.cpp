@@ -0,0 +1,214 @@
+#include "tal_export.h"
+#include "tal_graph.h"
+#include "tal_store.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+// Generates a call-heavy TAL stream (nested call_start/call_end pairs with
+// I/O and db events) as NDJSON and measures ingest and delta throughput.
+//
+//   tal_bench [events] [delta_every]
+//
+// Also compares a JSON state export with a checkpoint of the graph store
+// and a reload from it, and streams the LLM exports (tal_export.h) from the
+// store.
+
+static std::string make_events(long count) {
+    std::string out;
+    out.reserve((size_t)count * 160);
+
+    long seq = 0;
+    long span = 0;
+    const double t0 = 1.7e12;
+
+    auto next_span = [&span]() {
+        std::string s = "s";
+        s += std::to_string(span++);
+        return s;
+    };
+
+    auto emit = [&](const char* kind, const std::string& s, const std::string& parent,
+                    const char* key, const char* data) {
+        out += "{\"runId\":\"bench\",\"seq\":";
+        out += std::to_string(seq);
+        out += ",\"ts\":";
+        out += std::to_string((long)t0 + seq);
+        out += ",\"kind\":\"";
+        out += kind;
+        out += '"';
+        if (!s.empty()) {
+            out += ",\"span\":\"";
+            out += s;
+            out += '"';
+        }
+        if (!parent.empty()) {
+            out += ",\"parentSpan\":\"";
+            out += parent;
+            out += '"';
+        }
+        if (key) {
+            out += ",\"nodeKey\":\"";
+            out += key;
+            out += '"';
+        }
+        if (data) {
+            out += ",\"data\":";
+            out += data;
+        }
+        out += "}\n";
+        ++seq;
+    };
+
+    while (seq < count) {
+        std::string root = next_span();
+        emit("call_start", root, "", nullptr, "{\"fn\":\"handler\",\"args\":[1,2,3]}");
+
+        for (int i = 0; i < 4 && seq < count; ++i) {
+            std::string child = next_span();
+            emit("call_start", child, root, nullptr, "{\"fn\":\"step\",\"file\":\"src/app.ts\",\"line\":42}");
+            emit("fs_read", "", child, nullptr, "{\"path\":\"/tmp/data.json\",\"bytes\":4096}");
+            emit("query", "", child, nullptr, "{\"db.system\":\"postgresql\",\"db.statement\":\"SELECT 1\"}");
+            emit("call_end", child, root, nullptr, i == 3 ? "{\"status\":\"ERROR\"}" : "{\"ret\":\"ok\"}");
+        }
+        emit("call_end", root, "", nullptr, "{\"status\":\"OK\"}");
+    }
+    return out;
+}
+
+int main(int argc, char** argv) {
+    long events = argc > 1 ? std::atol(argv[1]) : 1000000;
+    long delta_every = argc > 2 ? std::atol(argv[2]) : 0;
+
+    std::string input = make_events(events);
+
+    using clock = std::chrono::steady_clock;
+    auto t0 = clock::now();
+
+    TalGraph graph;
+    std::string delta;
+    size_t delta_bytes = 0, patch_bytes = 0, binary_bytes = 0;
+    size_t applied = 0;
+
+    if (delta_every > 0) {
+        // Apply in batches with a delta after each, as the pipeline did, and
+        // the patches since the previous batch it publishes now
+        double since = -1;
+        const char* p = input.data();
+        const char* end = p + input.size();
+        while (p < end) {
+            const char* q = p;
+            for (long i = 0; i < delta_every && q < end; ++i) {
+                const char* nl = (const char*)std::memchr(q, '\n', (size_t)(end - q));
+                q = nl ? nl + 1 : end;
+            }
+            applied += graph.apply_lines(p, (size_t)(q - p));
+            delta.clear();
+            graph.write_delta(delta, "bench", 0, true);
+            delta_bytes += delta.size();
+            delta.clear();
+            graph.write_patch(delta, "bench", since, 0, true);
+            patch_bytes += delta.size();
+            delta.clear();
+            graph.write_patch_binary(delta, "bench", since, 0);
+            binary_bytes += delta.size();
+            since = graph.last_seq();
+            p = q;
+        }
+    } else {
+        applied = graph.apply_lines(input.data(), input.size());
+    }
+    auto t1 = clock::now();
+
+    delta.clear();
+    graph.write_delta(delta, "bench", 0, true);
+    auto t2 = clock::now();
+
+    std::string state;
+    graph.write_state(state);
+    auto t3 = clock::now();
+
+    char dir[] = "/tmp/tal_bench.XXXXXX";
+    bool stored = false;
+    double checkpoint_s = 0, reload_s = 0;
+    uint64_t store_bytes = 0;
+
+    struct ExportRun {
+        const char* name;
+        TalExportFormat format;
+        size_t budget;
+        double first_s = 0, total_s = 0;
+        size_t bytes = 0;
+    };
+    ExportRun exports[] = {
+        {"json", TalExportFormat::Json, 0},
+        {"prompt", TalExportFormat::Prompt, 0},
+        {"json/8k", TalExportFormat::Json, 8000},
+    };
+
+    if (::mkdtemp(dir)) {
+        TalStoreWriter writer;
+        TalStore store;
+        TalGraph reloaded;
+        auto c0 = clock::now();
+        stored = writer.open(dir) && writer.checkpoint(graph);
+        auto c1 = clock::now();
+        stored = stored && store.open(dir) && store.load(reloaded);
+        auto c2 = clock::now();
+        if (!stored) std::fprintf(stderr, "store: %s%s\n", writer.error().c_str(), store.error().c_str());
+
+        checkpoint_s = std::chrono::duration<double>(c1 - c0).count();
+        reload_s = std::chrono::duration<double>(c2 - c1).count();
+        store_bytes = writer.bytes();
+
+        // 64 KB chunks, as the API server writes them
+        for (ExportRun& run : exports) {
+            if (!stored) break;
+            TalExportOptions opts;
+            opts.format = run.format;
+            opts.run_id = "bench";
+            opts.token_budget = run.budget;
+
+            std::string chunk;
+            TalExporter exporter(store);
+            auto e0 = clock::now();
+            exporter.start(opts);
+            for (bool first = true; exporter.next(chunk, 64 * 1024); first = false) {
+                if (first) run.first_s = std::chrono::duration<double>(clock::now() - e0).count();
+                run.bytes += chunk.size();
+                chunk.clear();
+            }
+            run.total_s = std::chrono::duration<double>(clock::now() - e0).count();
+        }
+        ::unlink((std::string(dir) + "/checkpoint").c_str());
+        ::unlink((std::string(dir) + "/seg-000000.kts").c_str());
+        ::rmdir(dir);
+    }
+
+    double ingest_s = std::chrono::duration<double>(t1 - t0).count();
+    double delta_s = std::chrono::duration<double>(t2 - t1).count();
+    double state_s = std::chrono::duration<double>(t3 - t2).count();
+
+    std::printf("events       %zu applied of %ld (%.1f MB)\n", applied, events, input.size() / 1e6);
+    std::printf("graph        %zu nodes, %zu edges\n", graph.node_count(), graph.edge_count());
+    std::printf("ingest       %.3f s, %.0f events/s, %.1f MB/s\n", ingest_s, applied / ingest_s,
+                input.size() / 1e6 / ingest_s);
+    if (delta_every > 0) {
+        std::printf("deltas       every %ld events, %.1f MB serialized\n", delta_every, delta_bytes / 1e6);
+        std::printf("patches      %.1f MB JSON, %.1f MB binary\n", patch_bytes / 1e6, binary_bytes / 1e6);
+    }
+    std::printf("final delta  %.1f MB in %.3f s\n", delta.size() / 1e6, delta_s);
+    std::printf("state JSON   %.1f MB in %.3f s\n", state.size() / 1e6, state_s);
+    if (stored) {
+        std::printf("store        %.1f MB checkpoint in %.3f s, reload in %.3f s\n",
+                    store_bytes / 1e6, checkpoint_s, reload_s);
+        for (const ExportRun& run : exports) {
+            std::printf("export %-7s %.1f MB in %.3f s, first chunk after %.3f s\n", run.name,
+                        run.bytes / 1e6, run.total_s, run.first_s);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,922 @@
+#include "tal_export.h"
+#include "tal_json.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+
+static constexpr uint32_t kNone = UINT32_MAX;
+
+// TalGraph's codes for the statuses and the node type the export singles out
+static constexpr uint8_t kRunning = 0, kCompleted = 1, kError = 2;
+static constexpr uint8_t kErrorType = 7;
+
+static constexpr size_t kHotspots = 10;
+static constexpr size_t kPromptTimeline = 50;   // as llm_export.ts lists
+
+// Summarized exports: bytes per token, and rough sizes of the head, of a
+// timeline entry and of a call in the call tree
+static constexpr size_t kTokenBytes = 4;
+static constexpr size_t kHeadBytes = 1024;
+static constexpr size_t kJsonEntryBytes = 140, kPromptEntryBytes = 90;
+static constexpr size_t kJsonCallBytes = 160, kPromptCallBytes = 24;
+
+bool tal_parse_export_format(std::string_view name, TalExportFormat& out) {
+    if (name == "json") {
+        out = TalExportFormat::Json;
+    } else if (name == "prompt") {
+        out = TalExportFormat::Prompt;
+    } else if (name == "jsonld") {
+        out = TalExportFormat::JsonLd;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static uint64_t mix(uint64_t h, uint64_t v) {
+    v += 0x9e3779b97f4a7c15ull;
+    v = (v ^ (v >> 30)) * 0xbf58476d1ce4e5b9ull;
+    v = (v ^ (v >> 27)) * 0x94d049bb133111ebull;
+    v ^= v >> 31;
+    return ((h << 5) | (h >> 59)) ^ v;
+}
+
+// What llm_export.ts quotes from an error node's data: the first truthy
+// exception.message, error or statusMessage, and exception.stacktrace
+struct ErrorFields {
+    std::string_view message, stack;
+};
+
+static ErrorFields error_fields(std::string_view data, std::string& scratch) {
+    std::string_view candidates[3];
+    ErrorFields f;
+    json_for_each_member(data, scratch, [&](std::string_view key, std::string_view value) {
+        if (key == "exception.message") candidates[0] = value;
+        else if (key == "error") candidates[1] = value;
+        else if (key == "statusMessage") candidates[2] = value;
+        else if (key == "exception.stacktrace") f.stack = value;
+    });
+    for (std::string_view c : candidates) {
+        if (json_truthy(c)) {
+            f.message = c;
+            break;
+        }
+    }
+    return f;
+}
+
+// A raw JSON value as a template literal shows it: strings decoded,
+// anything else as written
+static void write_text(std::string& out, std::string_view raw, std::string& scratch) {
+    if (raw.size() >= 2 && raw.front() == '"') {
+        json_unescape(raw.substr(1, raw.size() - 2), scratch);
+        out += scratch;
+    } else {
+        out += raw;
+    }
+}
+
+// Date#toISOString() of a millisecond timestamp
+static void write_iso_time(std::string& out, double ms) {
+    if (!std::isfinite(ms)) {
+        out += "Invalid Date";
+        return;
+    }
+    int64_t t = (int64_t)std::trunc(ms);
+    int64_t secs = t / 1000, frac = t % 1000;
+    if (frac < 0) {
+        frac += 1000;
+        --secs;
+    }
+
+    time_t s = (time_t)secs;
+    struct tm tm;
+    char buf[48];
+    ::gmtime_r(&s, &tm);
+    std::snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", tm.tm_year + 1900,
+                  tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, (int)frac);
+    out += buf;
+}
+
+// The timeline only lists an end for a truthy endedAt
+static bool ends(const TalNodeRecord& rec) {
+    return rec.ended && rec.ended_at != 0 && !std::isnan(rec.ended_at);
+}
+
+bool TalExporter::start(const TalExportOptions& opts) {
+    m_opts = opts;
+
+    plan_slice();
+    if (!m_error.empty()) return false;
+    plan_stats();
+    if (summarized()) plan_budget();
+
+    m_sections = {Section::Head};
+    if (json()) {
+        m_sections.insert(m_sections.end(), {Section::Tree, Section::Errors, Section::Timeline});
+        if (!summarized()) m_sections.insert(m_sections.end(), {Section::Nodes, Section::Edges});
+        m_sections.push_back(Section::Tail);
+    } else {
+        m_sections.insert(m_sections.end(), {Section::Errors, Section::Tree, Section::Timeline});
+    }
+    return true;
+}
+
+void TalExporter::plan_slice() {
+    const uint32_t nodes = (uint32_t)m_store.node_count();
+    const uint32_t edges = (uint32_t)m_store.edge_count();
+
+    TalNodeRecord rec;
+    m_in.assign(nodes, false);
+    for (uint32_t n = 0; n < nodes; ++n) {
+        m_in[n] = m_store.node(n, rec) && rec.seq > m_opts.from_seq && rec.seq <= m_opts.to_seq;
+    }
+
+    // Calls within the seq slice, per caller in edge order
+    TalEdgeRecord e;
+    std::vector<uint32_t> first(nodes + 1, 0);
+    std::vector<bool> called(nodes);
+    for (uint32_t i = 0; i < edges; ++i) {
+        if (!m_store.edge(i, e) || !m_in[e.from] || !m_in[e.to]) continue;
+        first[e.from + 1]++;
+        called[e.to] = true;
+    }
+    for (uint32_t n = 0; n < nodes; ++n) first[n + 1] += first[n];
+
+    std::vector<uint32_t> callee(first[nodes]);
+    {
+        std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+        for (uint32_t i = 0; i < edges; ++i) {
+            if (m_store.edge(i, e) && m_in[e.from] && m_in[e.to]) callee[fill[e.from]++] = e.to;
+        }
+    }
+
+    std::vector<uint32_t> roots;
+    if (!m_opts.root.empty()) {
+        uint32_t root = m_store.find_node(m_opts.root);
+        if (root == kNone || !m_in[root]) {
+            m_error = "no node " + m_opts.root + " in the slice";
+            return;
+        }
+        roots.push_back(root);
+    } else {
+        for (uint32_t n = 0; n < nodes; ++n) {
+            if (m_in[n] && !called[n]) roots.push_back(n);
+        }
+    }
+    std::vector<bool>().swap(called);
+
+    // Depth-first, listing each node once
+    struct Frame {
+        uint32_t node, next, pre;
+    };
+    std::vector<Frame> stack;
+    std::vector<bool> seen(nodes);
+    const bool limited = m_opts.depth != UINT32_MAX;
+
+    auto enter = [&](uint32_t n, uint32_t level) {
+        seen[n] = true;
+        stack.push_back(Frame{n, first[n], (uint32_t)m_order.size()});
+        m_order.push_back(n);
+        m_end.push_back(0);
+        m_level.push_back(level);
+        if (limited) m_cut.push_back(0);
+    };
+
+    auto walk = [&](uint32_t root) {
+        enter(root, 0);
+        while (!stack.empty()) {
+            Frame& f = stack.back();
+            const uint32_t level = (uint32_t)stack.size() - 1;
+            if (level >= m_opts.depth && f.next < first[f.node + 1]) {
+                m_cut[f.pre] = first[f.node + 1] - f.next;
+                f.next = first[f.node + 1];
+            }
+            if (f.next == first[f.node + 1]) {
+                m_end[f.pre] = (uint32_t)m_order.size();
+                stack.pop_back();
+                continue;
+            }
+            uint32_t c = callee[f.next++];
+            if (!seen[c]) enter(c, level + 1);
+        }
+    };
+
+    for (uint32_t r : roots) walk(r);
+
+    // Without a root or depth limit, cycles nothing calls into are walked too
+    if (m_opts.root.empty() && !limited) {
+        for (uint32_t n = 0; n < nodes; ++n) {
+            if (m_in[n] && !seen[n]) walk(n);
+        }
+    }
+
+    m_in = std::move(seen);
+    m_count = (uint32_t)m_order.size();
+}
+
+void TalExporter::plan_stats() {
+    m_min_start = INFINITY;
+    m_max_end = 0;
+    m_timeline_cap = json() ? SIZE_MAX : kPromptTimeline;
+
+    TalNodeRecord rec;
+    for (uint32_t n = 0; n < m_in.size(); ++n) {
+        if (!m_in[n] || !m_store.node(n, rec)) continue;
+
+        m_statuses[rec.status]++;
+        if (m_types[rec.type]++ == 0) m_type_order[m_type_count++] = rec.type;
+
+        if (rec.started_at < m_min_start) m_min_start = rec.started_at;
+        if (ends(rec) && rec.ended_at > m_max_end) m_max_end = rec.ended_at;
+        m_timeline_total += ends(rec) ? 2 : 1;
+
+        // Slowest first, ties in node order
+        const double duration = rec.ended_at - rec.started_at;
+        if (rec.ended && duration > 0) {
+            auto at = std::upper_bound(m_hotspots.begin(), m_hotspots.end(), duration,
+                [](double d, const std::pair<double, uint32_t>& h) { return d > h.first; });
+            if ((size_t)(at - m_hotspots.begin()) < kHotspots) {
+                m_hotspots.insert(at, {duration, n});
+                if (m_hotspots.size() > kHotspots) m_hotspots.pop_back();
+            }
+        }
+
+        if (rec.status == kError || rec.type == kErrorType) m_errors.push_back(n);
+    }
+    m_error_total = (uint32_t)m_errors.size();
+}
+
+void TalExporter::plan_budget() {
+    size_t budget = m_opts.token_budget * kTokenBytes;
+    budget = budget > kHeadBytes ? budget - kHeadBytes : 0;
+
+    // Errors get up to a quarter of the budget and the timeline an eighth,
+    // the call tree whatever they leave
+    TalNodeRecord rec;
+    size_t used = 0, keep = 0;
+    for (uint32_t n : m_errors) {
+        m_store.node(n, rec);
+        ErrorFields f = error_fields(rec.data, m_scratch);
+        size_t cost = 80 + 2 * m_store.str(rec.label).size() + f.message.size() + f.stack.size();
+        if (used + cost > budget / 4) break;
+        used += cost;
+        ++keep;
+    }
+    m_errors.resize(keep);
+
+    const size_t entry = json() ? kJsonEntryBytes : kPromptEntryBytes;
+    m_timeline_cap = std::min(m_timeline_cap, budget / 8 / entry);
+    used += std::min<uint64_t>(m_timeline_cap, m_timeline_total) * entry;
+    const size_t tree_budget = budget > used ? budget - used : 0;
+
+    // Shapes bottom-up: each child's is final before its parent's
+    const uint32_t size = (uint32_t)m_order.size();
+    std::vector<uint64_t> shape(size);
+    std::vector<std::pair<uint64_t, uint32_t>> group;
+    m_repeat.assign(size, 1);
+
+    // Lists each shape among the siblings in [from, to) once, under its first
+    // occurrence, and folds the distinct shapes into h in order
+    auto fold = [&](uint32_t from, uint32_t to, uint64_t h) {
+        group.clear();
+        for (uint32_t j = from; j < to; j = m_end[j]) group.emplace_back(shape[j], j);
+        std::sort(group.begin(), group.end());
+        for (size_t k = 1, run = 0; k < group.size(); ++k) {
+            if (group[k].first != group[run].first) {
+                run = k;
+                continue;
+            }
+            m_repeat[group[run].second]++;
+            m_repeat[group[k].second] = 0;
+        }
+        for (uint32_t j = from; j < to; j = m_end[j]) {
+            if (m_repeat[j]) h = mix(h, shape[j]);
+        }
+        return h;
+    };
+
+    for (uint32_t i = size; i-- > 0;) {
+        m_store.node(m_order[i], rec);
+        shape[i] = fold(i + 1, m_end[i], mix(mix(0, rec.label), (uint64_t)rec.type << 8 | rec.status));
+    }
+    fold(0, size, 0);
+    std::vector<uint64_t>().swap(shape);
+
+    auto cost = [&](uint32_t i) {
+        m_store.node(m_order[i], rec);
+        size_t label = m_store.str(rec.label).size();
+        return json() ? kJsonCallBytes + label : kPromptCallBytes + label + 2 * m_level[i];
+    };
+
+    std::vector<size_t> level_bytes;
+    for (uint32_t i = 0; i < size;) {
+        if (m_repeat[i] == 0) {
+            i = m_end[i];
+            continue;
+        }
+        if (level_bytes.size() <= m_level[i]) level_bytes.resize(m_level[i] + 1);
+        level_bytes[m_level[i]] += cost(i);
+        ++i;
+    }
+
+    // The deepest level that fits with everything above it; when not even
+    // the roots fit, as many roots as do (at least one)
+    m_show_depth = 0;
+    size_t total = 0;
+    for (size_t l = 0; l < level_bytes.size() && total + level_bytes[l] <= tree_budget; ++l) {
+        total += level_bytes[l];
+        m_show_depth = (uint32_t)l;
+    }
+    if (!level_bytes.empty() && level_bytes[0] > tree_budget) {
+        m_show_roots = 0;
+        total = 0;
+        for (uint32_t i = 0; i < size; i = m_end[i]) {
+            if (m_repeat[i] == 0) continue;
+            size_t c = cost(i);
+            if (total + c > tree_budget && m_show_roots > 0) break;
+            total += c;
+            ++m_show_roots;
+        }
+    }
+
+    uint32_t roots = 0;
+    for (uint32_t i = 0; i < size;) {
+        if (m_repeat[i] == 0) {
+            m_aggregated += m_end[i] - i;
+            i = m_end[i];
+        } else if (m_level[i] > m_show_depth) {
+            m_collapsed += m_end[i] - i;
+            i = m_end[i];
+        } else if (m_level[i] == 0 && roots++ == m_show_roots) {
+            m_collapsed += size - i;
+            break;
+        } else {
+            ++m_shown;
+            ++i;
+        }
+    }
+}
+
+void TalExporter::plan_timeline() {
+    // The stable sort of llm_export.ts: ties keep node order, start first
+    auto before = [](const Entry& a, const Entry& b) {
+        if (a.ts != b.ts) return a.ts < b.ts;
+        return a.node != b.node ? a.node < b.node : a.end < b.end;
+    };
+
+    // A capped timeline keeps only the earliest entries, in a max-heap
+    const bool capped = m_timeline_cap < m_timeline_total;
+    if (!capped) m_entries.reserve(m_timeline_total);
+    auto add = [&](const Entry& e) {
+        if (!capped) {
+            m_entries.push_back(e);
+        } else if (m_entries.size() < m_timeline_cap) {
+            m_entries.push_back(e);
+            std::push_heap(m_entries.begin(), m_entries.end(), before);
+        } else if (before(e, m_entries.front())) {
+            std::pop_heap(m_entries.begin(), m_entries.end(), before);
+            m_entries.back() = e;
+            std::push_heap(m_entries.begin(), m_entries.end(), before);
+        }
+    };
+
+    TalNodeRecord rec;
+    for (uint32_t n = 0; n < m_in.size() && m_timeline_cap > 0; ++n) {
+        if (!m_in[n] || !m_store.node(n, rec)) continue;
+        add(Entry{rec.started_at, n, 0});
+        if (ends(rec)) add(Entry{rec.ended_at, n, 1});
+    }
+
+    if (capped) {
+        std::sort_heap(m_entries.begin(), m_entries.end(), before);
+    } else {
+        std::sort(m_entries.begin(), m_entries.end(), before);
+    }
+}
+
+bool TalExporter::next(std::string& out, size_t chunk_bytes) {
+    const size_t before = out.size();
+    while (m_section < m_sections.size()) {
+        if (out.size() - before >= chunk_bytes) return true;
+
+        const Section s = m_sections[m_section];
+        if (!m_begun) {
+            m_begun = true;
+            m_pos = 0;
+            m_comma = false;
+            begin(s, out);
+        } else if (!step(s, out)) {
+            finish(s, out);
+            m_begun = false;
+            ++m_section;
+        }
+    }
+    return out.size() > before;
+}
+
+void TalExporter::begin(Section s, std::string& out) {
+    switch (s) {
+    case Section::Head:
+        write_head(out);
+        break;
+    case Section::Errors:
+        if (json()) {
+            out += ",\"errors\":[";
+        } else if (m_error_total > 0) {
+            out += "## Errors\n";
+        }
+        break;
+    case Section::Tree:
+        out += json() ? "\"callTree\":[" : "## Call Tree\n";
+        break;
+    case Section::Timeline:
+        plan_timeline();
+        if (json()) {
+            out += ",\"timeline\":[";
+        } else {
+            out += "## Timeline (first ";
+            out += std::to_string(std::min(m_timeline_cap, kPromptTimeline));
+            out += " events)\n";
+        }
+        break;
+    case Section::Nodes:
+        out += ",\"graph\":{\"nodes\":[";
+        break;
+    case Section::Edges:
+        out += ",\"edges\":[";
+        break;
+    case Section::Tail:
+        out += '}';
+        break;
+    }
+}
+
+bool TalExporter::step(Section s, std::string& out) {
+    switch (s) {
+    case Section::Errors:
+        if (m_pos >= m_errors.size()) return false;
+        write_error(out, m_errors[m_pos++]);
+        return true;
+    case Section::Tree:
+        return write_tree(out);
+    case Section::Timeline:
+        if (m_pos >= m_entries.size()) return false;
+        write_entry(out, m_entries[m_pos++]);
+        return true;
+    case Section::Nodes:
+        while (m_pos < m_in.size() && !m_in[m_pos]) ++m_pos;
+        if (m_pos >= m_in.size()) return false;
+        write_node(out, (uint32_t)m_pos++);
+        return true;
+    case Section::Edges: {
+        TalEdgeRecord e;
+        while (m_pos < m_store.edge_count()) {
+            if (!m_store.edge((uint32_t)m_pos++, e) || !m_in[e.from] || !m_in[e.to]) continue;
+            write_edge(out, e);
+            return true;
+        }
+        return false;
+    }
+    default:
+        return false;
+    }
+}
+
+void TalExporter::finish(Section s, std::string& out) {
+    switch (s) {
+    case Section::Errors:
+        if (json()) {
+            out += ']';
+        } else if (m_error_total > m_errors.size()) {
+            out += "... and ";
+            out += std::to_string(m_error_total - m_errors.size());
+            out += " more errors\n\n";
+        }
+        std::vector<uint32_t>().swap(m_errors);
+        break;
+    case Section::Tree:
+        out += json() ? "]" : "\n";
+        // Neither the timeline nor the graph section needs the tree
+        std::vector<uint32_t>().swap(m_order);
+        std::vector<uint32_t>().swap(m_end);
+        std::vector<uint32_t>().swap(m_level);
+        std::vector<uint32_t>().swap(m_cut);
+        std::vector<uint32_t>().swap(m_repeat);
+        std::vector<uint32_t>().swap(m_open);
+        break;
+    case Section::Timeline:
+        if (json()) {
+            out += ']';
+        } else if (m_timeline_total > m_entries.size()) {
+            out += "... and ";
+            out += std::to_string(m_timeline_total - m_entries.size());
+            out += " more events\n";
+        }
+        std::vector<Entry>().swap(m_entries);
+        break;
+    case Section::Nodes:
+        out += ']';
+        break;
+    case Section::Edges:
+        out += "]}";
+        break;
+    default:
+        break;
+    }
+}
+
+void TalExporter::write_head(std::string& out) {
+    const double total = m_max_end > m_min_start ? m_max_end - m_min_start : NAN;
+    const char* status = m_statuses[kError] ? "error" : m_statuses[kRunning] ? "running" : "completed";
+
+    auto percentage = [&](double d) {
+        return std::isnan(total) || total == 0 ? 0.0 : std::floor(d / total * 100 + 0.5);
+    };
+
+    if (!json()) {
+        out += "# Execution Trace\n\nRun ID: ";
+        out += m_opts.run_id;
+        out += "\nStatus: ";
+        out += status;
+        if (!std::isnan(total) && total != 0) {
+            out += "\nTotal Duration: ";
+            json_write_number(out, total);
+            out += "ms";
+        }
+        out += "\n\n## Summary\n- Total Calls: ";
+        out += std::to_string(m_count);
+        out += "\n- Completed: ";
+        out += std::to_string(m_statuses[kCompleted]);
+        out += "\n- Errors: ";
+        out += std::to_string(m_statuses[kError]);
+        out += "\n- Running: ";
+        out += std::to_string(m_statuses[kRunning]);
+        out += "\n\n### Call Types\n";
+        for (uint32_t i = 0; i < m_type_count; ++i) {
+            out += "- ";
+            out += tal_node_type_name(m_type_order[i]);
+            out += ": ";
+            out += std::to_string(m_types[m_type_order[i]]);
+            out += '\n';
+        }
+        out += '\n';
+
+        TalNodeRecord rec;
+        if (!m_hotspots.empty()) {
+            out += "### Performance Hotspots\n";
+            for (const auto& [duration, n] : m_hotspots) {
+                m_store.node(n, rec);
+                out += "- ";
+                out += m_store.str(rec.label);
+                out += ": ";
+                json_write_number(out, duration);
+                out += "ms (";
+                json_write_number(out, percentage(duration));
+                out += "%)\n";
+            }
+            out += '\n';
+        }
+
+        if (summarized()) {
+            out += "## Summarization\nCondensed to about ";
+            out += std::to_string(m_opts.token_budget);
+            out += " tokens: ";
+            out += std::to_string(m_shown);
+            out += " calls shown down to depth ";
+            out += std::to_string(m_show_depth);
+            out += ", ";
+            out += std::to_string(m_aggregated);
+            out += " repeated calls folded into their first occurrence, ";
+            out += std::to_string(m_collapsed);
+            out += " further calls collapsed.\n\n";
+        }
+        return;
+    }
+
+    out += '{';
+    if (m_opts.format == TalExportFormat::JsonLd) {
+        out += "\"@context\":{\"@vocab\":\"https://kyntrix.io/schema/\","
+               "\"xsd\":\"http://www.w3.org/2001/XMLSchema#\","
+               "\"startedAt\":{\"@type\":\"xsd:dateTime\"},"
+               "\"endedAt\":{\"@type\":\"xsd:dateTime\"},"
+               "\"duration\":{\"@type\":\"xsd:integer\"}},"
+               "\"@type\":\"ExecutionTrace\",\"@id\":\"urn:kyntrix:run:";
+        json_write_escaped(out, m_opts.run_id);
+        out += "\",";
+    }
+
+    out += "\"meta\":{\"runId\":";
+    json_write_string(out, m_opts.run_id);
+    out += ",\"timestamp\":";
+    json_write_number(out, m_opts.timestamp_ms);
+    out += ",\"totalDuration\":";
+    json_write_number(out, total);
+    out += ",\"status\":\"";
+    out += status;
+    out += "\"},\"summary\":{\"totalCalls\":";
+    json_write_number(out, m_count);
+    out += ",\"completedCalls\":";
+    json_write_number(out, m_statuses[kCompleted]);
+    out += ",\"errorCalls\":";
+    json_write_number(out, m_statuses[kError]);
+    out += ",\"pendingCalls\":";
+    json_write_number(out, m_statuses[kRunning]);
+    out += ",\"callsByType\":{";
+    for (uint32_t i = 0; i < m_type_count; ++i) {
+        if (i) out += ',';
+        out += '"';
+        out += tal_node_type_name(m_type_order[i]);
+        out += "\":";
+        json_write_number(out, m_types[m_type_order[i]]);
+    }
+
+    out += "},\"hotspots\":[";
+    TalNodeRecord rec;
+    for (size_t i = 0; i < m_hotspots.size(); ++i) {
+        m_store.node(m_hotspots[i].second, rec);
+        out += i ? ",{\"label\":" : "{\"label\":";
+        json_write_string(out, m_store.str(rec.label));
+        out += ",\"duration\":";
+        json_write_number(out, m_hotspots[i].first);
+        out += ",\"percentage\":";
+        json_write_number(out, percentage(m_hotspots[i].first));
+        out += '}';
+    }
+    out += "]},";
+
+    if (summarized()) {
+        out += "\"summarized\":{\"tokenBudget\":";
+        json_write_number(out, (double)m_opts.token_budget);
+        out += ",\"depth\":";
+        json_write_number(out, m_show_depth);
+        out += ",\"shownCalls\":";
+        json_write_number(out, m_shown);
+        out += ",\"aggregatedCalls\":";
+        json_write_number(out, m_aggregated);
+        out += ",\"collapsedCalls\":";
+        json_write_number(out, m_collapsed);
+        out += ",\"shownErrors\":";
+        json_write_number(out, (double)m_errors.size());
+        out += ",\"shownTimeline\":";
+        json_write_number(out, (double)std::min<uint64_t>(m_timeline_cap, m_timeline_total));
+        out += "},";
+    }
+}
+
+void TalExporter::write_error(std::string& out, uint32_t n) {
+    TalNodeRecord rec;
+    m_store.node(n, rec);
+    ErrorFields f = error_fields(rec.data, m_scratch);
+
+    if (!json()) {
+        out += "### Error in ";
+        out += m_store.str(rec.label);
+        out += '\n';
+        if (!f.message.empty()) {
+            out += "Message: ";
+            write_text(out, f.message, m_scratch);
+            out += '\n';
+        }
+        if (!f.stack.empty()) {
+            out += "Stack trace:\n```\n";
+            write_text(out, f.stack, m_scratch);
+            out += "\n```\n";
+        }
+        out += '\n';
+        return;
+    }
+
+    if (m_comma) out += ',';
+    m_comma = true;
+    out += "{\"nodeId\":";
+    m_store.write_id(out, rec.id);
+    out += ",\"nodeName\":";
+    json_write_string(out, m_store.str(rec.label));
+    out += ",\"timestamp\":";
+    json_write_number(out, rec.started_at);
+    if (!f.message.empty()) {
+        out += ",\"message\":";
+        out += f.message;
+    }
+    if (!f.stack.empty()) {
+        out += ",\"stack\":";
+        out += f.stack;
+    }
+    if (!summarized()) {
+        out += ",\"context\":";
+        out += rec.data;
+    }
+    out += '}';
+}
+
+uint32_t TalExporter::collapsed(uint32_t i) const {
+    uint32_t n = m_cut.empty() ? 0 : m_cut[i];
+    if (!m_repeat.empty() && m_level[i] == m_show_depth) n += m_end[i] - i - 1;
+    return n;
+}
+
+// Opens the next call the export lists, closing the JSON calls whose
+// subtrees it has passed
+bool TalExporter::write_tree(std::string& out) {
+    const size_t size = m_order.size();
+    while (m_pos < size && !m_repeat.empty()) {
+        const uint32_t i = (uint32_t)m_pos;
+        if (m_repeat[i] == 0 || m_level[i] > m_show_depth) {
+            m_pos = m_end[i];
+            continue;
+        }
+        if (m_level[i] == 0 && m_roots == m_show_roots) m_pos = size;
+        break;
+    }
+
+    while (!m_open.empty() && (m_pos >= size || m_end[m_open.back()] <= m_pos)) {
+        close_call(out, m_open.back());
+        m_open.pop_back();
+    }
+    if (m_pos >= size) return false;
+
+    if (m_level[m_pos] == 0) ++m_roots;
+    open_call(out, (uint32_t)m_pos++);
+    return true;
+}
+
+void TalExporter::open_call(std::string& out, uint32_t i) {
+    const uint32_t n = m_order[i];
+    TalNodeRecord rec;
+    m_store.node(n, rec);
+    const uint32_t repeat = m_repeat.empty() ? 1 : m_repeat[i];
+    const uint32_t hidden = collapsed(i);
+
+    if (!json()) {
+        out.append(2 * (size_t)m_level[i], ' ');
+        out += "- [";
+        out += std::to_string(n + 1);
+        out += "] ";
+        out += m_store.str(rec.label);
+        if (rec.ended) {
+            out += " (";
+            json_write_number(out, rec.ended_at - rec.started_at);
+            out += "ms)";
+        }
+        if (rec.status == kError) out += " [ERROR]";
+        if (rec.status == kRunning) out += " [RUNNING]";
+        if (repeat > 1) {
+            out += " (repeated ";
+            out += std::to_string(repeat);
+            out += "x)";
+        }
+        if (hidden > 0) {
+            out += " (+";
+            out += std::to_string(hidden);
+            out += " calls collapsed)";
+        }
+        out += '\n';
+
+        if (rec.status == kError) {
+            ErrorFields f = error_fields(rec.data, m_scratch);
+            if (!f.message.empty()) {
+                out.append(2 * (size_t)m_level[i] + 2, ' ');
+                out += "Error: ";
+                write_text(out, f.message, m_scratch);
+                out += '\n';
+            }
+        }
+        return;
+    }
+
+    if (m_comma) out += ',';
+    out += "{\"id\":";
+    m_store.write_id(out, rec.id);
+    out += ",\"num\":";
+    json_write_number(out, (double)n + 1);
+    out += ",\"name\":";
+    json_write_string(out, m_store.str(rec.label));
+    out += ",\"type\":\"";
+    out += tal_node_type_name(rec.type);
+    out += "\",\"status\":\"";
+    out += tal_status_name(rec.status);
+    out += "\",\"duration\":";
+    if (rec.ended) json_write_number(out, rec.ended_at - rec.started_at); else out += "null";
+    out += ",\"startedAt\":";
+    json_write_number(out, rec.started_at);
+    out += ",\"endedAt\":";
+    if (rec.ended) json_write_number(out, rec.ended_at); else out += "null";
+    if (repeat > 1) {
+        out += ",\"repeat\":";
+        json_write_number(out, repeat);
+    }
+    if (hidden > 0) {
+        out += ",\"collapsedCalls\":";
+        json_write_number(out, hidden);
+    }
+    out += ",\"children\":[";
+    m_comma = false;
+    m_open.push_back(i);
+}
+
+void TalExporter::close_call(std::string& out, uint32_t i) {
+    TalNodeRecord rec;
+    m_store.node(m_order[i], rec);
+
+    out += ']';
+    if (!summarized()) {
+        out += ",\"data\":";
+        out += rec.data;
+    }
+    if (rec.status == kError) {
+        ErrorFields f = error_fields(rec.data, m_scratch);
+        if (!f.message.empty()) {
+            out += ",\"errorMessage\":";
+            out += f.message;
+        }
+    }
+    out += '}';
+    m_comma = true;
+}
+
+void TalExporter::write_entry(std::string& out, const Entry& e) {
+    TalNodeRecord rec;
+    m_store.node(e.node, rec);
+
+    const char* event = !e.end ? "call_start" : rec.status == kError ? "error" : "call_end";
+    const double duration = rec.ended_at - rec.started_at;
+
+    if (json()) {
+        if (m_comma) out += ',';
+        m_comma = true;
+        out += "{\"timestamp\":";
+        json_write_number(out, e.ts);
+        out += ",\"event\":\"";
+        out += event;
+        out += "\",\"nodeId\":";
+        m_store.write_id(out, rec.id);
+        out += ",\"nodeName\":";
+        json_write_string(out, m_store.str(rec.label));
+        out += ",\"details\":\"";
+    } else {
+        out += "- ";
+        write_iso_time(out, e.ts);
+        out += " | ";
+        out += event;
+        out += " | ";
+        out += m_store.str(rec.label);
+        out += " | ";
+    }
+
+    out += tal_node_type_name(rec.type);
+    if (!e.end) {
+        out += " started";
+    } else {
+        out += ' ';
+        out += tal_status_name(rec.status);
+        if (duration != 0 && !std::isnan(duration)) {
+            out += " (";
+            json_write_number(out, duration);
+            out += "ms)";
+        }
+    }
+    out += json() ? "\"}" : "\n";
+}
+
+void TalExporter::write_node(std::string& out, uint32_t n) {
+    TalNodeRecord rec;
+    m_store.node(n, rec);
+
+    if (m_comma) out += ',';
+    m_comma = true;
+    out += "{\"id\":";
+    m_store.write_id(out, rec.id);
+    out += ",\"num\":";
+    json_write_number(out, (double)n + 1);
+    out += ",\"name\":";
+    json_write_string(out, m_store.str(rec.label));
+    out += ",\"type\":\"";
+    out += tal_node_type_name(rec.type);
+    out += "\",\"status\":\"";
+    out += tal_status_name(rec.status);
+    out += "\",\"timing\":{\"startedAt\":";
+    json_write_number(out, rec.started_at);
+    out += ",\"endedAt\":";
+    if (rec.ended) json_write_number(out, rec.ended_at); else out += "null";
+    out += ",\"duration\":";
+    if (rec.ended) json_write_number(out, rec.ended_at - rec.started_at); else out += "null";
+    out += "},\"context\":";
+    out += rec.data;
+    out += '}';
+}
+
+void TalExporter::write_edge(std::string& out, const TalEdgeRecord& e) {
+    if (m_comma) out += ',';
+    m_comma = true;
+    out += "{\"caller\":";
+    m_store.write_id(out, e.from_id);
+    out += ",\"callee\":";
+    m_store.write_id(out, e.to_id);
+    out += ",\"type\":\"";
+    out += tal_edge_kind_name(e.kind);
+    out += "\",\"timestamp\":";
+    json_write_number(out, e.created_at);
+    out += '}';
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include "tal_store.h"
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Streaming counterpart of exportForLLM() (servers/agents/pipeline/
+// llm_export.ts): writes the json, prompt and jsonld exports of a stored
+// graph a chunk at a time, reading records straight from the store's mapped
+// columns. Planning keeps a few words per node (slice membership and the
+// call tree in preorder); ids, labels and data are read only while the
+// chunk that holds them is written.
+//
+// JSON is written compact rather than indented. A node reached from several
+// parents is listed once in the call tree, under the first, and nodes only
+// reachable through a cycle become roots of their own.
+//
+// With a token budget the export is summarized to fit it: sibling calls of
+// the same shape (label, type, status and the shapes of their distinct
+// calls) are listed once with a repeat count, the call tree is cut at the
+// deepest level that fits, errors and the timeline are capped, node data is
+// left out of the call tree and the raw graph section is dropped. Tokens are
+// estimated at four bytes each.
+
+enum class TalExportFormat : uint8_t { Json, Prompt, JsonLd };
+
+// "json", "prompt" or "jsonld"
+bool tal_parse_export_format(std::string_view name, TalExportFormat& out);
+
+struct TalExportOptions {
+    TalExportFormat format = TalExportFormat::Json;
+    std::string run_id;
+    double timestamp_ms = 0;
+
+    // The slice exported: nodes whose last change has a seq in
+    // (from_seq, to_seq], and of those the ones within depth calls of root
+    // (of every root when root is empty). Edges are kept when both ends are.
+    double from_seq = -std::numeric_limits<double>::infinity();
+    double to_seq = std::numeric_limits<double>::infinity();
+    std::string root;
+    uint32_t depth = UINT32_MAX;
+
+    size_t token_budget = 0;    // 0 exports everything
+};
+
+// The store must stay open while an export runs.
+class TalExporter {
+public:
+    explicit TalExporter(const TalStore& store) : m_store(store) {}
+
+    // Plans the export; call once per exporter. False (with error() set) if
+    // root names no node in the slice.
+    bool start(const TalExportOptions& opts);
+
+    // Appends the next part of the export to out: at least chunk_bytes of
+    // it, unless the export ends first. False once it is complete.
+    bool next(std::string& out, size_t chunk_bytes);
+
+    const std::string& error() const { return m_error; }
+
+private:
+    enum class Section : uint8_t { Head, Errors, Tree, Timeline, Nodes, Edges, Tail };
+
+    struct Entry {
+        double ts;
+        uint32_t node;
+        uint32_t end;           // 1 for the call_end / error entry
+    };
+
+    void plan_slice();
+    void plan_stats();
+    void plan_budget();
+    void plan_timeline();
+
+    void begin(Section s, std::string& out);
+    bool step(Section s, std::string& out);
+    void finish(Section s, std::string& out);
+
+    void write_head(std::string& out);
+    void write_error(std::string& out, uint32_t n);
+    bool write_tree(std::string& out);
+    void open_call(std::string& out, uint32_t i);
+    void close_call(std::string& out, uint32_t i);
+    void write_entry(std::string& out, const Entry& e);
+    void write_node(std::string& out, uint32_t n);
+    void write_edge(std::string& out, const TalEdgeRecord& e);
+
+    uint32_t collapsed(uint32_t i) const;
+    bool json() const { return m_opts.format != TalExportFormat::Prompt; }
+    bool summarized() const { return m_opts.token_budget > 0; }
+
+    const TalStore& m_store;
+    TalExportOptions m_opts;
+    std::string m_error;
+
+    std::vector<bool> m_in;             // node is in the slice
+    uint32_t m_count = 0;
+
+    // The call tree in preorder: node, preorder index past its subtree and
+    // level, and per entry the calls the depth limit cut off (when it did)
+    std::vector<uint32_t> m_order, m_end, m_level, m_cut;
+
+    // Summary of the slice
+    uint32_t m_statuses[3] = {};
+    uint32_t m_types[8] = {};
+    uint8_t m_type_order[8] = {};
+    uint32_t m_type_count = 0;
+    double m_min_start = 0, m_max_end = 0;
+    std::vector<std::pair<double, uint32_t>> m_hotspots;   // (duration, node), slowest first
+    std::vector<uint32_t> m_errors;     // error nodes to list
+    uint32_t m_error_total = 0;
+    uint64_t m_timeline_total = 0;
+    size_t m_timeline_cap = SIZE_MAX;
+
+    // With a token budget: per preorder entry, the siblings listed as it
+    // (0 if it is listed as an earlier one), and how far the tree is shown
+    std::vector<uint32_t> m_repeat;
+    uint32_t m_show_depth = UINT32_MAX;
+    uint32_t m_show_roots = UINT32_MAX;
+    uint32_t m_shown = 0, m_aggregated = 0, m_collapsed = 0;
+
+    // Output position
+    std::vector<Section> m_sections;
+    size_t m_section = 0;
+    bool m_begun = false;
+    size_t m_pos = 0;
+    uint32_t m_roots = 0;
+    bool m_comma = false;
+    std::vector<uint32_t> m_open;       // JSON call tree entries awaiting their close
+    std::vector<Entry> m_entries;
+    std::string m_scratch;
+};
@@ -0,0 +1,798 @@
+#include "tal_graph.h"
+#include "tal_json.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+static constexpr double kNull = std::numeric_limits<double>::quiet_NaN();
+
+// Properties of an event kind, computed once per distinct kind
+enum KindFlags : uint16_t {
+    kComputed      = 1 << 0,
+    kLowerError    = 1 << 1,   // lowercased kind is "error" or "exception"
+    kLowerCall     = 1 << 2,   // lowercased kind is call_start / call_end / call
+    kHasRead       = 1 << 3,
+    kHasWrite      = 1 << 4,
+    kHasCall       = 1 << 5,
+    kHasReturn     = 1 << 6,
+    kHasEmitEvent  = 1 << 7,   // contains "emit" or "event"
+    kIsCallEnd     = 1 << 8,   // exactly "call_end"
+    kIsErrorExact  = 1 << 9,   // exactly "error" or "exception"
+};
+
+enum class DataType : uint8_t { None, Database, Http, Client, Io, Rpc, Server, Read, Write, Other };
+
+// What inferNodeType() and determineEdgeKind() read from event.data
+struct TalGraph::DataFacts {
+    bool status_error = false;
+    DataType type = DataType::None;
+    bool db_system = false;
+    bool db_statement = false;
+    bool http_method = false;
+    bool rpc_system = false;
+};
+
+// The value of a raw JSON string, unescaped into scratch if needed; false
+// for any other JSON type
+static bool string_value(std::string_view raw, std::string& scratch, std::string_view& out) {
+    if (raw.empty() || raw[0] != '"') return false;
+
+    bool esc = false;
+    const char* end = json_scan_string(raw.data() + 1, raw.data() + raw.size(), esc);
+    out = std::string_view(raw.data() + 1, (size_t)(end - raw.data() - 1));
+    if (esc) {
+        json_unescape(out, scratch);
+        out = scratch;
+    }
+    return true;
+}
+
+static DataType classify_type(std::string_view raw) {
+    std::string scratch;
+    std::string_view v;
+    if (!string_value(raw, scratch, v)) return DataType::Other;
+
+    if (v == "database") return DataType::Database;
+    if (v == "http")     return DataType::Http;
+    if (v == "client")   return DataType::Client;
+    if (v == "io")       return DataType::Io;
+    if (v == "rpc")      return DataType::Rpc;
+    if (v == "server")   return DataType::Server;
+    if (v == "read")     return DataType::Read;
+    if (v == "write")    return DataType::Write;
+    return DataType::Other;
+}
+
+static bool is_error_status(std::string_view raw) {
+    std::string scratch;
+    std::string_view v;
+    return string_value(raw, scratch, v) && v == "ERROR";
+}
+
+TalGraph::TalGraph()
+    : m_empty_id_node(kNone), m_last_seq(-1), m_by_type(), m_type_order(), m_types_seen(0),
+      m_by_status(), m_error_props(0), m_ref_epoch(0) {}
+
+uint32_t TalGraph::intern(std::string_view s) {
+    uint32_t sid = m_strings.intern(s);
+    if (sid >= m_slots.size()) m_slots.resize(sid + 1);
+    return sid;
+}
+
+uint32_t TalGraph::id_key(std::string_view id) {
+    if (id.substr(0, 5) == "span:") return kSpanId | intern(id.substr(5));
+    return intern(id);
+}
+
+uint32_t& TalGraph::id_node(uint32_t key) {
+    if (key & kSpanId) return slot(key & ~kSpanId).span_id_node;
+    return slot(key).node;
+}
+
+uint16_t TalGraph::kind_flags(uint32_t kind_sid) {
+    uint16_t& f = m_slots[kind_sid].kind_flags;
+    if (f & kComputed) return f;
+
+    std::string_view kind = m_strings.str(kind_sid);
+    std::string lower(kind);
+    for (char& c : lower) {
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+    }
+    auto has = [&lower](const char* s) { return lower.find(s) != std::string::npos; };
+
+    f = kComputed;
+    if (lower == "error" || lower == "exception") f |= kLowerError;
+    if (lower == "call_start" || lower == "call_end" || lower == "call") f |= kLowerCall;
+    if (has("read"))   f |= kHasRead;
+    if (has("write"))  f |= kHasWrite;
+    if (has("call"))   f |= kHasCall;
+    if (has("return")) f |= kHasReturn;
+    if (has("emit") || has("event")) f |= kHasEmitEvent;
+    if (kind == "call_end") f |= kIsCallEnd;
+    if (kind == "error" || kind == "exception") f |= kIsErrorExact;
+    return f;
+}
+
+uint32_t TalGraph::add_node(uint32_t id, uint32_t label, NodeType type, uint32_t kind,
+                            uint32_t span, uint32_t parent, uint32_t key, double ts, double seq,
+                            Status status, std::string_view data, uint32_t errors,
+                            uint32_t children) {
+    uint32_t n = (uint32_t)m_node_id.size();
+
+    m_node_id.push_back(id);
+    m_node_label.push_back(label);
+    m_node_kind.push_back(kind);
+    m_node_span.push_back(span);
+    m_node_parent.push_back(parent);
+    m_node_key.push_back(key);
+    m_node_type.push_back(type);
+    m_node_status.push_back(status);
+    m_node_started_at.push_back(ts);
+    m_node_ended_at.push_back(kNull);
+    m_node_started_seq.push_back(seq);
+    m_node_ended_seq.push_back(kNull);
+    m_node_errors.push_back(errors);
+    m_node_children.push_back(children);
+    m_node_ordinal.push_back(0);
+
+    m_node_data_off.push_back(m_data.size());
+    m_node_data_len.push_back((uint32_t)data.size());
+    m_data.append(data.data(), data.size());
+
+    uint8_t t = (uint8_t)type;
+    if (m_by_type[t]++ == 0) m_type_order[m_types_seen++] = t;
+    m_by_status[(uint8_t)status]++;
+    m_error_props += errors;
+
+    m_node_log.push_back(kNone);
+    touch(n);
+
+    id_node(id) = n;
+    return n;
+}
+
+void TalGraph::set_status(uint32_t n, Status status) {
+    m_by_status[(uint8_t)m_node_status[n]]--;
+    m_by_status[(uint8_t)status]++;
+    m_node_status[n] = status;
+}
+
+void TalGraph::touch(uint32_t n) {
+    uint32_t& pos = m_node_log[n];
+
+    // Already the newest entry: only its seq moves
+    if (pos != kNone && pos + 1 == m_log_node.size()) {
+        m_log_seq[pos] = m_last_seq;
+        return;
+    }
+
+    pos = (uint32_t)m_log_node.size();
+    m_log_node.push_back(n);
+    m_log_seq.push_back(m_last_seq);
+
+    if (m_log_node.size() > 2 * m_node_id.size() + 1024) compact_log();
+}
+
+void TalGraph::compact_log() {
+    size_t w = 0;
+    for (size_t r = 0; r < m_log_node.size(); ++r) {
+        uint32_t n = m_log_node[r];
+        if (m_node_log[n] != r) continue;
+
+        m_log_node[w] = n;
+        m_log_seq[w] = m_log_seq[r];
+        m_node_log[n] = (uint32_t)w;
+        ++w;
+    }
+    m_log_node.resize(w);
+    m_log_seq.resize(w);
+}
+
+size_t TalGraph::log_since(double seq) const {
+    return (size_t)(std::upper_bound(m_log_seq.begin(), m_log_seq.end(), seq) - m_log_seq.begin());
+}
+
+size_t TalGraph::edges_since(double seq) const {
+    return (size_t)(std::upper_bound(m_edge_seq.begin(), m_edge_seq.end(), seq) - m_edge_seq.begin());
+}
+
+void TalGraph::add_edge(uint32_t from, uint32_t to, double seq, EdgeKind kind, double ts) {
+    m_edge_from.push_back(from);
+    m_edge_to.push_back(to);
+    m_edge_ordinal.push_back(++m_node_ordinal[from]);
+    m_edge_seq.push_back(seq);
+    m_edge_kind.push_back(kind);
+    m_edge_at.push_back(ts);
+}
+
+void TalGraph::map_span(uint32_t span_sid, uint32_t node) {
+    uint32_t& n = slot(span_sid).span_node;
+    if (n == kNone) m_span_order.push_back(span_sid);
+    n = node;
+}
+
+uint32_t TalGraph::span_node(uint32_t span_sid) {
+    // A node id of "" is falsy in spanToNode.get(span) checks
+    uint32_t n = slot(span_sid).span_node;
+    return n == m_empty_id_node ? kNone : n;
+}
+
+std::string_view TalGraph::node_data(uint32_t n) const {
+    if (m_node_data_len[n] == 0) return "{}";
+    return std::string_view(m_data.data() + m_node_data_off[n], m_node_data_len[n]);
+}
+
+void TalGraph::apply(const TalEventView& ev) {
+    // Skip duplicate/out-of-order events
+    if (ev.seq <= m_last_seq) return;
+    m_last_seq = ev.seq;
+
+    const double ts = ev.ts;
+    const uint32_t kind = intern(ev.kind);
+    const uint16_t kf = kind_flags(kind);
+
+    uint32_t& counter = slot(kind).counter;
+    if (counter == kNone) {
+        counter = (uint32_t)m_counters.size();
+        m_counters.push_back(0);
+        m_counters_kind.push_back(kind);
+    }
+    m_counters[counter] += 1;
+
+    // event.data is only looked at when a node or edge needs it
+    bool facts_ready = false;
+    DataFacts facts;
+    auto data_facts = [&]() -> const DataFacts& {
+        if (facts_ready) return facts;
+        facts_ready = true;
+        json_for_each_member(ev.data, m_key_scratch, [&](std::string_view k, std::string_view v) {
+            if (k == "status") facts.status_error = is_error_status(v);
+            else if (k == "type") facts.type = classify_type(v);
+            else if (k == "db.system") facts.db_system = json_truthy(v);
+            else if (k == "db.statement") facts.db_statement = json_truthy(v);
+            else if (k == "http.method") facts.http_method = json_truthy(v);
+            else if (k == "rpc.system") facts.rpc_system = json_truthy(v);
+        });
+        return facts;
+    };
+
+    const uint32_t span = ev.span.empty() ? kNone : intern(ev.span);
+
+    // call_end folds into the node its span started
+    if ((kf & kIsCallEnd) && span != kNone) {
+        uint32_t n = span_node(span);
+        if (n != kNone) {
+            m_node_ended_at[n] = ts;
+            m_node_ended_seq[n] = ev.seq;
+
+            if (data_facts().status_error) {
+                set_status(n, Status::Error);
+                m_node_errors[n]++;
+                m_error_props++;
+            } else {
+                set_status(n, Status::Completed);
+            }
+
+            // existingNode.data = { ...existingNode.data, ...data }
+            m_merge_buf.clear();
+            json_merge_objects(node_data(n), ev.data, m_merge_buf);
+            m_node_data_off[n] = m_data.size();
+            m_node_data_len[n] = m_merge_buf == "{}" ? 0 : (uint32_t)m_merge_buf.size();
+            if (m_node_data_len[n]) m_data += m_merge_buf;
+            touch(n);
+            return;
+        }
+    }
+
+    // Node id: nodeKey ?? (span ? `span:${span}` : `event:${kind}:${seq}`)
+    uint32_t node_id;
+    if (ev.has_node_key) {
+        node_id = id_key(ev.node_key);
+    } else if (span != kNone) {
+        node_id = kSpanId | span;
+    } else {
+        m_id_buf.assign("event:");
+        m_id_buf.append(ev.kind);
+        m_id_buf += ':';
+        json_write_number(m_id_buf, ev.seq);
+        node_id = intern(m_id_buf);
+    }
+
+    uint32_t node = id_node(node_id);
+    if (node == kNone) {
+        const DataFacts& d = data_facts();
+
+        NodeType type;
+        if ((kf & kLowerError) || d.status_error) {
+            type = NodeType::Error;
+        } else if (d.type == DataType::Database || d.db_system || d.db_statement) {
+            type = NodeType::DB;
+        } else if (d.type == DataType::Http || d.type == DataType::Client || d.http_method) {
+            type = NodeType::External;
+        } else if (d.type == DataType::Io || (kf & (kHasRead | kHasWrite))) {
+            type = NodeType::IO;
+        } else if (d.type == DataType::Rpc || d.type == DataType::Server || d.rpc_system) {
+            type = NodeType::Service;
+        } else if (kf & kLowerCall) {
+            type = NodeType::Function;
+        } else {
+            type = NodeType::Event;
+        }
+
+        bool is_error = kf & kIsErrorExact;
+        bool has_key = !ev.node_key.empty();
+        uint32_t key = has_key ? intern(ev.node_key) : kNone;
+        uint32_t parent = ev.parent_span.empty() ? kNone : intern(ev.parent_span);
+
+        node = add_node(node_id, has_key ? key : kind, type, kind, span, parent, key, ts, ev.seq,
+                        is_error ? Status::Error : Status::Running,
+                        json_truthy(ev.data) ? ev.data : std::string_view(),
+                        is_error ? 1 : 0, 0);
+
+        if (ev.has_node_key && ev.node_key.empty()) m_empty_id_node = node;
+        if (span != kNone) map_span(span, node);
+    }
+
+    if (ev.parent_span.empty()) return;
+
+    const uint32_t psid = intern(ev.parent_span);
+    uint32_t parent = span_node(psid);
+    if (parent == kNone) parent = slot(psid).span_id_node;
+
+    auto edge_kind = [&]() {
+        const DataFacts& d = data_facts();
+        if (kf & kHasCall) return EdgeKind::Calls;
+        if (kf & kHasReturn) return EdgeKind::Returns;
+        if (kf & kHasEmitEvent) return EdgeKind::Emits;
+        if ((kf & kHasRead) || d.type == DataType::Read) return EdgeKind::Reads;
+        if ((kf & kHasWrite) || d.type == DataType::Write) return EdgeKind::Writes;
+        if (d.type == DataType::Database || d.db_system) return EdgeKind::Queries;
+        if (d.type == DataType::Http) return EdgeKind::Requests;
+        return EdgeKind::Calls;
+    };
+
+    if (parent != kNone) {
+        if (m_edge_set.insert((uint64_t)parent << 32 | node)) {
+            add_edge(parent, node, ev.seq, edge_kind(), ts);
+            m_node_children[parent]++;
+            touch(parent);
+        }
+        return;
+    }
+
+    // Child arrived before its parent: create a placeholder parent node
+
+    m_id_buf.assign("pending:");
+    m_id_buf.append(ev.parent_span);
+    uint32_t label = intern(m_id_buf);
+
+    uint32_t placeholder = add_node(kSpanId | psid, label, NodeType::Function, intern("pending"),
+                                    psid, kNone, kNone, ts, ev.seq, Status::Running,
+                                    std::string_view(), 0, 1);
+    map_span(psid, placeholder);
+
+    m_edge_set.insert((uint64_t)placeholder << 32 | node);
+    add_edge(placeholder, node, ev.seq, edge_kind(), ts);
+}
+
+bool TalGraph::apply_json(const char* p, size_t n) {
+    TalEventView ev;
+    if (!m_parser.parse(p, n, ev)) return false;
+    apply(ev);
+    return true;
+}
+
+size_t TalGraph::apply_lines(const char* p, size_t n, std::vector<uint32_t>* rejected) {
+    const char* end = p + n;
+    size_t applied = 0;
+    uint32_t index = 0;
+
+    while (p < end) {
+        const char* nl = (const char*)std::memchr(p, '\n', (size_t)(end - p));
+        const char* line_end = nl ? nl : end;
+
+        if (json_skip_ws(p, line_end) != line_end) {
+            if (apply_json(p, (size_t)(line_end - p))) {
+                ++applied;
+            } else if (rejected) {
+                rejected->push_back(index);
+            }
+            ++index;
+        }
+        p = nl ? nl + 1 : end;
+    }
+    return applied;
+}
+
+const char* tal_node_type_name(uint8_t t) {
+    static const char* names[] = {"Function", "External", "IO", "Service", "DB", "Group", "Event", "Error"};
+    return names[t];
+}
+
+const char* tal_status_name(uint8_t s) {
+    static const char* names[] = {"running", "completed", "error"};
+    return names[s];
+}
+
+const char* tal_edge_kind_name(uint8_t k) {
+    static const char* names[] = {"calls", "returns", "emits", "reads", "writes", "queries", "requests"};
+    return names[k];
+}
+
+void TalGraph::write_opt(std::string& out, uint32_t sid) const {
+    if (sid == kNone) {
+        out += "null";
+    } else {
+        json_write_string(out, m_strings.str(sid));
+    }
+}
+
+void TalGraph::write_id(std::string& out, uint32_t key) const {
+    if (key & kSpanId) {
+        out += "\"span:";
+        json_write_escaped(out, m_strings.str(key & ~kSpanId));
+        out += '"';
+    } else {
+        json_write_string(out, m_strings.str(key));
+    }
+}
+
+void TalGraph::write_node(std::string& out, uint32_t n) const {
+    out += "{\"id\":";
+    write_id(out, m_node_id[n]);
+    out += ",\"num\":";
+    json_write_number(out, (double)n + 1);
+    out += ",\"label\":";
+    json_write_string(out, m_strings.str(m_node_label[n]));
+    out += ",\"type\":\"";
+    out += tal_node_type_name((uint8_t)m_node_type[n]);
+    out += "\",\"kind\":";
+    json_write_string(out, m_strings.str(m_node_kind[n]));
+    out += ",\"span\":";
+    write_opt(out, m_node_span[n]);
+    out += ",\"parentSpan\":";
+    write_opt(out, m_node_parent[n]);
+    out += ",\"key\":";
+    write_opt(out, m_node_key[n]);
+    out += ",\"startedAt\":";
+    json_write_number(out, m_node_started_at[n]);
+
+    bool ended = !std::isnan(m_node_ended_seq[n]);
+    out += ",\"endedAt\":";
+    if (ended) json_write_number(out, m_node_ended_at[n]); else out += "null";
+    out += ",\"duration\":";
+    if (ended) json_write_number(out, m_node_ended_at[n] - m_node_started_at[n]); else out += "null";
+    out += ",\"startedSeq\":";
+    json_write_number(out, m_node_started_seq[n]);
+    out += ",\"endedSeq\":";
+    if (ended) json_write_number(out, m_node_ended_seq[n]); else out += "null";
+
+    out += ",\"status\":\"";
+    out += tal_status_name((uint8_t)m_node_status[n]);
+    out += "\",\"data\":";
+    out += node_data(n);
+    out += ",\"props\":{\"errorCount\":";
+    json_write_number(out, m_node_errors[n]);
+    out += ",\"childCount\":";
+    json_write_number(out, m_node_children[n]);
+    out += "}}";
+}
+
+void TalGraph::write_edge(std::string& out, uint32_t e) const {
+    out += "{\"from\":";
+    write_id(out, m_node_id[m_edge_from[e]]);
+    out += ",\"to\":";
+    write_id(out, m_node_id[m_edge_to[e]]);
+    out += ",\"ordinal\":";
+    json_write_number(out, m_edge_ordinal[e]);
+    out += ",\"createdSeq\":";
+    json_write_number(out, m_edge_seq[e]);
+    out += ",\"kind\":\"";
+    out += tal_edge_kind_name((uint8_t)m_edge_kind[e]);
+    out += "\",\"createdAt\":";
+    json_write_number(out, m_edge_at[e]);
+    out += '}';
+}
+
+void TalGraph::write_counter_summary(std::string& out) const {
+    out += ",\"counter\":{";
+    for (size_t i = 0; i < m_counters.size(); ++i) {
+        if (i) out += ',';
+        json_write_string(out, m_strings.str(m_counters_kind[i]));
+        out += ':';
+        json_write_number(out, m_counters[i]);
+    }
+
+    uint64_t errors = m_by_status[(uint8_t)Status::Error] + m_error_props;
+
+    out += "},\"summary\":{\"totalNodes\":";
+    json_write_number(out, (double)m_node_id.size());
+    out += ",\"totalEdges\":";
+    json_write_number(out, (double)m_edge_from.size());
+    out += ",\"errorCount\":";
+    json_write_number(out, (double)errors);
+    out += ",\"completedCount\":";
+    json_write_number(out, (double)m_by_status[(uint8_t)Status::Completed]);
+    out += ",\"runningCount\":";
+    json_write_number(out, (double)m_by_status[(uint8_t)Status::Running]);
+    out += ",\"nodesByType\":{";
+    for (int i = 0; i < m_types_seen; ++i) {
+        if (i) out += ',';
+        out += '"';
+        out += tal_node_type_name(m_type_order[i]);
+        out += "\":";
+        json_write_number(out, (double)m_by_type[m_type_order[i]]);
+    }
+    out += "}}}";
+}
+
+void TalGraph::write_delta(std::string& out, std::string_view run_id, double timestamp_ms,
+                           bool tagged) const {
+    const uint32_t nodes = (uint32_t)m_node_id.size();
+    const uint32_t edges = (uint32_t)m_edge_from.size();
+
+    // ~300 bytes per node and ~120 per edge in practice
+    out.reserve(out.size() + nodes * 320 + edges * 128 + 256);
+
+    out += tagged ? "{\"type\":\"GraphDelta\",\"runId\":" : "{\"runId\":";
+    json_write_string(out, run_id);
+    out += ",\"atSeq\":";
+    json_write_number(out, m_last_seq);
+    out += ",\"timestamp\":";
+    json_write_number(out, timestamp_ms);
+
+    out += ",\"nodes\":[";
+    for (uint32_t n = 0; n < nodes; ++n) {
+        if (n) out += ',';
+        write_node(out, n);
+    }
+
+    out += "],\"edges\":[";
+    for (uint32_t e = 0; e < edges; ++e) {
+        if (e) out += ',';
+        write_edge(out, e);
+    }
+    out += ']';
+    write_counter_summary(out);
+}
+
+void TalGraph::write_patch(std::string& out, std::string_view run_id, double since_seq,
+                           double timestamp_ms, bool tagged) const {
+    out += tagged ? "{\"type\":\"GraphPatch\",\"runId\":" : "{\"runId\":";
+    json_write_string(out, run_id);
+    out += ",\"fromSeq\":";
+    json_write_number(out, since_seq);
+    out += ",\"atSeq\":";
+    json_write_number(out, m_last_seq);
+    out += ",\"timestamp\":";
+    json_write_number(out, timestamp_ms);
+
+    out += ",\"nodes\":[";
+    bool first = true;
+    for (size_t i = log_since(since_seq); i < m_log_node.size(); ++i) {
+        uint32_t n = m_log_node[i];
+        if (m_node_log[n] != i) continue;   // changed again later
+        if (!first) out += ',';
+        first = false;
+        write_node(out, n);
+    }
+
+    out += "],\"edges\":[";
+    const size_t edges = m_edge_from.size();
+    const size_t first_edge = edges_since(since_seq);
+    for (size_t e = first_edge; e < edges; ++e) {
+        if (e > first_edge) out += ',';
+        write_edge(out, (uint32_t)e);
+    }
+    out += ']';
+    write_counter_summary(out);
+}
+
+void TalGraph::write_changes(std::string& out, double since_seq) const {
+    out += "{\"atSeq\":";
+    json_write_number(out, m_last_seq);
+
+    out += ",\"nodes\":[";
+    bool first = true;
+    for (size_t i = log_since(since_seq); i < m_log_node.size(); ++i) {
+        uint32_t n = m_log_node[i];
+        if (m_node_log[n] != i) continue;   // changed again later
+        if (!first) out += ',';
+        first = false;
+
+        write_node(out, n);
+        out.pop_back();     // reopen the node object
+        out += ",\"parentId\":";
+        uint32_t parent = m_node_parent[n] == kNone ? kNone : m_slots[m_node_parent[n]].span_node;
+        if (parent == kNone) out += "null"; else write_id(out, m_node_id[parent]);
+        out += '}';
+    }
+
+    out += "],\"edges\":[";
+    const size_t edges = m_edge_from.size();
+    const size_t first_edge = edges_since(since_seq);
+    for (size_t e = first_edge; e < edges; ++e) {
+        if (e > first_edge) out += ',';
+        write_edge(out, (uint32_t)e);
+    }
+    out += "]}";
+}
+
+// GraphPatch binary layout, little-endian (servers/agents/pipeline/graph_patch.ts
+// decodes it):
+//   "KTGP" u8 version=1, str runId, f64 fromSeq, f64 atSeq, f64 timestamp
+//   varint totalNodes, totalEdges, errorCount, completedCount, runningCount
+//   u8 types, then per type u8 NodeType and varint count      nodesByType
+//   varint counters, then per counter ref kind and varint count
+//   varint nodes, then per node:
+//     varint num, id, ref label, u8 NodeType, ref kind, ref span,
+//     ref parentSpan, ref key, f64 startedAt, f64 endedAt, f64 startedSeq,
+//     f64 endedSeq (NaN = null), u8 Status, varint errorCount,
+//     varint childCount, str data (JSON)
+//   varint edges, then per edge:
+//     id from, id to, varint ordinal, f64 createdSeq, u8 EdgeKind, f64 createdAt
+// varint is LEB128 and str a varint length plus UTF-8. A ref is 0 for null,
+// len << 1 | 1 followed by the bytes for a string not seen before in the
+// message, or (index + 1) << 1 for the index-th new string. An id is a ref
+// shifted left by one, with bit 0 set when the id is "span:" + the string.
+
+static void put_varint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out += (char)(v | 0x80);
+        v >>= 7;
+    }
+    out += (char)v;
+}
+
+static void put_f64(std::string& out, double v) {
+    char b[8];
+    std::memcpy(b, &v, 8);
+    out.append(b, 8);
+}
+
+static void put_str(std::string& out, std::string_view s) {
+    put_varint(out, s.size());
+    out.append(s.data(), s.size());
+}
+
+void TalGraph::write_patch_binary(std::string& out, std::string_view run_id, double since_seq,
+                                  double timestamp_ms) const {
+    // Dictionary slots are valid for the current epoch only, so nothing is
+    // cleared between messages
+    if (++m_ref_epoch == 0) {
+        std::fill(m_ref_gen.begin(), m_ref_gen.end(), 0);
+        m_ref_epoch = 1;
+    }
+    if (m_ref_gen.size() < m_slots.size()) {
+        m_ref_gen.resize(m_slots.size(), 0);
+        m_ref_index.resize(m_slots.size());
+    }
+    uint32_t next_ref = 0;
+
+    // Writes ref << shift | low (ids are shifted to carry the span flag)
+    auto put_ref = [&](uint32_t sid, unsigned shift = 0, uint64_t low = 0) {
+        if (sid == kNone) {
+            put_varint(out, 0);
+            return;
+        }
+        if (m_ref_gen[sid] == m_ref_epoch) {
+            put_varint(out, ((uint64_t)(m_ref_index[sid] + 1) << 1) << shift | low);
+            return;
+        }
+        m_ref_gen[sid] = m_ref_epoch;
+        m_ref_index[sid] = next_ref++;
+
+        std::string_view str = m_strings.str(sid);
+        put_varint(out, ((uint64_t)str.size() << 1 | 1) << shift | low);
+        out.append(str.data(), str.size());
+    };
+    auto put_id = [&](uint32_t key) { put_ref(key & ~kSpanId, 1, (key & kSpanId) ? 1 : 0); };
+
+    out += "KTGP";
+    out += (char)1;
+    put_str(out, run_id);
+    put_f64(out, since_seq);
+    put_f64(out, m_last_seq);
+    put_f64(out, timestamp_ms);
+
+    put_varint(out, m_node_id.size());
+    put_varint(out, m_edge_from.size());
+    put_varint(out, m_by_status[(uint8_t)Status::Error] + m_error_props);
+    put_varint(out, m_by_status[(uint8_t)Status::Completed]);
+    put_varint(out, m_by_status[(uint8_t)Status::Running]);
+    out += (char)m_types_seen;
+    for (int i = 0; i < m_types_seen; ++i) {
+        out += (char)m_type_order[i];
+        put_varint(out, m_by_type[m_type_order[i]]);
+    }
+
+    put_varint(out, m_counters.size());
+    for (size_t i = 0; i < m_counters.size(); ++i) {
+        put_ref(m_counters_kind[i]);
+        put_varint(out, (uint64_t)m_counters[i]);
+    }
+
+    const size_t from = log_since(since_seq);
+    size_t live = 0;
+    for (size_t i = from; i < m_log_node.size(); ++i) {
+        if (m_node_log[m_log_node[i]] == i) ++live;
+    }
+    put_varint(out, live);
+    for (size_t i = from; i < m_log_node.size(); ++i) {
+        uint32_t n = m_log_node[i];
+        if (m_node_log[n] != i) continue;
+
+        put_varint(out, (uint64_t)n + 1);
+        put_id(m_node_id[n]);
+        put_ref(m_node_label[n]);
+        out += (char)m_node_type[n];
+        put_ref(m_node_kind[n]);
+        put_ref(m_node_span[n]);
+        put_ref(m_node_parent[n]);
+        put_ref(m_node_key[n]);
+        bool ended = !std::isnan(m_node_ended_seq[n]);
+        put_f64(out, m_node_started_at[n]);
+        put_f64(out, ended ? m_node_ended_at[n] : kNull);
+        put_f64(out, m_node_started_seq[n]);
+        put_f64(out, m_node_ended_seq[n]);
+        out += (char)m_node_status[n];
+        put_varint(out, m_node_errors[n]);
+        put_varint(out, m_node_children[n]);
+        put_str(out, node_data(n));
+    }
+
+    const size_t edges = m_edge_from.size();
+    const size_t first_edge = edges_since(since_seq);
+    put_varint(out, edges - first_edge);
+    for (size_t e = first_edge; e < edges; ++e) {
+        put_id(m_node_id[m_edge_from[e]]);
+        put_id(m_node_id[m_edge_to[e]]);
+        put_varint(out, m_edge_ordinal[e]);
+        put_f64(out, m_edge_seq[e]);
+        out += (char)m_edge_kind[e];
+        put_f64(out, m_edge_at[e]);
+    }
+}
+
+void TalGraph::write_state(std::string& out) const {
+    const uint32_t nodes = (uint32_t)m_node_id.size();
+    const uint32_t edges = (uint32_t)m_edge_from.size();
+
+    out += "{\"lastSeq\":";
+    json_write_number(out, m_last_seq);
+    out += ",\"nodeNum\":";
+    json_write_number(out, nodes);
+
+    out += ",\"nodes\":[";
+    for (uint32_t n = 0; n < nodes; ++n) {
+        if (n) out += ',';
+        write_node(out, n);
+    }
+
+    out += "],\"edges\":[";
+    for (uint32_t e = 0; e < edges; ++e) {
+        if (e) out += ',';
+        write_edge(out, e);
+    }
+
+    out += "],\"spanToNode\":[";
+    for (size_t i = 0; i < m_span_order.size(); ++i) {
+        uint32_t sid = m_span_order[i];
+        if (i) out += ',';
+        out += '[';
+        json_write_string(out, m_strings.str(sid));
+        out += ',';
+        write_id(out, m_node_id[m_slots[sid].span_node]);
+        out += ']';
+    }
+
+    out += "],\"counter\":{";
+    for (size_t i = 0; i < m_counters.size(); ++i) {
+        if (i) out += ',';
+        json_write_string(out, m_strings.str(m_counters_kind[i]));
+        out += ':';
+        json_write_number(out, m_counters[i]);
+    }
+    out += "}}";
+}
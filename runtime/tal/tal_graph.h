@@ -0,0 +1,175 @@
+#pragma once
+#include "tal_intern.h"
+#include "tal_parser.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Names of TalGraph's node types, node statuses and edge kinds, by code
+const char* tal_node_type_name(uint8_t t);
+const char* tal_status_name(uint8_t s);
+const char* tal_edge_kind_name(uint8_t k);
+
+// Native counterpart of servers/agents/pipeline/t2_correlator.ts. Applies
+// TAL events to an execution graph with the same semantics as applyEvent()
+// (node ids, call_end folding, placeholder parents, edge ordinals, node and
+// edge kinds) and serializes it in the GraphDelta / GraphState shapes.
+//
+// Every string (node id, span, kind, label) is interned once; per-string
+// lookups (node by id, spanToNode, kind counters) are flat vectors indexed
+// by string id, and nodes and edges are stored column-wise. Node ids of the
+// form "span:<span>" are keyed by the interned span rather than interned
+// themselves, which saves a lookup per span event.
+//
+// Every node change is appended to a change-log stamped with the event's
+// seq, and the summary counts are kept up to date as nodes change, so a
+// GraphPatch since any earlier atSeq costs only what changed after it.
+//
+// Known divergence: a non-object `data` is never spread into a node's data
+// on call_end (JS would spread a string or array into index keys).
+class TalGraph {
+public:
+    TalGraph();
+
+    // applyEvent() for an already validated event
+    void apply(const TalEventView& ev);
+
+    // Parses, validates and applies one JSON event. Returns false (and
+    // leaves the graph untouched) if TalEventSchema would reject it.
+    bool apply_json(const char* p, size_t n);
+
+    // Applies newline-delimited events. Blank lines are skipped; the indices
+    // (among non-blank lines) of rejected events are appended to rejected.
+    size_t apply_lines(const char* p, size_t n, std::vector<uint32_t>* rejected = nullptr);
+
+    // buildDelta(run_id, state) as JSON. tagged prepends "type":"GraphDelta"
+    // as the pipeline publishes it.
+    void write_delta(std::string& out, std::string_view run_id, double timestamp_ms,
+                     bool tagged = false) const;
+
+    // GraphPatch since since_seq as JSON: the nodes created or changed and
+    // the edges created by events after since_seq, plus the full counter and
+    // summary. since_seq < 0 yields the whole graph.
+    void write_patch(std::string& out, std::string_view run_id, double since_seq,
+                     double timestamp_ms, bool tagged = false) const;
+
+    // The same patch in the binary layout documented in tal_graph.cpp
+    void write_patch_binary(std::string& out, std::string_view run_id, double since_seq,
+                            double timestamp_ms) const;
+
+    // What a patch since since_seq carries, for persistence:
+    // {"atSeq","nodes","edges"}, each node with its parentId (parentSpan
+    // resolved through spanToNode, or null)
+    void write_changes(std::string& out, double since_seq) const;
+
+    // The GraphState fields persistence needs: lastSeq, nodeNum, nodes,
+    // edges, spanToNode (as [span, nodeId] pairs) and counter
+    void write_state(std::string& out) const;
+
+    double last_seq() const { return m_last_seq; }
+    size_t node_count() const { return m_node_id.size(); }
+    size_t edge_count() const { return m_edge_from.size(); }
+
+    const char* last_error() const { return m_parser.error(); }
+
+private:
+    // Checkpoints read the columns directly and reloads rebuild them (tal_store.h)
+    friend class TalStoreWriter;
+    friend class TalStore;
+
+    static constexpr uint32_t kNone = StringInterner::kNone;
+
+    enum class NodeType : uint8_t { Function, External, IO, Service, DB, Group, Event, Error };
+    enum class Status : uint8_t { Running, Completed, Error };
+    enum class EdgeKind : uint8_t { Calls, Returns, Emits, Reads, Writes, Queries, Requests };
+
+    // Node id key: an interned id, or kSpanId | span for "span:<span>"
+    static constexpr uint32_t kSpanId = 0x80000000u;
+
+    // Per interned string
+    struct StrSlot {
+        uint32_t node = kNone;           // node whose id is this string
+        uint32_t span_id_node = kNone;   // node whose id is "span:" + this string
+        uint32_t span_node = kNone;      // spanToNode
+        uint32_t counter = kNone;        // index into m_counters when used as a kind
+        uint16_t kind_flags = 0;         // KindFlags, once computed
+    };
+
+    struct DataFacts;
+
+    uint32_t intern(std::string_view s);
+    StrSlot& slot(uint32_t sid) { return m_slots[sid]; }
+    void map_span(uint32_t span_sid, uint32_t node);
+    uint32_t span_node(uint32_t span_sid);
+    uint16_t kind_flags(uint32_t kind_sid);
+    uint32_t id_key(std::string_view id);
+    uint32_t& id_node(uint32_t key);
+
+    uint32_t add_node(uint32_t id, uint32_t label, NodeType type, uint32_t kind,
+                      uint32_t span, uint32_t parent, uint32_t key, double ts, double seq,
+                      Status status, std::string_view data, uint32_t errors, uint32_t children);
+    void add_edge(uint32_t from, uint32_t to, double seq, EdgeKind kind, double ts);
+    void set_status(uint32_t n, Status status);
+    void touch(uint32_t n);
+    void compact_log();
+    size_t log_since(double seq) const;
+    size_t edges_since(double seq) const;
+
+    void write_node(std::string& out, uint32_t n) const;
+    void write_edge(std::string& out, uint32_t e) const;
+    void write_opt(std::string& out, uint32_t sid) const;
+    void write_id(std::string& out, uint32_t key) const;
+    void write_counter_summary(std::string& out) const;
+    std::string_view node_data(uint32_t n) const;
+
+    TalParser m_parser;
+    StringInterner m_strings;
+    std::vector<StrSlot> m_slots;
+    std::vector<uint32_t> m_span_order;   // spanToNode insertion order
+    uint32_t m_empty_id_node;             // node with id "" (nodeKey: "")
+
+    double m_last_seq;
+    std::vector<uint32_t> m_counters_kind;   // counter insertion order
+    std::vector<double> m_counters;
+
+    // Nodes, column-wise; index + 1 is the node's num
+    std::vector<uint32_t> m_node_id, m_node_label, m_node_kind;   // m_node_id: id keys
+    std::vector<uint32_t> m_node_span, m_node_parent, m_node_key;
+    std::vector<NodeType> m_node_type;
+    std::vector<Status> m_node_status;
+    std::vector<double> m_node_started_at, m_node_ended_at;   // ended: NaN = null
+    std::vector<double> m_node_started_seq, m_node_ended_seq;
+    std::vector<uint32_t> m_node_errors, m_node_children, m_node_ordinal;
+    std::vector<uint64_t> m_node_data_off;
+    std::vector<uint32_t> m_node_data_len;   // 0 = {}
+    std::string m_data;                       // node data arena
+
+    // Edges, column-wise
+    std::vector<uint32_t> m_edge_from, m_edge_to, m_edge_ordinal;
+    std::vector<double> m_edge_seq, m_edge_at;
+    std::vector<EdgeKind> m_edge_kind;
+    U64Set m_edge_set;
+
+    // Change-log: (node, seq) per change, seqs non-decreasing. An entry is
+    // live while m_node_log[node] points at it; dead entries are compacted
+    // away once they dominate. Edges need no log, m_edge_seq is ordered.
+    std::vector<uint32_t> m_log_node;
+    std::vector<double> m_log_seq;
+    std::vector<uint32_t> m_node_log;
+
+    // Summary counts, maintained as nodes are added and changed
+    uint64_t m_by_type[8];
+    uint8_t m_type_order[8];        // nodesByType key order
+    uint8_t m_types_seen;
+    uint64_t m_by_status[3];
+    uint64_t m_error_props;         // sum of props.errorCount
+
+    // write_patch_binary() string dictionary, by string id
+    mutable std::vector<uint32_t> m_ref_gen, m_ref_index;
+    mutable uint32_t m_ref_epoch;
+
+    std::string m_id_buf;
+    std::string m_merge_buf;
+    std::string m_key_scratch;
+};
@@ -0,0 +1,184 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Fast non-cryptographic hash for short identifiers (span ids, node keys).
+inline uint64_t tal_hash(const char* p, size_t n) {
+    const uint64_t m = 0x9E3779B97F4A7C15ull;
+    uint64_t h = 0x243F6A8885A308D3ull ^ (n * m);
+
+    while (n >= 8) {
+        uint64_t w;
+        std::memcpy(&w, p, 8);
+        h = (h ^ w) * m;
+        h ^= h >> 29;
+        p += 8;
+        n -= 8;
+    }
+    if (n > 0) {
+        uint64_t w = 0;
+        std::memcpy(&w, p, n);
+        h = (h ^ w) * m;
+    }
+
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ull;
+    h ^= h >> 32;
+    return h;
+}
+
+// Interns byte strings into dense uint32 ids, so per-string state can live
+// in flat vectors indexed by id. Bytes are kept in stable chunks; lookup is
+// an open-addressing table probed linearly, whose slots pack the upper half
+// of the hash with the id so most mismatches never touch the string.
+class StringInterner {
+public:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    StringInterner() : m_slots(1024, kEmpty), m_chunk_used(kChunkSize) {}
+
+    uint32_t intern(std::string_view s) {
+        uint64_t h = tal_hash(s.data(), s.size());
+        size_t mask = m_slots.size() - 1;
+        size_t i = h & mask;
+
+        for (;; i = (i + 1) & mask) {
+            uint64_t slot = m_slots[i];
+            if (slot == kEmpty) break;
+            if ((slot & kTagMask) == (h & kTagMask) && str((uint32_t)slot) == s) return (uint32_t)slot;
+        }
+
+        uint32_t id = (uint32_t)m_strings.size();
+        m_strings.push_back({store(s), (uint32_t)s.size()});
+
+        if ((m_strings.size() + 1) * 2 > m_slots.size()) {
+            grow();
+        } else {
+            m_slots[i] = (h & kTagMask) | id;
+        }
+        return id;
+    }
+
+    uint32_t find(std::string_view s) const {
+        uint64_t h = tal_hash(s.data(), s.size());
+        size_t mask = m_slots.size() - 1;
+
+        for (size_t i = h & mask;; i = (i + 1) & mask) {
+            uint64_t slot = m_slots[i];
+            if (slot == kEmpty) return kNone;
+            if ((slot & kTagMask) == (h & kTagMask) && str((uint32_t)slot) == s) return (uint32_t)slot;
+        }
+    }
+
+    std::string_view str(uint32_t id) const {
+        return std::string_view(m_strings[id].ptr, m_strings[id].len);
+    }
+
+    size_t size() const { return m_strings.size(); }
+
+private:
+    static constexpr size_t kChunkSize = 64 * 1024;
+    static constexpr uint64_t kEmpty = UINT64_MAX;   // id kNone is never issued
+    static constexpr uint64_t kTagMask = 0xFFFFFFFF00000000ull;
+
+    struct Entry {
+        const char* ptr;
+        uint32_t len;
+    };
+
+    const char* store(std::string_view s) {
+        if (s.empty()) return "";
+        if (s.size() > kChunkSize / 4) {
+            m_chunks.emplace_back(new char[s.size()]);
+            std::memcpy(m_chunks.back().get(), s.data(), s.size());
+            return m_chunks.back().get();
+        }
+        if (m_chunk_used + s.size() > kChunkSize) {
+            m_chunks.emplace_back(new char[kChunkSize]);
+            m_current_ptr = m_chunks.back().get();
+            m_chunk_used = 0;
+        }
+        char* dst = m_current_ptr + m_chunk_used;
+        std::memcpy(dst, s.data(), s.size());
+        m_chunk_used += s.size();
+        return dst;
+    }
+
+    void grow() {
+        m_slots.assign(m_slots.size() * 2, kEmpty);
+        size_t mask = m_slots.size() - 1;
+
+        for (uint32_t id = 0; id < m_strings.size(); ++id) {
+            std::string_view s = str(id);
+            uint64_t h = tal_hash(s.data(), s.size());
+            size_t i = h & mask;
+            while (m_slots[i] != kEmpty) i = (i + 1) & mask;
+            m_slots[i] = (h & kTagMask) | id;
+        }
+    }
+
+    std::vector<uint64_t> m_slots;
+    std::vector<Entry> m_strings;
+
+    std::vector<std::unique_ptr<char[]>> m_chunks;
+    char* m_current_ptr = nullptr;
+    size_t m_chunk_used;
+};
+
+// Open-addressing set of 64-bit keys (e.g. packed (from, to) edge pairs).
+class U64Set {
+public:
+    U64Set() : m_slots(1024, kEmpty), m_size(0) {}
+
+    // Returns false if the key was already present
+    bool insert(uint64_t key) {
+        if ((m_size + 1) * 2 > m_slots.size()) grow();
+
+        size_t mask = m_slots.size() - 1;
+        for (size_t i = mix(key) & mask;; i = (i + 1) & mask) {
+            if (m_slots[i] == key) return false;
+            if (m_slots[i] == kEmpty) {
+                m_slots[i] = key;
+                ++m_size;
+                return true;
+            }
+        }
+    }
+
+    bool contains(uint64_t key) const {
+        size_t mask = m_slots.size() - 1;
+        for (size_t i = mix(key) & mask;; i = (i + 1) & mask) {
+            if (m_slots[i] == key) return true;
+            if (m_slots[i] == kEmpty) return false;
+        }
+    }
+
+    size_t size() const { return m_size; }
+
+private:
+    static constexpr uint64_t kEmpty = UINT64_MAX;
+
+    static uint64_t mix(uint64_t k) {
+        k ^= k >> 33;
+        k *= 0xFF51AFD7ED558CCDull;
+        k ^= k >> 33;
+        return k;
+    }
+
+    void grow() {
+        std::vector<uint64_t> old;
+        old.swap(m_slots);
+        m_slots.assign(old.size() * 2, kEmpty);
+        m_size = 0;
+        for (uint64_t k : old) {
+            if (k != kEmpty) insert(k);
+        }
+    }
+
+    std::vector<uint64_t> m_slots;
+    size_t m_size;
+};
@@ -0,0 +1,386 @@
+#include "tal_json.h"
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static inline bool is_ws(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline int hex_val(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+const char* json_skip_ws(const char* p, const char* end) {
+    while (p < end && is_ws(*p)) ++p;
+    return p;
+}
+
+// Validates the escape at p (which points at the backslash); returns the
+// position after it
+static const char* skip_escape(const char* p, const char* end) {
+    if (end - p < 2) return nullptr;
+
+    switch (p[1]) {
+        case '"': case '\\': case '/': case 'b':
+        case 'f': case 'n': case 'r': case 't':
+            return p + 2;
+        case 'u':
+            if (end - p < 6) return nullptr;
+            for (int i = 2; i < 6; ++i) {
+                if (hex_val(p[i]) < 0) return nullptr;
+            }
+            return p + 6;
+        default:
+            return nullptr;
+    }
+}
+
+const char* json_scan_string(const char* p, const char* end, bool& has_escape) {
+#ifdef __SSE2__
+    // 16 bytes at a time: stop on '"', '\\' or a control character
+    const __m128i quote  = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    const __m128i ctl    = _mm_set1_epi8(0x1F);
+
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        __m128i hit = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v));
+        int mask = _mm_movemask_epi8(hit);
+        if (mask == 0) {
+            p += 16;
+            continue;
+        }
+
+        p += __builtin_ctz((unsigned)mask);
+        if (*p == '"') return p;
+        if (*p != '\\') return nullptr;
+
+        has_escape = true;
+        p = skip_escape(p, end);
+        if (!p) return nullptr;
+    }
+#endif
+
+    while (p < end) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"') return p;
+        if (c < 0x20) return nullptr;
+        if (c == '\\') {
+            has_escape = true;
+            p = skip_escape(p, end);
+            if (!p) return nullptr;
+            continue;
+        }
+        ++p;
+    }
+    return nullptr;
+}
+
+static void append_utf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += (char)cp;
+    } else if (cp < 0x800) {
+        out += (char)(0xC0 | (cp >> 6));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += (char)(0xE0 | (cp >> 12));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else {
+        out += (char)(0xF0 | (cp >> 18));
+        out += (char)(0x80 | ((cp >> 12) & 0x3F));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+static uint32_t read_hex4(const char* p) {
+    return (uint32_t)(hex_val(p[0]) << 12 | hex_val(p[1]) << 8 | hex_val(p[2]) << 4 | hex_val(p[3]));
+}
+
+void json_unescape(std::string_view body, std::string& out) {
+    out.clear();
+    const char* p = body.data();
+    const char* end = p + body.size();
+
+    while (p < end) {
+        const char* bs = (const char*)std::memchr(p, '\\', (size_t)(end - p));
+        if (!bs) {
+            out.append(p, (size_t)(end - p));
+            break;
+        }
+        out.append(p, (size_t)(bs - p));
+
+        // Escapes were validated by json_scan_string()
+        char c = bs[1];
+        p = bs + 2;
+        switch (c) {
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t cp = read_hex4(p);
+                p += 4;
+                if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                    uint32_t lo = read_hex4(p + 2);
+                    if (lo >= 0xDC00 && lo < 0xE000) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                        p += 6;
+                    }
+                }
+                // A lone surrogate cannot be encoded; U+FFFD is what Node
+                // produces when it converts such a string to UTF-8
+                if (cp >= 0xD800 && cp < 0xE000) cp = 0xFFFD;
+                append_utf8(out, cp);
+                break;
+            }
+            default: out += c; break;
+        }
+    }
+}
+
+const char* json_parse_number(const char* p, const char* end, double& out) {
+    const char* start = p;
+
+    if (p < end && *p == '-') ++p;
+    if (p == end) return nullptr;
+
+    if (*p == '0') {
+        ++p;
+    } else if (*p >= '1' && *p <= '9') {
+        while (p < end && *p >= '0' && *p <= '9') ++p;
+    } else {
+        return nullptr;
+    }
+
+    if (p < end && *p == '.') {
+        ++p;
+        if (p == end || *p < '0' || *p > '9') return nullptr;
+        while (p < end && *p >= '0' && *p <= '9') ++p;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        if (p < end && (*p == '+' || *p == '-')) ++p;
+        if (p == end || *p < '0' || *p > '9') return nullptr;
+        while (p < end && *p >= '0' && *p <= '9') ++p;
+    }
+
+    auto r = std::from_chars(start, p, out);
+    if (r.ec == std::errc::result_out_of_range) {
+        // Overflow to +-Infinity / underflow to 0, as JSON.parse does
+        std::string tmp(start, p);
+        out = std::strtod(tmp.c_str(), nullptr);
+    } else if (r.ec != std::errc()) {
+        return nullptr;
+    }
+    return p;
+}
+
+static const char* skip_literal(const char* p, const char* end, const char* lit, size_t n) {
+    if ((size_t)(end - p) < n || std::memcmp(p, lit, n) != 0) return nullptr;
+    return p + n;
+}
+
+const char* json_skip_value(const char* p, const char* end, int depth) {
+    if (p == end) return nullptr;
+
+    switch (*p) {
+        case '"': {
+            bool esc = false;
+            const char* q = json_scan_string(p + 1, end, esc);
+            return q ? q + 1 : nullptr;
+        }
+        case '{': {
+            if (depth >= kJsonMaxDepth) return nullptr;
+            p = json_skip_ws(p + 1, end);
+            if (p < end && *p == '}') return p + 1;
+
+            while (p < end && *p == '"') {
+                bool esc = false;
+                p = json_scan_string(p + 1, end, esc);
+                if (!p) return nullptr;
+                p = json_skip_ws(p + 1, end);
+                if (p == end || *p != ':') return nullptr;
+                p = json_skip_value(json_skip_ws(p + 1, end), end, depth + 1);
+                if (!p) return nullptr;
+                p = json_skip_ws(p, end);
+                if (p < end && *p == '}') return p + 1;
+                if (p == end || *p != ',') return nullptr;
+                p = json_skip_ws(p + 1, end);
+            }
+            return nullptr;
+        }
+        case '[': {
+            if (depth >= kJsonMaxDepth) return nullptr;
+            p = json_skip_ws(p + 1, end);
+            if (p < end && *p == ']') return p + 1;
+
+            while (true) {
+                p = json_skip_value(p, end, depth + 1);
+                if (!p) return nullptr;
+                p = json_skip_ws(p, end);
+                if (p < end && *p == ']') return p + 1;
+                if (p == end || *p != ',') return nullptr;
+                p = json_skip_ws(p + 1, end);
+            }
+        }
+        case 't': return skip_literal(p, end, "true", 4);
+        case 'f': return skip_literal(p, end, "false", 5);
+        case 'n': return skip_literal(p, end, "null", 4);
+        default: {
+            double ignored;
+            return json_parse_number(p, end, ignored);
+        }
+    }
+}
+
+bool json_truthy(std::string_view raw) {
+    if (raw.empty()) return false;
+
+    switch (raw[0]) {
+        case '"': return raw.size() > 2;
+        case '{': case '[': case 't': return true;
+        case 'f': case 'n': return false;
+        default: {
+            double v = 0;
+            json_parse_number(raw.data(), raw.data() + raw.size(), v);
+            return v != 0 && !std::isnan(v);
+        }
+    }
+}
+
+void json_merge_objects(std::string_view a, std::string_view b, std::string& out) {
+    // Members in first-seen order; a later duplicate replaces the value in
+    // place, matching object spread
+    std::vector<std::pair<std::string, std::string_view>> members;
+    std::string scratch;
+
+    auto add = [&members](std::string_view key, std::string_view value) {
+        for (auto& m : members) {
+            if (m.first == key) {
+                m.second = value;
+                return;
+            }
+        }
+        members.emplace_back(std::string(key), value);
+    };
+
+    json_for_each_member(a, scratch, add);
+    json_for_each_member(b, scratch, add);
+
+    out += '{';
+    for (size_t i = 0; i < members.size(); ++i) {
+        if (i) out += ',';
+        json_write_string(out, members[i].first);
+        out += ':';
+        out.append(members[i].second.data(), members[i].second.size());
+    }
+    out += '}';
+}
+
+void json_write_string(std::string& out, std::string_view s) {
+    out += '"';
+    json_write_escaped(out, s);
+    out += '"';
+}
+
+void json_write_escaped(std::string& out, std::string_view s) {
+    static const char hex[] = "0123456789abcdef";
+
+    const char* p = s.data();
+    const char* end = p + s.size();
+    const char* run = p;
+
+    for (; p < end; ++p) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        out.append(run, (size_t)(p - run));
+        run = p + 1;
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default: {
+                char u[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+                out.append(u, 6);
+            }
+        }
+    }
+    out.append(run, (size_t)(end - run));
+}
+
+void json_write_number(std::string& out, double v) {
+    if (!std::isfinite(v)) {
+        out += "null";
+        return;
+    }
+    if (v == 0) {
+        out += '0';   // JSON.stringify(-0) === "0"
+        return;
+    }
+
+    char buf[64];
+    if (v == std::trunc(v) && std::fabs(v) < 9.007199254740992e15) {
+        auto r = std::to_chars(buf, buf + sizeof(buf), (int64_t)v);
+        out.append(buf, (size_t)(r.ptr - buf));
+        return;
+    }
+
+    // Shortest round-trip digits, laid out by the Number::toString rules
+    auto r = std::to_chars(buf, buf + sizeof(buf) - 1, v, std::chars_format::scientific);
+    *r.ptr = '\0';
+    const char* p = buf;
+    if (*p == '-') {
+        out += '-';
+        ++p;
+    }
+
+    char digits[32];
+    int k = 0;
+    for (; p < r.ptr && *p != 'e'; ++p) {
+        if (*p != '.') digits[k++] = *p;
+    }
+    int n = std::atoi(p + 1) + 1;   // decimal point position
+
+    if (k <= n && n <= 21) {
+        out.append(digits, (size_t)k);
+        out.append((size_t)(n - k), '0');
+    } else if (0 < n && n <= 21) {
+        out.append(digits, (size_t)n);
+        out += '.';
+        out.append(digits + n, (size_t)(k - n));
+    } else if (-6 < n && n <= 0) {
+        out += "0.";
+        out.append((size_t)-n, '0');
+        out.append(digits, (size_t)k);
+    } else {
+        out += digits[0];
+        if (k > 1) {
+            out += '.';
+            out.append(digits + 1, (size_t)(k - 1));
+        }
+        out += n - 1 < 0 ? "e-" : "e+";
+        out += std::to_string(std::abs(n - 1));
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+// The small, validating subset of JSON the TAL pipeline needs: scanning and
+// skipping values in place, decoding strings and numbers, and writing
+// escaped output. Values are accepted exactly when JSON.parse accepts them
+// (nesting is capped at kJsonMaxDepth).
+
+constexpr int kJsonMaxDepth = 512;
+
+const char* json_skip_ws(const char* p, const char* end);
+
+// p points just past an opening quote. Returns the closing quote, or nullptr
+// if the string is unterminated, holds a raw control character or a bad
+// escape. has_escape is set if the body contains a backslash.
+const char* json_scan_string(const char* p, const char* end, bool& has_escape);
+
+// Decodes the body of a string (between the quotes) into out.
+void json_unescape(std::string_view body, std::string& out);
+
+// Returns the position after one complete value, or nullptr if it is invalid.
+const char* json_skip_value(const char* p, const char* end, int depth = 0);
+
+// Returns the position after a number, or nullptr if it is not one.
+const char* json_parse_number(const char* p, const char* end, double& out);
+
+// Truthiness of a raw JSON value as JavaScript sees it after JSON.parse.
+bool json_truthy(std::string_view raw);
+
+// Calls fn(key, raw_value) for each member of a raw object, in order.
+// Keys are decoded (scratch backs escaped ones). Returns false if raw is
+// not an object.
+template <typename Fn>
+bool json_for_each_member(std::string_view raw, std::string& scratch, Fn&& fn);
+
+// Writes {...a, ...b} for two raw objects; a non-object side contributes no
+// members.
+void json_merge_objects(std::string_view a, std::string_view b, std::string& out);
+
+void json_write_string(std::string& out, std::string_view s);
+
+// json_write_string() without the surrounding quotes
+void json_write_escaped(std::string& out, std::string_view s);
+
+// Formats like JSON.stringify: JavaScript's Number#toString layout of the
+// shortest round-trip digits, with non-finite values written as null.
+void json_write_number(std::string& out, double v);
+
+template <typename Fn>
+bool json_for_each_member(std::string_view raw, std::string& scratch, Fn&& fn) {
+    const char* p = raw.data();
+    const char* end = p + raw.size();
+
+    if (p == end || *p != '{') return false;
+    p = json_skip_ws(p + 1, end);
+    if (p < end && *p == '}') return true;
+
+    while (p < end && *p == '"') {
+        bool esc = false;
+        const char* kend = json_scan_string(p + 1, end, esc);
+        if (!kend) return false;
+
+        std::string_view key(p + 1, (size_t)(kend - p - 1));
+        if (esc) {
+            json_unescape(key, scratch);
+            key = scratch;
+        }
+
+        p = json_skip_ws(kend + 1, end);
+        if (p == end || *p != ':') return false;
+        p = json_skip_ws(p + 1, end);
+
+        const char* vend = json_skip_value(p, end, 1);
+        if (!vend) return false;
+        fn(key, std::string_view(p, (size_t)(vend - p)));
+
+        p = json_skip_ws(vend, end);
+        if (p < end && *p == ',') {
+            p = json_skip_ws(p + 1, end);
+            continue;
+        }
+        return p < end && *p == '}';
+    }
+    return false;
+}
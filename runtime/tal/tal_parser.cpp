@@ -0,0 +1,135 @@
+#include "tal_parser.h"
+#include "tal_json.h"
+#include <cmath>
+#include <cstring>
+
+enum class Member { RunId, Seq, Ts, Kind, Span, ParentSpan, NodeKey, Data, Other };
+
+static Member classify(std::string_view key) {
+    switch (key.size()) {
+        case 2:  if (key == "ts") return Member::Ts; break;
+        case 3:  if (key == "seq") return Member::Seq; break;
+        case 4:
+            if (key == "kind") return Member::Kind;
+            if (key == "span") return Member::Span;
+            if (key == "data") return Member::Data;
+            break;
+        case 5:  if (key == "runId") return Member::RunId; break;
+        case 7:  if (key == "nodeKey") return Member::NodeKey; break;
+        case 10: if (key == "parentSpan") return Member::ParentSpan; break;
+    }
+    return Member::Other;
+}
+
+bool TalParser::read_string(const char*& p, const char* end, Field f, std::string_view& out) {
+    if (p == end || *p != '"') return fail("expected string");
+
+    bool esc = false;
+    const char* q = json_scan_string(p + 1, end, esc);
+    if (!q) return fail("invalid string");
+
+    out = std::string_view(p + 1, (size_t)(q - p - 1));
+    if (esc) {
+        json_unescape(out, m_scratch[f]);
+        out = m_scratch[f];
+    }
+    p = q + 1;
+    return true;
+}
+
+bool TalParser::parse(const char* p, size_t n, TalEventView& ev) {
+    const char* end = p + n;
+    ev = TalEventView{};
+
+    bool have_run_id = false, have_seq = false, have_ts = false, have_kind = false;
+
+    p = json_skip_ws(p, end);
+    if (p == end || *p != '{') return fail("expected object");
+    p = json_skip_ws(p + 1, end);
+
+    if (p < end && *p == '}') {
+        ++p;
+    } else {
+        while (true) {
+            if (p == end || *p != '"') return fail("expected member name");
+
+            bool esc = false;
+            const char* kend = json_scan_string(p + 1, end, esc);
+            if (!kend) return fail("invalid member name");
+
+            std::string_view key(p + 1, (size_t)(kend - p - 1));
+            if (esc) {
+                json_unescape(key, m_key);
+                key = m_key;
+            }
+
+            p = json_skip_ws(kend + 1, end);
+            if (p == end || *p != ':') return fail("expected ':'");
+            p = json_skip_ws(p + 1, end);
+
+            // Duplicate members: the last one wins, as in JSON.parse
+            switch (classify(key)) {
+                case Member::RunId:
+                    if (!read_string(p, end, RunId, ev.run_id)) return fail("runId must be a string");
+                    have_run_id = true;
+                    break;
+                case Member::Kind:
+                    if (!read_string(p, end, Kind, ev.kind)) return fail("kind must be a string");
+                    have_kind = true;
+                    break;
+                case Member::Span:
+                    if (!read_string(p, end, Span, ev.span)) return fail("span must be a string");
+                    break;
+                case Member::ParentSpan:
+                    if (!read_string(p, end, ParentSpan, ev.parent_span)) return fail("parentSpan must be a string");
+                    break;
+                case Member::NodeKey:
+                    if (!read_string(p, end, NodeKey, ev.node_key)) return fail("nodeKey must be a string");
+                    ev.has_node_key = true;
+                    break;
+                case Member::Seq:
+                    p = json_parse_number(p, end, ev.seq);
+                    if (!p) return fail("seq must be a number");
+                    have_seq = true;
+                    break;
+                case Member::Ts:
+                    p = json_parse_number(p, end, ev.ts);
+                    if (!p) return fail("ts must be a number");
+                    have_ts = true;
+                    break;
+                case Member::Data: {
+                    const char* v = p;
+                    p = json_skip_value(p, end, 1);
+                    if (!p) return fail("invalid data");
+                    ev.data = std::string_view(v, (size_t)(p - v));
+                    break;
+                }
+                case Member::Other:
+                    p = json_skip_value(p, end, 1);
+                    if (!p) return fail("invalid JSON");
+                    break;
+            }
+
+            p = json_skip_ws(p, end);
+            if (p < end && *p == ',') {
+                p = json_skip_ws(p + 1, end);
+                continue;
+            }
+            if (p < end && *p == '}') {
+                ++p;
+                break;
+            }
+            return fail("expected ',' or '}'");
+        }
+    }
+
+    if (json_skip_ws(p, end) != end) return fail("trailing characters");
+
+    if (!have_run_id || ev.run_id.empty()) return fail("runId is required");
+    if (!have_seq || !std::isfinite(ev.seq) || ev.seq < 0 || ev.seq != std::trunc(ev.seq)) {
+        return fail("seq must be a non-negative integer");
+    }
+    if (!have_ts) return fail("ts is required");
+    if (!have_kind) return fail("kind is required");
+    return true;
+}
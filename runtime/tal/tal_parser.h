@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// One TAL event as validated against TalEventSchema
+// (servers/agents/pipeline/t1_parser.ts). String views point into the input
+// or into the parser's scratch buffers and stay valid until the next parse().
+struct TalEventView {
+    std::string_view run_id;
+    double seq;
+    double ts;
+    std::string_view kind;
+
+    // Optional fields: absent and "" behave the same way everywhere the
+    // correlator looks at them, so only the value is kept
+    std::string_view span;
+    std::string_view parent_span;
+    std::string_view node_key;
+    bool has_node_key;            // nodeKey ?? ... treats "" as present
+
+    std::string_view data;        // raw JSON value; empty if absent
+};
+
+// Single-pass parser for one JSON-encoded TAL event. Accepts exactly the
+// documents JSON.parse + TalEventSchema.parse accept: unknown members are
+// skipped but still validated, and an optional member set to null is an
+// error, as it is for zod's .optional().
+class TalParser {
+public:
+    bool parse(const char* p, size_t n, TalEventView& ev);
+
+    // Reason for the last rejection
+    const char* error() const { return m_error; }
+
+private:
+    enum Field { RunId, Kind, Span, ParentSpan, NodeKey, FieldCount };
+
+    bool read_string(const char*& p, const char* end, Field f, std::string_view& out);
+    bool fail(const char* why) {
+        m_error = why;
+        return false;
+    }
+
+    std::string m_scratch[FieldCount];
+    std::string m_key;
+    const char* m_error = "";
+};
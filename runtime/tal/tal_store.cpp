@@ -0,0 +1,982 @@
+#include "tal_store.h"
+#include "tal_json.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Store layout, little-endian. The checkpoint file:
+//   CheckpointHeader, then a TalBlockRef per block, oldest first
+// A segment is a run of blocks, each 8-byte aligned:
+//   BlockHeader, then the columns in Column order, each padded to 8 bytes
+// Node columns hold one entry per record, ordered by NodeSeq (the seq of
+// the node's last change before the checkpoint); that order, together with
+// each block's at_seq, is the seq index. Strings are the graph's string ids
+// first_string onwards; NodeId, EdgeFromId and EdgeToId are id keys (a
+// string id, with bit 31 set for "span:" + the string); NodeIndex, EdgeFrom
+// and EdgeTo are node indices (num - 1); kNone marks an absent string.
+// NodeEndedAt and NodeEndedSeq are NaN while a node runs, and a zero-length
+// NodeData is {}. Only the first block of a store may hold the whole graph;
+// every block carries all counters.
+
+static constexpr uint32_t kNone = StringInterner::kNone;
+static constexpr uint32_t kSpanId = 0x80000000u;
+static constexpr uint64_t kSegmentBytes = 64ull << 20;
+// Blocks a checkpoint lists before the store is rewritten whole
+static constexpr size_t kMaxBlocks = 4096;
+
+struct CheckpointHeader {
+    char magic[4];          // "KTSC"
+    uint32_t version;
+    double at_seq;
+    uint32_t strings, nodes, edges, blocks;
+    uint64_t records;       // node records across blocks
+};
+static_assert(sizeof(CheckpointHeader) == 40, "checkpoint header layout");
+static_assert(sizeof(TalBlockRef) == 32, "block ref layout");
+
+struct BlockHeader {
+    char magic[4];          // "KTSB"
+    uint32_t version;
+    uint64_t size;          // header and columns
+    double from_seq;        // at_seq of the checkpoint before, -1 for a whole graph
+    double at_seq;
+    uint32_t first_string, strings;
+    uint32_t first_edge, edges;
+    uint32_t nodes;         // node records
+    uint32_t total_nodes;   // graph nodes at at_seq
+    uint32_t counters;
+    uint32_t reserved;
+    uint64_t string_bytes, data_bytes;
+};
+static_assert(sizeof(BlockHeader) == 80, "block header layout");
+
+enum Column {
+    StrOff, StrBytes,                                           // u64[strings + 1], bytes
+    NodeSeq, NodeStartedAt, NodeEndedAt, NodeStartedSeq, NodeEndedSeq,   // f64
+    NodeDataOff,                                                // u64[nodes + 1]
+    NodeIndex, NodeId, NodeLabel, NodeKind, NodeSpan, NodeParent, NodeKey,
+    NodeErrors, NodeChildren,                                   // u32
+    NodeType, NodeStatus,                                       // u8
+    NodeData,                                                   // bytes
+    EdgeSeq, EdgeAt,                                            // f64
+    EdgeFrom, EdgeTo, EdgeFromId, EdgeToId, EdgeOrdinal,        // u32
+    EdgeKind,                                                   // u8
+    CounterCount,                                               // f64
+    CounterKind,                                                // u32
+    kColumns
+};
+static_assert(kColumns <= 32, "TalStore::Block::col");
+
+static uint64_t column_bytes(const BlockHeader& h, int c) {
+    const uint64_t nodes = h.nodes, edges = h.edges, counters = h.counters;
+    switch (c) {
+    case StrOff:       return 8 * ((uint64_t)h.strings + 1);
+    case StrBytes:     return h.string_bytes;
+    case NodeDataOff:  return 8 * (nodes + 1);
+    case NodeType:
+    case NodeStatus:   return nodes;
+    case NodeData:     return h.data_bytes;
+    case EdgeKind:     return edges;
+    case CounterCount: return 8 * counters;
+    case CounterKind:  return 4 * counters;
+    }
+    if (c <= NodeEndedSeq) return 8 * nodes;
+    if (c <= NodeChildren) return 4 * nodes;
+    if (c <= EdgeAt) return 8 * edges;
+    return 4 * edges;
+}
+
+// Fills col with column offsets from the block start and returns the block
+// size, or 0 if it would exceed limit
+static uint64_t block_layout(const BlockHeader& h, uint64_t* col, uint64_t limit) {
+    uint64_t off = sizeof(BlockHeader);
+    for (int c = 0; c < kColumns; ++c) {
+        col[c] = off;
+        uint64_t n = column_bytes(h, c);
+        if (n > limit || off + n > limit) return 0;
+        off += (n + 7) & ~7ull;
+    }
+    return off <= limit ? off : 0;
+}
+
+static const BlockHeader& header_of(const char* p) {
+    return *(const BlockHeader*)p;
+}
+
+template <typename T>
+static const T* column(const char* p, const uint64_t* col, int c) {
+    return (const T*)(p + col[c]);
+}
+
+static std::string segment_path(const std::string& dir, uint32_t segment) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/seg-%06u.kts", segment);
+    return dir + name;
+}
+
+static std::string sys_error(const char* what, const std::string& path) {
+    return std::string(what) + " " + path + ": " + std::strerror(errno);
+}
+
+static bool write_all(int fd, const char* p, size_t n, uint64_t offset) {
+    while (n > 0) {
+        ssize_t w = ::pwrite(fd, p, n, (off_t)offset);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= (size_t)w;
+        offset += (uint64_t)w;
+    }
+    return true;
+}
+
+// 1 with the checkpoint read, 0 if there is none, -1 on error
+static int read_checkpoint(const std::string& dir, CheckpointHeader& ch,
+                           std::vector<TalBlockRef>& blocks, std::string& err) {
+    std::string path = dir + "/checkpoint";
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) return 0;
+        err = sys_error("open", path);
+        return -1;
+    }
+
+    struct stat st;
+    std::string buf;
+    bool ok = ::fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(ch);
+    if (ok) {
+        buf.resize((size_t)st.st_size);
+        size_t got = 0;
+        while (got < buf.size()) {
+            ssize_t n = ::pread(fd, buf.data() + got, buf.size() - got, (off_t)got);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            got += (size_t)n;
+        }
+        ok = got == buf.size();
+    }
+    ::close(fd);
+
+    if (ok) {
+        std::memcpy(&ch, buf.data(), sizeof(ch));
+        ok = std::memcmp(ch.magic, "KTSC", 4) == 0 && ch.version == 1 && ch.blocks > 0 &&
+             buf.size() == sizeof(ch) + (size_t)ch.blocks * sizeof(TalBlockRef);
+    }
+    if (!ok) {
+        err = "corrupt checkpoint " + path;
+        return -1;
+    }
+
+    blocks.resize(ch.blocks);
+    std::memcpy(blocks.data(), buf.data() + sizeof(ch), ch.blocks * sizeof(TalBlockRef));
+
+    // Blocks run back to back; a new segment starts at offset 0
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const TalBlockRef& b = blocks[i];
+        bool next = i == 0 ? b.offset == 0
+                  : b.segment == blocks[i - 1].segment ? b.offset == blocks[i - 1].offset + blocks[i - 1].size
+                  : b.segment == blocks[i - 1].segment + 1 && b.offset == 0;
+        if (!next || b.size < sizeof(BlockHeader) || b.size % 8 != 0) {
+            err = "corrupt checkpoint " + path;
+            return -1;
+        }
+    }
+    return 1;
+}
+
+// Removes segments outside the checkpoint's (a compacted store's old ones,
+// or one started by a checkpoint that never committed)
+static void remove_stale_segments(const std::string& dir, const std::vector<TalBlockRef>& blocks) {
+    DIR* d = ::opendir(dir.c_str());
+    if (!d) return;
+
+    while (dirent* e = ::readdir(d)) {
+        unsigned segment;
+        char tail;
+        if (std::sscanf(e->d_name, "seg-%u.kt%c", &segment, &tail) != 2 || tail != 's') continue;
+        if (!blocks.empty() && segment >= blocks.front().segment && segment <= blocks.back().segment) continue;
+        ::unlink((dir + "/" + e->d_name).c_str());
+    }
+    ::closedir(d);
+    ::unlink((dir + "/checkpoint.tmp").c_str());
+}
+
+bool TalStoreWriter::fail(std::string why) {
+    m_error = std::move(why);
+    return false;
+}
+
+bool TalStoreWriter::open(const std::string& dir) {
+    m_dir.clear();
+    m_blocks.clear();
+    m_at_seq = -1;
+    m_strings = m_nodes = m_edges = 0;
+    m_records = m_bytes = 0;
+
+    if (::mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST) {
+        return fail(sys_error("mkdir", dir));
+    }
+
+    CheckpointHeader ch;
+    int found = read_checkpoint(dir, ch, m_blocks, m_error);
+    if (found < 0) return false;
+
+    if (found) {
+        // Drop a block appended after the checkpoint
+        const TalBlockRef& tail = m_blocks.back();
+        std::string path = segment_path(dir, tail.segment);
+        if (::truncate(path.c_str(), (off_t)(tail.offset + tail.size)) < 0) {
+            m_blocks.clear();
+            return fail(sys_error("truncate", path));
+        }
+
+        m_at_seq = ch.at_seq;
+        m_strings = ch.strings;
+        m_nodes = ch.nodes;
+        m_edges = ch.edges;
+        m_records = ch.records;
+        for (const TalBlockRef& b : m_blocks) m_bytes += b.size;
+    }
+    remove_stale_segments(dir, m_blocks);
+
+    m_dir = dir;
+    return true;
+}
+
+bool TalStoreWriter::checkpoint(const TalGraph& g) {
+    if (m_dir.empty()) return fail("store not open");
+
+    const uint32_t strings = (uint32_t)g.m_strings.size();
+    const uint32_t nodes = (uint32_t)g.node_count();
+    const uint32_t edges = (uint32_t)g.edge_count();
+    if (g.m_last_seq < m_at_seq || strings < m_strings || nodes < m_nodes || edges < m_edges) {
+        return fail("graph does not extend the store in " + m_dir);
+    }
+    if (!m_blocks.empty() && g.m_last_seq == m_at_seq) return true;
+
+    // Rewrite the whole graph once superseded records dominate, or the
+    // checkpoint itself grows long
+    const bool whole = m_blocks.empty() || m_blocks.size() >= kMaxBlocks ||
+                       m_records > 4 * (uint64_t)nodes + 65536;
+
+    // Live change-log entries after the last checkpoint, in seq order
+    std::vector<uint32_t> recs;
+    for (size_t i = whole ? 0 : g.log_since(m_at_seq); i < g.m_log_node.size(); ++i) {
+        if (g.m_node_log[g.m_log_node[i]] == i) recs.push_back((uint32_t)i);
+    }
+
+    BlockHeader h{};
+    std::memcpy(h.magic, "KTSB", 4);
+    h.version = 1;
+    h.from_seq = whole ? -1 : m_at_seq;
+    h.at_seq = g.m_last_seq;
+    h.first_string = whole ? 0 : m_strings;
+    h.strings = strings - h.first_string;
+    h.first_edge = whole ? 0 : m_edges;
+    h.edges = edges - h.first_edge;
+    h.nodes = (uint32_t)recs.size();
+    h.total_nodes = nodes;
+    h.counters = (uint32_t)g.m_counters.size();
+    for (uint32_t sid = h.first_string; sid < strings; ++sid) h.string_bytes += g.m_strings.str(sid).size();
+    for (uint32_t pos : recs) h.data_bytes += g.m_node_data_len[g.m_log_node[pos]];
+
+    uint64_t col[kColumns];
+    h.size = block_layout(h, col, UINT64_MAX);
+
+    m_buf.assign(h.size, '\0');
+    char* base = m_buf.data();
+    std::memcpy(base, &h, sizeof(h));
+    auto put = [&](int c, size_t i, auto v) { std::memcpy(base + col[c] + i * sizeof(v), &v, sizeof(v)); };
+
+    uint64_t off = 0;
+    for (uint32_t i = 0; i < h.strings; ++i) {
+        std::string_view s = g.m_strings.str(h.first_string + i);
+        put(StrOff, i, off);
+        std::memcpy(base + col[StrBytes] + off, s.data(), s.size());
+        off += s.size();
+    }
+    put(StrOff, h.strings, off);
+
+    off = 0;
+    for (uint32_t r = 0; r < h.nodes; ++r) {
+        uint32_t pos = recs[r];
+        uint32_t n = g.m_log_node[pos];
+        put(NodeSeq, r, g.m_log_seq[pos]);
+        put(NodeStartedAt, r, g.m_node_started_at[n]);
+        put(NodeEndedAt, r, g.m_node_ended_at[n]);
+        put(NodeStartedSeq, r, g.m_node_started_seq[n]);
+        put(NodeEndedSeq, r, g.m_node_ended_seq[n]);
+        put(NodeIndex, r, n);
+        put(NodeId, r, g.m_node_id[n]);
+        put(NodeLabel, r, g.m_node_label[n]);
+        put(NodeKind, r, g.m_node_kind[n]);
+        put(NodeSpan, r, g.m_node_span[n]);
+        put(NodeParent, r, g.m_node_parent[n]);
+        put(NodeKey, r, g.m_node_key[n]);
+        put(NodeErrors, r, g.m_node_errors[n]);
+        put(NodeChildren, r, g.m_node_children[n]);
+        put(NodeType, r, (uint8_t)g.m_node_type[n]);
+        put(NodeStatus, r, (uint8_t)g.m_node_status[n]);
+
+        uint32_t len = g.m_node_data_len[n];
+        put(NodeDataOff, r, off);
+        std::memcpy(base + col[NodeData] + off, g.m_data.data() + g.m_node_data_off[n], len);
+        off += len;
+    }
+    put(NodeDataOff, h.nodes, off);
+
+    for (uint32_t i = 0; i < h.edges; ++i) {
+        uint32_t e = h.first_edge + i;
+        put(EdgeSeq, i, g.m_edge_seq[e]);
+        put(EdgeAt, i, g.m_edge_at[e]);
+        put(EdgeFrom, i, g.m_edge_from[e]);
+        put(EdgeTo, i, g.m_edge_to[e]);
+        put(EdgeFromId, i, g.m_node_id[g.m_edge_from[e]]);
+        put(EdgeToId, i, g.m_node_id[g.m_edge_to[e]]);
+        put(EdgeOrdinal, i, g.m_edge_ordinal[e]);
+        put(EdgeKind, i, (uint8_t)g.m_edge_kind[e]);
+    }
+
+    for (uint32_t i = 0; i < h.counters; ++i) {
+        put(CounterCount, i, g.m_counters[i]);
+        put(CounterKind, i, g.m_counters_kind[i]);
+    }
+
+    // A whole graph starts a fresh segment, as does a full segment
+    TalBlockRef ref{0, 0, 0, h.size, h.at_seq};
+    if (!m_blocks.empty()) {
+        const TalBlockRef& tail = m_blocks.back();
+        ref.segment = tail.segment;
+        ref.offset = tail.offset + tail.size;
+        if (whole || ref.offset >= kSegmentBytes) {
+            ref.segment++;
+            ref.offset = 0;
+        }
+    }
+
+    std::string path = segment_path(m_dir, ref.segment);
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (ref.offset == 0 ? O_TRUNC : 0), 0644);
+    if (fd < 0) return fail(sys_error("open", path));
+    bool written = write_all(fd, m_buf.data(), m_buf.size(), ref.offset) && ::fdatasync(fd) == 0;
+    ::close(fd);
+    if (!written) return fail(sys_error("write", path));
+
+    std::vector<TalBlockRef> blocks;
+    if (!whole) blocks = m_blocks;
+    blocks.push_back(ref);
+
+    uint64_t records = (whole ? 0 : m_records) + h.nodes;
+
+    CheckpointHeader ch{};
+    std::memcpy(ch.magic, "KTSC", 4);
+    ch.version = 1;
+    ch.at_seq = h.at_seq;
+    ch.strings = strings;
+    ch.nodes = nodes;
+    ch.edges = edges;
+    ch.blocks = (uint32_t)blocks.size();
+    ch.records = records;
+
+    m_buf.assign((const char*)&ch, sizeof(ch));
+    m_buf.append((const char*)blocks.data(), blocks.size() * sizeof(TalBlockRef));
+
+    // Commit: the new checkpoint replaces the old one in a single rename
+    std::string tmp = m_dir + "/checkpoint.tmp";
+    fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return fail(sys_error("open", tmp));
+    written = write_all(fd, m_buf.data(), m_buf.size(), 0) && ::fdatasync(fd) == 0;
+    ::close(fd);
+    if (!written) return fail(sys_error("write", tmp));
+
+    if (::rename(tmp.c_str(), (m_dir + "/checkpoint").c_str()) < 0) {
+        return fail(sys_error("rename", tmp));
+    }
+    int dfd = ::open(m_dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd >= 0) {
+        ::fsync(dfd);
+        ::close(dfd);
+    }
+
+    m_blocks.swap(blocks);
+    m_at_seq = h.at_seq;
+    m_strings = strings;
+    m_nodes = nodes;
+    m_edges = edges;
+    m_records = records;
+    m_bytes = 0;
+    for (const TalBlockRef& b : m_blocks) m_bytes += b.size;
+
+    if (whole) remove_stale_segments(m_dir, m_blocks);
+    m_buf.clear();
+    return true;
+}
+
+TalStore::~TalStore() {
+    close();
+}
+
+bool TalStore::fail(std::string why) const {
+    m_error = std::move(why);
+    return false;
+}
+
+bool TalStore::exists(const std::string& dir) {
+    struct stat st;
+    return ::stat((dir + "/checkpoint").c_str(), &st) == 0;
+}
+
+void TalStore::close() {
+    for (const Segment& s : m_segments) {
+        if (s.base) ::munmap(s.base, s.len);
+    }
+    m_segments.clear();
+    m_blocks.clear();
+    m_latest.clear();
+    m_at_seq = -1;
+    m_strings = m_nodes = m_edges = 0;
+    m_bytes = 0;
+}
+
+bool TalStore::open(const std::string& dir) {
+    close();
+
+    // A writer compacting the store may unlink the segments the checkpoint
+    // just read named; the next read sees the new ones
+    for (int attempt = 0;; ++attempt) {
+        CheckpointHeader ch;
+        std::vector<TalBlockRef> refs;
+        int found = read_checkpoint(dir, ch, refs, m_error);
+        if (found == 0) return fail("no checkpoint in " + dir);
+        if (found < 0) return false;
+
+        const uint32_t first = refs.front().segment;
+        bool missing = false;
+        for (uint32_t seg = first; seg <= refs.back().segment; ++seg) {
+            uint64_t need = 0;
+            for (const TalBlockRef& b : refs) {
+                if (b.segment == seg) need = b.offset + b.size;
+            }
+
+            std::string path = segment_path(dir, seg);
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                missing = errno == ENOENT;
+                if (!missing) fail(sys_error("open", path));
+                break;
+            }
+            struct stat st;
+            void* base = MAP_FAILED;
+            if (::fstat(fd, &st) == 0 && (uint64_t)st.st_size >= need && need > 0) {
+                base = ::mmap(nullptr, need, PROT_READ, MAP_SHARED, fd, 0);
+            }
+            ::close(fd);
+            if (base == MAP_FAILED) {
+                fail("cannot map " + path);
+                break;
+            }
+            m_segments.push_back(Segment{base, need});
+        }
+
+        if (m_segments.size() != refs.back().segment - first + 1) {
+            close();
+            if (missing && attempt < 3) continue;
+            if (missing) fail("segments of " + dir + " keep disappearing");
+            return false;
+        }
+
+        uint32_t strings = 0, edges = 0;
+        for (const TalBlockRef& ref : refs) {
+            const Segment& seg = m_segments[ref.segment - first];
+            Block b;
+            b.p = (const char*)seg.base + ref.offset;
+            const BlockHeader& h = header_of(b.p);
+
+            if (std::memcmp(h.magic, "KTSB", 4) != 0 || h.version != 1 || h.size != ref.size ||
+                block_layout(h, b.col, ref.size) != h.size || h.first_string != strings ||
+                h.first_edge != edges) {
+                close();
+                return fail("corrupt block in " + segment_path(dir, ref.segment));
+            }
+            strings += h.strings;
+            edges += h.edges;
+            m_blocks.push_back(b);
+            m_bytes += ref.size;
+        }
+
+        if (strings != ch.strings || edges != ch.edges ||
+            header_of(m_blocks.back().p).total_nodes != ch.nodes) {
+            close();
+            return fail("checkpoint of " + dir + " does not match its blocks");
+        }
+        m_at_seq = ch.at_seq;
+        m_strings = ch.strings;
+        m_nodes = ch.nodes;
+        m_edges = ch.edges;
+        return true;
+    }
+}
+
+std::string_view TalStore::str(uint32_t sid) const {
+    // The last block with strings that starts at or before sid
+    auto it = std::upper_bound(m_blocks.begin(), m_blocks.end(), sid,
+        [](uint32_t s, const Block& b) { return s < header_of(b.p).first_string; });
+    while (it != m_blocks.begin()) {
+        --it;
+        const BlockHeader& h = header_of(it->p);
+        if (h.strings == 0) continue;
+        if (sid - h.first_string >= h.strings) return {};
+
+        const uint64_t* off = column<uint64_t>(it->p, it->col, StrOff) + (sid - h.first_string);
+        if (off[0] > off[1] || off[1] > h.string_bytes) return {};
+        return std::string_view(column<char>(it->p, it->col, StrBytes) + off[0], off[1] - off[0]);
+    }
+    return {};
+}
+
+uint32_t TalStore::find_str(std::string_view s) const {
+    for (const Block& b : m_blocks) {
+        const BlockHeader& h = header_of(b.p);
+        const uint64_t* off = column<uint64_t>(b.p, b.col, StrOff);
+        const char* bytes = column<char>(b.p, b.col, StrBytes);
+
+        // Lengths first, so most strings are never read
+        for (uint32_t i = 0; i < h.strings; ++i) {
+            if (off[i + 1] - off[i] != s.size() || off[i + 1] > h.string_bytes) continue;
+            if (std::memcmp(bytes + off[i], s.data(), s.size()) == 0) return h.first_string + i;
+        }
+    }
+    return kNone;
+}
+
+const std::vector<uint64_t>& TalStore::latest() const {
+    if (!m_latest.empty() || m_nodes == 0) return m_latest;
+
+    m_latest.assign(m_nodes, UINT64_MAX);
+    for (size_t b = 0; b < m_blocks.size(); ++b) {
+        const Block& blk = m_blocks[b];
+        const uint32_t* idx = column<uint32_t>(blk.p, blk.col, NodeIndex);
+        for (uint32_t r = 0; r < header_of(blk.p).nodes; ++r) {
+            if (idx[r] < m_nodes) m_latest[idx[r]] = (uint64_t)b << 32 | r;
+        }
+    }
+    return m_latest;
+}
+
+bool TalStore::load(TalGraph& g) const {
+    if (g.node_count() != 0 || g.m_strings.size() != 0) return fail("load needs an empty graph");
+    if (m_blocks.empty()) return fail("store not open");
+
+    g.m_last_seq = m_at_seq;
+
+    for (const Block& b : m_blocks) {
+        const BlockHeader& h = header_of(b.p);
+        for (uint32_t i = 0; i < h.strings; ++i) {
+            uint32_t sid = h.first_string + i;
+            if (g.intern(str(sid)) != sid) return fail("duplicate string in store");
+        }
+    }
+
+    auto valid = [this](uint32_t sid) { return sid < m_strings; };
+    auto valid_opt = [this](uint32_t sid) { return sid == kNone || sid < m_strings; };
+
+    const std::vector<uint64_t>& lat = latest();
+    std::vector<double> change_seq(m_nodes);
+
+    for (uint32_t n = 0; n < m_nodes; ++n) {
+        if (lat[n] == UINT64_MAX) return fail("node missing from store");
+        const Block& b = m_blocks[lat[n] >> 32];
+        const uint32_t r = (uint32_t)lat[n];
+        const BlockHeader& h = header_of(b.p);
+
+        uint32_t id = column<uint32_t>(b.p, b.col, NodeId)[r];
+        uint32_t label = column<uint32_t>(b.p, b.col, NodeLabel)[r];
+        uint32_t kind = column<uint32_t>(b.p, b.col, NodeKind)[r];
+        uint32_t span = column<uint32_t>(b.p, b.col, NodeSpan)[r];
+        uint32_t parent = column<uint32_t>(b.p, b.col, NodeParent)[r];
+        uint32_t key = column<uint32_t>(b.p, b.col, NodeKey)[r];
+        uint8_t type = column<uint8_t>(b.p, b.col, NodeType)[r];
+        uint8_t status = column<uint8_t>(b.p, b.col, NodeStatus)[r];
+        const uint64_t* doff = column<uint64_t>(b.p, b.col, NodeDataOff) + r;
+
+        if (!valid(id & ~kSpanId) || !valid(label) || !valid(kind) || !valid_opt(span) ||
+            !valid_opt(parent) || !valid_opt(key) || type > 7 || status > 2 ||
+            doff[0] > doff[1] || doff[1] > h.data_bytes) {
+            return fail("corrupt node record in store");
+        }
+
+        std::string_view data(column<char>(b.p, b.col, NodeData) + doff[0], doff[1] - doff[0]);
+        g.add_node(id, label, (TalGraph::NodeType)type, kind, span, parent, key,
+                   column<double>(b.p, b.col, NodeStartedAt)[r],
+                   column<double>(b.p, b.col, NodeStartedSeq)[r], (TalGraph::Status)status, data,
+                   column<uint32_t>(b.p, b.col, NodeErrors)[r],
+                   column<uint32_t>(b.p, b.col, NodeChildren)[r]);
+        g.m_node_ended_at[n] = column<double>(b.p, b.col, NodeEndedAt)[r];
+        g.m_node_ended_seq[n] = column<double>(b.p, b.col, NodeEndedSeq)[r];
+        if (span != kNone) g.map_span(span, n);
+        change_seq[n] = column<double>(b.p, b.col, NodeSeq)[r];
+    }
+
+    uint32_t empty = g.m_strings.find("");
+    if (empty != kNone) g.m_empty_id_node = g.m_slots[empty].node;
+
+    // The change-log as compaction would leave it: one entry per node
+    std::vector<uint32_t> order(m_nodes);
+    for (uint32_t n = 0; n < m_nodes; ++n) order[n] = n;
+    std::stable_sort(order.begin(), order.end(),
+                     [&](uint32_t a, uint32_t b) { return change_seq[a] < change_seq[b]; });
+    g.m_log_node = order;
+    g.m_log_seq.resize(m_nodes);
+    for (uint32_t i = 0; i < m_nodes; ++i) {
+        g.m_log_seq[i] = change_seq[order[i]];
+        g.m_node_log[order[i]] = i;
+    }
+
+    for (const Block& b : m_blocks) {
+        const BlockHeader& h = header_of(b.p);
+        const uint32_t* from = column<uint32_t>(b.p, b.col, EdgeFrom);
+        const uint32_t* to = column<uint32_t>(b.p, b.col, EdgeTo);
+        const uint8_t* kind = column<uint8_t>(b.p, b.col, EdgeKind);
+
+        for (uint32_t i = 0; i < h.edges; ++i) {
+            if (from[i] >= m_nodes || to[i] >= m_nodes || kind[i] > 6) {
+                return fail("corrupt edge record in store");
+            }
+            g.m_edge_set.insert((uint64_t)from[i] << 32 | to[i]);
+            g.add_edge(from[i], to[i], column<double>(b.p, b.col, EdgeSeq)[i],
+                       (TalGraph::EdgeKind)kind[i], column<double>(b.p, b.col, EdgeAt)[i]);
+        }
+    }
+
+    const Block& tail = m_blocks.back();
+    const uint32_t* kinds = column<uint32_t>(tail.p, tail.col, CounterKind);
+    const double* counts = column<double>(tail.p, tail.col, CounterCount);
+    for (uint32_t i = 0; i < header_of(tail.p).counters; ++i) {
+        if (!valid(kinds[i])) return fail("corrupt counter in store");
+        g.slot(kinds[i]).counter = i;
+        g.m_counters_kind.push_back(kinds[i]);
+        g.m_counters.push_back(counts[i]);
+    }
+    return true;
+}
+
+void TalStore::write_opt(std::string& out, uint32_t sid) const {
+    if (sid == kNone) {
+        out += "null";
+    } else {
+        json_write_string(out, str(sid));
+    }
+}
+
+void TalStore::write_id(std::string& out, uint32_t key) const {
+    if (key & kSpanId) {
+        out += "\"span:";
+        json_write_escaped(out, str(key & ~kSpanId));
+        out += '"';
+    } else {
+        json_write_string(out, str(key));
+    }
+}
+
+void TalStore::write_head(std::string& out) const {
+    out += "{\"cursor\":{\"lastSeq\":";
+    json_write_number(out, m_at_seq);
+    out += ",\"nodeNum\":";
+    json_write_number(out, m_nodes);
+    out += '}';
+}
+
+// TalGraph::write_node() from a stored record
+void TalStore::write_node(std::string& out, const Block& b, uint32_t r) const {
+    const char* p = b.p;
+    const uint64_t* col = b.col;
+
+    out += "{\"id\":";
+    write_id(out, column<uint32_t>(p, col, NodeId)[r]);
+    out += ",\"num\":";
+    json_write_number(out, (double)column<uint32_t>(p, col, NodeIndex)[r] + 1);
+    out += ",\"label\":";
+    json_write_string(out, str(column<uint32_t>(p, col, NodeLabel)[r]));
+    out += ",\"type\":\"";
+    out += tal_node_type_name(column<uint8_t>(p, col, NodeType)[r] & 7);
+    out += "\",\"kind\":";
+    json_write_string(out, str(column<uint32_t>(p, col, NodeKind)[r]));
+    out += ",\"span\":";
+    write_opt(out, column<uint32_t>(p, col, NodeSpan)[r]);
+    out += ",\"parentSpan\":";
+    write_opt(out, column<uint32_t>(p, col, NodeParent)[r]);
+    out += ",\"key\":";
+    write_opt(out, column<uint32_t>(p, col, NodeKey)[r]);
+
+    double started_at = column<double>(p, col, NodeStartedAt)[r];
+    double ended_at = column<double>(p, col, NodeEndedAt)[r];
+    double ended_seq = column<double>(p, col, NodeEndedSeq)[r];
+    bool ended = !std::isnan(ended_seq);
+
+    out += ",\"startedAt\":";
+    json_write_number(out, started_at);
+    out += ",\"endedAt\":";
+    if (ended) json_write_number(out, ended_at); else out += "null";
+    out += ",\"duration\":";
+    if (ended) json_write_number(out, ended_at - started_at); else out += "null";
+    out += ",\"startedSeq\":";
+    json_write_number(out, column<double>(p, col, NodeStartedSeq)[r]);
+    out += ",\"endedSeq\":";
+    if (ended) json_write_number(out, ended_seq); else out += "null";
+
+    uint8_t status = column<uint8_t>(p, col, NodeStatus)[r];
+    const uint64_t* doff = column<uint64_t>(p, col, NodeDataOff) + r;
+    std::string_view data = "{}";
+    if (doff[0] < doff[1] && doff[1] <= header_of(p).data_bytes) {
+        data = std::string_view(column<char>(p, col, NodeData) + doff[0], doff[1] - doff[0]);
+    }
+
+    out += ",\"status\":\"";
+    out += tal_status_name(status < 3 ? status : 0);
+    out += "\",\"data\":";
+    out += data;
+    out += ",\"props\":{\"errorCount\":";
+    json_write_number(out, column<uint32_t>(p, col, NodeErrors)[r]);
+    out += ",\"childCount\":";
+    json_write_number(out, column<uint32_t>(p, col, NodeChildren)[r]);
+    out += "}}";
+}
+
+void TalStore::write_edge(std::string& out, const Block& b, uint32_t e) const {
+    out += "{\"from\":";
+    write_id(out, column<uint32_t>(b.p, b.col, EdgeFromId)[e]);
+    out += ",\"to\":";
+    write_id(out, column<uint32_t>(b.p, b.col, EdgeToId)[e]);
+    out += ",\"ordinal\":";
+    json_write_number(out, column<uint32_t>(b.p, b.col, EdgeOrdinal)[e]);
+    out += ",\"createdSeq\":";
+    json_write_number(out, column<double>(b.p, b.col, EdgeSeq)[e]);
+    out += ",\"kind\":\"";
+    uint8_t kind = column<uint8_t>(b.p, b.col, EdgeKind)[e];
+    out += tal_edge_kind_name(kind < 7 ? kind : 0);
+    out += "\",\"createdAt\":";
+    json_write_number(out, column<double>(b.p, b.col, EdgeAt)[e]);
+    out += '}';
+}
+
+void TalStore::write_range(std::string& out, double from_seq, double to_seq) const {
+    write_head(out);
+    out += ",\"fromSeq\":";
+    json_write_number(out, from_seq);
+    out += ",\"toSeq\":";
+    json_write_number(out, to_seq);
+
+    // Newest blocks first: a node's first record seen is its latest, and a
+    // block checkpointed at or before from_seq holds nothing newer
+    struct Hit {
+        double seq;
+        uint32_t block, record;
+    };
+    std::vector<Hit> hits;
+    std::vector<bool> seen(m_nodes);
+
+    for (size_t b = m_blocks.size(); b-- > 0;) {
+        const Block& blk = m_blocks[b];
+        const BlockHeader& h = header_of(blk.p);
+        if (h.at_seq <= from_seq) break;
+
+        const double* seq = column<double>(blk.p, blk.col, NodeSeq);
+        const uint32_t* idx = column<uint32_t>(blk.p, blk.col, NodeIndex);
+        uint32_t lo = (uint32_t)(std::upper_bound(seq, seq + h.nodes, from_seq) - seq);
+        uint32_t hi = (uint32_t)(std::upper_bound(seq, seq + h.nodes, to_seq) - seq);
+
+        for (uint32_t r = lo; r < hi; ++r) {
+            if (idx[r] < m_nodes && !seen[idx[r]]) hits.push_back(Hit{seq[r], (uint32_t)b, r});
+        }
+        for (uint32_t r = 0; r < h.nodes; ++r) {
+            if (idx[r] < m_nodes) seen[idx[r]] = true;
+        }
+    }
+    std::stable_sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) { return a.seq < b.seq; });
+
+    out += ",\"nodes\":[";
+    for (size_t i = 0; i < hits.size(); ++i) {
+        if (i) out += ',';
+        write_node(out, m_blocks[hits[i].block], hits[i].record);
+    }
+
+    // Edges are stored once each, in seq order across blocks
+    out += "],\"edges\":[";
+    bool first = true;
+    for (const Block& blk : m_blocks) {
+        const BlockHeader& h = header_of(blk.p);
+        if (h.edges == 0) continue;
+
+        const double* seq = column<double>(blk.p, blk.col, EdgeSeq);
+        if (seq[h.edges - 1] <= from_seq) continue;
+        if (seq[0] > to_seq) break;
+
+        uint32_t lo = (uint32_t)(std::upper_bound(seq, seq + h.edges, from_seq) - seq);
+        uint32_t hi = (uint32_t)(std::upper_bound(seq, seq + h.edges, to_seq) - seq);
+        for (uint32_t e = lo; e < hi; ++e) {
+            if (!first) out += ',';
+            first = false;
+            write_edge(out, blk, e);
+        }
+    }
+    out += "]}";
+}
+
+uint32_t TalStore::find_node(std::string_view id) const {
+    uint32_t key = kNone;
+    if (id.substr(0, 5) == "span:") {
+        uint32_t sid = find_str(id.substr(5));
+        if (sid != kNone) key = kSpanId | sid;
+    } else {
+        key = find_str(id);
+    }
+    if (key == kNone) return kNone;
+
+    const std::vector<uint64_t>& lat = latest();
+    for (uint32_t n = 0; n < m_nodes; ++n) {
+        if (lat[n] == UINT64_MAX) continue;
+        const Block& b = m_blocks[lat[n] >> 32];
+        if (column<uint32_t>(b.p, b.col, NodeId)[(uint32_t)lat[n]] == key) return n;
+    }
+    return kNone;
+}
+
+bool TalStore::node(uint32_t n, TalNodeRecord& out) const {
+    if (n >= m_nodes) return false;
+    uint64_t at = latest()[n];
+    if (at == UINT64_MAX) return false;
+
+    const Block& b = m_blocks[at >> 32];
+    const uint32_t r = (uint32_t)at;
+    const char* p = b.p;
+    const uint64_t* col = b.col;
+
+    out.id = column<uint32_t>(p, col, NodeId)[r];
+    out.label = column<uint32_t>(p, col, NodeLabel)[r];
+    out.kind = column<uint32_t>(p, col, NodeKind)[r];
+    out.type = column<uint8_t>(p, col, NodeType)[r] & 7;
+    out.status = column<uint8_t>(p, col, NodeStatus)[r];
+    if (out.status > 2) out.status = 0;
+    out.seq = column<double>(p, col, NodeSeq)[r];
+    out.started_at = column<double>(p, col, NodeStartedAt)[r];
+    out.ended_at = column<double>(p, col, NodeEndedAt)[r];
+    out.ended = !std::isnan(column<double>(p, col, NodeEndedSeq)[r]);
+    out.errors = column<uint32_t>(p, col, NodeErrors)[r];
+    out.children = column<uint32_t>(p, col, NodeChildren)[r];
+
+    const uint64_t* doff = column<uint64_t>(p, col, NodeDataOff) + r;
+    out.data = "{}";
+    if (doff[0] < doff[1] && doff[1] <= header_of(p).data_bytes) {
+        out.data = std::string_view(column<char>(p, col, NodeData) + doff[0], doff[1] - doff[0]);
+    }
+    return true;
+}
+
+bool TalStore::edge(uint32_t e, TalEdgeRecord& out) const {
+    if (e >= m_edges) return false;
+
+    // The last block whose edges start at or before e
+    auto it = std::upper_bound(m_blocks.begin(), m_blocks.end(), e,
+        [](uint32_t x, const Block& b) { return x < header_of(b.p).first_edge; });
+    while (it != m_blocks.begin()) {
+        --it;
+        const BlockHeader& h = header_of(it->p);
+        if (h.edges == 0) continue;
+        if (e - h.first_edge >= h.edges) return false;
+
+        const uint32_t i = e - h.first_edge;
+        const char* p = it->p;
+        const uint64_t* col = it->col;
+        out.from = column<uint32_t>(p, col, EdgeFrom)[i];
+        out.to = column<uint32_t>(p, col, EdgeTo)[i];
+        out.from_id = column<uint32_t>(p, col, EdgeFromId)[i];
+        out.to_id = column<uint32_t>(p, col, EdgeToId)[i];
+        out.ordinal = column<uint32_t>(p, col, EdgeOrdinal)[i];
+        out.kind = column<uint8_t>(p, col, EdgeKind)[i];
+        if (out.kind > 6) out.kind = 0;
+        out.seq = column<double>(p, col, EdgeSeq)[i];
+        out.created_at = column<double>(p, col, EdgeAt)[i];
+        return out.from < m_nodes && out.to < m_nodes;
+    }
+    return false;
+}
+
+bool TalStore::write_subtree(std::string& out, std::string_view root_id, uint32_t depth) const {
+    const uint32_t root = find_node(root_id);
+    if (root == kNone) return false;
+    const std::vector<uint64_t>& lat = latest();
+
+    // Out-edges per node, as (block << 32 | edge)
+    std::vector<uint32_t> start(m_nodes + 1, 0);
+    for (const Block& b : m_blocks) {
+        const uint32_t* from = column<uint32_t>(b.p, b.col, EdgeFrom);
+        for (uint32_t e = 0; e < header_of(b.p).edges; ++e) {
+            if (from[e] < m_nodes) start[from[e] + 1]++;
+        }
+    }
+    for (uint32_t n = 0; n < m_nodes; ++n) start[n + 1] += start[n];
+
+    std::vector<uint64_t> out_edges(start[m_nodes]);
+    std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+    for (size_t bi = 0; bi < m_blocks.size(); ++bi) {
+        const Block& b = m_blocks[bi];
+        const uint32_t* from = column<uint32_t>(b.p, b.col, EdgeFrom);
+        for (uint32_t e = 0; e < header_of(b.p).edges; ++e) {
+            if (from[e] < m_nodes) out_edges[fill[from[e]]++] = (uint64_t)bi << 32 | e;
+        }
+    }
+
+    // Breadth-first from the root
+    std::vector<bool> seen(m_nodes);
+    std::vector<uint32_t> nodes{root};
+    std::vector<uint64_t> walked;
+    seen[root] = true;
+
+    size_t level_end = nodes.size();
+    for (size_t i = 0, level = 0; i < nodes.size() && level < depth; ++i) {
+        uint32_t n = nodes[i];
+        for (uint32_t k = start[n]; k < start[n + 1]; ++k) {
+            const Block& b = m_blocks[out_edges[k] >> 32];
+            uint32_t to = column<uint32_t>(b.p, b.col, EdgeTo)[(uint32_t)out_edges[k]];
+            if (to >= m_nodes) continue;
+            walked.push_back(out_edges[k]);
+            if (!seen[to]) {
+                seen[to] = true;
+                nodes.push_back(to);
+            }
+        }
+        if (i + 1 == level_end) {
+            ++level;
+            level_end = nodes.size();
+        }
+    }
+
+    write_head(out);
+    out += ",\"root\":";
+    json_write_string(out, root_id);
+    out += ",\"depth\":";
+    json_write_number(out, depth);
+
+    out += ",\"nodes\":[";
+    bool first = true;
+    for (uint32_t n : nodes) {
+        if (lat[n] == UINT64_MAX) continue;
+        if (!first) out += ',';
+        first = false;
+        write_node(out, m_blocks[lat[n] >> 32], (uint32_t)lat[n]);
+    }
+
+    out += "],\"edges\":[";
+    for (size_t i = 0; i < walked.size(); ++i) {
+        if (i) out += ',';
+        write_edge(out, m_blocks[walked[i] >> 32], (uint32_t)walked[i]);
+    }
+    out += "]}";
+    return true;
+}
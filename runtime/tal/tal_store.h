@@ -0,0 +1,158 @@
+#pragma once
+#include "tal_graph.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// On-disk store for one run's TalGraph: a directory of append-only segment
+// files (seg-NNNNNN.kts) plus a checkpoint file listing the committed blocks.
+//
+// Each checkpoint appends one block holding what changed since the previous
+// one: the strings interned since, a record per changed node (its full
+// state, ordered by the seq of its last change), the new edges and the
+// counters, all column-wise so a reader touches only the columns it needs.
+// String ids and node indices are the graph's own, so a reload rebuilds the
+// graph column by column without parsing anything. The layout is documented
+// in tal_store.cpp.
+//
+// The checkpoint is replaced atomically after the block is synced, so a
+// crash loses at most the block being written. Once superseded records
+// dominate (or blocks pile up), the next checkpoint writes the whole graph
+// into a fresh segment and drops the old ones.
+
+// One committed block, as listed in the checkpoint file
+struct TalBlockRef {
+    uint32_t segment;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+    double at_seq;
+};
+
+// A node's newest stored record, as TalStore::node() reads it
+struct TalNodeRecord {
+    uint32_t id;                // id key, written by TalStore::write_id()
+    uint32_t label, kind;       // string ids
+    uint8_t type, status;       // tal_node_type_name() / tal_status_name() codes
+    bool ended;
+    double seq;                 // of its last stored change
+    double started_at, ended_at;
+    std::string_view data;      // raw JSON object
+    uint32_t errors, children;
+};
+
+struct TalEdgeRecord {
+    uint32_t from, to;          // node indices
+    uint32_t from_id, to_id;    // id keys
+    uint32_t ordinal;
+    uint8_t kind;               // tal_edge_kind_name() code
+    double seq, created_at;
+};
+
+// Appends checkpoints of a graph to a store directory
+class TalStoreWriter {
+public:
+    // Opens or creates the store in dir and resumes after its last
+    // checkpoint, discarding anything appended after it
+    bool open(const std::string& dir);
+
+    // Appends what changed in g since the last checkpoint and commits it. g
+    // must be the graph the store was written from (or reloaded from it).
+    bool checkpoint(const TalGraph& g);
+
+    double at_seq() const { return m_at_seq; }
+    uint64_t bytes() const { return m_bytes; }   // committed, across segments
+    const std::string& error() const { return m_error; }
+
+private:
+    bool fail(std::string why);
+
+    std::string m_dir;
+    std::vector<TalBlockRef> m_blocks;
+    double m_at_seq = -1;
+    uint32_t m_strings = 0, m_nodes = 0, m_edges = 0;
+    uint64_t m_records = 0;     // node records across blocks
+    uint64_t m_bytes = 0;
+    std::string m_buf;
+    std::string m_error;
+};
+
+// Read-only view of a store as of its checkpoint at open(). Segments are
+// mmap'd, so opening reads only the checkpoint and the block headers; node
+// and edge columns are paged in as queries touch them.
+class TalStore {
+public:
+    TalStore() = default;
+    TalStore(const TalStore&) = delete;
+    TalStore& operator=(const TalStore&) = delete;
+    ~TalStore();
+
+    // True if dir holds a checkpoint
+    static bool exists(const std::string& dir);
+
+    bool open(const std::string& dir);
+    void close();
+
+    // Rebuilds the graph into g, which must be empty
+    bool load(TalGraph& g) const;
+
+    // Nodes whose last stored change has a seq in (from_seq, to_seq], and
+    // edges created in that range, as
+    // {"cursor":{lastSeq,nodeNum},"fromSeq","toSeq","nodes":[...],"edges":[...]}.
+    // Blocks checkpointed at or before from_seq are not touched.
+    void write_range(std::string& out, double from_seq, double to_seq) const;
+
+    // The nodes reachable from root_id within depth edges and the edges
+    // walked to reach them, as {"cursor","root","depth","nodes","edges"}.
+    // False if no node has that id.
+    bool write_subtree(std::string& out, std::string_view root_id, uint32_t depth) const;
+
+    // Record access for readers that format the graph themselves
+    // (tal_export.h). Nodes are indexed num - 1 and edges in creation order;
+    // false if n or e is out of range or the record is corrupt.
+    bool node(uint32_t n, TalNodeRecord& out) const;
+    bool edge(uint32_t e, TalEdgeRecord& out) const;
+
+    // Index of the node with this id, or UINT32_MAX
+    uint32_t find_node(std::string_view id) const;
+
+    std::string_view str(uint32_t sid) const;
+    void write_id(std::string& out, uint32_t key) const;
+
+    double at_seq() const { return m_at_seq; }
+    size_t node_count() const { return m_nodes; }
+    size_t edge_count() const { return m_edges; }
+    uint64_t bytes() const { return m_bytes; }
+    const std::string& error() const { return m_error; }
+
+private:
+    struct Block {
+        const char* p;          // block header, inside a mapped segment
+        uint64_t col[32];       // column offsets from p (tal_store.cpp)
+    };
+
+    struct Segment {
+        void* base;
+        size_t len;
+    };
+
+    bool fail(std::string why) const;
+    uint32_t find_str(std::string_view s) const;
+    const std::vector<uint64_t>& latest() const;
+
+    void write_head(std::string& out) const;
+    void write_node(std::string& out, const Block& b, uint32_t r) const;
+    void write_edge(std::string& out, const Block& b, uint32_t e) const;
+    void write_opt(std::string& out, uint32_t sid) const;
+
+    std::vector<Segment> m_segments;
+    std::vector<Block> m_blocks;
+    double m_at_seq = -1;
+    uint32_t m_strings = 0, m_nodes = 0, m_edges = 0;
+    uint64_t m_bytes = 0;
+
+    // (block << 32 | record) of each node's newest record, built on demand
+    mutable std::vector<uint64_t> m_latest;
+    mutable std::string m_error;
+};
@@ -0,0 +1,169 @@
+/**
+ * Binary GraphPatch decoder
+ *
+ * Decodes the KTGP messages written by TalGraph::write_patch_binary()
+ * (runtime/tal/tal_graph.cpp documents the layout) into the GraphPatch
+ * shape the JSON path publishes. Depends only on DataView and TextDecoder,
+ * so browsers can use it as-is.
+ */
+
+import type { Edge, GraphPatch, Node, NodeType } from './t2_correlator.js';
+
+const MAGIC = 'KTGP';
+const VERSION = 1;
+
+// Enum orders of TalGraph
+const NODE_TYPES: NodeType[] = ['Function', 'External', 'IO', 'Service', 'DB', 'Group', 'Event', 'Error'];
+const STATUSES: Node['status'][] = ['running', 'completed', 'error'];
+const EDGE_KINDS = ['calls', 'returns', 'emits', 'reads', 'writes', 'queries', 'requests'];
+
+export function isGraphPatchBinary(buf: Uint8Array): boolean {
+    return buf.length >= 5 && buf[0] === 0x4b && buf[1] === 0x54 && buf[2] === 0x47 && buf[3] === 0x50;
+}
+
+class Reader {
+    buf: Uint8Array;
+    view: DataView;
+    pos = 0;
+    strings: string[] = [];
+    utf8 = new TextDecoder();
+
+    constructor(buf: Uint8Array) {
+        this.buf = buf;
+        this.view = new DataView(buf.buffer, buf.byteOffset, buf.byteLength);
+    }
+
+    u8(): number {
+        if (this.pos >= this.buf.length) throw new Error('truncated GraphPatch');
+        return this.buf[this.pos++];
+    }
+
+    varint(): number {
+        let result = 0;
+        let scale = 1;
+        for (let i = 0; i < 10; i++) {
+            const b = this.u8();
+            result += (b & 0x7f) * scale;
+            if (b < 0x80) return result;
+            scale *= 128;
+        }
+        throw new Error('varint too long');
+    }
+
+    f64(): number {
+        if (this.pos + 8 > this.buf.length) throw new Error('truncated GraphPatch');
+        const v = this.view.getFloat64(this.pos, true);
+        this.pos += 8;
+        return v;
+    }
+
+    str(len = this.varint()): string {
+        if (this.pos + len > this.buf.length) throw new Error('truncated GraphPatch');
+        const s = this.utf8.decode(this.buf.subarray(this.pos, this.pos + len));
+        this.pos += len;
+        return s;
+    }
+
+    // A dictionary reference whose low `shift` bits were already removed
+    resolve(v: number): string | null {
+        if (v === 0) return null;
+        if (v % 2 === 1) {
+            const s = this.str((v - 1) / 2);
+            this.strings.push(s);
+            return s;
+        }
+        const s = this.strings[v / 2 - 1];
+        if (s === undefined) throw new Error('bad dictionary reference');
+        return s;
+    }
+
+    ref(): string | null {
+        return this.resolve(this.varint());
+    }
+
+    id(): string {
+        const v = this.varint();
+        const s = this.resolve(Math.floor(v / 2));
+        if (s === null) throw new Error('null node id');
+        return v % 2 === 1 ? `span:${s}` : s;
+    }
+
+    nullable(): number | null {
+        const v = this.f64();
+        return Number.isNaN(v) ? null : v;
+    }
+}
+
+export function decodeGraphPatch(buf: Uint8Array): GraphPatch {
+    const r = new Reader(buf);
+    if (r.utf8.decode(buf.subarray(0, 4)) !== MAGIC) throw new Error('bad GraphPatch magic');
+    r.pos = 4;
+    const version = r.u8();
+    if (version !== VERSION) throw new Error(`unsupported GraphPatch version ${version}`);
+
+    const runId = r.str();
+    const fromSeq = r.f64();
+    const atSeq = r.f64();
+    const timestamp = r.f64();
+
+    const totalNodes = r.varint();
+    const totalEdges = r.varint();
+    const errorCount = r.varint();
+    const completedCount = r.varint();
+    const runningCount = r.varint();
+    const nodesByType: Record<string, number> = {};
+    for (let i = r.u8(); i > 0; i--) {
+        const type = NODE_TYPES[r.u8()];
+        nodesByType[type] = r.varint();
+    }
+
+    const counter: Record<string, number> = {};
+    for (let i = r.varint(); i > 0; i--) {
+        const kind = r.ref() ?? '';
+        counter[kind] = r.varint();
+    }
+
+    const nodes: Node[] = [];
+    for (let i = r.varint(); i > 0; i--) {
+        const num = r.varint();
+        const id = r.id();
+        const label = r.ref() ?? '';
+        const type = NODE_TYPES[r.u8()];
+        const kind = r.ref() ?? '';
+        const span = r.ref();
+        const parentSpan = r.ref();
+        const key = r.ref();
+        const startedAt = r.f64();
+        const endedAt = r.nullable();
+        const startedSeq = r.f64();
+        const endedSeq = r.nullable();
+        const status = STATUSES[r.u8()];
+        const errorCount = r.varint();
+        const childCount = r.varint();
+        const data = JSON.parse(r.str());
+
+        nodes.push({
+            id, num, label, type, kind, span, parentSpan, key,
+            startedAt, endedAt,
+            duration: endedAt === null ? null : endedAt - startedAt,
+            startedSeq, endedSeq, status, data,
+            props: { errorCount, childCount },
+        });
+    }
+
+    const edges: Edge[] = [];
+    for (let i = r.varint(); i > 0; i--) {
+        const from = r.id();
+        const to = r.id();
+        const ordinal = r.varint();
+        const createdSeq = r.f64();
+        const kind = EDGE_KINDS[r.u8()];
+        const createdAt = r.f64();
+        edges.push({ from, to, ordinal, createdSeq, kind, createdAt });
+    }
+
+    return {
+        runId, fromSeq, atSeq, timestamp, nodes, edges, counter,
+        summary: { totalNodes, totalEdges, errorCount, completedCount, runningCount, nodesByType },
+    };
+}
@@ -1,11 +1,13 @@
 import dotenv from 'dotenv';
-import { redis, ensureGroup } from '../storage/redis.js';
-import { TalEventSchema, type TalEvent } from './t1_parser.js';
-import { initState, applyEvent, buildDelta, GraphState } from './t2_correlator.js';
+import fs from 'node:fs';
+import { redis, ensureGroup, keyframeKey } from '../storage/redis.js';
+import { createGraphEngine, loadNativeAddon, type GraphEngine } from './tal_native.js';
 import {
     initPersistenceState,
+    loadPersistenceState,
     persistGraph,
     saveSnapshot,
+    graphStoreDir,
     PersistenceState,
 } from './persistence.js';
 
@@ -18,20 +20,35 @@ const BLOCK_MS = Number(process.env.BLOCK_MS) || 20;
 const FPS = Number(process.env.FPS) || 5;
 const EMIT_MS = Math.round(1000 / FPS);
 
+// Between full GraphDeltas (keyframes) runs publish GraphPatches with only
+// what changed; PATCH_FORMAT=binary publishes them as KTGP (graph_patch.ts)
+// when the native engine is loaded
+const KEYFRAME_MS = Number(process.env.KEYFRAME_MS) || 5000;
+const KEYFRAME_TTL_S = Number(process.env.KEYFRAME_TTL_S) || 3600;
+const PATCH_BINARY = process.env.PATCH_FORMAT === 'binary';
+
 // Persistence settings
 const PERSIST_ENABLED = process.env.PERSIST_ENABLED !== 'false';
 const PERSIST_INTERVAL_MS = Number(process.env.PERSIST_INTERVAL_MS) || 5000; // Persist every 5 seconds
 const SNAPSHOT_INTERVAL_MS = Number(process.env.SNAPSHOT_INTERVAL_MS) || 60000; // Snapshot every minute
 
+// With SNAPSHOT_DIR set, native engines checkpoint each run into an
+// append-only graph store under it instead of saving JSON snapshots, and a
+// restarted worker reloads runs from there
+const SNAPSHOT_DIR = process.env.SNAPSHOT_DIR;
+
 function now(): number {
     return Date.now();
 }
 
 type RunState = {
-    graph: GraphState;
+    graph: GraphEngine;
     persistence: PersistenceState;
     lastPersist: number;
     lastSnapshot: number;
+    storeDir: string | null;    // graph store, when the engine checkpoints into one
+    emittedSeq: number;     // atSeq of the last published delta or patch
+    lastKeyframe: number;
 };
 
 const runs = new Map<string, RunState>();
@@ -67,15 +84,40 @@ async function scanStreams(): Promise<string[]> {
 }
 
 
+// A run this worker has not seen may have been applied, and acked, by a
+// previous worker; its graph is restored only as far as the last checkpoint,
+// if there is one, and '>' never delivers the acked events again. So the
+// stream is read back from the start; engines skip events at or below their
+// seq as duplicates, including the ones the current read delivers again.
+async function replayStream(stream: string, runId: string, graph: GraphEngine): Promise<void> {
+    let start = '-';
+    let rejected = 0;
+    for (;;) {
+        const entries = await (redis as any).xrangeBuffer(stream, start, '+', 'COUNT', BATCH);
+        if (entries.length === 0) break;
+
+        rejected += graph.applyBatch(entries.map((e: any) => e[1][1])).length;
+        if (entries.length < BATCH) break;
+        start = `(${entries[entries.length - 1][0].toString()}`;
+    }
+    if (rejected > 0) {
+        console.error(`[pipeline] Rejected ${rejected} replayed events for run=${runId}: ${graph.lastError()}`);
+    }
+}
+
 async function main() {
     const streams = await scanStreams();
     for (const stream of streams) {
         await ensureGroup(stream);
     }
 
+    if (SNAPSHOT_DIR) {
+        fs.mkdirSync(SNAPSHOT_DIR, { recursive: true });
+    }
+
     let lastEmit = 0;
 
-    console.log(`[pipeline] Starting with STREAM_PREFIX=${STREAM_PREFIX}, PERSIST_ENABLED=${PERSIST_ENABLED}`);
+    console.log(`[pipeline] Starting with STREAM_PREFIX=${STREAM_PREFIX}, PERSIST_ENABLED=${PERSIST_ENABLED}, engine=${loadNativeAddon() ? 'native' : 'ts'}`);
 
     while (true) {
 
@@ -101,31 +143,48 @@ async function main() {
             let runState = runs.get(runId);
 
             if (!runState) {
+                const graph = createGraphEngine();
+                const storeDir = graph.native ? graphStoreDir(runId) : null;
+
+                // Pick up where a previous worker's last checkpoint left off
+                // (if any), then catch up on what it applied since
+                let restored = false;
+                if (storeDir) {
+                    try {
+                        restored = graph.restore(storeDir);
+                    } catch (err) {
+                        console.error(`[pipeline] Failed to restore run=${runId} from ${storeDir}:`, err);
+                    }
+                }
+                await replayStream(stream, runId, graph);
+
                 runState = {
-                    graph: initState(),
-                    persistence: initPersistenceState(),
+                    graph,
+                    persistence: restored && PERSIST_ENABLED ? await loadPersistenceState(runId) : initPersistenceState(),
                     lastPersist: now(),
                     lastSnapshot: now(),
+                    storeDir,
+                    emittedSeq: -1,
+                    lastKeyframe: 0,
                 };
                 runs.set(runId, runState);
-                console.log(`[pipeline] New run detected: ${runId}`);
+                console.log(restored
+                    ? `[pipeline] Restored run ${runId} at seq=${graph.atSeq()}`
+                    : `[pipeline] New run detected: ${runId}`);
             }
 
-            const ids: string[] = [];
-
-            for (const [idBuff, kys] of entries) {
-                const id = idBuff.toString();
-                const json = kys[1].toString();
+            // Raw event buffers go to the engine as-is; only accepted ids are acked
+            const rejected = new Set(runState.graph.applyBatch(entries.map((e: any) => e[1][1])));
+            if (rejected.size > 0) {
+                console.error(`[pipeline] Rejected ${rejected.size} events for run=${runId}: ${runState.graph.lastError()}`);
+            }
 
-                try {
-                    const event: TalEvent = TalEventSchema.parse(JSON.parse(json));
-                    applyEvent(runState.graph, event);
-                    ids.push(id)
-                }
-                catch (err) {
-                    console.error("[pipeline] Error parsing event:", err);
+            const ids: string[] = [];
+            entries.forEach((e: any, i: number) => {
+                if (!rejected.has(i)) {
+                    ids.push(e[0].toString());
                 }
-            }
+            });
 
             if (ids.length > 0) {
                 acks.push([stream, ids]);
@@ -138,15 +197,27 @@ async function main() {
         if (nowTs - lastEmit >= EMIT_MS) {
 
             for (const [runId, runState] of runs) {
-                const delta = buildDelta(runId, runState.graph);
-
-                // Publish to WebSocket clients
-                await redis.publish(`updates:${runId}`, JSON.stringify({ type: 'GraphDelta', ...delta }));
+                // Publish to WebSocket clients; idle runs publish nothing
+                const atSeq = runState.graph.atSeq();
+                if (atSeq !== runState.emittedSeq) {
+                    if (nowTs - runState.lastKeyframe >= KEYFRAME_MS) {
+                        const keyframe = runState.graph.deltaMessage(runId);
+                        await redis.set(keyframeKey(runId), keyframe, 'EX', KEYFRAME_TTL_S);
+                        await redis.publish(`updates:${runId}`, keyframe);
+                        runState.lastKeyframe = nowTs;
+                    } else {
+                        await redis.publish(`updates:${runId}`,
+                            runState.graph.patchMessage(runId, runState.emittedSeq, PATCH_BINARY));
+                    }
+                    runState.emittedSeq = atSeq;
+                }
 
                 // Persist to database periodically
                 if (PERSIST_ENABLED && nowTs - runState.lastPersist >= PERSIST_INTERVAL_MS) {
                     try {
-                        const result = await persistGraph(runId, runState.graph, runState.persistence);
+                        // Only what changed since the last persist crosses from the engine
+                        const changes = runState.graph.changes(runState.persistence.lastPersistedSeq);
+                        const result = await persistGraph(runId, changes, runState.persistence);
                         if (result.nodesCreated > 0 || result.edgesCreated > 0) {
                             console.log(`[pipeline] Persisted run=${runId}: ${result.nodesCreated} nodes, ${result.edgesCreated} edges, ${result.nodesUpdated} updated`);
                         }
@@ -156,11 +227,17 @@ async function main() {
                     }
                 }
 
-                // Save periodic snapshots
-                if (PERSIST_ENABLED && nowTs - runState.lastSnapshot >= SNAPSHOT_INTERVAL_MS) {
+                // Save periodic snapshots: a checkpoint appends only what
+                // changed since the last one
+                if ((PERSIST_ENABLED || runState.storeDir) && nowTs - runState.lastSnapshot >= SNAPSHOT_INTERVAL_MS) {
                     try {
-                        await saveSnapshot(runId, runState.graph);
-                        console.log(`[pipeline] Snapshot saved for run=${runId}`);
+                        const checkpoint = runState.storeDir ? runState.graph.checkpoint(runState.storeDir) : null;
+                        if (checkpoint) {
+                            console.log(`[pipeline] Checkpoint for run=${runId} at seq=${checkpoint.atSeq} (${checkpoint.bytes} bytes stored)`);
+                        } else {
+                            await saveSnapshot(runId, runState.graph.graphState());
+                            console.log(`[pipeline] Snapshot saved for run=${runId}`);
+                        }
                         runState.lastSnapshot = nowTs;
                     } catch (err) {
                         console.error(`[pipeline] Snapshot error for run=${runId}:`, err);
@@ -5,8 +5,9 @@
  * for long-term storage and LLM consumption.
  */
 
+import path from 'node:path';
 import { prisma } from '../db/client.js';
-import type { GraphState, Node, Edge } from './t2_correlator.js';
+import type { GraphState, GraphChanges, Node, Edge } from './t2_correlator.js';
 
 /**
  * Track what's been persisted to avoid duplicate writes
@@ -45,9 +46,8 @@ export async function ensureRun(runId: string): Promise<void> {
  */
 export async function persistNodes(
     runId: string,
-    nodes: Node[],
-    persistState: PersistenceState,
-    state: GraphState
+    nodes: GraphChanges['nodes'],
+    persistState: PersistenceState
 ): Promise<number> {
     const newNodes = nodes.filter(n => !persistState.persistedNodes.has(n.id));
 
@@ -56,17 +56,12 @@ export async function persistNodes(
     }
 
     const createData = newNodes.map(node => {
-        // Resolve parentId from spanToNode using the node's parentSpan
-        const parentId = node.parentSpan
-            ? (state.spanToNode.get(node.parentSpan) ?? null)
-            : null;
-
         return {
         id: node.id,
         runId,
         num: node.num,
         span: node.span,
-        parentId,
+        parentId: node.parentId,
         type: node.type,
         label: node.label,
         key: node.key,
@@ -197,7 +192,21 @@ export async function updateCursor(runId: string, seq: number): Promise<void> {
 }
 
 /**
- * Save a graph snapshot for fast reload
+ * Directory of a run's graph store (runtime/tal/tal_store.h) under
+ * SNAPSHOT_DIR; null when SNAPSHOT_DIR is unset or the run id is not a
+ * plain path component
+ */
+export function graphStoreDir(runId: string): string | null {
+    const root = process.env.SNAPSHOT_DIR;
+    if (!root || !/^[\w.-]+$/.test(runId) || runId === '.' || runId === '..') {
+        return null;
+    }
+    return path.join(root, runId);
+}
+
+/**
+ * Save a graph snapshot for fast reload (the whole graph as JSON; native
+ * engines checkpoint into graphStoreDir() instead)
  */
 export async function saveSnapshot(
     runId: string,
@@ -259,31 +268,32 @@ export async function completeRun(runId: string, status: 'completed' | 'error'):
 }
 
 /**
- * Persist all graph data for a run
+ * Persist what changed in a run's graph since the last call
+ * (GraphEngine.changes(persistState.lastPersistedSeq))
  * Called periodically or on significant changes
  */
 export async function persistGraph(
     runId: string,
-    state: GraphState,
+    changes: GraphChanges,
     persistState: PersistenceState
 ): Promise<{ nodesCreated: number; edgesCreated: number; nodesUpdated: number }> {
     // Ensure run exists
     await ensureRun(runId);
 
-    const nodes = Array.from(state.nodes.values());
-    const edges = state.edges;
+    // Nodes persisted by an earlier call were written with older values
+    const changedNodes = changes.nodes.filter(n => persistState.persistedNodes.has(n.id));
 
     // Persist new nodes and edges
-    const nodesCreated = await persistNodes(runId, nodes, persistState, state);
-    const edgesCreated = await persistEdges(runId, edges, persistState);
+    const nodesCreated = await persistNodes(runId, changes.nodes, persistState);
+    const edgesCreated = await persistEdges(runId, changes.edges, persistState);
 
     // Update completed nodes
-    const nodesUpdated = await updateCompletedNodes(runId, nodes);
+    const nodesUpdated = await updateCompletedNodes(runId, changedNodes);
 
     // Update cursor
-    if (state.lastSeq > persistState.lastPersistedSeq) {
-        await updateCursor(runId, state.lastSeq);
-        persistState.lastPersistedSeq = state.lastSeq;
+    if (changes.atSeq > persistState.lastPersistedSeq) {
+        await updateCursor(runId, changes.atSeq);
+        persistState.lastPersistedSeq = changes.atSeq;
     }
 
     return { nodesCreated, edgesCreated, nodesUpdated };
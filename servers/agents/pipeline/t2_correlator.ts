@@ -43,6 +43,28 @@ export type Edge = {
     createdAt: number;        // Timestamp when edge was created
 }
 
+/**
+ * Node changes in event order, so buildPatch() only visits what changed
+ * after its watermark. An entry is live while `latest` points at it;
+ * superseded entries are dropped once they outnumber the nodes.
+ */
+export type ChangeLog = {
+    ids: string[];
+    seqs: number[];                     // non-decreasing
+    latest: Map<string, number>;        // node ID -> index of its newest entry
+};
+
+/**
+ * Summary counts kept up to date as nodes are added and change
+ */
+export type GraphStats = {
+    nodesByType: Record<string, number>;
+    running: number;
+    completed: number;
+    error: number;
+    errorProps: number;                 // sum of props.errorCount
+};
+
 /**
  * Graph state maintained during event processing
  */
@@ -51,10 +73,12 @@ export type GraphState = {
     nodeNum: number;                    // Counter for node numbering
     nodes: Map<string, Node>;           // Nodes keyed by ID
     spanToNode: Map<string, string>;    // Maps span IDs to node IDs
-    edges: Edge[];
+    edges: Edge[];                      // createdSeq is non-decreasing
     edgeSet: Set<string>;               // O(1) duplicate edge checks
     edgeOrdinals: Map<string, number>;  // Track ordinals per source node
     counter: Map<string, number>;       // Event kind counters
+    changes: ChangeLog;
+    stats: GraphStats;
 };
 
 /**
@@ -70,7 +94,71 @@ export function initState(): GraphState {
         edgeSet: new Set(),
         edgeOrdinals: new Map(),
         counter: new Map(),
+        changes: { ids: [], seqs: [], latest: new Map() },
+        stats: { nodesByType: {}, running: 0, completed: 0, error: 0, errorProps: 0 },
+    }
+}
+
+/**
+ * Record that a node was created or changed by the current event
+ */
+function touch(state: GraphState, nodeId: string) {
+    const log = state.changes;
+    const pos = log.latest.get(nodeId);
+
+    // Already the newest entry: only its seq moves
+    if (pos !== undefined && pos === log.ids.length - 1) {
+        log.seqs[pos] = state.lastSeq;
+        return;
     }
+
+    log.latest.set(nodeId, log.ids.length);
+    log.ids.push(nodeId);
+    log.seqs.push(state.lastSeq);
+
+    if (log.ids.length > 2 * state.nodes.size + 1024) {
+        let w = 0;
+        for (let r = 0; r < log.ids.length; r++) {
+            const id = log.ids[r];
+            if (log.latest.get(id) !== r) continue;
+            log.ids[w] = id;
+            log.seqs[w] = log.seqs[r];
+            log.latest.set(id, w);
+            w++;
+        }
+        log.ids.length = w;
+        log.seqs.length = w;
+    }
+}
+
+function addNode(state: GraphState, node: Node) {
+    state.nodes.set(node.id, node);
+
+    const stats = state.stats;
+    stats.nodesByType[node.type] = (stats.nodesByType[node.type] ?? 0) + 1;
+    stats[node.status]++;
+    stats.errorProps += node.props.errorCount;
+    touch(state, node.id);
+}
+
+function setStatus(state: GraphState, node: Node, status: Node['status']) {
+    state.stats[node.status]--;
+    state.stats[status]++;
+    node.status = status;
+}
+
+/**
+ * Index of the first element of a non-decreasing sequence above seq
+ */
+function firstAfter<T>(items: T[], seqOf: (item: T) => number, seq: number): number {
+    let lo = 0;
+    let hi = items.length;
+    while (lo < hi) {
+        const mid = (lo + hi) >>> 1;
+        if (seqOf(items[mid]) <= seq) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
 }
 
 /**
@@ -147,14 +235,16 @@ export function applyEvent(state: GraphState, event: TalEvent) {
                 // Check for error status
                 const data = event.data || {};
                 if (data.status === 'ERROR') {
-                    existingNode.status = 'error';
+                    setStatus(state, existingNode, 'error');
                     existingNode.props.errorCount++;
+                    state.stats.errorProps++;
                 } else {
-                    existingNode.status = 'completed';
+                    setStatus(state, existingNode, 'completed');
                 }
 
                 // Merge end data
                 existingNode.data = { ...existingNode.data, ...data };
+                touch(state, existingNode.id);
                 return;
             }
         }
@@ -189,7 +279,7 @@ export function applyEvent(state: GraphState, event: TalEvent) {
             },
         };
 
-        state.nodes.set(nodeId, node);
+        addNode(state, node);
 
         // Map span to node for later correlation
         if (event.span) {
@@ -232,6 +322,7 @@ export function applyEvent(state: GraphState, event: TalEvent) {
                 const parentNode = state.nodes.get(parentNodeId);
                 if (parentNode) {
                     parentNode.props.childCount++;
+                    touch(state, parentNodeId);
                 }
             }
         } else if (event.parentSpan) {
@@ -262,7 +353,7 @@ export function applyEvent(state: GraphState, event: TalEvent) {
                         data: {},
                         props: { errorCount: 0, childCount: 1 },
                     };
-                    state.nodes.set(placeholderParentId, placeholderNode);
+                    addNode(state, placeholderNode);
                     state.spanToNode.set(event.parentSpan, placeholderParentId);
                 }
 
@@ -323,43 +414,91 @@ export type GraphDelta = {
     };
 }
 
+/**
+ * GraphPatch - the part of a GraphDelta that changed after fromSeq: nodes
+ * created or changed since (in full) and edges created since. counter and
+ * summary are always complete. Patches are upserts, so a client at atSeq A
+ * can apply any patch with fromSeq <= A; a later fromSeq means it missed
+ * one and should wait for the next full GraphDelta.
+ */
+export type GraphPatch = GraphDelta & {
+    fromSeq: number;
+}
+
+function summarize(state: GraphState): GraphDelta['summary'] {
+    const stats = state.stats;
+    return {
+        totalNodes: state.nodes.size,
+        totalEdges: state.edges.length,
+        errorCount: stats.error + stats.errorProps,
+        completedCount: stats.completed,
+        runningCount: stats.running,
+        nodesByType: { ...stats.nodesByType },
+    };
+}
+
 /**
  * Build a GraphDelta from current state
  * This is the format that gets published and can be consumed by LLM
  */
 export function buildDelta(runId: string, state: GraphState): GraphDelta {
-    const nodes = Array.from(state.nodes.values());
-
-    // Compute summary statistics
-    const nodesByType: Record<string, number> = {};
-    let errorCount = 0;
-    let completedCount = 0;
-    let runningCount = 0;
-
-    for (const node of nodes) {
-        nodesByType[node.type] = (nodesByType[node.type] ?? 0) + 1;
-
-        if (node.status === 'error') errorCount++;
-        else if (node.status === 'completed') completedCount++;
-        else runningCount++;
+    return {
+        runId,
+        atSeq: state.lastSeq,
+        timestamp: Date.now(),
+        nodes: Array.from(state.nodes.values()),
+        edges: state.edges.slice(),
+        counter: Object.fromEntries(state.counter.entries()),
+        summary: summarize(state),
+    };
+}
 
-        errorCount += node.props.errorCount;
+function changedNodes(state: GraphState, sinceSeq: number): Node[] {
+    const log = state.changes;
+    const nodes: Node[] = [];
+    for (let i = firstAfter(log.seqs, (seq) => seq, sinceSeq); i < log.ids.length; i++) {
+        const id = log.ids[i];
+        if (log.latest.get(id) === i) {
+            nodes.push(state.nodes.get(id)!);
+        }
     }
+    return nodes;
+}
 
+/**
+ * Build the GraphPatch of everything after sinceSeq (-1 for the whole graph)
+ */
+export function buildPatch(runId: string, state: GraphState, sinceSeq: number): GraphPatch {
     return {
         runId,
+        fromSeq: sinceSeq,
         atSeq: state.lastSeq,
         timestamp: Date.now(),
-        nodes,
-        edges: state.edges.slice(),
+        nodes: changedNodes(state, sinceSeq),
+        edges: state.edges.slice(firstAfter(state.edges, (e) => e.createdSeq, sinceSeq)),
         counter: Object.fromEntries(state.counter.entries()),
-        summary: {
-            totalNodes: nodes.length,
-            totalEdges: state.edges.length,
-            errorCount,
-            completedCount,
-            runningCount,
-            nodesByType,
-        },
+        summary: summarize(state),
+    };
+}
+
+/**
+ * GraphChanges - the nodes and edges of a GraphPatch, as persistence takes
+ * them: each node carries its parentId (parentSpan resolved through
+ * spanToNode)
+ */
+export type GraphChanges = {
+    atSeq: number;
+    nodes: Array<Node & { parentId: string | null }>;
+    edges: Edge[];
+}
+
+export function buildChanges(state: GraphState, sinceSeq: number): GraphChanges {
+    return {
+        atSeq: state.lastSeq,
+        nodes: changedNodes(state, sinceSeq).map((node) => ({
+            ...node,
+            parentId: node.parentSpan ? (state.spanToNode.get(node.parentSpan) ?? null) : null,
+        })),
+        edges: state.edges.slice(firstAfter(state.edges, (e) => e.createdSeq, sinceSeq)),
     };
 }
@@ -0,0 +1,272 @@
+import { createRequire } from 'node:module';
+import { TalEventSchema } from './t1_parser.js';
+import {
+    initState, applyEvent, buildDelta, buildPatch, buildChanges,
+    type GraphState, type GraphChanges, type Node, type Edge,
+} from './t2_correlator.js';
+
+/**
+ * Graph engine used by the pipeline worker. The native engine
+ * (runtime/tal, built as kyntrix_tal.node) parses, validates and correlates
+ * raw event JSON without materializing JS objects; the TS engine is the
+ * original zod + applyEvent path and is used when the addon is unavailable.
+ */
+export interface GraphEngine {
+    readonly native: boolean;
+
+    /** Applies raw JSON events; returns the indices of rejected events */
+    applyBatch(events: Array<string | Buffer>): number[];
+
+    /** JSON of the `{ type: 'GraphDelta', ...delta }` message published to clients */
+    deltaMessage(runId: string): string | Buffer;
+
+    /**
+     * `{ type: 'GraphPatch', ...patch }` of what changed after sinceSeq, as
+     * JSON, or as KTGP (graph_patch.ts) when binary is set and the engine
+     * is native
+     */
+    patchMessage(runId: string, sinceSeq: number, binary: boolean): string | Buffer;
+
+    /** Seq of the last applied event; deltas and patches are taken at it */
+    atSeq(): number;
+
+    /** Nodes and edges changed after sinceSeq, for persistGraph() */
+    changes(sinceSeq: number): GraphChanges;
+
+    /**
+     * Whole GraphState view for snapshots (the native engine copies the
+     * graph and leaves changes and stats empty)
+     */
+    graphState(): GraphState;
+
+    /**
+     * Reloads a fresh engine from the graph store in dir (tal_store.h);
+     * false if there is none or the engine is not native
+     */
+    restore(dir: string): boolean;
+
+    /**
+     * Appends what changed since the last checkpoint to the graph store in
+     * dir; null when the engine is not native
+     */
+    checkpoint(dir: string): { atSeq: number; bytes: number } | null;
+
+    /** Reason the last event was rejected */
+    lastError(): string;
+}
+
+interface NativeTalGraph {
+    apply(event: string | Buffer): boolean;
+    applyBatch(events: Array<string | Buffer>): number[];
+    applyLines(ndjson: string | Buffer): number[];
+    delta(runId: string, timestampMs: number, tagged?: boolean): Buffer;
+    patch(runId: string, sinceSeq: number, timestampMs: number, binary?: boolean): Buffer;
+    changes(sinceSeq: number): Buffer;
+    lastSeq(): number;
+    exportState(): string;
+    stats(): { lastSeq: number; nodes: number; edges: number };
+    lastError(): string;
+    restore(dir: string): boolean;
+    checkpoint(dir: string): { atSeq: number; bytes: number };
+}
+
+/** Read-only view of a graph store, as of its checkpoint when opened */
+export interface NativeTalStore {
+    /**
+     * `{ cursor, fromSeq, toSeq, nodes, edges }` JSON: nodes whose last
+     * checkpointed change is in (fromSeq, toSeq] and edges created there
+     */
+    range(fromSeq: number, toSeq: number): Buffer;
+    /** `{ cursor, root, depth, nodes, edges }` JSON, or null for an unknown root */
+    subtree(rootId: string, depth: number): Buffer | null;
+    stats(): { atSeq: number; nodes: number; edges: number; bytes: number };
+    /**
+     * Plans a streaming exportForLLM() of the store (runtime/tal/tal_export.h),
+     * replacing any export in progress; false when root is not in the slice
+     */
+    exportStart(options: NativeExportOptions): boolean;
+    /** Next chunk of the export, at least maxBytes unless it is the last; null once complete */
+    exportNext(maxBytes: number): Buffer | null;
+    close(): void;
+}
+
+/**
+ * Native LLM export options. The slice is the nodes whose last change is in
+ * (fromSeq, toSeq], narrowed to those within depth calls of root (or of every
+ * root). A tokenBudget summarizes the export to about that many tokens:
+ * repeated call subtrees are listed once with a count, and the call tree,
+ * errors and timeline are cut to fit.
+ */
+export interface NativeExportOptions {
+    format?: 'json' | 'prompt' | 'jsonld';
+    runId?: string;
+    timestampMs?: number;
+    fromSeq?: number;
+    toSeq?: number;
+    root?: string;
+    depth?: number;
+    tokenBudget?: number;
+}
+
+type NativeAddon = {
+    TalGraph: new () => NativeTalGraph;
+    TalStore: new (dir: string) => NativeTalStore;
+};
+
+type NativeState = {
+    lastSeq: number;
+    nodeNum: number;
+    nodes: Node[];
+    edges: Edge[];
+    spanToNode: Array<[string, string]>;
+    counter: Record<string, number>;
+};
+
+let addon: NativeAddon | null | undefined;
+
+/**
+ * Loads the addon named by KYNTRIX_TAL_ADDON once; null when unset or when it
+ * fails to load
+ */
+export function loadNativeAddon(): NativeAddon | null {
+    if (addon !== undefined) {
+        return addon;
+    }
+
+    addon = null;
+    const path = process.env.KYNTRIX_TAL_ADDON;
+    if (path) {
+        try {
+            addon = createRequire(import.meta.url)(path);
+        } catch (err) {
+            console.error(`[pipeline] Failed to load native TAL engine from ${path}, using TS engine:`, err);
+        }
+    }
+    return addon;
+}
+
+class NativeGraphEngine implements GraphEngine {
+    readonly native = true;
+    private graph: NativeTalGraph;
+
+    constructor(ctor: new () => NativeTalGraph) {
+        this.graph = new ctor();
+    }
+
+    applyBatch(events: Array<string | Buffer>): number[] {
+        return this.graph.applyBatch(events);
+    }
+
+    deltaMessage(runId: string): Buffer {
+        return this.graph.delta(runId, Date.now(), true);
+    }
+
+    patchMessage(runId: string, sinceSeq: number, binary: boolean): Buffer {
+        return this.graph.patch(runId, sinceSeq, Date.now(), binary);
+    }
+
+    atSeq(): number {
+        return this.graph.lastSeq();
+    }
+
+    changes(sinceSeq: number): GraphChanges {
+        return JSON.parse(this.graph.changes(sinceSeq).toString());
+    }
+
+    graphState(): GraphState {
+        const s: NativeState = JSON.parse(this.graph.exportState());
+
+        const state = initState();
+        state.lastSeq = s.lastSeq;
+        state.nodeNum = s.nodeNum;
+        for (const node of s.nodes) {
+            state.nodes.set(node.id, node);
+        }
+        state.spanToNode = new Map(s.spanToNode);
+        state.edges = s.edges;
+        for (const edge of s.edges) {
+            state.edgeSet.add(`${edge.from}->${edge.to}`);
+            state.edgeOrdinals.set(edge.from, Math.max(state.edgeOrdinals.get(edge.from) ?? 0, edge.ordinal));
+        }
+        state.counter = new Map(Object.entries(s.counter));
+        return state;
+    }
+
+    lastError(): string {
+        return this.graph.lastError();
+    }
+
+    restore(dir: string): boolean {
+        return this.graph.restore(dir);
+    }
+
+    checkpoint(dir: string): { atSeq: number; bytes: number } {
+        return this.graph.checkpoint(dir);
+    }
+}
+
+class TsGraphEngine implements GraphEngine {
+    readonly native = false;
+    private state = initState();
+    private error = '';
+
+    applyBatch(events: Array<string | Buffer>): number[] {
+        const rejected: number[] = [];
+
+        events.forEach((raw, i) => {
+            try {
+                applyEvent(this.state, TalEventSchema.parse(JSON.parse(raw.toString())));
+            } catch (err) {
+                this.error = String(err);
+                rejected.push(i);
+            }
+        });
+        return rejected;
+    }
+
+    deltaMessage(runId: string): string {
+        return JSON.stringify({ type: 'GraphDelta', ...buildDelta(runId, this.state) });
+    }
+
+    patchMessage(runId: string, sinceSeq: number): string {
+        return JSON.stringify({ type: 'GraphPatch', ...buildPatch(runId, this.state, sinceSeq) });
+    }
+
+    atSeq(): number {
+        return this.state.lastSeq;
+    }
+
+    changes(sinceSeq: number): GraphChanges {
+        return buildChanges(this.state, sinceSeq);
+    }
+
+    graphState(): GraphState {
+        return this.state;
+    }
+
+    lastError(): string {
+        return this.error;
+    }
+
+    restore(): boolean {
+        return false;
+    }
+
+    checkpoint(): null {
+        return null;
+    }
+}
+
+/**
+ * Opens the graph store in dir (mmap, no parse); null without the native
+ * addon. Throws if dir holds no readable store.
+ */
+export function openGraphStore(dir: string): NativeTalStore | null {
+    const native = loadNativeAddon();
+    return native ? new native.TalStore(dir) : null;
+}
+
+export function createGraphEngine(): GraphEngine {
+    const native = loadNativeAddon();
+    return native ? new NativeGraphEngine(native.TalGraph) : new TsGraphEngine();
+}
@@ -3,6 +3,7 @@ import { z } from 'zod';
 import split2 from 'split2';
 
 import { redis, streamKey } from '../storage/redis.js';
+import { decodeTalWire, TAL_WIRE_CONTENT_TYPE } from '../transforms/talWire.js';
 
 
 export const ingestRouter = Router();
@@ -51,6 +52,60 @@ ingestRouter.post('/tal', (req, res) => {
 });
 */
 
+// agent_core batches are sent in the binary wire format; one request holds
+// up to a few MiB of frames
+const MAX_WIRE_BODY = 32 * 1024 * 1024;
+
+ingestRouter.post("/tal", (req, res, next) => {
+    if (!req.is(TAL_WIRE_CONTENT_TYPE)) {
+        return next();
+    }
+
+    const chunks: Buffer[] = [];
+    let size = 0;
+
+    req.on('data', (chunk: Buffer) => {
+        size += chunk.length;
+        if (size > MAX_WIRE_BODY) {
+            if (!res.headersSent) {
+                res.status(413).json({ error: 'body too large' });
+            }
+            req.destroy();
+            return;
+        }
+        chunks.push(chunk);
+    });
+
+    req.on('end', async () => {
+        try {
+            const { events, rejected } = decodeTalWire(Buffer.concat(chunks, size));
+            if (rejected > 0) {
+                console.error(`[ingest] dropped ${rejected} wire events with invalid data`);
+            }
+
+            const pipeline = redis.pipeline();
+            for (const ev of events) {
+                pipeline.xadd(streamKey(ev.runId), '*', 'json', ev.json);
+            }
+            await pipeline.exec();
+            res.status(200).json({ status: 'ok', ingested: events.length });
+        }
+        catch (err) {
+            console.error('[ingest] bad wire body:', err);
+            if (!res.headersSent) {
+                res.status(400).json({ error: 'invalid wire body' });
+            }
+        }
+    });
+
+    req.on('error', (err) => {
+        console.error('[ingest] stream error:', err);
+        if (!res.headersSent) {
+            res.status(500).json({ error: 'ingest failed' });
+        }
+    });
+})
+
 ingestRouter.post("/tal", (req, res) => {
     const pipeline = redis.pipeline();
     req.setEncoding('utf8');
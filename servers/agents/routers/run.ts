@@ -1,6 +1,9 @@
-import { Router } from "express";
+import { Router, type Request, type Response } from "express";
+import fs from "node:fs";
 import { prisma } from "../db/client.js";
 import { exportForLLM, type ExportFormat } from "../pipeline/llm_export.js";
+import { graphStoreDir } from "../pipeline/persistence.js";
+import { openGraphStore } from "../pipeline/tal_native.js";
 import type { GraphDelta, Node, Edge } from "../pipeline/t2_correlator.js";
 import { authenticate, requireScopes, rateLimit } from "../auth/middleware.js";
 
@@ -72,6 +75,11 @@ runRouter.delete("/run/:runId", authenticate(), rateLimit(), requireScopes('run:
         prisma.run.delete({ where: { id: runId } }),
     ]);
 
+    const storeDir = graphStoreDir(runId);
+    if (storeDir) {
+        await fs.promises.rm(storeDir, { recursive: true, force: true });
+    }
+
     res.json({ success: true, message: 'Run deleted' });
 })
 
@@ -188,13 +196,120 @@ runRouter.get("/run/:runId/graph", authenticate(), rateLimit(), requireScopes('r
     }
 })
 
+// Bytes per chunk of a streamed LLM export
+const LLM_EXPORT_CHUNK = 64 * 1024;
+
+// Query parameters that slice a graph store
+type SliceParams = {
+    fromSeq?: number;
+    toSeq?: number;
+    root?: string;
+    depth?: number;
+    budget?: number;
+};
+
+/**
+ * Parses the slice parameters; an error message instead when one is not a
+ * finite, non-negative number (a whole one for depth and budget)
+ */
+function sliceParams(query: Request['query']): SliceParams | string {
+    const out: SliceParams = {};
+    for (const name of ['fromSeq', 'toSeq', 'depth', 'budget'] as const) {
+        const raw = query[name];
+        if (raw === undefined) {
+            continue;
+        }
+        const value = typeof raw === 'string' && raw.trim() !== '' ? Number(raw) : NaN;
+        const whole = name === 'depth' || name === 'budget';
+        if (!Number.isFinite(value) || value < 0 || (whole && !Number.isInteger(value))) {
+            return `${name} must be a ${whole ? 'whole' : 'finite'} non-negative number`;
+        }
+        out[name] = value;
+    }
+    if (query.root !== undefined) {
+        if (typeof query.root !== 'string') {
+            return 'root must be a single node id';
+        }
+        out.root = query.root;
+    }
+    return out;
+}
+
+/** Resolves once res can take more output, or has closed */
+function drained(res: Response): Promise<void> {
+    return new Promise(resolve => {
+        const done = () => {
+            res.off('drain', done);
+            res.off('close', done);
+            resolve();
+        };
+        res.on('drain', done);
+        res.on('close', done);
+    });
+}
+
+/**
+ * Streams the LLM export of runId from its graph store, narrowed and
+ * summarized as slice asks. False, with nothing sent, when the run has no
+ * store or the native engine is unavailable.
+ */
+async function streamStoreExport(res: Response, runId: string, format: ExportFormat,
+                                 slice: SliceParams): Promise<boolean> {
+    const storeDir = graphStoreDir(runId);
+    if (!storeDir || !fs.existsSync(`${storeDir}/checkpoint`)) {
+        return false;
+    }
+    const store = openGraphStore(storeDir);
+    if (!store) {
+        return false;
+    }
+
+    try {
+        const started = store.exportStart({
+            format: format === 'prompt' || format === 'jsonld' ? format : 'json',
+            runId,
+            timestampMs: Date.now(),
+            fromSeq: slice.fromSeq,
+            toSeq: slice.toSeq,
+            root: slice.root,
+            depth: slice.depth !== undefined ? Math.min(slice.depth, 0xffffffff) : undefined,
+            tokenBudget: slice.budget,
+        });
+        if (!started) {
+            res.status(404).json({ error: 'Node not found' });
+            return true;
+        }
+
+        res.type(format === 'prompt' ? 'text/plain' : 'application/json');
+        for (let chunk = store.exportNext(LLM_EXPORT_CHUNK); chunk && !res.destroyed;
+             chunk = store.exportNext(LLM_EXPORT_CHUNK)) {
+            if (!res.write(chunk)) {
+                await drained(res);
+            }
+        }
+        res.end();
+        return true;
+    } finally {
+        store.close();
+    }
+}
+
 /**
  * Get graph data formatted for LLM consumption
  * Supports multiple export formats: json, prompt, jsonld
+ *
+ * With a graph store (SNAPSHOT_DIR and the native engine) the export is
+ * streamed from the last checkpoint in chunks, never built whole, and may be
+ * narrowed to ?fromSeq=&toSeq= and/or ?root=<nodeId>&depth=, or summarized
+ * to about ?budget=<tokens>. Otherwise it is built from the database.
  */
 runRouter.get("/run/:runId/llm", authenticate(), rateLimit(), requireScopes('run:read'), async (req, res) => {
     const { runId } = req.params;
     const format = (req.query.format as ExportFormat) || 'json';
+    const slice = sliceParams(req.query);
+    if (typeof slice === 'string') {
+        return res.status(400).json({ error: slice });
+    }
 
     try {
         // Verify ownership
@@ -209,6 +324,10 @@ runRouter.get("/run/:runId/llm", authenticate(), rateLimit(), requireScopes('run
             return res.status(404).json({ error: 'Run not found' });
         }
 
+        if (await streamStoreExport(res, runId, format, slice)) {
+            return;
+        }
+
         // Fetch nodes and edges from database
         const [nodes, edges] = await Promise.all([
             prisma.node.findMany({
@@ -301,15 +420,26 @@ runRouter.get("/run/:runId/llm", authenticate(), rateLimit(), requireScopes('run
         }
     } catch (err) {
         console.error('[run] Error exporting for LLM:', err);
+        if (res.headersSent) {
+            res.destroy();
+            return;
+        }
         res.status(500).json({ error: 'Failed to export graph' });
     }
 })
 
 /**
- * Get the latest snapshot for a run
+ * Get the latest snapshot for a run. With a graph store (SNAPSHOT_DIR and
+ * the native engine) it is read from the last checkpoint, optionally
+ * narrowed to ?fromSeq=&toSeq= or to ?root=<nodeId>&depth=; only the
+ * columns that range or subtree needs are paged in.
  */
 runRouter.get("/run/:runId/snapshot", authenticate(), rateLimit(), requireScopes('run:read'), async (req, res) => {
     const { runId } = req.params;
+    const slice = sliceParams(req.query);
+    if (typeof slice === 'string') {
+        return res.status(400).json({ error: slice });
+    }
 
     try {
         // Verify ownership
@@ -324,6 +454,24 @@ runRouter.get("/run/:runId/snapshot", authenticate(), rateLimit(), requireScopes
             return res.status(404).json({ error: 'Run not found' });
         }
 
+        const storeDir = graphStoreDir(runId);
+        if (storeDir && fs.existsSync(`${storeDir}/checkpoint`)) {
+            const store = openGraphStore(storeDir);
+            if (store) {
+                try {
+                    const body = slice.root !== undefined
+                        ? store.subtree(slice.root, Math.min(slice.depth ?? 1000000, 0xffffffff))
+                        : store.range(slice.fromSeq ?? -1, slice.toSeq ?? Infinity);
+                    if (!body) {
+                        return res.status(404).json({ error: 'Node not found' });
+                    }
+                    return res.type('application/json').send(body);
+                } finally {
+                    store.close();
+                }
+            }
+        }
+
         const snapshot = await prisma.snapshot.findFirst({
             where: { runId },
             orderBy: { ts: 'desc' },
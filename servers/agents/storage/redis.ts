@@ -12,6 +12,11 @@ export const GROUP = process.env.GROUP || 'graph-worker';
 
 export const redis = new Redis(REDIS_URL, { lazyConnect: false });
 
+// Latest full GraphDelta of a run, for clients that join mid-run
+export function keyframeKey(runId: string) {
+    return `graph:keyframe:${runId}`;
+}
+
 export function streamKey(sessionId: string) {
     return `${STREAM_PREFIX}:${sessionId}`;
 }
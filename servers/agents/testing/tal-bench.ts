@@ -0,0 +1,160 @@
+import { deepStrictEqual } from 'node:assert';
+import { TalEventSchema } from '../pipeline/t1_parser.js';
+import { initState, applyEvent, buildDelta, buildPatch } from '../pipeline/t2_correlator.js';
+import { loadNativeAddon } from '../pipeline/tal_native.js';
+
+// Compares the native TAL engine against the TS pipeline (zod + applyEvent +
+// buildDelta) on the same synthetic stream, then times both.
+//
+//   KYNTRIX_TAL_ADDON=.../kyntrix_tal.node tsx testing/tal-bench.ts [events] [batch]
+
+const EVENTS = Number(process.argv[2]) || 200000;
+const BATCH = Number(process.argv[3]) || 2000;
+
+const KINDS = ['call_start', 'call_end', 'fs_read', 'write_file', 'emit', 'event', 'log', 'error', 'Exception', 'query', 'return'];
+
+function rng(seed: number) {
+    return () => {
+        seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+        return seed / 0x7fffffff;
+    };
+}
+
+function generate(count: number): Buffer[] {
+    const rand = rng(42);
+    const pick = <T>(xs: T[]) => xs[Math.floor(rand() * xs.length)];
+    const out: Buffer[] = [];
+    const open: string[] = [];
+    let span = 0;
+
+    for (let seq = 0; out.length < count; seq++) {
+        const r = rand();
+        const ev: Record<string, unknown> = { runId: 'bench', seq, ts: 1.7e12 + seq + (r < 0.05 ? 0.25 : 0) };
+
+        if (r < 0.3 || open.length === 0) {
+            const s = `s${span++}`;
+            ev.kind = 'call_start';
+            ev.span = s;
+            if (open.length) ev.parentSpan = pick(open);
+            if (r < 0.05) ev.nodeKey = `src/app.ts:fn${span % 50}`;
+            ev.data = { fn: `fn${span % 50}`, args: [span, 'a"b\\c', null], nested: { ok: true } };
+            open.push(s);
+        } else if (r < 0.55) {
+            const s = open.splice(Math.floor(rand() * open.length), 1)[0];
+            ev.kind = 'call_end';
+            ev.span = s;
+            ev.data = rand() < 0.1 ? { status: 'ERROR', message: 'boom ☃' } : { ret: span % 7, status: 'OK' };
+        } else if (r < 0.6) {
+            // Child before its parent
+            ev.kind = pick(KINDS);
+            ev.parentSpan = `late${span % 300}`;
+            ev.span = `c${span++}`;
+        } else {
+            ev.kind = pick(KINDS);
+            ev.parentSpan = pick(open);
+            if (rand() < 0.5) ev.span = `e${span++}`;
+            const t = rand();
+            ev.data = t < 0.2 ? { 'db.system': 'postgresql', 'db.statement': 'SELECT 1' }
+                : t < 0.3 ? { type: 'http', 'http.method': 'GET' }
+                : t < 0.4 ? { type: 'rpc', 'rpc.system': 'grpc' }
+                : t < 0.5 ? { type: pick(['io', 'read', 'write', 'server', 'client', 'database']) }
+                : t < 0.55 ? 'plain string'
+                : t < 0.6 ? 0
+                : { n: t, big: 1e21, small: 1e-7 };
+        }
+
+        let json = JSON.stringify(ev);
+        const x = rand();
+        if (x < 0.01) json = json.replace('"bench"', '""');           // empty runId
+        else if (x < 0.015) json = json.replace(/"seq":\d+/, '"seq":1.5');
+        else if (x < 0.02) json = json.slice(0, -1);                  // truncated
+        else if (x < 0.025) seq -= 3;                                  // duplicates / out of order
+        out.push(Buffer.from(json));
+    }
+    return out;
+}
+
+type Timing = {
+    ingestMs: number;
+    deltaMs: number;
+    deltaBytes: number;
+    patchMs: number;      // GraphPatch since the previous batch
+    patchBytes: number;
+    rejected: number[];
+};
+
+function runTs(events: Buffer[]) {
+    const state = initState();
+    const t: Timing = { ingestMs: 0, deltaMs: 0, deltaBytes: 0, patchMs: 0, patchBytes: 0, rejected: [] };
+    let since = -1;
+
+    for (let i = 0; i < events.length; i += BATCH) {
+        const t0 = performance.now();
+        const end = Math.min(i + BATCH, events.length);
+        for (let j = i; j < end; j++) {
+            try {
+                applyEvent(state, TalEventSchema.parse(JSON.parse(events[j].toString())));
+            } catch {
+                t.rejected.push(j);
+            }
+        }
+        const t1 = performance.now();
+        t.deltaBytes += Buffer.byteLength(JSON.stringify({ type: 'GraphDelta', ...buildDelta('bench', state) }));
+        const t2 = performance.now();
+        t.patchBytes += Buffer.byteLength(JSON.stringify({ type: 'GraphPatch', ...buildPatch('bench', state, since) }));
+        since = state.lastSeq;
+        t.ingestMs += t1 - t0;
+        t.deltaMs += t2 - t1;
+        t.patchMs += performance.now() - t2;
+    }
+    return { ...t, delta: { ...buildDelta('bench', state), timestamp: 0 } };
+}
+
+function runNative(events: Buffer[]) {
+    const addon = loadNativeAddon();
+    if (!addon) {
+        throw new Error('KYNTRIX_TAL_ADDON is not set or failed to load');
+    }
+
+    const graph = new addon.TalGraph();
+    const t: Timing = { ingestMs: 0, deltaMs: 0, deltaBytes: 0, patchMs: 0, patchBytes: 0, rejected: [] };
+    let since = -1;
+
+    for (let i = 0; i < events.length; i += BATCH) {
+        const t0 = performance.now();
+        for (const r of graph.applyBatch(events.slice(i, i + BATCH))) {
+            t.rejected.push(i + r);
+        }
+        const t1 = performance.now();
+        t.deltaBytes += graph.delta('bench', Date.now(), true).length;
+        const t2 = performance.now();
+        t.patchBytes += graph.patch('bench', since, Date.now(), true).length;
+        since = graph.lastSeq();
+        t.ingestMs += t1 - t0;
+        t.deltaMs += t2 - t1;
+        t.patchMs += performance.now() - t2;
+    }
+    return { ...t, delta: JSON.parse(graph.delta('bench', 0).toString()) };
+}
+
+const events = generate(EVENTS);
+console.log(`[tal-bench] ${events.length} events, delta every ${BATCH}`);
+
+const ts = runTs(events);
+const native = runNative(events);
+
+deepStrictEqual(native.rejected, ts.rejected, 'rejected events differ');
+deepStrictEqual(native.delta, ts.delta, 'final GraphDelta differs');
+console.log(`[tal-bench] outputs match: ${ts.delta.nodes.length} nodes, ${ts.delta.edges.length} edges, ${ts.rejected.length} rejected`);
+
+const rate = (ms: number) => Math.round(events.length / (ms / 1000)).toLocaleString();
+const report = (name: string, r: Timing) => console.log(
+    `[tal-bench] ${name.padEnd(7)} ingest ${r.ingestMs.toFixed(0)} ms (${rate(r.ingestMs)} events/s), ` +
+    `deltas ${r.deltaMs.toFixed(0)} ms (${(r.deltaBytes / 1e6).toFixed(1)} MB), ` +
+    `patches ${r.patchMs.toFixed(0)} ms (${(r.patchBytes / 1e6).toFixed(1)} MB${name === 'native' ? ' binary' : ''})`);
+
+report('ts', ts);
+report('native', native);
+console.log(`[tal-bench] speedup ingest ${(ts.ingestMs / native.ingestMs).toFixed(1)}x, ` +
+    `deltas ${(ts.deltaMs / native.deltaMs).toFixed(1)}x, ` +
+    `total ${((ts.ingestMs + ts.deltaMs) / (native.ingestMs + native.deltaMs)).toFixed(1)}x`);
@@ -0,0 +1,158 @@
+/**
+ * Binary TAL wire format decoder
+ *
+ * Decodes application/x-kyntrix-tal bodies sent by agent_core
+ * (runtime/agent/agent_wire.h documents the frame layout) into TAL event
+ * JSON strings, the same form the NDJSON ingest path stores in Redis.
+ */
+
+import zlib from 'node:zlib';
+
+export const TAL_WIRE_CONTENT_TYPE = 'application/x-kyntrix-tal';
+
+const MAGIC = 0x4c41544b; // "KTAL" little-endian
+const VERSION = 1;
+const FLAG_ZSTD = 1;
+
+const MASK_SPAN = 1;
+const MASK_PARENT_SPAN = 2;
+const MASK_NODE_KEY = 4;
+const MASK_RUN_ID = 8;
+const MASK_DATA = 16;
+
+export interface WireEvent {
+    runId: string;
+    // TAL event as JSON text
+    json: string;
+}
+
+export interface WireBatch {
+    events: WireEvent[];
+    // events dropped because their data was not valid JSON
+    rejected: number;
+}
+
+type ZstdDecompress = (buf: Buffer) => Buffer;
+const zstdDecompress: ZstdDecompress | undefined =
+    (zlib as unknown as { zstdDecompressSync?: ZstdDecompress }).zstdDecompressSync;
+
+class Reader {
+    buf: Buffer;
+    pos = 0;
+
+    constructor(buf: Buffer) {
+        this.buf = buf;
+    }
+
+    u8(): number {
+        if (this.pos >= this.buf.length) throw new Error('truncated frame');
+        return this.buf[this.pos++];
+    }
+
+    // Varints above 2^53 are not produced for lengths, counts or deltas in
+    // practice; they lose precision rather than throwing
+    varint(): number {
+        let result = 0;
+        let scale = 1;
+        for (let i = 0; i < 10; i++) {
+            const b = this.u8();
+            result += (b & 0x7f) * scale;
+            if (b < 0x80) return result;
+            scale *= 128;
+        }
+        throw new Error('varint too long');
+    }
+
+    zigzag(): number {
+        const v = this.varint();
+        return v % 2 === 0 ? v / 2 : -(v + 1) / 2;
+    }
+
+    bytes(n: number): Buffer {
+        if (this.pos + n > this.buf.length) throw new Error('truncated frame');
+        const out = this.buf.subarray(this.pos, this.pos + n);
+        this.pos += n;
+        return out;
+    }
+}
+
+function decodePayload(payload: Buffer, out: WireBatch) {
+    const r = new Reader(payload);
+    // Strings are also kept JSON-quoted so each event is assembled by
+    // concatenation
+    const strings: string[] = [];
+    const quoted: string[] = [];
+    const ref = (): number => {
+        const v = r.varint();
+        if (v % 2 === 1) {
+            const s = r.bytes((v - 1) / 2).toString('utf8');
+            strings.push(s);
+            quoted.push(JSON.stringify(s));
+            return strings.length - 1;
+        }
+        if (v / 2 >= strings.length) throw new Error('bad dictionary reference');
+        return v / 2;
+    };
+
+    const frameRun = ref();
+    const count = r.varint();
+    let seq = 0;
+    let ts = 0;
+
+    for (let i = 0; i < count; i++) {
+        const mask = r.u8();
+        seq += r.zigzag();
+        ts += r.zigzag();
+        const kind = quoted[ref()];
+        const span = mask & MASK_SPAN ? quoted[ref()] : undefined;
+        const parentSpan = mask & MASK_PARENT_SPAN ? quoted[ref()] : undefined;
+        const nodeKey = mask & MASK_NODE_KEY ? quoted[ref()] : undefined;
+        const runId = mask & MASK_RUN_ID ? ref() : frameRun;
+        const data = mask & MASK_DATA ? r.bytes(r.varint()).toString('utf8') : undefined;
+
+        // data is the producer's JSON text. It is checked like the NDJSON path
+        // checks whole lines, then spliced in first so that no key inside it
+        // can shadow the fields decoded here
+        if (data !== undefined) {
+            try {
+                JSON.parse(data);
+            } catch {
+                out.rejected += 1;
+                continue;
+            }
+        }
+
+        let json = data !== undefined ? `{"data":${data},` : '{';
+        json += `"runId":${quoted[runId]},"seq":${seq},"ts":${ts},"kind":${kind}`;
+        if (span !== undefined) json += `,"span":${span}`;
+        if (parentSpan !== undefined) json += `,"parentSpan":${parentSpan}`;
+        if (nodeKey !== undefined) json += `,"nodeKey":${nodeKey}`;
+        json += '}';
+
+        out.events.push({ runId: strings[runId], json });
+    }
+}
+
+export function decodeTalWire(body: Buffer): WireBatch {
+    const batch: WireBatch = { events: [], rejected: 0 };
+    const r = new Reader(body);
+
+    while (r.pos < body.length) {
+        if (r.bytes(4).readUInt32LE(0) !== MAGIC) throw new Error('bad frame magic');
+        const version = r.u8();
+        if (version !== VERSION) throw new Error(`unsupported wire version ${version}`);
+        const flags = r.u8();
+        const payloadLen = r.varint();
+        const rawLen = r.varint();
+        let payload = r.bytes(payloadLen);
+
+        if (flags & FLAG_ZSTD) {
+            if (!zstdDecompress) throw new Error('zstd frames need a Node.js build with zlib zstd support');
+            payload = zstdDecompress(payload);
+            if (payload.length !== rawLen) throw new Error('zstd frame size mismatch');
+        }
+
+        decodePayload(payload, batch);
+    }
+    return batch;
+}
@@ -3,6 +3,8 @@ import http from 'http';
 import url from 'url';
 import WebSocket, { WebSocketServer } from 'ws';
 import { Redis } from 'ioredis';
+import { redis, keyframeKey } from '../storage/redis.js';
+import { isGraphPatchBinary } from '../pipeline/graph_patch.js';
 dotenv.config();
 
 const REDIS_URL = process.env.REDIS_URL || 'redis://localhost:6379';
@@ -30,15 +32,18 @@ export const attachWebSocketServer = (server: http.Server) => {
         console.log('[ws-hub] Subscribed to updates:*');
     });
 
-    sub.on('pmessage', (_pattern, channel, message) => {
-        const runIdFromChannel = channel.split(':')[1];
+    // GraphDelta and JSON GraphPatch messages go out as text frames, KTGP
+    // patches as binary frames
+    sub.on('pmessageBuffer', (_pattern: Buffer, channel: Buffer, message: Buffer) => {
+        const runIdFromChannel = channel.toString().split(':')[1];
+        const binary = isGraphPatchBinary(message);
 
         for (const client of clients) {
             if (
                 client.runId === runIdFromChannel &&
                 client.ws.readyState === WebSocket.OPEN
             ) {
-                client.ws.send(message);
+                client.ws.send(message, { binary });
             }
         }
     });
@@ -53,7 +58,17 @@ export const attachWebSocketServer = (server: http.Server) => {
         }
         const client = { ws, runId };
         clients.add(client);
-        
+
+        // Patches only make sense on top of a full graph: start the client
+        // from the run's latest keyframe
+        redis.getBuffer(keyframeKey(runId)).then((keyframe) => {
+            if (keyframe && ws.readyState === WebSocket.OPEN) {
+                ws.send(keyframe, { binary: false });
+            }
+        }).catch((err) => {
+            console.error(`[ws-hub] Failed to load keyframe for run=${runId}`, err);
+        });
+
         ws.on('close', () => {
             clients.delete(client);
 
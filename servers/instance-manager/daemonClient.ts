@@ -11,89 +11,324 @@ if (!SocketPath) {
 // Updated interface to support both file and git modes
 export interface StartInstancePayload {
     runId: string;
-    traceId: string;
     template: "node" | "python";
     entry: string;
     mode: "files" | "git";
     
-    // File mode fields
-    workspacePath?: string;
+    // File mode fields (the daemon snapshots the files itself)
     files?: Record<string, string>;
     
     // Git mode fields
     gitUrl?: string;
     commitSha?: string;
     branch?: string;
+
+    // Daemon-enforced wall-clock limit (SIGTERM, then SIGKILL)
+    timeoutMs?: number;
 }
 
 interface DaemonResponse {
-    status: "ok" | "error";
+    ok: boolean;
     error?: string;
-    cache_hit?: boolean;  // For git mode
+    cache_hit?: boolean;       // Workspace snapshot was already cached
+    queued?: boolean;          // Over capacity; starts when the scheduler admits it
+    workspace_key?: string;    // Snapshot the run was started from
     raw?: string;
     [key: string]: any;
 }
 
-// Updated payload type to include new modes
-type DaemonPayload = 
-    | ({ action: "start" } & StartInstancePayload)
-    | { action: "stop"; runId: string };
+// One entry of a start_many response, in request order
+export interface BatchStartResult {
+    run_id: string;
+    ok: boolean;
+    error?: string;
+    cache_hit?: boolean;
+    workspace_key?: string;
+}
+
+// Wire format expected by kyntrixd (snake_case); see
+// runtime/daemon/control_protocol.h
+type StartWire = {
+    action: "start";
+    run_id: string;
+    template: "node" | "python";
+    entry: string;
+    mode: "files" | "git";
+    timeout_ms?: number;
+    files?: Record<string, string>;
+    git_url?: string;
+    commit_sha?: string;
+    branch?: string;
+};
+
+type DaemonPayload =
+    | StartWire
+    | { action: "start_many"; runs: Omit<StartWire, "action">[] }
+    | { action: "stop"; run_id: string }
+    | { action: "status"; run_id: string }
+    | { action: "subscribe" };
+
+// Pushed by kyntrixd to subscribed connections when a run's container exits
+export interface RunExitEvent {
+    event: "exit";
+    run_id: string;
+    exit_code: number;     // -1 if killed by a signal
+    signal: number;        // 0 if exited normally
+    wall_ms: number;
+    timed_out: boolean;
+    stopped: boolean;
+    not_started: boolean;  // left kyntrixd's scheduler queue without starting
+    usage: {
+        cpu_usec: number;
+        user_usec: number;
+        system_usec: number;
+        memory_peak_bytes: number;
+        io_read_bytes: number;
+        io_write_bytes: number;
+    };
+}
+
+// Frame header shared with kyntrixd: magic, version, type, flags, u32 id,
+// u32 body length, little-endian
+const FRAME_MAGIC = 0xc7;
+const PROTOCOL_VERSION = 1;
+const HEADER_BYTES = 12;
+const FRAME_REQUEST = 1;
+const FRAME_RESPONSE = 2;
+const FRAME_EVENT = 3;
+
+// Slightly more than the execution timeout
+const REQUEST_TIMEOUT_MS = 35000;
+// A git-mode start fetches the commit before answering; the daemon gives
+// up on the fetch after 2 minutes (kGitTimeout, ct_workspace.cpp)
+export const GIT_START_TIMEOUT_MS = 150000;
+const RECONNECT_DELAY_MS = 1000;
+
+interface PendingRequest {
+    resolve: (response: DaemonResponse) => void;
+    reject: (error: Error) => void;
+    timer: NodeJS.Timeout;
+}
 
 /**
- * Send a message to the C++ daemon via Unix socket
+ * One persistent, framed connection to kyntrixd. Requests are pipelined and
+ * matched to their responses by id, so concurrent starts never wait on each
+ * other's round trip. The connection subscribes to exit events before it
+ * carries anything else, so no run started over it can exit unobserved;
+ * after a reconnect, runs still awaited are looked up with status.
  */
-function MessageDaemon(payload: DaemonPayload): Promise<DaemonResponse> { 
-    return new Promise<DaemonResponse>((resolve, reject) => {
+class DaemonConnection {
+    private socket: net.Socket | null = null;
+    private ready: Promise<void> | null = null;
+    private buffer = Buffer.alloc(0);
+    private nextId = 1;
+    private pending = new Map<number, PendingRequest>();
+    private connectedBefore = false;
+    private onEvent: (event: any) => void;
+    private onReconnect: () => void;
+
+    constructor(onEvent: (event: any) => void, onReconnect: () => void) {
+        this.onEvent = onEvent;
+        this.onReconnect = onReconnect;
+    }
+
+    async request(payload: DaemonPayload, timeoutMs = REQUEST_TIMEOUT_MS): Promise<DaemonResponse> {
+        await this.connect();
+        return this.send(payload, timeoutMs);
+    }
+
+    connect(): Promise<void> {
+        if (this.ready) return this.ready;
+
         const socket = net.createConnection({ path: SocketPath });
-        
-        // Set timeout to prevent hanging
-        socket.setTimeout(35000); // 35 seconds (slightly more than execution timeout)
-        
-        socket.on("connect", () => {
-            const json = JSON.stringify(payload);
-            console.log(`[DaemonClient] Sending to daemon:`, json);
-            socket.write(json);
-            socket.end();
-        });
+        this.socket = socket;
+        this.buffer = Buffer.alloc(0);
 
-        let responseBuffer = "";
-        
-        socket.on("data", (data) => {
-            responseBuffer += data.toString();
+        this.ready = new Promise<void>((resolve, reject) => {
+            socket.on("connect", () => {
+                this.send({ action: "subscribe" }).then(() => {
+                    resolve();
+                    if (this.connectedBefore) this.onReconnect();
+                    this.connectedBefore = true;
+                }, reject);
+            });
+            socket.on("data", (data) => this.onData(data));
+            socket.on("error", (error) => {
+                console.error("[DaemonClient] Socket error:", error);
+                reject(error);
+            });
+            socket.on("close", () => this.onClose(socket));
         });
+        this.ready.catch(() => {});
 
-        socket.on("timeout", () => {
-            socket.destroy();
-            reject(new Error("Daemon communication timeout"));
-        });
+        return this.ready;
+    }
+
+    private send(payload: DaemonPayload, timeoutMs = REQUEST_TIMEOUT_MS): Promise<DaemonResponse> {
+        const socket = this.socket;
+        if (!socket) return Promise.reject(new Error("Daemon connection closed"));
+
+        const id = this.nextId;
+        this.nextId = this.nextId >= 0xffffffff ? 1 : this.nextId + 1;
 
-        socket.on("error", (error) => {
-            console.error("[DaemonClient] Socket error:", error);
-            reject(error);
+        const body = Buffer.from(JSON.stringify(payload));
+        const header = Buffer.alloc(HEADER_BYTES);
+        header.writeUInt8(FRAME_MAGIC, 0);
+        header.writeUInt8(PROTOCOL_VERSION, 1);
+        header.writeUInt8(FRAME_REQUEST, 2);
+        header.writeUInt32LE(id, 4);
+        header.writeUInt32LE(body.length, 8);
+
+        return new Promise<DaemonResponse>((resolve, reject) => {
+            const timer = setTimeout(() => {
+                this.pending.delete(id);
+                reject(new Error("Daemon communication timeout"));
+            }, timeoutMs);
+
+            this.pending.set(id, { resolve, reject, timer });
+            socket.write(Buffer.concat([header, body]));
         });
+    }
 
-        socket.on("end", () => {
+    private onData(data: Buffer): void {
+        this.buffer = this.buffer.length ? Buffer.concat([this.buffer, data]) : data;
+
+        while (this.buffer.length >= HEADER_BYTES) {
+            // Out of sync with the framing; nothing after this can be trusted
+            if (this.buffer.readUInt8(0) !== FRAME_MAGIC || this.buffer.readUInt8(1) !== PROTOCOL_VERSION) {
+                console.error("[DaemonClient] Bad frame header from daemon; reconnecting");
+                this.buffer = Buffer.alloc(0);
+                this.socket?.destroy();
+                return;
+            }
+
+            const length = this.buffer.readUInt32LE(8);
+            if (this.buffer.length < HEADER_BYTES + length) break;
+
+            const type = this.buffer.readUInt8(2);
+            const id = this.buffer.readUInt32LE(4);
+            const body = this.buffer.subarray(HEADER_BYTES, HEADER_BYTES + length).toString();
+            this.buffer = this.buffer.subarray(HEADER_BYTES + length);
+
+            let msg: any;
             try {
-                if (!responseBuffer) {
-                    // Empty response = success
-                    return resolve({ status: "ok" } as DaemonResponse);
-                }
-
-                const response = JSON.parse(responseBuffer);
-                console.log(`[DaemonClient] Received from daemon:`, response);
-                
-                if (response.error) {
-                    reject(new Error(response.error));
-                } else {
-                    resolve(response as DaemonResponse);
-                }
-            } catch (e) {
-                // Fallback for non-JSON response
-                console.warn("[DaemonClient] Non-JSON response:", responseBuffer);
-                resolve({ status: "ok", raw: responseBuffer });
+                msg = JSON.parse(body);
+            } catch {
+                console.warn("[DaemonClient] Non-JSON frame from daemon:", body);
+                continue;
             }
-        });
-    });
+
+            if (type === FRAME_EVENT) {
+                this.onEvent(msg);
+            } else if (type === FRAME_RESPONSE) {
+                this.settle(id, msg);
+            }
+        }
+    }
+
+    private settle(id: number, response: any): void {
+        const req = this.pending.get(id);
+        if (!req) return;   // timed out already
+
+        this.pending.delete(id);
+        clearTimeout(req.timer);
+        // A start_many answers ok: false when any run failed; its results
+        // carry the per-run outcome, so only single requests reject on it
+        if (response.error || (response.ok === false && !Array.isArray(response.results))) {
+            req.reject(new Error(response.error ?? "Daemon request failed"));
+        } else {
+            req.resolve(response as DaemonResponse);
+        }
+    }
+
+    private onClose(socket: net.Socket): void {
+        if (this.socket !== socket) return;
+        this.socket = null;
+        this.ready = null;
+
+        for (const [id, req] of this.pending) {
+            clearTimeout(req.timer);
+            req.reject(new Error("Daemon connection closed"));
+            this.pending.delete(id);
+        }
+
+        // Keep the exit subscription alive while runs are awaited
+        if (exitWaiters.size > 0) {
+            setTimeout(() => this.connect().catch(() => {}), RECONNECT_DELAY_MS);
+        }
+    }
+}
+
+const exitWaiters = new Map<string, (ev: RunExitEvent) => void>();
+
+function deliverExit(ev: RunExitEvent): void {
+    const waiter = exitWaiters.get(ev.run_id);
+    if (waiter) {
+        exitWaiters.delete(ev.run_id);
+        waiter(ev);
+    }
+}
+
+// Exit events sent while the connection was down are lost; ask about each
+// awaited run instead
+async function recheckWaiters(): Promise<void> {
+    await Promise.all([...exitWaiters.keys()].map(async (runId) => {
+        let st: DaemonResponse;
+        try {
+            st = await daemon.request({ action: "status", run_id: runId });
+        } catch {
+            return;     // not known to the daemon; the waiter's timeout decides
+        }
+        if (st.state === "exited") {
+            const { ok, state, ...exit } = st;
+            deliverExit({ ...exit, event: "exit", run_id: runId } as RunExitEvent);
+        }
+    }));
+}
+
+const daemon = new DaemonConnection((msg) => {
+    if (msg.event === "exit") deliverExit(msg as RunExitEvent);
+}, () => {
+    recheckWaiters().catch((error) => console.error("[DaemonClient] Exit recheck failed:", error));
+});
+
+function validateStart(req: StartInstancePayload): void {
+    if (req.mode === "git") {
+        if (!req.gitUrl || !req.commitSha) {
+            throw new Error("Git mode requires gitUrl and commitSha");
+        }
+    } else if (req.mode === "files") {
+        if (!req.files) {
+            throw new Error("File mode requires files");
+        }
+    }
+}
+
+function startWire(req: StartInstancePayload): StartWire {
+    return {
+        action: "start",
+        run_id: req.runId,
+        template: req.template,
+        entry: req.entry,
+        mode: req.mode,
+        timeout_ms: req.timeoutMs,
+
+        // Include mode-specific fields
+        ...(req.mode === "git"
+            ? {
+                git_url: req.gitUrl,
+                commit_sha: req.commitSha,
+                branch: req.branch
+            }
+            : {
+                files: req.files
+            }
+        )
+    };
+}
+
+function startTimeout(reqs: StartInstancePayload[]): number {
+    return reqs.some((req) => req.mode === "git") ? GIT_START_TIMEOUT_MS : REQUEST_TIMEOUT_MS;
 }
 
 /**
@@ -102,43 +337,29 @@ function MessageDaemon(payload: DaemonPayload): Promise<DaemonResponse> {
  */
 export async function startInstance(req: StartInstancePayload): Promise<DaemonResponse> {
     try {
-        // Validate based on mode
-        if (req.mode === "git") {
-            if (!req.gitUrl || !req.commitSha) {
-                throw new Error("Git mode requires gitUrl and commitSha");
-            }
-        } else if (req.mode === "files") {
-            if (!req.workspacePath) {
-                throw new Error("File mode requires workspacePath");
-            }
-        }
+        validateStart(req);
+        return await daemon.request(startWire(req), startTimeout([req]));
+    } catch (error) {
+        console.error("[DaemonClient] Start instance failed:", error);
+        throw error;
+    }
+}
 
-        const response = await MessageDaemon({
-            action: "start",
-            runId: req.runId,
-            traceId: req.traceId,
-            template: req.template,
-            entry: req.entry,
-            mode: req.mode,
-            
-            // Include mode-specific fields
-            ...(req.mode === "git" 
-                ? {
-                    gitUrl: req.gitUrl,
-                    commitSha: req.commitSha,
-                    branch: req.branch
-                }
-                : {
-                    workspacePath: req.workspacePath,
-                    files: req.files
-                }
-            )
+/**
+ * Start several runs in one request; the daemon starts them in parallel and
+ * answers once with a result per run. A failed run does not fail the batch.
+ */
+export async function startMany(reqs: StartInstancePayload[]): Promise<BatchStartResult[]> {
+    try {
+        reqs.forEach(validateStart);
+        const runs = reqs.map((req) => {
+            const { action, ...run } = startWire(req);
+            return run;
         });
-
-        return response;
-        
+        const response = await daemon.request({ action: "start_many", runs }, startTimeout(reqs));
+        return response.results as BatchStartResult[];
     } catch (error) {
-        console.error("[DaemonClient] Start instance failed:", error);
+        console.error("[DaemonClient] Batch start failed:", error);
         throw error;
     }
 }
@@ -148,18 +369,48 @@ export async function startInstance(req: StartInstancePayload): Promise<DaemonRe
  */
 export async function stopInstance(runId: string): Promise<DaemonResponse> {
     try {
-        const response = await MessageDaemon({
+        return await daemon.request({
             action: "stop",
-            runId: runId,
+            run_id: runId,
         });
-
-        return response;
-        
     } catch (error) {
         console.error("[DaemonClient] Stop instance failed:", error);
         throw error;
     }
 }
 
+/**
+ * Registers interest in runId's exit. Resolves once the subscription is
+ * live, so awaiting it before startInstance guarantees a fast run cannot
+ * finish unobserved; `exited` resolves when the daemon reaps the container.
+ */
+export async function watchExit(runId: string, timeoutMs: number):
+        Promise<{ exited: Promise<RunExitEvent>; cancel: () => void }> {
+    await daemon.connect();
+
+    let timer: NodeJS.Timeout | undefined;
+    const exited = new Promise<RunExitEvent>((resolve, reject) => {
+        timer = setTimeout(() => {
+            exitWaiters.delete(runId);
+            reject(new Error(`Execution timed out after ${timeoutMs / 1000}s`));
+        }, timeoutMs);
+
+        exitWaiters.set(runId, (ev) => {
+            clearTimeout(timer);
+            resolve(ev);
+        });
+    });
+
+    // Surfaced by the caller; avoid an unhandled rejection if it never awaits
+    exited.catch(() => {});
+
+    // For a run that failed to start: no exit event will come
+    const cancel = () => {
+        clearTimeout(timer);
+        exitWaiters.delete(runId);
+    };
+    return { exited, cancel };
+}
+
 // Export types for use in other files
 export type { DaemonResponse, DaemonPayload };
\ No newline at end of file
@@ -1,37 +1,20 @@
 import { Router } from "express";
-import { startInstance, stopInstance } from "./daemonClient";
+import { GIT_START_TIMEOUT_MS, startInstance, stopInstance, watchExit } from "./daemonClient";
 import { randomUUID } from "crypto";
-import fs from "fs";
-import path from "path";
-import { Redis } from "ioredis";
-import { redis, REDIS_URL } from "../agents/storage/redis";
+import { redis } from "../agents/storage/redis";
 
 export const runsRouter = Router();
 
-const redisSubscriber = new Redis(REDIS_URL, {lazyConnect: true})
+// The daemon kills runs at RUN_TIMEOUT_MS; the extra slack covers the
+// SIGTERM -> SIGKILL grace period and reaping. A run over the daemon's
+// capacity may first wait up to SCHED_QUEUE_TIMEOUT_MS to be admitted
+// (KYNTRIXD_SCHED_QUEUE_TIMEOUT_MS), and a git-mode run up to
+// GIT_START_TIMEOUT_MS for its commit to be fetched
+const RUN_TIMEOUT_MS = 30000;
+const SCHED_QUEUE_TIMEOUT_MS = 60000;
+const EXIT_WAIT_SLACK_MS = 10000;
 
 
-/**
- * Write files to disk (for file-upload mode)
- */
-function writeFilesToDisk(workspacePath: string, files: Record<string, string>) {
-    if (!fs.existsSync(workspacePath)) {
-        fs.mkdirSync(workspacePath, { recursive: true });
-    }
-    
-    for (const [filePath, fileContent] of Object.entries(files)) {
-        const fullPath = path.join(workspacePath, filePath);
-        const dir = path.dirname(fullPath);
-        
-        // Create nested directories if needed
-        if (!fs.existsSync(dir)) {
-            fs.mkdirSync(dir, { recursive: true });
-        }
-        
-        fs.writeFileSync(fullPath, fileContent, 'utf-8');
-    }
-}
-
 /**
  * Main execution endpoint
  * Handles both file-upload  and git-based 
@@ -50,7 +33,6 @@ runsRouter.post("/start", async (req, res) => {
         } = req.body ?? {};
 
         const runId = randomUUID();
-        const traceId = `trace_${runId}`;
 
         // Validation based on execution mode
         if (execution_mode === "git") {
@@ -60,6 +42,11 @@ runsRouter.post("/start", async (req, res) => {
                     error: "Missing required fields for git mode: git_url, commit_sha, entry_point"
                 });
             }
+            if (!/^([0-9a-f]{40}|[0-9a-f]{64})$/.test(commit_sha)) {
+                return res.status(400).json({
+                    error: "commit_sha must be a full 40 or 64 hex digit commit id"
+                });
+            }
         } else {
             // File upload mode validation (default)
             if (!files || !entry_point) {
@@ -69,103 +56,87 @@ runsRouter.post("/start", async (req, res) => {
             }
         }
 
-        // Setup workspace
-        let workspacePath: string;
-        let cacheHit = false;
-
-        if (execution_mode === "git") {
-            // Git mode: workspace will be managed by daemon's GitManager
-            // Just pass the git info, daemon will handle cloning/caching
-            workspacePath = `/cache/repos/${commit_sha.slice(0, 8)}`;
-            
-            // Note: In real implementation, daemon will return cache_hit status
-            // For now, we'll check if the path exists (simplified)
-            cacheHit = fs.existsSync(workspacePath);
-            
-        } else {
-            // File upload mode: write files to temporary workspace
-            workspacePath = `/tmp/kyntrix/${runId}`;
-            writeFilesToDisk(workspacePath, files);
-        }
-
-        // Setup Redis subscription for completion notification
-        const channel = `run:${runId}:complete`;
-        
-        const completionPromise = new Promise((resolve, reject) => {
-            // Safety timeout
-            const timeout = setTimeout(() => {
-                redisSubscriber.off('message', onMessage);
-                redisSubscriber.unsubscribe(channel).catch(() => {});
-                reject(new Error("Execution timed out after 30s"));
-            }, 30000);
-
-            const onMessage = (receivedChannel: string, message: string) => {
-                if (receivedChannel !== channel) return;
-                clearTimeout(timeout);
-                redisSubscriber.off('message', onMessage);
-                redisSubscriber.unsubscribe(channel).catch(() => {});
-                try {
-                    const result = JSON.parse(message);
-                    resolve(result);
-                } catch (err) {
-                    reject(new Error("Failed to parse completion message"));
-                }
-            };
+        // Workspace setup (git clone / file upload) happens in the daemon,
+        // which snapshots and caches it per commit or per file bundle
 
-            redisSubscriber.on('message', onMessage);
-            redisSubscriber.subscribe(channel).catch((err) => {
-                clearTimeout(timeout);
-                redisSubscriber.off('message', onMessage);
-                reject(err);
-            });
-        });
+        // The daemon reaps the container and pushes its exit status
+        const { exited, cancel } = await watchExit(runId,
+            RUN_TIMEOUT_MS + SCHED_QUEUE_TIMEOUT_MS + EXIT_WAIT_SLACK_MS +
+            (execution_mode === "git" ? GIT_START_TIMEOUT_MS : 0));
 
         // Prepare payload for daemon
         const payload = {
             runId,
-            traceId,
             template: (language || "python") as "node" | "python",
             entry: entry_point,
-            
+            timeoutMs: RUN_TIMEOUT_MS,
+
             // Mode-specific fields
             ...(execution_mode === "git" 
                 ? {
                     mode: "git" as const,
                     gitUrl: git_url,
                     commitSha: commit_sha,
-                    branch: branch,
-                    workspacePath: workspacePath
+                    branch: branch
                 }
                 : {
                     mode: "files" as const,
-                    workspacePath: workspacePath,
                     files: files
                 }
             )
         };
 
         // Start execution via daemon
-        const daemonResponse = await startInstance(payload);
-        
-        if (!daemonResponse) {
+        let daemonResponse;
+        try {
+            daemonResponse = await startInstance(payload);
+        } catch (err) {
+            // A run that failed to start sends no exit event
+            cancel();
             return res.status(500).json({
-                error: "Failed to start instance in daemon"
+                error: err instanceof Error ? err.message : "Failed to start instance in daemon"
             });
         }
 
-        // Wait for execution to complete and get trace
-        const executionResult = await completionPromise;
+        if (!daemonResponse.ok) {
+            cancel();
+            return res.status(500).json({
+                error: daemonResponse.error ?? "Failed to start instance in daemon"
+            });
+        }
+
+        // Wait for the container to exit
+        const exit = await exited;
+
+        let error: string | undefined;
+        if (exit.not_started) {
+            if (exit.timed_out) {
+                error = "Daemon at capacity; the run was not admitted in time";
+            } else if (exit.stopped) {
+                error = "Stopped before it started";
+            } else {
+                error = "Run failed to start";
+            }
+        } else if (exit.timed_out) {
+            error = `Execution timed out after ${RUN_TIMEOUT_MS / 1000}s`;
+        } else if (exit.signal) {
+            error = `Killed by signal ${exit.signal}`;
+        } else if (exit.exit_code !== 0) {
+            error = `Exited with code ${exit.exit_code}`;
+        }
 
         // Build response in format CLI expects
-        const result = executionResult as Record<string, any>;
         const response = {
             runId: runId,
-            status: result.status || "success",
-            output: result.output || "",
-            error: result.error,
-            timeline: result.timeline || [],
+            status: error ? "error" : "success",
+            output: "",
+            error,
+            exit_code: exit.exit_code,
+            duration_ms: exit.wall_ms,
+            usage: exit.usage,
+            timeline: [],
             trace_url: `http://localhost:3000/trace/${runId}`,
-            cache_hit: cacheHit
+            cache_hit: daemonResponse.cache_hit ?? false
         };
 
         return res.status(200).json(response);